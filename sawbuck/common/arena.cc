@@ -0,0 +1,97 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Arena allocator implementation.
+#include "sawbuck/common/arena.h"
+
+#include <malloc.h>
+#include <string.h>
+#include "base/logging.h"
+
+namespace {
+
+// The alignment of the chunks we allocate.
+const size_t kMaxAlignment = 16;
+
+char* AlignUp(char* ptr, size_t alignment) {
+  uintptr_t value = reinterpret_cast<uintptr_t>(ptr);
+  value = (value + alignment - 1) & ~(alignment - 1);
+  return reinterpret_cast<char*>(value);
+}
+
+}  // namespace
+
+Arena::Arena(size_t chunk_size)
+    : chunk_size_(chunk_size), next_(NULL), end_(NULL), bytes_allocated_(0),
+      bytes_reserved_(0) {
+  DCHECK_LE(kMaxAlignment, chunk_size);
+}
+
+Arena::~Arena() {
+  Clear();
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+  DCHECK_NE(0U, alignment);
+  DCHECK_EQ(0U, alignment & (alignment - 1));
+  DCHECK_GE(kMaxAlignment, alignment);
+  if (size == 0)
+    return NULL;
+
+  bytes_allocated_ += size;
+
+  // Large allocations get their own chunk, so as not to waste the
+  // remainder of the current one.
+  if (size > chunk_size_ / 4)
+    return AllocateChunk(size);
+
+  char* ptr = AlignUp(next_, alignment);
+  if (next_ == NULL || ptr + size > end_) {
+    next_ = AllocateChunk(chunk_size_);
+    end_ = next_ + chunk_size_;
+    ptr = next_;
+  }
+
+  next_ = ptr + size;
+  return ptr;
+}
+
+void* Arena::Copy(const void* data, size_t size, size_t alignment) {
+  void* copy = Allocate(size, alignment);
+  if (copy != NULL)
+    memcpy(copy, data, size);
+
+  return copy;
+}
+
+void Arena::Clear() {
+  for (size_t i = 0; i < chunks_.size(); ++i)
+    _aligned_free(chunks_[i]);
+
+  chunks_.clear();
+  next_ = NULL;
+  end_ = NULL;
+  bytes_allocated_ = 0;
+  bytes_reserved_ = 0;
+}
+
+char* Arena::AllocateChunk(size_t size) {
+  char* chunk = static_cast<char*>(_aligned_malloc(size, kMaxAlignment));
+  CHECK(chunk != NULL) << "Out of memory allocating " << size << " bytes.";
+
+  chunks_.push_back(chunk);
+  bytes_reserved_ += size;
+
+  return chunk;
+}
@@ -0,0 +1,74 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A bump-pointer arena allocator.
+#ifndef SAWBUCK_COMMON_ARENA_H_
+#define SAWBUCK_COMMON_ARENA_H_
+
+#include <vector>
+#include "base/basictypes.h"
+
+// Hands out memory from large chunks, which are only freed all at once.
+// Allocations never move, so pointers into the arena stay valid until
+// the arena is cleared or destroyed.
+class Arena {
+ public:
+  static const size_t kDefaultChunkSize = 1024 * 1024;
+
+  // @param chunk_size the size of the chunks we allocate. Allocations
+  //     larger than a quarter of this get a chunk of their own.
+  explicit Arena(size_t chunk_size = kDefaultChunkSize);
+  ~Arena();
+
+  // Allocates @p size bytes aligned to @p alignment.
+  // @param alignment must be a power of two, no larger than 16.
+  // @returns the allocation, or NULL if @p size is zero.
+  void* Allocate(size_t size, size_t alignment);
+
+  // Copies @p size bytes at @p data to the arena.
+  // @returns the copy, or NULL if @p size is zero.
+  void* Copy(const void* data, size_t size, size_t alignment);
+
+  // Copies the string @p str of length @p len to the arena.
+  // @returns the copy, or NULL if @p len is zero.
+  const char* CopyString(const char* str, size_t len) {
+    return static_cast<const char*>(Copy(str, len, 1));
+  }
+
+  // Frees all allocations.
+  void Clear();
+
+  // @returns the number of bytes handed out.
+  size_t bytes_allocated() const { return bytes_allocated_; }
+  // @returns the number of bytes reserved in chunks.
+  size_t bytes_reserved() const { return bytes_reserved_; }
+
+ private:
+  // Allocates a new chunk of @p size bytes.
+  char* AllocateChunk(size_t size);
+
+  const size_t chunk_size_;
+  std::vector<char*> chunks_;
+
+  // The unused part of the current chunk.
+  char* next_;
+  char* end_;
+
+  size_t bytes_allocated_;
+  size_t bytes_reserved_;
+
+  DISALLOW_COPY_AND_ASSIGN(Arena);
+};
+
+#endif  // SAWBUCK_COMMON_ARENA_H_
@@ -0,0 +1,93 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/common/arena.h"
+
+#include <string.h>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+
+bool IsAligned(const void* ptr, size_t alignment) {
+  return (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)) == 0;
+}
+
+TEST(ArenaTest, ZeroSizeAllocationsAreNull) {
+  Arena arena(256);
+
+  EXPECT_TRUE(arena.Allocate(0, 1) == NULL);
+  EXPECT_TRUE(arena.CopyString("", 0) == NULL);
+  EXPECT_EQ(0U, arena.bytes_allocated());
+  EXPECT_EQ(0U, arena.bytes_reserved());
+}
+
+TEST(ArenaTest, AllocationsAreAligned) {
+  Arena arena(256);
+
+  for (size_t alignment = 1; alignment <= 16; alignment *= 2) {
+    arena.Allocate(1, 1);
+    void* ptr = arena.Allocate(3, alignment);
+    ASSERT_TRUE(ptr != NULL);
+    EXPECT_TRUE(IsAligned(ptr, alignment));
+  }
+}
+
+TEST(ArenaTest, CopiesAreStable) {
+  Arena arena(256);
+
+  // Enough strings to span several chunks.
+  const char kText[] = "The quick brown fox";
+  std::vector<const char*> copies;
+  for (size_t i = 0; i < 100; ++i) {
+    const char* copy = arena.CopyString(kText, sizeof(kText));
+    ASSERT_TRUE(copy != NULL);
+    copies.push_back(copy);
+  }
+
+  for (size_t i = 0; i < copies.size(); ++i)
+    EXPECT_STREQ(kText, copies[i]);
+
+  EXPECT_EQ(100 * sizeof(kText), arena.bytes_allocated());
+  EXPECT_LE(arena.bytes_allocated(), arena.bytes_reserved());
+}
+
+TEST(ArenaTest, LargeAllocationsGetOwnChunk) {
+  Arena arena(256);
+
+  void* small = arena.Allocate(16, 8);
+  size_t reserved = arena.bytes_reserved();
+
+  // This doesn't disturb the current chunk.
+  char* large = static_cast<char*>(arena.Allocate(1000, 8));
+  ASSERT_TRUE(large != NULL);
+  memset(large, 0xCC, 1000);
+  EXPECT_EQ(reserved + 1000, arena.bytes_reserved());
+
+  char* next = static_cast<char*>(arena.Allocate(16, 8));
+  EXPECT_EQ(static_cast<char*>(small) + 16, next);
+}
+
+TEST(ArenaTest, Clear) {
+  Arena arena(256);
+
+  arena.Allocate(100, 1);
+  arena.Allocate(1000, 1);
+  arena.Clear();
+
+  EXPECT_EQ(0U, arena.bytes_allocated());
+  EXPECT_EQ(0U, arena.bytes_reserved());
+  EXPECT_TRUE(arena.Allocate(10, 1) != NULL);
+}
+
+}  // namespace
@@ -13,10 +13,59 @@
 // limitations under the License.
 #include "sawbuck/common/buffer_parser.h"
 
+#include <emmintrin.h>
+#include <intrin.h>
 #include "base/logging.h"
 
 namespace {
 
+const size_t kBlockSize = sizeof(__m128i);
+
+// @returns a bit mask of the bytes of the zero characters in the block
+//     at @p block.
+int ZeroMask(const char* block) {
+  __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(data, _mm_setzero_si128()));
+}
+
+int ZeroMask(const wchar_t* block) {
+  COMPILE_ASSERT(sizeof(wchar_t) == 2, wchar_t_is_two_bytes);
+  __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+  return _mm_movemask_epi8(_mm_cmpeq_epi16(data, _mm_setzero_si128()));
+}
+
+// Finds the first zero character in [@p str, @p str + @p num_chars) a
+// block at a time. The final block is loaded to end flush with the range,
+// overlapping the one before, so that no load strays outside the range.
+// @returns the index of the zero, or @p num_chars if there is none.
+template <class CharType>
+size_t FindTerminator(const CharType* str, size_t num_chars) {
+  const size_t kBlockChars = kBlockSize / sizeof(CharType);
+  if (num_chars < kBlockChars) {
+    for (size_t i = 0; i < num_chars; ++i) {
+      if (str[i] == 0)
+        return i;
+    }
+    return num_chars;
+  }
+
+  size_t i = 0;
+  while (true) {
+    int mask = ZeroMask(str + i);
+    if (mask != 0) {
+      unsigned long index = 0;
+      _BitScanForward(&index, mask);
+      return i + index / sizeof(CharType);
+    }
+
+    if (i + kBlockChars == num_chars)
+      return num_chars;
+    i += kBlockChars;
+    if (i + kBlockChars > num_chars)
+      i = num_chars - kBlockChars;
+  }
+}
+
 template <class CharType>
 bool GetStringAtImpl(BinaryBufferParser* parser, size_t pos,
     const CharType** ptr, size_t* len) {
@@ -26,15 +75,13 @@ bool GetStringAtImpl(BinaryBufferParser* parser, size_t pos,
     return false;
 
   size_t num_chars = (parser->data_len() - pos) / sizeof(*start);
-  for (size_t strlen = 0; strlen < num_chars; ++strlen) {
-    if (start[strlen] == '\0') {
-      *len = strlen;
-      *ptr = start;
-      return true;
-    }
-  }
+  size_t strlen = FindTerminator(start, num_chars);
+  if (strlen == num_chars)
+    return false;
 
-  return false;
+  *len = strlen;
+  *ptr = start;
+  return true;
 }
 
 }  // namespace
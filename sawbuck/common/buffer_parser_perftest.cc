@@ -0,0 +1,96 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Measures the string reading throughput of BinaryBufferReader.
+#include "sawbuck/common/buffer_parser.h"
+
+#include <string>
+#include <vector>
+#include "base/basictypes.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/perf_time_logger.h"
+#include "gtest/gtest.h"
+#include "sawbuck/common/test_random.h"
+
+namespace {
+
+using testing::Random;
+
+// Roughly 4 MB of strings, read this many times per measurement.
+const size_t kBufferBytes = 4 * 1024 * 1024;
+const size_t kNumPasses = 10;
+
+// Fills a buffer with back to back strings of lengths uniformly
+// distributed in [@p min_len, @p max_len], roughly kBufferBytes worth.
+template <class CharType>
+void MakeStrings(size_t min_len,
+                 size_t max_len,
+                 std::vector<CharType>* buf,
+                 size_t* num_strings) {
+  const size_t kBufferChars = kBufferBytes / sizeof(CharType);
+  Random random(42);
+  buf->clear();
+  *num_strings = 0;
+  while (buf->size() < kBufferChars) {
+    size_t len = min_len + random.Next(max_len - min_len + 1);
+    buf->insert(buf->end(), len, 'x');
+    buf->push_back('\0');
+    ++(*num_strings);
+  }
+}
+
+template <class CharType>
+void MeasureReadStrings(const char* name, size_t min_len, size_t max_len) {
+  std::vector<CharType> buf;
+  size_t num_strings = 0;
+  MakeStrings(min_len, max_len, &buf, &num_strings);
+
+  size_t total_len = 0;
+  std::string timer_name = base::StringPrintf("read_string_%s", name);
+  base::PerfTimeLogger timer(timer_name.c_str());
+  for (size_t pass = 0; pass < kNumPasses; ++pass) {
+    BinaryBufferReader reader(&buf[0], buf.size() * sizeof(buf[0]));
+    const CharType* str = NULL;
+    size_t str_len = 0;
+    while (reader.ReadString(&str, &str_len))
+      total_len += str_len;
+  }
+  timer.Done();
+
+  EXPECT_EQ(kNumPasses * (buf.size() - num_strings), total_len);
+}
+
+// The string lengths typical of log messages, file names, image names
+// and command lines.
+TEST(BinaryBufferReaderPerfTest, ReadFileNames) {
+  MeasureReadStrings<char>("file_names", 8, 40);
+}
+
+TEST(BinaryBufferReaderPerfTest, ReadLogMessages) {
+  MeasureReadStrings<char>("log_messages", 20, 300);
+}
+
+TEST(BinaryBufferReaderPerfTest, ReadProcessImageNames) {
+  MeasureReadStrings<char>("process_image_names", 6, 20);
+}
+
+TEST(BinaryBufferReaderPerfTest, ReadModulePaths) {
+  MeasureReadStrings<wchar_t>("module_paths", 30, 120);
+}
+
+TEST(BinaryBufferReaderPerfTest, ReadCommandLines) {
+  MeasureReadStrings<wchar_t>("command_lines", 20, 600);
+}
+
+}  // namespace
@@ -12,6 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include "sawbuck/common/buffer_parser.h"
+
+#include <string.h>
+#include <vector>
 #include "gtest/gtest.h"
 
 namespace {
@@ -113,6 +116,55 @@ TEST(BinaryBufferParser, GetStringAtWideSucceeds) {
   TestGetStringAt<wchar_t>();
 }
 
+// Writes a string of @p str_len characters at byte @p offset of @p buf,
+// which is filled with non-zero characters.
+template <class CharType>
+void PutString(size_t offset, size_t str_len, std::vector<char>* buf) {
+  std::vector<CharType> str(str_len + 1, 'x');
+  str[str_len] = '\0';
+  memset(&buf->at(0), 'x', buf->size());
+  memcpy(&buf->at(offset), &str[0], str.size() * sizeof(str[0]));
+}
+
+template <class CharType>
+void TestGetStringAtAlignment() {
+  // Strings of up to a few blocks of SIMD width long, at every byte
+  // alignment, ending at, before and after the end of the buffer.
+  const size_t kMaxOffset = 32;
+  const size_t kMaxLen = 48;
+  std::vector<char> buf(kMaxOffset + (kMaxLen + 8) * sizeof(CharType));
+  for (size_t offset = 0; offset < kMaxOffset; ++offset) {
+    for (size_t str_len = 0; str_len <= kMaxLen; ++str_len) {
+      PutString<CharType>(offset, str_len, &buf);
+      size_t str_end = offset + (str_len + 1) * sizeof(CharType);
+
+      const CharType* str = NULL;
+      size_t len = 0;
+      BinaryBufferParser flush_parser(&buf[0], str_end);
+      ASSERT_TRUE(flush_parser.GetStringAt(offset, &str, &len));
+      EXPECT_EQ(reinterpret_cast<const CharType*>(&buf[offset]), str);
+      EXPECT_EQ(str_len, len);
+
+      BinaryBufferParser long_parser(&buf[0], buf.size());
+      ASSERT_TRUE(long_parser.GetStringAt(offset, &str, &len));
+      EXPECT_EQ(str_len, len);
+
+      // The terminator lies just past the end of the buffer.
+      BinaryBufferParser short_parser(&buf[0], str_end - 1);
+      EXPECT_FALSE(short_parser.GetStringAt(offset, &str, &len))
+          << "offset " << offset << ", length " << str_len;
+    }
+  }
+}
+
+TEST(BinaryBufferParser, GetStringAtAlignment) {
+  TestGetStringAtAlignment<char>();
+}
+
+TEST(BinaryBufferParser, GetStringAtWideAlignment) {
+  TestGetStringAtAlignment<wchar_t>();
+}
+
 TEST(BinaryBufferReader, IsAligned) {
   BinaryBufferReader reader(kDataBuffer, kDataBufferSize);
 
@@ -218,4 +270,37 @@ TEST(BinaryBufferReader, ReadWideString) {
   ASSERT_FALSE(reader.ReadString(&str, &str_len));
 }
 
+template <class CharType>
+void TestReadStrings() {
+  // Back to back strings of growing length, straddling block boundaries.
+  const size_t kNumStrings = 40;
+  std::vector<CharType> buf;
+  for (size_t i = 0; i < kNumStrings; ++i) {
+    buf.insert(buf.end(), i, 'x');
+    buf.push_back('\0');
+  }
+  buf.push_back('x');
+
+  BinaryBufferReader reader(&buf[0], buf.size() * sizeof(buf[0]));
+  for (size_t i = 0; i < kNumStrings; ++i) {
+    const CharType* str = NULL;
+    size_t str_len = 0;
+    ASSERT_TRUE(reader.ReadString(&str, &str_len));
+    EXPECT_EQ(i, str_len);
+  }
+
+  const CharType* str = NULL;
+  size_t str_len = 0;
+  EXPECT_FALSE(reader.ReadString(&str, &str_len));
+  EXPECT_EQ(sizeof(buf[0]), reader.RemainingBytes());
+}
+
+TEST(BinaryBufferReader, ReadCharStrings) {
+  TestReadStrings<char>();
+}
+
+TEST(BinaryBufferReader, ReadWideStrings) {
+  TestReadStrings<wchar_t>();
+}
+
 }  // namespace
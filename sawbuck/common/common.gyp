@@ -67,21 +67,46 @@
         '<(DEPTH)/testing/gmock.gyp:gmock',
       ],
       'sources': [
+        'arena.cc',
+        'arena.h',
         'buffer_parser.cc',
         'buffer_parser.h',
         'com_utils.cc',
         'com_utils.h',
         'initializing_coclass.h',
+        'row_bitmap.cc',
+        'row_bitmap.h',
+        'spsc_ring.h',
+        'string_table.cc',
+        'string_table.h',
+        'trace_table.cc',
+        'trace_table.h',
+        'trigram_index.cc',
+        'trigram_index.h',
+      ],
+    },
+    {
+      'target_name': 'common_test_utils',
+      'type': 'none',
+      'sources': [
+        'test_random.h',
+        'test_time.h',
       ],
     },
     {
       'target_name': 'common_unittests',
       'type': 'executable',
       'sources': [
+        'arena_unittest.cc',
         'buffer_parser_unittest.cc',
         'com_utils_unittest.cc',
         'common_unittest_main.cc',
         'initializing_coclass_unittest.cc',
+        'row_bitmap_unittest.cc',
+        'spsc_ring_unittest.cc',
+        'string_table_unittest.cc',
+        'trace_table_unittest.cc',
+        'trigram_index_unittest.cc',
       ],
       'dependencies': [
         'common',
@@ -89,6 +114,20 @@
         '<(DEPTH)/testing/gmock.gyp:gmock',
         '<(DEPTH)/testing/gtest.gyp:gtest',
       ],
+    },
+    {
+      'target_name': 'common_perftests',
+      'type': 'executable',
+      'sources': [
+        'buffer_parser_perftest.cc',
+      ],
+      'dependencies': [
+        'common',
+        'common_test_utils',
+        '<(DEPTH)/base/base.gyp:base',
+        '<(DEPTH)/base/base.gyp:test_support_perf',
+        '<(DEPTH)/testing/gtest.gyp:gtest',
+      ],
     }
   ]
 }
@@ -0,0 +1,476 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Compressed row set implementation.
+#include "sawbuck/common/row_bitmap.h"
+
+#include <algorithm>
+#include <iterator>
+#include "base/logging.h"
+
+namespace {
+
+const uint64 kOne = 1;
+
+size_t CountBits(uint32 word) {
+  word = word - ((word >> 1) & 0x55555555);
+  word = (word & 0x33333333) + ((word >> 2) & 0x33333333);
+  word = (word + (word >> 4)) & 0x0F0F0F0F;
+  return (word * 0x01010101) >> 24;
+}
+
+size_t CountBits(uint64 word) {
+  return CountBits(static_cast<uint32>(word)) +
+      CountBits(static_cast<uint32>(word >> 32));
+}
+
+bool IsBitSet(const std::vector<uint64>& bitmap, uint16 low) {
+  return (bitmap[low / 64] & (kOne << (low % 64))) != 0;
+}
+
+void SetBit(std::vector<uint64>* bitmap, uint16 low) {
+  (*bitmap)[low / 64] |= kOne << (low % 64);
+}
+
+void ClearBit(std::vector<uint64>* bitmap, uint16 low) {
+  (*bitmap)[low / 64] &= ~(kOne << (low % 64));
+}
+
+// Sets the bits [begin, end) of bitmap.
+void SetBits(std::vector<uint64>* bitmap, size_t begin, size_t end) {
+  while (begin < end) {
+    size_t word = begin / 64;
+    size_t first = begin % 64;
+    size_t last = std::min<size_t>(end - word * 64, 64);
+    uint64 mask = ~uint64(0) << first;
+    if (last < 64)
+      mask &= (kOne << last) - 1;
+    (*bitmap)[word] |= mask;
+    begin = word * 64 + last;
+  }
+}
+
+}  // namespace
+
+bool RowBitmap::Chunk::Contains(uint16 low) const {
+  if (is_bitmap())
+    return IsBitSet(bitmap, low);
+  return std::binary_search(array.begin(), array.end(), low);
+}
+
+void RowBitmap::Chunk::Add(uint16 low) {
+  if (is_bitmap()) {
+    if (!IsBitSet(bitmap, low)) {
+      SetBit(&bitmap, low);
+      ++size;
+    }
+    return;
+  }
+
+  if (array.empty() || array.back() < low) {
+    array.push_back(low);
+  } else {
+    std::vector<uint16>::iterator it =
+        std::lower_bound(array.begin(), array.end(), low);
+    if (*it == low)
+      return;
+    array.insert(it, low);
+  }
+  ++size;
+
+  if (size > kMaxArraySize)
+    ToBitmap();
+}
+
+void RowBitmap::Chunk::Swap(Chunk* other) {
+  std::swap(key, other->key);
+  std::swap(size, other->size);
+  array.swap(other->array);
+  bitmap.swap(other->bitmap);
+}
+
+void RowBitmap::Chunk::Normalize() {
+  if (is_bitmap() && size <= kMaxArraySize)
+    ToArray();
+  else if (!is_bitmap() && size > kMaxArraySize)
+    ToBitmap();
+}
+
+void RowBitmap::Chunk::ToBitmap() {
+  if (is_bitmap())
+    return;
+
+  bitmap.assign(kWordsPerBitmap, 0);
+  for (size_t i = 0; i < array.size(); ++i)
+    SetBit(&bitmap, array[i]);
+  std::vector<uint16>().swap(array);
+}
+
+void RowBitmap::Chunk::ToArray() {
+  if (!is_bitmap())
+    return;
+
+  array.clear();
+  array.reserve(size);
+  for (size_t i = 0; i < kWordsPerBitmap; ++i) {
+    for (uint64 word = bitmap[i]; word != 0; word &= word - 1) {
+      size_t bit = CountBits((word & (~word + 1)) - 1);
+      array.push_back(static_cast<uint16>(i * 64 + bit));
+    }
+  }
+  std::vector<uint64>().swap(bitmap);
+  DCHECK_EQ(size, array.size());
+}
+
+void RowBitmap::Chunk::CountBitmap() {
+  DCHECK(is_bitmap());
+  size = 0;
+  for (size_t i = 0; i < kWordsPerBitmap; ++i)
+    size += CountBits(bitmap[i]);
+}
+
+RowBitmap::RowBitmap() {
+}
+
+RowBitmap::~RowBitmap() {
+}
+
+void RowBitmap::Add(uint32 row) {
+  GetChunk(row >> kChunkBits)->Add(row & (kChunkSize - 1));
+}
+
+void RowBitmap::AddRange(uint32 begin, uint32 end) {
+  uint64 next = begin;
+  while (next < end) {
+    uint16 key = static_cast<uint16>(next >> kChunkBits);
+    uint64 chunk_start = static_cast<uint64>(key) << kChunkBits;
+    uint64 chunk_end = std::min<uint64>(end, chunk_start + kChunkSize);
+    size_t low = static_cast<size_t>(next - chunk_start);
+    size_t high = static_cast<size_t>(chunk_end - chunk_start);
+
+    Chunk* chunk = GetChunk(key);
+    if (!chunk->is_bitmap() && chunk->size + high - low <= kMaxArraySize) {
+      for (size_t i = low; i < high; ++i)
+        chunk->Add(static_cast<uint16>(i));
+    } else {
+      chunk->ToBitmap();
+      SetBits(&chunk->bitmap, low, high);
+      chunk->CountBitmap();
+    }
+
+    next = chunk_end;
+  }
+}
+
+bool RowBitmap::Contains(uint32 row) const {
+  uint16 key = row >> kChunkBits;
+  for (size_t lo = 0, hi = chunks_.size(); lo < hi;) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (chunks_[mid].key < key)
+      lo = mid + 1;
+    else if (chunks_[mid].key > key)
+      hi = mid;
+    else
+      return chunks_[mid].Contains(row & (kChunkSize - 1));
+  }
+  return false;
+}
+
+size_t RowBitmap::size() const {
+  size_t size = 0;
+  for (size_t i = 0; i < chunks_.size(); ++i)
+    size += chunks_[i].size;
+  return size;
+}
+
+void RowBitmap::Clear() {
+  chunks_.clear();
+}
+
+void RowBitmap::Union(const RowBitmap& other) {
+  if (&other == this)
+    return;
+
+  std::vector<Chunk> result;
+  result.reserve(chunks_.size() + other.chunks_.size());
+
+  size_t i = 0;
+  size_t j = 0;
+  while (i < chunks_.size() || j < other.chunks_.size()) {
+    if (j == other.chunks_.size() ||
+        (i < chunks_.size() && chunks_[i].key < other.chunks_[j].key)) {
+      result.push_back(Chunk(chunks_[i].key));
+      result.back().Swap(&chunks_[i++]);
+      continue;
+    }
+    if (i == chunks_.size() || other.chunks_[j].key < chunks_[i].key) {
+      result.push_back(other.chunks_[j++]);
+      continue;
+    }
+
+    result.push_back(Chunk(chunks_[i].key));
+    Chunk& chunk = result.back();
+    chunk.Swap(&chunks_[i++]);
+    const Chunk& other_chunk = other.chunks_[j++];
+
+    if (!chunk.is_bitmap() && !other_chunk.is_bitmap() &&
+        chunk.size + other_chunk.size <= kMaxArraySize) {
+      std::vector<uint16> merged;
+      merged.reserve(chunk.size + other_chunk.size);
+      std::set_union(chunk.array.begin(), chunk.array.end(),
+                     other_chunk.array.begin(), other_chunk.array.end(),
+                     std::back_inserter(merged));
+      chunk.array.swap(merged);
+      chunk.size = chunk.array.size();
+      continue;
+    }
+
+    chunk.ToBitmap();
+    if (other_chunk.is_bitmap()) {
+      for (size_t k = 0; k < kWordsPerBitmap; ++k)
+        chunk.bitmap[k] |= other_chunk.bitmap[k];
+    } else {
+      for (size_t k = 0; k < other_chunk.array.size(); ++k)
+        SetBit(&chunk.bitmap, other_chunk.array[k]);
+    }
+    chunk.CountBitmap();
+    chunk.Normalize();
+  }
+
+  chunks_.swap(result);
+}
+
+void RowBitmap::Intersect(const RowBitmap& other) {
+  if (&other == this)
+    return;
+
+  std::vector<Chunk> result;
+
+  size_t i = 0;
+  size_t j = 0;
+  while (i < chunks_.size() && j < other.chunks_.size()) {
+    if (chunks_[i].key < other.chunks_[j].key) {
+      ++i;
+      continue;
+    }
+    if (other.chunks_[j].key < chunks_[i].key) {
+      ++j;
+      continue;
+    }
+
+    Chunk& chunk = chunks_[i++];
+    const Chunk& other_chunk = other.chunks_[j++];
+    if (!chunk.is_bitmap()) {
+      // Keep the rows the other chunk contains, in place.
+      size_t kept = 0;
+      for (size_t k = 0; k < chunk.array.size(); ++k) {
+        if (other_chunk.Contains(chunk.array[k]))
+          chunk.array[kept++] = chunk.array[k];
+      }
+      chunk.array.resize(kept);
+      chunk.size = kept;
+    } else if (!other_chunk.is_bitmap()) {
+      std::vector<uint16> kept;
+      for (size_t k = 0; k < other_chunk.array.size(); ++k) {
+        if (chunk.Contains(other_chunk.array[k]))
+          kept.push_back(other_chunk.array[k]);
+      }
+      std::vector<uint64>().swap(chunk.bitmap);
+      chunk.array.swap(kept);
+      chunk.size = chunk.array.size();
+    } else {
+      for (size_t k = 0; k < kWordsPerBitmap; ++k)
+        chunk.bitmap[k] &= other_chunk.bitmap[k];
+      chunk.CountBitmap();
+      chunk.Normalize();
+    }
+
+    if (chunk.size != 0) {
+      result.push_back(Chunk(chunk.key));
+      result.back().Swap(&chunk);
+    }
+  }
+
+  chunks_.swap(result);
+}
+
+void RowBitmap::Subtract(const RowBitmap& other) {
+  if (&other == this) {
+    Clear();
+    return;
+  }
+
+  std::vector<Chunk> result;
+  result.reserve(chunks_.size());
+
+  size_t j = 0;
+  for (size_t i = 0; i < chunks_.size(); ++i) {
+    Chunk& chunk = chunks_[i];
+    while (j < other.chunks_.size() && other.chunks_[j].key < chunk.key)
+      ++j;
+
+    if (j < other.chunks_.size() && other.chunks_[j].key == chunk.key) {
+      const Chunk& other_chunk = other.chunks_[j];
+      if (!chunk.is_bitmap()) {
+        size_t kept = 0;
+        for (size_t k = 0; k < chunk.array.size(); ++k) {
+          if (!other_chunk.Contains(chunk.array[k]))
+            chunk.array[kept++] = chunk.array[k];
+        }
+        chunk.array.resize(kept);
+        chunk.size = kept;
+      } else {
+        if (other_chunk.is_bitmap()) {
+          for (size_t k = 0; k < kWordsPerBitmap; ++k)
+            chunk.bitmap[k] &= ~other_chunk.bitmap[k];
+        } else {
+          for (size_t k = 0; k < other_chunk.array.size(); ++k)
+            ClearBit(&chunk.bitmap, other_chunk.array[k]);
+        }
+        chunk.CountBitmap();
+        chunk.Normalize();
+      }
+    }
+
+    if (chunk.size != 0) {
+      result.push_back(Chunk(chunk.key));
+      result.back().Swap(&chunk);
+    }
+  }
+
+  chunks_.swap(result);
+}
+
+void RowBitmap::AppendRows(uint32 begin,
+                           uint32 end,
+                           std::vector<int>* rows) const {
+  DCHECK(rows != NULL);
+
+  for (size_t i = 0; i < chunks_.size(); ++i) {
+    const Chunk& chunk = chunks_[i];
+    uint64 base = static_cast<uint64>(chunk.key) << kChunkBits;
+    if (base + kChunkSize <= begin)
+      continue;
+    if (base >= end)
+      break;
+
+    if (!chunk.is_bitmap()) {
+      for (size_t k = 0; k < chunk.array.size(); ++k) {
+        uint64 row = base + chunk.array[k];
+        if (row >= end)
+          break;
+        if (row >= begin)
+          rows->push_back(static_cast<int>(row));
+      }
+      continue;
+    }
+
+    for (size_t k = 0; k < kWordsPerBitmap; ++k) {
+      for (uint64 word = chunk.bitmap[k]; word != 0; word &= word - 1) {
+        size_t bit = CountBits((word & (~word + 1)) - 1);
+        uint64 row = base + k * 64 + bit;
+        if (row >= end)
+          return;
+        if (row >= begin)
+          rows->push_back(static_cast<int>(row));
+      }
+    }
+  }
+}
+
+bool RowBitmap::NextRow(uint32 row, uint32* next) const {
+  DCHECK(next != NULL);
+
+  uint16 key = row >> kChunkBits;
+  size_t lo = 0;
+  size_t hi = chunks_.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (chunks_[mid].key < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  for (size_t i = lo; i < chunks_.size(); ++i) {
+    const Chunk& chunk = chunks_[i];
+    uint32 base = static_cast<uint32>(chunk.key) << kChunkBits;
+    uint16 low = chunk.key == key ? row & (kChunkSize - 1) : 0;
+
+    if (!chunk.is_bitmap()) {
+      std::vector<uint16>::const_iterator it =
+          std::lower_bound(chunk.array.begin(), chunk.array.end(), low);
+      if (it != chunk.array.end()) {
+        *next = base + *it;
+        return true;
+      }
+      continue;
+    }
+
+    size_t k = low / 64;
+    uint64 word = chunk.bitmap[k] & (~uint64(0) << (low % 64));
+    while (true) {
+      if (word != 0) {
+        *next = base + k * 64 + CountBits((word & (~word + 1)) - 1);
+        return true;
+      }
+      if (++k == kWordsPerBitmap)
+        break;
+      word = chunk.bitmap[k];
+    }
+  }
+
+  return false;
+}
+
+void RowBitmap::RemoveFront(uint32 count) {
+  DCHECK_EQ(0U, count % kChunkSize);
+  uint32 removed_keys = count >> kChunkBits;
+
+  size_t first = 0;
+  while (first < chunks_.size() && chunks_[first].key < removed_keys)
+    ++first;
+
+  // Move the chunks kept down by swapping, which doesn't copy them.
+  for (size_t i = first; i < chunks_.size(); ++i) {
+    chunks_[i].key -= removed_keys;
+    chunks_[i - first].Swap(&chunks_[i]);
+  }
+  chunks_.erase(chunks_.end() - first, chunks_.end());
+}
+
+RowBitmap::Chunk* RowBitmap::GetChunk(uint16 key) {
+  // Rows are mostly added in increasing order, so try the last chunk
+  // first.
+  if (chunks_.empty() || chunks_.back().key < key) {
+    chunks_.push_back(Chunk(key));
+    return &chunks_.back();
+  }
+  if (chunks_.back().key == key)
+    return &chunks_.back();
+
+  size_t lo = 0;
+  size_t hi = chunks_.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (chunks_[mid].key < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo < chunks_.size() && chunks_[lo].key == key)
+    return &chunks_[lo];
+
+  return &*chunks_.insert(chunks_.begin() + lo, Chunk(key));
+}
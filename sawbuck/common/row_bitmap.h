@@ -0,0 +1,115 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A compressed set of row numbers.
+#ifndef SAWBUCK_COMMON_ROW_BITMAP_H_
+#define SAWBUCK_COMMON_ROW_BITMAP_H_
+
+#include <vector>
+#include "base/basictypes.h"
+
+// A set of row numbers, compressed in the manner of a roaring bitmap. Rows
+// are grouped in chunks of 64K by their high 16 bits, and each chunk holds
+// the low 16 bits of its rows either as a sorted array, while it has at
+// most kMaxArraySize rows, or as a bitmap of all 64K. Sparse and dense
+// sets both stay small, and set operations work a chunk at a time.
+//
+// Adding rows in increasing order, as a log grows, is cheapest.
+class RowBitmap {
+ public:
+  // The most rows a chunk holds as an array, beyond which a bitmap is
+  // smaller.
+  static const size_t kMaxArraySize = 4096;
+
+  // The number of rows per chunk.
+  static const size_t kChunkBits = 16;
+  static const size_t kChunkSize = 1 << kChunkBits;
+
+  RowBitmap();
+  ~RowBitmap();
+
+  // Adds @p row.
+  void Add(uint32 row);
+
+  // Adds the rows [@p begin, @p end).
+  void AddRange(uint32 begin, uint32 end);
+
+  // @returns true iff @p row is in the set.
+  bool Contains(uint32 row) const;
+
+  // @returns the number of rows in the set.
+  size_t size() const;
+
+  // @returns true iff the set is empty.
+  bool empty() const { return chunks_.empty(); }
+
+  // Removes all rows.
+  void Clear();
+
+  // Set operations, which update this set in place.
+  // @{
+  void Union(const RowBitmap& other);
+  void Intersect(const RowBitmap& other);
+  void Subtract(const RowBitmap& other);
+  // @}
+
+  // Appends the rows in [@p begin, @p end) to @p rows, in increasing
+  // order.
+  void AppendRows(uint32 begin, uint32 end, std::vector<int>* rows) const;
+
+  // Finds the first row in the set at or after @p row.
+  // @param next on success returns the row found.
+  // @returns true on success, or false if there's no such row.
+  bool NextRow(uint32 row, uint32* next) const;
+
+  // Removes the rows below @p count, and renumbers the rest down by
+  // @p count, which must be a multiple of kChunkSize. This only moves
+  // whole chunks, so it's cheap.
+  void RemoveFront(uint32 count);
+
+ private:
+  static const size_t kWordsPerBitmap = kChunkSize / 64;
+
+  // The rows of one chunk. Exactly one of array and bitmap is in use.
+  struct Chunk {
+    explicit Chunk(uint16 key) : key(key), size(0) {
+    }
+
+    bool is_bitmap() const { return !bitmap.empty(); }
+    bool Contains(uint16 low) const;
+    void Add(uint16 low);
+    void Swap(Chunk* other);
+
+    // Converts between array and bitmap form, as the size requires.
+    void Normalize();
+    void ToBitmap();
+    void ToArray();
+
+    // Recounts size from the bitmap.
+    void CountBitmap();
+
+    uint16 key;
+    size_t size;
+    std::vector<uint16> array;
+    std::vector<uint64> bitmap;
+  };
+
+  // @returns the chunk for @p key, adding it if need be.
+  Chunk* GetChunk(uint16 key);
+
+  // The chunks, in order of key. None are empty.
+  std::vector<Chunk> chunks_;
+};
+
+#endif  // SAWBUCK_COMMON_ROW_BITMAP_H_
@@ -0,0 +1,222 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/common/row_bitmap.h"
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+
+typedef std::set<uint32> RowSet;
+
+// Fills both sets with every stride'th row of [begin, end).
+void AddRows(uint32 begin, uint32 end, uint32 stride,
+             RowBitmap* bitmap, RowSet* rows) {
+  for (uint32 row = begin; row < end; row += stride) {
+    bitmap->Add(row);
+    rows->insert(row);
+  }
+}
+
+void ExpectSameRows(const RowSet& expected, const RowBitmap& bitmap) {
+  EXPECT_EQ(expected.size(), bitmap.size());
+  EXPECT_EQ(expected.empty(), bitmap.empty());
+
+  std::vector<int> rows;
+  bitmap.AppendRows(0, kuint32max, &rows);
+  ASSERT_EQ(expected.size(), rows.size());
+  EXPECT_TRUE(std::equal(expected.begin(), expected.end(), rows.begin()));
+}
+
+TEST(RowBitmapTest, AddAndContains) {
+  RowBitmap bitmap;
+  EXPECT_TRUE(bitmap.empty());
+  EXPECT_FALSE(bitmap.Contains(0));
+
+  bitmap.Add(7);
+  bitmap.Add(3);
+  bitmap.Add(70000);
+  bitmap.Add(3);
+  EXPECT_EQ(3U, bitmap.size());
+  EXPECT_TRUE(bitmap.Contains(3));
+  EXPECT_TRUE(bitmap.Contains(7));
+  EXPECT_TRUE(bitmap.Contains(70000));
+  EXPECT_FALSE(bitmap.Contains(4));
+  EXPECT_FALSE(bitmap.Contains(70001));
+
+  bitmap.Clear();
+  EXPECT_TRUE(bitmap.empty());
+  EXPECT_FALSE(bitmap.Contains(3));
+}
+
+TEST(RowBitmapTest, DenseChunks) {
+  RowBitmap bitmap;
+  RowSet rows;
+
+  // Enough rows in the first chunk to hold it as a bitmap, and few in
+  // the next.
+  AddRows(0, 65536, 2, &bitmap, &rows);
+  AddRows(65536, 65536 + 100, 3, &bitmap, &rows);
+  ExpectSameRows(rows, bitmap);
+  EXPECT_TRUE(bitmap.Contains(65534));
+  EXPECT_FALSE(bitmap.Contains(65535));
+
+  // Out of order additions.
+  bitmap.Add(65535);
+  rows.insert(65535);
+  bitmap.Add(1);
+  rows.insert(1);
+  ExpectSameRows(rows, bitmap);
+}
+
+TEST(RowBitmapTest, AddRange) {
+  RowBitmap bitmap;
+  RowSet rows;
+
+  bitmap.AddRange(10, 20);
+  bitmap.AddRange(60000, 200000);
+  bitmap.AddRange(15, 25);
+  bitmap.AddRange(30, 30);
+  for (uint32 row = 10; row < 25; ++row)
+    rows.insert(row);
+  for (uint32 row = 60000; row < 200000; ++row)
+    rows.insert(row);
+  ExpectSameRows(rows, bitmap);
+}
+
+TEST(RowBitmapTest, Union) {
+  RowBitmap a;
+  RowBitmap b;
+  RowSet rows;
+  AddRows(0, 100000, 3, &a, &rows);
+  AddRows(50000, 300000, 5, &b, &rows);
+  AddRows(1, 20, 7, &b, &rows);
+
+  a.Union(b);
+  ExpectSameRows(rows, a);
+
+  a.Union(a);
+  ExpectSameRows(rows, a);
+}
+
+TEST(RowBitmapTest, Intersect) {
+  RowBitmap a;
+  RowBitmap b;
+  RowSet a_rows;
+  RowSet b_rows;
+  AddRows(0, 200000, 2, &a, &a_rows);
+  AddRows(0, 10, 1, &b, &b_rows);
+  AddRows(60000, 140000, 3, &b, &b_rows);
+  AddRows(300000, 300010, 1, &b, &b_rows);
+
+  RowSet rows;
+  std::set_intersection(a_rows.begin(), a_rows.end(),
+                        b_rows.begin(), b_rows.end(),
+                        std::inserter(rows, rows.begin()));
+  a.Intersect(b);
+  ExpectSameRows(rows, a);
+
+  RowBitmap none;
+  a.Intersect(none);
+  EXPECT_TRUE(a.empty());
+}
+
+TEST(RowBitmapTest, Subtract) {
+  RowBitmap a;
+  RowBitmap b;
+  RowSet a_rows;
+  RowSet b_rows;
+  AddRows(0, 200000, 1, &a, &a_rows);
+  AddRows(0, 70000, 2, &b, &b_rows);
+  AddRows(131072, 196608, 1, &b, &b_rows);
+
+  RowSet rows;
+  std::set_difference(a_rows.begin(), a_rows.end(),
+                      b_rows.begin(), b_rows.end(),
+                      std::inserter(rows, rows.begin()));
+  a.Subtract(b);
+  ExpectSameRows(rows, a);
+  EXPECT_FALSE(a.Contains(150000));
+
+  a.Subtract(a);
+  EXPECT_TRUE(a.empty());
+}
+
+TEST(RowBitmapTest, AppendRowsInRange) {
+  RowBitmap bitmap;
+  RowSet rows;
+  AddRows(0, 100000, 1, &bitmap, &rows);
+  AddRows(100000, 200000, 1000, &bitmap, &rows);
+
+  std::vector<int> appended(1, -1);
+  bitmap.AppendRows(65530, 101000, &appended);
+  ASSERT_EQ(1U + 100000 - 65530 + 1, appended.size());
+  EXPECT_EQ(-1, appended[0]);
+  EXPECT_EQ(65530, appended[1]);
+  EXPECT_EQ(99999, appended[appended.size() - 2]);
+  EXPECT_EQ(100000, appended.back());
+}
+
+TEST(RowBitmapTest, NextRow) {
+  RowBitmap bitmap;
+  uint32 next = 0;
+  EXPECT_FALSE(bitmap.NextRow(0, &next));
+
+  // A sparse chunk, a dense one, and another sparse one.
+  bitmap.Add(5);
+  bitmap.AddRange(65536 + 100, 65536 + 10000);
+  bitmap.Add(300000);
+
+  ASSERT_TRUE(bitmap.NextRow(0, &next));
+  EXPECT_EQ(5U, next);
+  ASSERT_TRUE(bitmap.NextRow(5, &next));
+  EXPECT_EQ(5U, next);
+  ASSERT_TRUE(bitmap.NextRow(6, &next));
+  EXPECT_EQ(65536U + 100, next);
+  ASSERT_TRUE(bitmap.NextRow(65536 + 5000, &next));
+  EXPECT_EQ(65536U + 5000, next);
+  ASSERT_TRUE(bitmap.NextRow(65536 + 10000, &next));
+  EXPECT_EQ(300000U, next);
+  EXPECT_FALSE(bitmap.NextRow(300001, &next));
+}
+
+TEST(RowBitmapTest, RemoveFront) {
+  RowBitmap bitmap;
+  RowSet rows;
+  AddRows(0, 5 * RowBitmap::kChunkSize, 7, &bitmap, &rows);
+  bitmap.AddRange(3 * RowBitmap::kChunkSize, 4 * RowBitmap::kChunkSize);
+
+  bitmap.RemoveFront(2 * RowBitmap::kChunkSize);
+
+  RowSet expected;
+  for (RowSet::const_iterator it = rows.begin(); it != rows.end(); ++it) {
+    if (*it >= 2 * RowBitmap::kChunkSize)
+      expected.insert(*it - 2 * RowBitmap::kChunkSize);
+  }
+  for (uint32 row = RowBitmap::kChunkSize; row < 2 * RowBitmap::kChunkSize;
+       ++row) {
+    expected.insert(row);
+  }
+  ExpectSameRows(expected, bitmap);
+
+  bitmap.RemoveFront(0);
+  ExpectSameRows(expected, bitmap);
+  bitmap.RemoveFront(10 * RowBitmap::kChunkSize);
+  EXPECT_TRUE(bitmap.empty());
+}
+
+}  // namespace
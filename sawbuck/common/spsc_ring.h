@@ -0,0 +1,107 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A bounded, lock-free, single-producer single-consumer ring.
+#ifndef SAWBUCK_COMMON_SPSC_RING_H_
+#define SAWBUCK_COMMON_SPSC_RING_H_
+
+#include <vector>
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/logging.h"
+
+// A fixed-capacity FIFO that allows one producer thread and one consumer
+// thread to exchange items without locking. The producer publishes an
+// item by release-storing the tail index after writing the item, and the
+// consumer frees a slot by release-storing the head index after reading
+// it, so each side only ever writes its own index.
+// @note Type must be default constructible and assignable. Items are
+//     copied in and out of the ring, so large items are best passed by
+//     pointer.
+template <class Type>
+class SpscRing {
+ public:
+  // @param capacity the number of items the ring holds, which must be a
+  //     power of two.
+  explicit SpscRing(size_t capacity)
+      : items_(capacity), mask_(static_cast<uint32>(capacity - 1)),
+        head_(0), tail_(0) {
+    DCHECK_LT(0U, capacity);
+    DCHECK_EQ(0U, capacity & (capacity - 1));
+  }
+
+  size_t capacity() const { return items_.size(); }
+
+  // @returns the number of items in the ring. This is exact only when
+  //     called from the producer or consumer while the other is idle,
+  //     otherwise it's a snapshot.
+  size_t size() const {
+    return static_cast<uint32>(base::subtle::Acquire_Load(&tail_)) -
+        static_cast<uint32>(base::subtle::Acquire_Load(&head_));
+  }
+
+  // Appends @p item to the ring. Must only be called by the producer.
+  // @returns true on success, false if the ring is full.
+  bool TryPush(const Type& item) {
+    uint32 tail = static_cast<uint32>(base::subtle::NoBarrier_Load(&tail_));
+    uint32 head = static_cast<uint32>(base::subtle::Acquire_Load(&head_));
+    if (tail - head == items_.size())
+      return false;
+
+    items_[tail & mask_] = item;
+    base::subtle::Release_Store(&tail_,
+                                static_cast<base::subtle::Atomic32>(tail + 1));
+    return true;
+  }
+
+  // Removes the oldest item from the ring. Must only be called by the
+  // consumer.
+  // @param item on success returns the item.
+  // @returns true on success, false if the ring is empty.
+  bool TryPop(Type* item) {
+    DCHECK(item != NULL);
+    uint32 head = static_cast<uint32>(base::subtle::NoBarrier_Load(&head_));
+    uint32 tail = static_cast<uint32>(base::subtle::Acquire_Load(&tail_));
+    if (head == tail)
+      return false;
+
+    Type& slot = items_[head & mask_];
+    *item = slot;
+    slot = Type();
+    base::subtle::Release_Store(&head_,
+                                static_cast<base::subtle::Atomic32>(head + 1));
+    return true;
+  }
+
+ private:
+  // A cache line's worth of padding, to keep the producer's and the
+  // consumer's index from sharing a line.
+  static const size_t kCacheLineSize = 64;
+
+  std::vector<Type> items_;
+  const uint32 mask_;
+
+  // The index of the next item to pop, written only by the consumer.
+  char head_padding_[kCacheLineSize];
+  base::subtle::Atomic32 head_;
+
+  // The index of the next item to push, written only by the producer.
+  char tail_padding_[kCacheLineSize - sizeof(base::subtle::Atomic32)];
+  base::subtle::Atomic32 tail_;
+  char trailing_padding_[kCacheLineSize - sizeof(base::subtle::Atomic32)];
+
+  DISALLOW_COPY_AND_ASSIGN(SpscRing);
+};
+
+#endif  // SAWBUCK_COMMON_SPSC_RING_H_
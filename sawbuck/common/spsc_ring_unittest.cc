@@ -0,0 +1,107 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/common/spsc_ring.h"
+
+#include "base/threading/platform_thread.h"
+#include "base/threading/simple_thread.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(SpscRingTest, PushPopInOrder) {
+  SpscRing<int> ring(4);
+  EXPECT_EQ(4U, ring.capacity());
+  EXPECT_EQ(0U, ring.size());
+
+  int item = 0;
+  EXPECT_FALSE(ring.TryPop(&item));
+
+  EXPECT_TRUE(ring.TryPush(1));
+  EXPECT_TRUE(ring.TryPush(2));
+  EXPECT_EQ(2U, ring.size());
+
+  EXPECT_TRUE(ring.TryPop(&item));
+  EXPECT_EQ(1, item);
+  EXPECT_TRUE(ring.TryPop(&item));
+  EXPECT_EQ(2, item);
+  EXPECT_FALSE(ring.TryPop(&item));
+}
+
+TEST(SpscRingTest, FailsWhenFull) {
+  SpscRing<int> ring(2);
+
+  EXPECT_TRUE(ring.TryPush(1));
+  EXPECT_TRUE(ring.TryPush(2));
+  EXPECT_FALSE(ring.TryPush(3));
+  EXPECT_EQ(2U, ring.size());
+
+  int item = 0;
+  EXPECT_TRUE(ring.TryPop(&item));
+  EXPECT_EQ(1, item);
+  EXPECT_TRUE(ring.TryPush(3));
+}
+
+TEST(SpscRingTest, WrapsAround) {
+  SpscRing<int> ring(4);
+
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(ring.TryPush(i));
+    ASSERT_TRUE(ring.TryPush(i + 1000));
+
+    int item = 0;
+    ASSERT_TRUE(ring.TryPop(&item));
+    EXPECT_EQ(i, item);
+    ASSERT_TRUE(ring.TryPop(&item));
+    EXPECT_EQ(i + 1000, item);
+  }
+  EXPECT_EQ(0U, ring.size());
+}
+
+class Producer : public base::DelegateSimpleThread::Delegate {
+ public:
+  Producer(SpscRing<int>* ring, int num_items)
+      : ring_(ring), num_items_(num_items) {
+  }
+
+  virtual void Run() {
+    for (int i = 0; i < num_items_; ++i) {
+      while (!ring_->TryPush(i))
+        base::PlatformThread::YieldCurrentThread();
+    }
+  }
+
+ private:
+  SpscRing<int>* ring_;
+  int num_items_;
+};
+
+TEST(SpscRingTest, ProducerAndConsumerThreads) {
+  const int kNumItems = 100000;
+  SpscRing<int> ring(64);
+  Producer producer(&ring, kNumItems);
+  base::DelegateSimpleThread thread(&producer, "SpscRing producer");
+  thread.Start();
+
+  for (int expected = 0; expected < kNumItems; ++expected) {
+    int item = -1;
+    while (!ring.TryPop(&item))
+      base::PlatformThread::YieldCurrentThread();
+    ASSERT_EQ(expected, item);
+  }
+
+  thread.Join();
+  EXPECT_EQ(0U, ring.size());
+}
+
+}  // namespace
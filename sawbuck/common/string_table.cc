@@ -0,0 +1,71 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// String table implementation.
+#include "sawbuck/common/string_table.h"
+
+namespace {
+
+// Interned strings are few and short, so a small chunk size will do.
+const size_t kArenaChunkSize = 64 * 1024;
+
+}  // namespace
+
+// static
+const StringTable::StringId StringTable::kEmptyStringId;
+
+StringTable::StringTable() : arena_(kArenaChunkSize) {
+  Clear();
+}
+
+StringTable::~StringTable() {
+}
+
+StringTable::StringId StringTable::Intern(const base::StringPiece& str) {
+  if (str.empty())
+    return kEmptyStringId;
+
+  IdMap::const_iterator it = ids_.find(str);
+  if (it != ids_.end())
+    return it->second;
+
+  base::StringPiece copy(arena_.CopyString(str.data(), str.size()),
+                         str.size());
+  StringId id = static_cast<StringId>(strings_.size());
+  CHECK_EQ(strings_.size(), id) << "Too many strings.";
+
+  strings_.push_back(copy);
+  ids_.insert(std::make_pair(copy, id));
+
+  return id;
+}
+
+bool StringTable::Find(const base::StringPiece& str, StringId* id) const {
+  DCHECK(id != NULL);
+  IdMap::const_iterator it = ids_.find(str);
+  if (it == ids_.end())
+    return false;
+
+  *id = it->second;
+  return true;
+}
+
+void StringTable::Clear() {
+  strings_.clear();
+  ids_.clear();
+  arena_.Clear();
+
+  strings_.push_back(base::StringPiece());
+  ids_.insert(std::make_pair(base::StringPiece(), kEmptyStringId));
+}
@@ -0,0 +1,76 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A table of interned strings.
+#ifndef SAWBUCK_COMMON_STRING_TABLE_H_
+#define SAWBUCK_COMMON_STRING_TABLE_H_
+
+#include <vector>
+#include "base/basictypes.h"
+#include "base/containers/hash_tables.h"
+#include "base/logging.h"
+#include "base/strings/string_piece.h"
+#include "sawbuck/common/arena.h"
+
+// Maps strings to small integer ids, storing each distinct string once.
+// This suits strings with few distinct values that recur a lot, such as
+// the source file names of log messages.
+class StringTable {
+ public:
+  typedef uint32 StringId;
+
+  // The id of the empty string, which is always interned.
+  static const StringId kEmptyStringId = 0;
+
+  StringTable();
+  ~StringTable();
+
+  // @returns the id of @p str, interning it if it's new.
+  StringId Intern(const base::StringPiece& str);
+
+  // Looks up @p str without interning it.
+  // @param id on success returns the id of @p str.
+  // @returns true iff @p str is interned.
+  bool Find(const base::StringPiece& str, StringId* id) const;
+
+  // @returns the string with id @p id, which is valid until the table is
+  //     cleared.
+  base::StringPiece Get(StringId id) const {
+    DCHECK_LT(id, strings_.size());
+    return strings_[id];
+  }
+
+  // @returns the number of distinct strings, including the empty string.
+  size_t size() const { return strings_.size(); }
+
+  // @returns the number of bytes used for the strings.
+  size_t data_bytes() const { return arena_.bytes_allocated(); }
+
+  // Discards all strings, save for the empty string.
+  void Clear();
+
+ private:
+  // The strings by id. These refer to arena_.
+  std::vector<base::StringPiece> strings_;
+
+  // Maps strings to their id.
+  typedef base::hash_map<base::StringPiece, StringId> IdMap;
+  IdMap ids_;
+
+  Arena arena_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringTable);
+};
+
+#endif  // SAWBUCK_COMMON_STRING_TABLE_H_
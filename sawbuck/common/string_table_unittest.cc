@@ -0,0 +1,75 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/common/string_table.h"
+
+#include <string>
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(StringTableTest, EmptyStringIsPreInterned) {
+  StringTable table;
+
+  EXPECT_EQ(1U, table.size());
+  EXPECT_EQ(StringTable::kEmptyStringId, table.Intern(""));
+  EXPECT_TRUE(table.Get(StringTable::kEmptyStringId).empty());
+}
+
+TEST(StringTableTest, InternsOnce) {
+  StringTable table;
+
+  std::string foo("foo.cc");
+  StringTable::StringId foo_id = table.Intern(foo);
+  StringTable::StringId bar_id = table.Intern("bar.cc");
+  EXPECT_NE(foo_id, bar_id);
+  EXPECT_NE(StringTable::kEmptyStringId, foo_id);
+  EXPECT_EQ(3U, table.size());
+
+  // The table holds its own copy.
+  foo.assign("xxx.xx");
+  EXPECT_EQ("foo.cc", table.Get(foo_id).as_string());
+  EXPECT_EQ("bar.cc", table.Get(bar_id).as_string());
+
+  EXPECT_EQ(foo_id, table.Intern("foo.cc"));
+  EXPECT_EQ(bar_id, table.Intern("bar.cc"));
+  EXPECT_EQ(3U, table.size());
+  EXPECT_EQ(12U, table.data_bytes());
+}
+
+TEST(StringTableTest, FindDoesNotIntern) {
+  StringTable table;
+
+  StringTable::StringId id = StringTable::kEmptyStringId;
+  EXPECT_FALSE(table.Find("foo.cc", &id));
+  EXPECT_EQ(1U, table.size());
+
+  StringTable::StringId foo_id = table.Intern("foo.cc");
+  ASSERT_TRUE(table.Find("foo.cc", &id));
+  EXPECT_EQ(foo_id, id);
+  ASSERT_TRUE(table.Find("", &id));
+  EXPECT_EQ(StringTable::kEmptyStringId, id);
+}
+
+TEST(StringTableTest, Clear) {
+  StringTable table;
+
+  table.Intern("foo.cc");
+  table.Clear();
+
+  EXPECT_EQ(1U, table.size());
+  EXPECT_EQ(0U, table.data_bytes());
+  EXPECT_EQ(1U, table.Intern("bar.cc"));
+}
+
+}  // namespace
@@ -0,0 +1,42 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A seeded pseudo-random number generator for tests.
+#ifndef SAWBUCK_COMMON_TEST_RANDOM_H_
+#define SAWBUCK_COMMON_TEST_RANDOM_H_
+
+#include "base/basictypes.h"
+
+namespace testing {
+
+// A deterministic pseudo-random number generator, so that randomized
+// tests reproduce and benchmarks measure the same input on each run.
+class Random {
+ public:
+  explicit Random(uint32 seed) : state_(seed) {
+  }
+
+  // @returns a number in [0, range).
+  uint32 Next(uint32 range) {
+    state_ = state_ * 1103515245 + 12345;
+    return (state_ >> 8) % range;
+  }
+
+ private:
+  uint32 state_;
+};
+
+}  // namespace testing
+
+#endif  // SAWBUCK_COMMON_TEST_RANDOM_H_
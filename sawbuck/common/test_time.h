@@ -0,0 +1,32 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Time helpers for tests.
+#ifndef SAWBUCK_COMMON_TEST_TIME_H_
+#define SAWBUCK_COMMON_TEST_TIME_H_
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+
+namespace testing {
+
+// @returns the time with internal value @p ticks, for tests that only
+//     care how times order and how far apart they are.
+inline base::Time TimeAt(int64 ticks) {
+  return base::Time::FromInternalValue(ticks);
+}
+
+}  // namespace testing
+
+#endif  // SAWBUCK_COMMON_TEST_TIME_H_
@@ -0,0 +1,108 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Trace table implementation.
+#include "sawbuck/common/trace_table.h"
+
+#include <string.h>
+
+namespace {
+
+// Distinct traces number in the thousands, so a modest chunk size will do.
+const size_t kArenaChunkSize = 64 * 1024;
+
+const size_t kMinBuckets = 256;
+
+}  // namespace
+
+// static
+const TraceTable::TraceId TraceTable::kEmptyTraceId;
+
+TraceTable::TraceTable() : arena_(kArenaChunkSize) {
+  Clear();
+}
+
+TraceTable::~TraceTable() {
+}
+
+TraceTable::TraceId TraceTable::Intern(void* const* frames, size_t depth) {
+  if (depth == 0)
+    return kEmptyTraceId;
+  DCHECK(frames != NULL);
+
+  uint32 hash = Hash(frames, depth);
+  size_t mask = buckets_.size() - 1;
+  size_t bucket = hash & mask;
+  for (; buckets_[bucket] != kEmptyTraceId; bucket = (bucket + 1) & mask) {
+    const Trace& trace = traces_[buckets_[bucket]];
+    if (trace.hash == hash && trace.depth == depth &&
+        memcmp(trace.frames, frames, depth * sizeof(frames[0])) == 0) {
+      return buckets_[bucket];
+    }
+  }
+
+  TraceId id = static_cast<TraceId>(traces_.size());
+  CHECK_EQ(traces_.size(), id) << "Too many traces.";
+
+  Trace trace = {};
+  trace.frames = static_cast<void* const*>(
+      arena_.Copy(frames, depth * sizeof(frames[0]), sizeof(frames[0])));
+  trace.depth = static_cast<uint32>(depth);
+  trace.hash = hash;
+  traces_.push_back(trace);
+  buckets_[bucket] = id;
+
+  // Keep the load factor at or below one half.
+  if (traces_.size() * 2 > buckets_.size())
+    Rehash(buckets_.size() * 2);
+
+  return id;
+}
+
+void TraceTable::Clear() {
+  traces_.clear();
+  arena_.Clear();
+
+  Trace empty = {};
+  traces_.push_back(empty);
+  buckets_.assign(kMinBuckets, kEmptyTraceId);
+}
+
+// static
+uint32 TraceTable::Hash(void* const* frames, size_t depth) {
+  // FNV-1a over the frame addresses.
+  uint32 hash = 2166136261U;
+  for (size_t i = 0; i < depth; ++i) {
+    uintptr_t frame = reinterpret_cast<uintptr_t>(frames[i]);
+    for (size_t j = 0; j < sizeof(frame); ++j) {
+      hash ^= static_cast<uint8>(frame >> (j * 8));
+      hash *= 16777619U;
+    }
+  }
+
+  return hash;
+}
+
+void TraceTable::Rehash(size_t num_buckets) {
+  DCHECK_EQ(0U, num_buckets & (num_buckets - 1));
+
+  buckets_.assign(num_buckets, kEmptyTraceId);
+  size_t mask = num_buckets - 1;
+  for (TraceId id = 1; id < traces_.size(); ++id) {
+    size_t bucket = traces_[id].hash & mask;
+    while (buckets_[bucket] != kEmptyTraceId)
+      bucket = (bucket + 1) & mask;
+    buckets_[bucket] = id;
+  }
+}
@@ -0,0 +1,90 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A table of interned stack traces.
+#ifndef SAWBUCK_COMMON_TRACE_TABLE_H_
+#define SAWBUCK_COMMON_TRACE_TABLE_H_
+
+#include <vector>
+#include "base/basictypes.h"
+#include "base/logging.h"
+#include "sawbuck/common/arena.h"
+
+// Maps stack traces to small integer ids, storing each distinct trace
+// once. Log messages tend to repeat a modest number of call stacks, so
+// this saves a lot over storing a trace per message, and makes comparing
+// traces a matter of comparing ids.
+class TraceTable {
+ public:
+  typedef uint32 TraceId;
+
+  // The id of the empty trace, which is always interned.
+  static const TraceId kEmptyTraceId = 0;
+
+  TraceTable();
+  ~TraceTable();
+
+  // @returns the id of the trace of @p depth frames at @p frames,
+  //     interning it if it's new.
+  TraceId Intern(void* const* frames, size_t depth);
+
+  // @returns the frames of trace @p id, which are valid until the table
+  //     is cleared.
+  void* const* frames(TraceId id) const {
+    DCHECK_LT(id, traces_.size());
+    return traces_[id].frames;
+  }
+
+  // @returns the number of frames in trace @p id.
+  size_t depth(TraceId id) const {
+    DCHECK_LT(id, traces_.size());
+    return traces_[id].depth;
+  }
+
+  // @returns the number of distinct traces, including the empty trace.
+  size_t size() const { return traces_.size(); }
+
+  // @returns the number of bytes used for the frames.
+  size_t data_bytes() const { return arena_.bytes_allocated(); }
+
+  // Discards all traces, save for the empty trace.
+  void Clear();
+
+ private:
+  struct Trace {
+    void* const* frames;
+    uint32 depth;
+    uint32 hash;
+  };
+
+  // @returns the hash of the trace of @p depth frames at @p frames.
+  static uint32 Hash(void* const* frames, size_t depth);
+
+  // Rebuilds buckets_ with @p num_buckets buckets.
+  void Rehash(size_t num_buckets);
+
+  // The traces by id. These refer to arena_.
+  std::vector<Trace> traces_;
+
+  // An open addressed hash table of trace ids, with linear probing. The
+  // empty trace is never looked up, so its id marks empty buckets. The
+  // number of buckets is a power of two.
+  std::vector<TraceId> buckets_;
+
+  Arena arena_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceTable);
+};
+
+#endif  // SAWBUCK_COMMON_TRACE_TABLE_H_
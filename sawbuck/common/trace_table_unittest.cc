@@ -0,0 +1,90 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/common/trace_table.h"
+
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+
+void* Frame(uintptr_t address) {
+  return reinterpret_cast<void*>(address);
+}
+
+TEST(TraceTableTest, EmptyTraceIsPreInterned) {
+  TraceTable table;
+
+  EXPECT_EQ(1U, table.size());
+  EXPECT_EQ(TraceTable::kEmptyTraceId, table.Intern(NULL, 0));
+  EXPECT_EQ(0U, table.depth(TraceTable::kEmptyTraceId));
+}
+
+TEST(TraceTableTest, InternsOnce) {
+  TraceTable table;
+
+  void* foo[] = { Frame(1), Frame(2), Frame(3) };
+  void* bar[] = { Frame(1), Frame(2) };
+  TraceTable::TraceId foo_id = table.Intern(foo, arraysize(foo));
+  TraceTable::TraceId bar_id = table.Intern(bar, arraysize(bar));
+  EXPECT_NE(foo_id, bar_id);
+  EXPECT_NE(TraceTable::kEmptyTraceId, foo_id);
+  EXPECT_EQ(3U, table.size());
+
+  // The table holds its own copy.
+  foo[0] = NULL;
+  ASSERT_EQ(3U, table.depth(foo_id));
+  EXPECT_EQ(Frame(1), table.frames(foo_id)[0]);
+  EXPECT_EQ(Frame(3), table.frames(foo_id)[2]);
+  ASSERT_EQ(2U, table.depth(bar_id));
+
+  foo[0] = Frame(1);
+  EXPECT_EQ(foo_id, table.Intern(foo, arraysize(foo)));
+  EXPECT_EQ(bar_id, table.Intern(bar, arraysize(bar)));
+  EXPECT_EQ(3U, table.size());
+  EXPECT_EQ(5 * sizeof(void*), table.data_bytes());
+}
+
+TEST(TraceTableTest, ManyTraces) {
+  TraceTable table;
+
+  // Enough traces to grow the table a few times.
+  const size_t kNumTraces = 10000;
+  std::vector<TraceTable::TraceId> ids;
+  for (size_t i = 0; i < kNumTraces; ++i) {
+    void* trace[] = { Frame(0x1000), Frame(i) };
+    ids.push_back(table.Intern(trace, arraysize(trace)));
+  }
+  EXPECT_EQ(kNumTraces + 1, table.size());
+
+  for (size_t i = 0; i < kNumTraces; ++i) {
+    void* trace[] = { Frame(0x1000), Frame(i) };
+    ASSERT_EQ(ids[i], table.Intern(trace, arraysize(trace)));
+    ASSERT_EQ(Frame(i), table.frames(ids[i])[1]);
+  }
+  EXPECT_EQ(kNumTraces + 1, table.size());
+}
+
+TEST(TraceTableTest, Clear) {
+  TraceTable table;
+
+  void* trace[] = { Frame(1) };
+  table.Intern(trace, arraysize(trace));
+  table.Clear();
+
+  EXPECT_EQ(1U, table.size());
+  EXPECT_EQ(0U, table.data_bytes());
+  EXPECT_EQ(1U, table.Intern(trace, arraysize(trace)));
+}
+
+}  // namespace
@@ -0,0 +1,345 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Trigram index implementation.
+#include "sawbuck/common/trigram_index.h"
+
+#include <string.h>
+#include <algorithm>
+#include "base/logging.h"
+
+namespace {
+
+uint8 FoldCase(char c) {
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A' + 'a';
+  return static_cast<uint8>(c);
+}
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+bool IsAlphaNumeric(char c) {
+  return IsDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// Escapes that stand for a class of characters or an assertion, and take
+// no argument.
+const char kClassEscapes[] = "dDwWsSbBhHvVRAzZG";
+
+// Builds the literals of a regular expression as it's parsed.
+class LiteralBuilder {
+ public:
+  LiteralBuilder(bool caseless, std::vector<std::string>* literals)
+      : caseless_(caseless), literals_(literals) {
+  }
+
+  // Appends @p c to the current literal.
+  void Append(char c) {
+    // Non-ASCII characters may have other cases the index doesn't fold.
+    if (caseless_ && static_cast<uint8>(c) >= 0x80)
+      End();
+    else
+      current_.push_back(c);
+  }
+
+  // Drops the last character of the current literal, which a quantifier
+  // has made optional, and ends the literal. The character may be UTF-8
+  // encoded in several bytes.
+  void DropLast() {
+    while (!current_.empty() &&
+           (static_cast<uint8>(current_[current_.size() - 1]) & 0xC0) == 0x80) {
+      current_.resize(current_.size() - 1);
+    }
+    if (!current_.empty())
+      current_.resize(current_.size() - 1);
+    End();
+  }
+
+  // Ends the current literal.
+  void End() {
+    if (current_.size() >= TrigramIndex::kMinLiteralLength)
+      literals_->push_back(current_);
+    current_.clear();
+  }
+
+  // Discards all literals, as the expression has no certain literals.
+  void Fail() {
+    current_.clear();
+    literals_->clear();
+  }
+
+ private:
+  bool caseless_;
+  std::string current_;
+  std::vector<std::string>* literals_;
+};
+
+// Parses a {n}, {n,} or {n,m} quantifier at @p pos of @p pattern.
+// @returns the length of the quantifier, or 0 if it isn't one, in which
+//     case the brace is a literal.
+size_t ParseRepeat(const base::StringPiece& pattern, size_t pos, int* min) {
+  DCHECK_EQ('{', pattern[pos]);
+  size_t i = pos + 1;
+  if (i == pattern.size() || !IsDigit(pattern[i]))
+    return 0;
+
+  *min = 0;
+  for (; i < pattern.size() && IsDigit(pattern[i]); ++i)
+    *min = std::min(*min * 10 + pattern[i] - '0', 0xFFFF);
+  if (i < pattern.size() && pattern[i] == ',') {
+    for (++i; i < pattern.size() && IsDigit(pattern[i]); ++i) {
+    }
+  }
+  if (i == pattern.size() || pattern[i] != '}')
+    return 0;
+
+  return i + 1 - pos;
+}
+
+// Skips the character class starting with the '[' at @p pos of @p
+// pattern. @returns the position past its closing ']'.
+size_t SkipClass(const base::StringPiece& pattern, size_t pos) {
+  DCHECK_EQ('[', pattern[pos]);
+  size_t i = pos + 1;
+  if (i < pattern.size() && pattern[i] == '^')
+    ++i;
+  // A leading ']' is a member of the class.
+  if (i < pattern.size() && pattern[i] == ']')
+    ++i;
+
+  while (i < pattern.size() && pattern[i] != ']') {
+    if (pattern[i] == '\\') {
+      i += 2;
+    } else if (pattern[i] == '[' && i + 1 < pattern.size() &&
+               pattern[i + 1] == ':') {
+      // A POSIX class like [:alpha:].
+      size_t end = pattern.find(":]", i + 2);
+      i = end == base::StringPiece::npos ? pattern.size() : end + 2;
+    } else {
+      ++i;
+    }
+  }
+
+  return std::min(i + 1, pattern.size());
+}
+
+}  // namespace
+
+TrigramIndex::TrigramIndex() : num_rows_(0) {
+}
+
+TrigramIndex::~TrigramIndex() {
+}
+
+void TrigramIndex::AddRow(const base::StringPiece& text) {
+  std::vector<Trigram> trigrams;
+  GetTrigrams(text, &trigrams);
+  std::sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(std::unique(trigrams.begin(), trigrams.end()),
+                 trigrams.end());
+
+  uint32 row = static_cast<uint32>(num_rows_);
+  for (size_t i = 0; i < trigrams.size(); ++i)
+    trigrams_[trigrams[i]].Add(row);
+
+  ++num_rows_;
+}
+
+void TrigramIndex::Clear() {
+  trigrams_.clear();
+  num_rows_ = 0;
+}
+
+void TrigramIndex::RemoveFront(size_t count) {
+  DCHECK_LE(count, num_rows_);
+
+  // Trigrams left with no rows are dropped.
+  TrigramMap::iterator it(trigrams_.begin());
+  while (it != trigrams_.end()) {
+    it->second.RemoveFront(static_cast<uint32>(count));
+    if (it->second.empty())
+      trigrams_.erase(it++);
+    else
+      ++it;
+  }
+
+  num_rows_ -= count;
+}
+
+bool TrigramIndex::GetCandidates(const std::vector<std::string>& literals,
+                                 RowBitmap* rows) const {
+  DCHECK(rows != NULL);
+
+  std::vector<Trigram> trigrams;
+  for (size_t i = 0; i < literals.size(); ++i)
+    GetTrigrams(literals[i], &trigrams);
+  if (trigrams.empty())
+    return false;
+
+  std::sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(std::unique(trigrams.begin(), trigrams.end()),
+                 trigrams.end());
+
+  // Intersect the rows of each trigram, smallest first, so the
+  // intersection is small from the start.
+  std::vector<std::pair<size_t, const RowBitmap*> > bitmaps;
+  for (size_t i = 0; i < trigrams.size(); ++i) {
+    TrigramMap::const_iterator it = trigrams_.find(trigrams[i]);
+    if (it == trigrams_.end()) {
+      rows->Clear();
+      return true;
+    }
+    bitmaps.push_back(std::make_pair(it->second.size(), &it->second));
+  }
+  std::sort(bitmaps.begin(), bitmaps.end());
+
+  *rows = *bitmaps[0].second;
+  for (size_t i = 1; i < bitmaps.size() && !rows->empty(); ++i)
+    rows->Intersect(*bitmaps[i].second);
+
+  return true;
+}
+
+// static
+void TrigramIndex::ExtractLiterals(const base::StringPiece& pattern,
+                                   bool caseless,
+                                   std::vector<std::string>* literals) {
+  DCHECK(literals != NULL);
+
+  literals->clear();
+  LiteralBuilder builder(caseless, literals);
+
+  // Literals are only taken outside of groups, as a group may be
+  // optional, or hold alternatives.
+  int depth = 0;
+  size_t i = 0;
+  while (i < pattern.size()) {
+    char c = pattern[i];
+    switch (c) {
+      case '|':
+        // With alternatives, no literal is certain.
+        builder.Fail();
+        return;
+
+      case '\\': {
+        if (i + 1 == pattern.size()) {
+          builder.Fail();
+          return;
+        }
+        char escaped = pattern[i + 1];
+        if (!IsAlphaNumeric(escaped)) {
+          if (depth == 0)
+            builder.Append(escaped);
+          else
+            builder.End();
+        } else if (strchr(kClassEscapes, escaped) != NULL) {
+          builder.End();
+        } else {
+          // Escapes with arguments, quoting, back references and the
+          // like aren't worth parsing.
+          builder.Fail();
+          return;
+        }
+        i += 2;
+        break;
+      }
+
+      case '[':
+        builder.End();
+        i = SkipClass(pattern, i);
+        break;
+
+      case '(':
+        // Option settings like (?x) may change how the rest is parsed.
+        if (i + 2 < pattern.size() && pattern[i + 1] == '?' &&
+            (IsAlphaNumeric(pattern[i + 2]) || pattern[i + 2] == '-')) {
+          builder.Fail();
+          return;
+        }
+        builder.End();
+        ++depth;
+        ++i;
+        break;
+
+      case ')':
+        builder.End();
+        if (--depth < 0) {
+          builder.Fail();
+          return;
+        }
+        ++i;
+        break;
+
+      case '*':
+      case '?':
+        builder.DropLast();
+        ++i;
+        break;
+
+      case '+':
+        builder.End();
+        ++i;
+        break;
+
+      case '{': {
+        int min = 0;
+        size_t length = ParseRepeat(pattern, i, &min);
+        if (length == 0) {
+          if (depth == 0)
+            builder.Append(c);
+          ++i;
+        } else {
+          if (min == 0)
+            builder.DropLast();
+          else
+            builder.End();
+          i += length;
+        }
+        break;
+      }
+
+      case '.':
+      case '^':
+      case '$':
+        builder.End();
+        ++i;
+        break;
+
+      default:
+        if (depth == 0)
+          builder.Append(c);
+        ++i;
+        break;
+    }
+  }
+
+  builder.End();
+}
+
+// static
+void TrigramIndex::GetTrigrams(const base::StringPiece& text,
+                               std::vector<Trigram>* trigrams) {
+  DCHECK(trigrams != NULL);
+
+  if (text.size() < 3)
+    return;
+
+  Trigram trigram = (FoldCase(text[0]) << 8) | FoldCase(text[1]);
+  for (size_t i = 2; i < text.size(); ++i) {
+    trigram = ((trigram << 8) | FoldCase(text[i])) & 0xFFFFFF;
+    trigrams->push_back(trigram);
+  }
+}
@@ -0,0 +1,95 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// An inverted index of the trigrams of rows of text.
+#ifndef SAWBUCK_COMMON_TRIGRAM_INDEX_H_
+#define SAWBUCK_COMMON_TRIGRAM_INDEX_H_
+
+#include <string>
+#include <vector>
+#include "base/basictypes.h"
+#include "base/containers/hash_tables.h"
+#include "base/strings/string_piece.h"
+#include "sawbuck/common/row_bitmap.h"
+
+// Keeps a RowBitmap of the rows containing each distinct trigram, that is
+// each run of three bytes, of rows of text. A row can only contain a
+// literal string if it contains all of the literal's trigrams, so the
+// index narrows a search for a literal, or for a regular expression
+// that requires literals, to a few candidate rows. The candidates must
+// still be matched, as they may contain the trigrams apart.
+//
+// ASCII letters are indexed case insensitively, and other bytes as they
+// are, so the candidates serve both case sensitive and insensitive
+// searches. Rows are added in order.
+class TrigramIndex {
+ public:
+  // The shortest literal the index can narrow a search for.
+  static const size_t kMinLiteralLength = 3;
+
+  TrigramIndex();
+  ~TrigramIndex();
+
+  // Indexes the next row, whose text is @p text.
+  void AddRow(const base::StringPiece& text);
+
+  // Discards all rows.
+  void Clear();
+
+  // Discards the first @p count rows, and renumbers the rest down by
+  // @p count, which must be a multiple of RowBitmap::kChunkSize.
+  void RemoveFront(size_t count);
+
+  // @returns the number of rows indexed.
+  size_t num_rows() const { return num_rows_; }
+
+  // @returns the number of distinct trigrams indexed.
+  size_t num_trigrams() const { return trigrams_.size(); }
+
+  // Finds the rows that may contain all of @p literals.
+  // @param rows on success returns the candidate rows.
+  // @returns true on success, or false if none of @p literals is long
+  //     enough to narrow the search.
+  bool GetCandidates(const std::vector<std::string>& literals,
+                     RowBitmap* rows) const;
+
+  // Extracts literal strings any match of a regular expression contains.
+  // The parse is conservative: parts of @p pattern that aren't plainly
+  // literal, including anything optional, grouped or alternative, yield
+  // no literals.
+  // @param pattern a PCRE regular expression.
+  // @param caseless true iff @p pattern is matched case insensitively,
+  //     in which case non-ASCII characters, whose other cases aren't
+  //     indexed, are left out of the literals.
+  // @param literals returns the literals of at least kMinLiteralLength
+  //     bytes that every match contains.
+  static void ExtractLiterals(const base::StringPiece& pattern,
+                              bool caseless,
+                              std::vector<std::string>* literals);
+
+ private:
+  typedef uint32 Trigram;
+  typedef base::hash_map<Trigram, RowBitmap> TrigramMap;
+
+  // Appends the trigrams of @p text to @p trigrams.
+  static void GetTrigrams(const base::StringPiece& text,
+                          std::vector<Trigram>* trigrams);
+
+  TrigramMap trigrams_;
+  size_t num_rows_;
+
+  DISALLOW_COPY_AND_ASSIGN(TrigramIndex);
+};
+
+#endif  // SAWBUCK_COMMON_TRIGRAM_INDEX_H_
@@ -0,0 +1,173 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/common/trigram_index.h"
+
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+
+std::vector<std::string> Literals(const char* pattern, bool caseless) {
+  std::vector<std::string> literals;
+  TrigramIndex::ExtractLiterals(pattern, caseless, &literals);
+  return literals;
+}
+
+std::string JoinedLiterals(const char* pattern) {
+  std::vector<std::string> literals(Literals(pattern, true));
+  std::string joined;
+  for (size_t i = 0; i < literals.size(); ++i) {
+    if (i != 0)
+      joined += ",";
+    joined += literals[i];
+  }
+  return joined;
+}
+
+std::vector<int> Candidates(const TrigramIndex& index, const char* literal) {
+  std::vector<std::string> literals(1, literal);
+  RowBitmap rows;
+  EXPECT_TRUE(index.GetCandidates(literals, &rows));
+
+  std::vector<int> candidates;
+  rows.AppendRows(0, kuint32max, &candidates);
+  return candidates;
+}
+
+TEST(TrigramIndexTest, GetCandidates) {
+  TrigramIndex index;
+  index.AddRow("Hello world");
+  index.AddRow("Goodbye WORLD");
+  index.AddRow("wor ld");
+  index.AddRow("");
+  EXPECT_EQ(4U, index.num_rows());
+
+  std::vector<int> rows(Candidates(index, "World"));
+  ASSERT_EQ(2U, rows.size());
+  EXPECT_EQ(0, rows[0]);
+  EXPECT_EQ(1, rows[1]);
+
+  // Candidates have every trigram, though perhaps not in order.
+  index.AddRow("rld worl");
+  rows = Candidates(index, "world");
+  ASSERT_EQ(3U, rows.size());
+  EXPECT_EQ(4, rows[2]);
+
+  EXPECT_TRUE(Candidates(index, "planet").empty());
+
+  // Literals too short to narrow the search.
+  std::vector<std::string> literals(1, "wo");
+  RowBitmap candidates;
+  EXPECT_FALSE(index.GetCandidates(literals, &candidates));
+
+  index.Clear();
+  EXPECT_EQ(0U, index.num_rows());
+  EXPECT_EQ(0U, index.num_trigrams());
+  EXPECT_TRUE(Candidates(index, "world").empty());
+}
+
+TEST(TrigramIndexTest, RemoveFront) {
+  TrigramIndex index;
+  for (size_t i = 0; i < RowBitmap::kChunkSize; ++i)
+    index.AddRow("Hello world");
+  index.AddRow("Goodbye world");
+  EXPECT_LT(0U, index.num_trigrams());
+
+  index.RemoveFront(RowBitmap::kChunkSize);
+  EXPECT_EQ(1U, index.num_rows());
+  EXPECT_TRUE(Candidates(index, "Hello").empty());
+  std::vector<int> rows(Candidates(index, "world"));
+  ASSERT_EQ(1U, rows.size());
+  EXPECT_EQ(0, rows[0]);
+
+  // Only the remaining row's trigrams are left.
+  index.RemoveFront(0);
+  TrigramIndex goodbye;
+  goodbye.AddRow("Goodbye world");
+  EXPECT_EQ(goodbye.num_trigrams(), index.num_trigrams());
+}
+
+TEST(TrigramIndexTest, GetCandidatesForSeveralLiterals) {
+  TrigramIndex index;
+  index.AddRow("Opened foo.txt");
+  index.AddRow("Closed foo.txt");
+  index.AddRow("Opened bar.txt");
+
+  std::vector<std::string> literals;
+  literals.push_back("Opened");
+  literals.push_back("foo");
+  RowBitmap rows;
+  ASSERT_TRUE(index.GetCandidates(literals, &rows));
+  EXPECT_EQ(1U, rows.size());
+  EXPECT_TRUE(rows.Contains(0));
+}
+
+TEST(TrigramIndexTest, ExtractPlainLiterals) {
+  EXPECT_EQ("hello world", JoinedLiterals("hello world"));
+  EXPECT_EQ("foo,bar", JoinedLiterals("^foo.*bar$"));
+  EXPECT_EQ("foo.txt", JoinedLiterals("foo\\.txt"));
+  EXPECT_EQ("abc,def", JoinedLiterals("abc\\d+def"));
+  EXPECT_EQ("abc,def", JoinedLiterals("abc[0-9]def"));
+  EXPECT_EQ("abc,def", JoinedLiterals("abc[]x[:alpha:]]def"));
+  EXPECT_EQ("a{b", JoinedLiterals("a{b"));
+  EXPECT_EQ("", JoinedLiterals("ab"));
+}
+
+TEST(TrigramIndexTest, ExtractLiteralsSkipsOptionalParts) {
+  // Quantifiers that allow no repetition drop the last character.
+  EXPECT_EQ("abc,efg", JoinedLiterals("abcd?efg"));
+  EXPECT_EQ("abc,efg", JoinedLiterals("abcd*efg"));
+  EXPECT_EQ("abc,efg", JoinedLiterals("abcd{0,2}efg"));
+  EXPECT_EQ("abcd,efg", JoinedLiterals("abcd{1,2}efg"));
+  EXPECT_EQ("abcd,efg", JoinedLiterals("abcd+efg"));
+
+  // Groups are skipped.
+  EXPECT_EQ("abc,efg", JoinedLiterals("abc(def)?efg"));
+  EXPECT_EQ("efg", JoinedLiterals("(?:abc)efg"));
+}
+
+TEST(TrigramIndexTest, ExtractNoLiterals) {
+  // Alternatives anywhere leave no literal certain.
+  EXPECT_EQ("", JoinedLiterals("hello|world"));
+  EXPECT_EQ("", JoinedLiterals("hello (a|b) world"));
+
+  // Escapes that aren't worth parsing.
+  EXPECT_EQ("", JoinedLiterals("hello\\x41world"));
+  EXPECT_EQ("", JoinedLiterals("\\Qa.b\\E hello"));
+
+  // Option settings.
+  EXPECT_EQ("", JoinedLiterals("(?x) hello world"));
+
+  // Unbalanced groups.
+  EXPECT_EQ("", JoinedLiterals("hello) world"));
+}
+
+TEST(TrigramIndexTest, ExtractNonAsciiLiterals) {
+  // Case sensitive searches keep non-ASCII characters, and drop them
+  // whole when they're optional.
+  std::vector<std::string> literals(Literals("caf\xC3\xA9s", false));
+  ASSERT_EQ(1U, literals.size());
+  EXPECT_EQ("caf\xC3\xA9s", literals[0]);
+  literals = Literals("caf\xC3\xA9?s", false);
+  ASSERT_EQ(1U, literals.size());
+  EXPECT_EQ("caf", literals[0]);
+
+  // Case insensitive searches break literals at them.
+  literals = Literals("caf\xC3\xA9s", true);
+  ASSERT_EQ(1U, literals.size());
+  EXPECT_EQ("caf", literals[0]);
+}
+
+}  // namespace
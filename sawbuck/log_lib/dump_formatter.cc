@@ -0,0 +1,419 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Dump record and formatter implementations.
+#include "sawbuck/log_lib/dump_formatter.h"
+
+#include <algorithm>
+#include <string.h>
+#include "base/logging.h"
+
+namespace {
+
+const char* const kTypeNames[] = {
+  "log",
+  "trace_begin",
+  "trace_end",
+  "trace_instant",
+  "process_is_running",
+  "process_started",
+  "process_ended",
+  "module_is_loaded",
+  "module_load",
+  "module_unload",
+  "transition_fault",
+  "demand_zero_fault",
+  "copy_on_write_fault",
+  "guard_page_fault",
+  "hard_fault",
+  "access_violation_fault",
+  "hard_page_fault",
+};
+COMPILE_ASSERT(arraysize(kTypeNames) == DumpRecord::NUM_TYPES,
+               type_names_mismatch);
+
+const char* const kColumnNames[] = {
+  "type", "time", "process_id", "thread_id", "level", "line", "address",
+  "value", "size", "file_object", "latency", "file", "text",
+};
+
+// base::Time counts microseconds from the Windows epoch, 1601-01-01.
+const int64 kMicrosecondsPerSecond = 1000000;
+const int64 kSecondsPerDay = 24 * 60 * 60;
+const int64 kDaysFrom1601To1970 = 134774;
+
+// @returns @p a divided by @p b, rounded towards negative infinity.
+int64 FloorDivide(int64 a, int64 b) {
+  int64 quotient = a / b;
+  if ((a % b != 0) && ((a < 0) != (b < 0)))
+    --quotient;
+  return quotient;
+}
+
+// Appends @p value to @p out, zero padded to @p width digits.
+void AppendPadded(uint32 value, size_t width, std::string* out) {
+  char digits[10];
+  size_t i = width;
+  while (i != 0) {
+    digits[--i] = '0' + value % 10;
+    value /= 10;
+  }
+  out->append(digits, width);
+}
+
+// Appends @p value in its native, little-endian byte order.
+void AppendRawUInt32(uint32 value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendRawUInt64(uint64 value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Formats records as separated values.
+class DelimitedFormatter : public DumpFormatter {
+ public:
+  explicit DelimitedFormatter(char separator) : separator_(separator) {
+  }
+
+  virtual void AppendHeader(std::string* out) {
+    for (size_t i = 0; i < arraysize(kColumnNames); ++i) {
+      if (i != 0)
+        out->push_back(separator_);
+      out->append(kColumnNames[i]);
+    }
+    out->push_back('\n');
+  }
+
+  virtual void AppendRecord(const DumpRecord& record, std::string* out) {
+    out->append(GetTypeName(record.type));
+    out->push_back(separator_);
+    AppendTime(record.time, out);
+    out->push_back(separator_);
+    AppendDecimal(record.process_id, out);
+    out->push_back(separator_);
+    AppendDecimal(record.thread_id, out);
+    out->push_back(separator_);
+    AppendSignedDecimal(record.level, out);
+    out->push_back(separator_);
+    AppendSignedDecimal(record.line, out);
+    out->push_back(separator_);
+    AppendHex(record.address, out);
+    out->push_back(separator_);
+    AppendDecimal(record.value, out);
+    out->push_back(separator_);
+    AppendDecimal(record.size, out);
+    out->push_back(separator_);
+    AppendHex(record.file_object, out);
+    out->push_back(separator_);
+    AppendSignedDecimal(record.latency, out);
+    out->push_back(separator_);
+    AppendString(record.file, out);
+    out->push_back(separator_);
+    AppendString(record.text, out);
+    out->push_back('\n');
+  }
+
+ private:
+  void AppendString(const std::string& str, std::string* out) {
+    if (separator_ == '\t')
+      AppendTabEscaped(str, out);
+    else
+      AppendQuoted(str, out);
+  }
+
+  void AppendTabEscaped(const std::string& str, std::string* out) {
+    size_t start = 0;
+    for (size_t i = 0; i < str.size(); ++i) {
+      char escape = 0;
+      switch (str[i]) {
+        case '\t': escape = 't'; break;
+        case '\n': escape = 'n'; break;
+        case '\r': escape = 'r'; break;
+        case '\\': escape = '\\'; break;
+        default: continue;
+      }
+      out->append(str, start, i - start);
+      out->push_back('\\');
+      out->push_back(escape);
+      start = i + 1;
+    }
+    out->append(str, start, str.size() - start);
+  }
+
+  void AppendQuoted(const std::string& str, std::string* out) {
+    if (str.find_first_of(",\"\r\n") == std::string::npos) {
+      out->append(str);
+      return;
+    }
+
+    out->push_back('"');
+    size_t start = 0;
+    size_t quote = str.find('"');
+    while (quote != std::string::npos) {
+      out->append(str, start, quote + 1 - start);
+      out->push_back('"');
+      start = quote + 1;
+      quote = str.find('"', start);
+    }
+    out->append(str, start, str.size() - start);
+    out->push_back('"');
+  }
+
+  char separator_;
+};
+
+// Formats records as a JSON object per line.
+class JsonLinesFormatter : public DumpFormatter {
+ public:
+  virtual void AppendHeader(std::string* out) {
+  }
+
+  virtual void AppendRecord(const DumpRecord& record, std::string* out) {
+    out->append("{\"type\":\"");
+    out->append(GetTypeName(record.type));
+    out->append("\",\"time\":\"");
+    AppendTime(record.time, out);
+    out->append("\",\"process_id\":");
+    AppendDecimal(record.process_id, out);
+    out->append(",\"thread_id\":");
+    AppendDecimal(record.thread_id, out);
+    out->append(",\"level\":");
+    AppendSignedDecimal(record.level, out);
+    out->append(",\"line\":");
+    AppendSignedDecimal(record.line, out);
+    // 64 bit values don't survive JSON numbers, so these are strings.
+    out->append(",\"address\":\"");
+    AppendHex(record.address, out);
+    out->append("\",\"value\":\"");
+    AppendDecimal(record.value, out);
+    out->append("\",\"size\":\"");
+    AppendDecimal(record.size, out);
+    out->append("\",\"file_object\":\"");
+    AppendHex(record.file_object, out);
+    out->append("\",\"latency\":");
+    AppendSignedDecimal(record.latency, out);
+    out->append(",\"file\":");
+    AppendJsonString(record.file, out);
+    out->append(",\"text\":");
+    AppendJsonString(record.text, out);
+    out->append("}\n");
+  }
+
+ private:
+  static void AppendJsonString(const std::string& str, std::string* out) {
+    static const char kHexDigits[] = "0123456789abcdef";
+
+    out->push_back('"');
+    size_t start = 0;
+    for (size_t i = 0; i < str.size(); ++i) {
+      unsigned char c = static_cast<unsigned char>(str[i]);
+      if (c >= 0x20 && c != '"' && c != '\\')
+        continue;
+
+      out->append(str, start, i - start);
+      start = i + 1;
+      switch (c) {
+        case '"': out->append("\\\""); break;
+        case '\\': out->append("\\\\"); break;
+        case '\n': out->append("\\n"); break;
+        case '\r': out->append("\\r"); break;
+        case '\t': out->append("\\t"); break;
+        default:
+          out->append("\\u00");
+          out->push_back(kHexDigits[c >> 4]);
+          out->push_back(kHexDigits[c & 0xF]);
+          break;
+      }
+    }
+    out->append(str, start, str.size() - start);
+    out->push_back('"');
+  }
+};
+
+// Formats records in the binary format.
+class BinaryFormatter : public DumpFormatter {
+ public:
+  virtual void AppendHeader(std::string* out) {
+    out->append(kBinaryMagic, sizeof(kBinaryMagic));
+  }
+
+  virtual void AppendRecord(const DumpRecord& record, std::string* out) {
+    const size_t kFixedSize = 4 + 1 + 8 + 4 * 4 + 4 * 8 + 8 + 2 * 4;
+    size_t size = kFixedSize + record.file.size() + record.text.size();
+
+    AppendRawUInt32(static_cast<uint32>(size), out);
+    out->push_back(static_cast<char>(record.type));
+    AppendRawUInt64(record.time.ToInternalValue(), out);
+    AppendRawUInt32(record.process_id, out);
+    AppendRawUInt32(record.thread_id, out);
+    AppendRawUInt32(record.level, out);
+    AppendRawUInt32(record.line, out);
+    AppendRawUInt64(record.address, out);
+    AppendRawUInt64(record.value, out);
+    AppendRawUInt64(record.size, out);
+    AppendRawUInt64(record.file_object, out);
+    AppendRawUInt64(record.latency, out);
+    AppendRawUInt32(static_cast<uint32>(record.file.size()), out);
+    AppendRawUInt32(static_cast<uint32>(record.text.size()), out);
+    out->append(record.file);
+    out->append(record.text);
+  }
+};
+
+}  // namespace
+
+DumpRecord::DumpRecord() {
+  Clear();
+}
+
+void DumpRecord::Clear() {
+  type = LOG_MESSAGE;
+  time = base::Time();
+  process_id = 0;
+  thread_id = 0;
+  level = 0;
+  line = 0;
+  address = 0;
+  value = 0;
+  size = 0;
+  file_object = 0;
+  latency = 0;
+  file.clear();
+  text.clear();
+}
+
+const char DumpFormatter::kBinaryMagic[8] = {
+  'S', 'A', 'W', 'D', 'U', 'M', 'P', '1'
+};
+
+// static
+DumpFormatter* DumpFormatter::Create(Format format) {
+  switch (format) {
+    case TSV:
+      return new DelimitedFormatter('\t');
+    case CSV:
+      return new DelimitedFormatter(',');
+    case JSON_LINES:
+      return new JsonLinesFormatter();
+    case BINARY:
+      return new BinaryFormatter();
+  }
+
+  NOTREACHED();
+  return NULL;
+}
+
+// static
+bool DumpFormatter::ParseFormat(const base::StringPiece& name,
+                                Format* format) {
+  DCHECK(format != NULL);
+  if (name == "tsv") {
+    *format = TSV;
+  } else if (name == "csv") {
+    *format = CSV;
+  } else if (name == "jsonl") {
+    *format = JSON_LINES;
+  } else if (name == "binary") {
+    *format = BINARY;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+// static
+const char* DumpFormatter::GetTypeName(DumpRecord::Type type) {
+  DCHECK_LT(type, DumpRecord::NUM_TYPES);
+  return kTypeNames[type];
+}
+
+// static
+void DumpFormatter::AppendDecimal(uint64 value, std::string* out) {
+  char digits[20];
+  size_t i = sizeof(digits);
+  do {
+    digits[--i] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+  out->append(digits + i, sizeof(digits) - i);
+}
+
+// static
+void DumpFormatter::AppendSignedDecimal(int64 value, std::string* out) {
+  if (value < 0) {
+    out->push_back('-');
+    // Negate in unsigned arithmetic, which is defined for the minimum.
+    AppendDecimal(0 - static_cast<uint64>(value), out);
+  } else {
+    AppendDecimal(static_cast<uint64>(value), out);
+  }
+}
+
+// static
+void DumpFormatter::AppendHex(uint64 value, std::string* out) {
+  static const char kHexDigits[] = "0123456789ABCDEF";
+
+  char digits[18];
+  size_t i = sizeof(digits);
+  do {
+    digits[--i] = kHexDigits[value & 0xF];
+    value >>= 4;
+  } while (value != 0);
+  digits[--i] = 'x';
+  digits[--i] = '0';
+  out->append(digits + i, sizeof(digits) - i);
+}
+
+// static
+void DumpFormatter::AppendTime(const base::Time& time, std::string* out) {
+  int64 microseconds = time.ToInternalValue();
+  int64 seconds = FloorDivide(microseconds, kMicrosecondsPerSecond);
+  int64 days = FloorDivide(seconds, kSecondsPerDay);
+  uint32 second_of_day = static_cast<uint32>(seconds - days * kSecondsPerDay);
+  uint32 microsecond =
+      static_cast<uint32>(microseconds - seconds * kMicrosecondsPerSecond);
+
+  // Convert days since 1970 to a civil date, after H. Hinnant's
+  // civil_from_days, in eras of 400 years starting on March 1st.
+  int64 z = days - kDaysFrom1601To1970 + 719468;
+  int64 era = FloorDivide(z, 146097);
+  uint32 day_of_era = static_cast<uint32>(z - era * 146097);
+  uint32 year_of_era = (day_of_era - day_of_era / 1460 +
+                        day_of_era / 36524 - day_of_era / 146096) / 365;
+  uint32 day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  uint32 shifted_month = (5 * day_of_year + 2) / 153;
+  uint32 day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+  uint32 month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+  int64 year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+
+  // Years before the Windows epoch only come from bogus times.
+  AppendPadded(static_cast<uint32>(std::max(year, static_cast<int64>(0))),
+               4, out);
+  out->push_back('-');
+  AppendPadded(month, 2, out);
+  out->push_back('-');
+  AppendPadded(day, 2, out);
+  out->push_back('T');
+  AppendPadded(second_of_day / 3600, 2, out);
+  out->push_back(':');
+  AppendPadded(second_of_day / 60 % 60, 2, out);
+  out->push_back(':');
+  AppendPadded(second_of_day % 60, 2, out);
+  out->push_back('.');
+  AppendPadded(microsecond, 6, out);
+  out->push_back('Z');
+}
@@ -0,0 +1,131 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Dump record and formatter declarations.
+#ifndef SAWBUCK_LOG_LIB_DUMP_FORMATTER_H_
+#define SAWBUCK_LOG_LIB_DUMP_FORMATTER_H_
+
+#include <string>
+#include "base/basictypes.h"
+#include "base/strings/string_piece.h"
+#include "base/time/time.h"
+
+// An event, flattened to the columns dump_logs writes. What the generic
+// columns hold depends on the type of event:
+//   address: the trace event id, module base or faulting address.
+//   value: the program counter of page faults, the file offset of hard
+//       page faults, the parent process id of process events, or the
+//       exit status of process ends.
+//   size: the module size, or the byte count of hard page faults.
+//   file_object: the file object of hard page faults.
+//   latency: the I/O latency of hard page faults, in microseconds.
+//   file: the source file of log messages, or the image name of module
+//       and process events.
+//   text: the log message, the trace event name, or the command line of
+//       process events.
+struct DumpRecord {
+  enum Type {
+    LOG_MESSAGE,
+    TRACE_BEGIN,
+    TRACE_END,
+    TRACE_INSTANT,
+    PROCESS_IS_RUNNING,
+    PROCESS_STARTED,
+    PROCESS_ENDED,
+    MODULE_IS_LOADED,
+    MODULE_LOAD,
+    MODULE_UNLOAD,
+    TRANSITION_FAULT,
+    DEMAND_ZERO_FAULT,
+    COPY_ON_WRITE_FAULT,
+    GUARD_PAGE_FAULT,
+    HARD_FAULT,
+    ACCESS_VIOLATION_FAULT,
+    HARD_PAGE_FAULT,
+    NUM_TYPES
+  };
+
+  DumpRecord();
+
+  // Resets all fields, keeping the capacity of the strings.
+  void Clear();
+
+  Type type;
+  base::Time time;
+  uint32 process_id;
+  uint32 thread_id;
+  int32 level;
+  int32 line;
+  uint64 address;
+  uint64 value;
+  uint64 size;
+  uint64 file_object;
+  int64 latency;
+  std::string file;
+  std::string text;
+};
+
+// Formats dump records to one of the dump formats.
+//
+// The binary format starts with kBinaryMagic, followed by the records.
+// Each record is, in little-endian order: its total size as a uint32, its
+// type as a uint8, the time's internal value as an int64, process_id and
+// thread_id as uint32s, level and line as int32s, address, value, size and
+// file_object as uint64s, latency as an int64, the lengths of file and
+// text as uint32s, and finally the bytes of file and text.
+class DumpFormatter {
+ public:
+  enum Format {
+    // Tab separated values, with tabs, newlines and backslashes in
+    // strings escaped with backslashes.
+    TSV,
+    // Comma separated values, quoted as in RFC 4180.
+    CSV,
+    // A JSON object per line.
+    JSON_LINES,
+    // Binary records, as above.
+    BINARY,
+  };
+
+  static const char kBinaryMagic[8];
+
+  virtual ~DumpFormatter() {
+  }
+
+  // @returns a new formatter for @p format.
+  static DumpFormatter* Create(Format format);
+
+  // Parses a format name, one of "tsv", "csv", "jsonl" or "binary".
+  // @param format on success returns the format.
+  // @returns true iff @p name names a format.
+  static bool ParseFormat(const base::StringPiece& name, Format* format);
+
+  // @returns the name of @p type, as formatted.
+  static const char* GetTypeName(DumpRecord::Type type);
+
+  // Appends what precedes the records in the output to @p out.
+  virtual void AppendHeader(std::string* out) = 0;
+
+  // Appends @p record to @p out.
+  virtual void AppendRecord(const DumpRecord& record, std::string* out) = 0;
+
+  // Fast formatting helpers, which append to @p out.
+  static void AppendDecimal(uint64 value, std::string* out);
+  static void AppendSignedDecimal(int64 value, std::string* out);
+  static void AppendHex(uint64 value, std::string* out);
+  // Appends @p time as ISO 8601 UTC, with microseconds.
+  static void AppendTime(const base::Time& time, std::string* out);
+};
+
+#endif  // SAWBUCK_LOG_LIB_DUMP_FORMATTER_H_
@@ -0,0 +1,173 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/log_lib/dump_formatter.h"
+
+#include <string.h>
+#include "base/memory/scoped_ptr.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+std::string Decimal(uint64 value) {
+  std::string out;
+  DumpFormatter::AppendDecimal(value, &out);
+  return out;
+}
+
+std::string SignedDecimal(int64 value) {
+  std::string out;
+  DumpFormatter::AppendSignedDecimal(value, &out);
+  return out;
+}
+
+std::string Hex(uint64 value) {
+  std::string out;
+  DumpFormatter::AppendHex(value, &out);
+  return out;
+}
+
+std::string TimeString(int64 internal_value) {
+  std::string out;
+  DumpFormatter::AppendTime(base::Time::FromInternalValue(internal_value),
+                            &out);
+  return out;
+}
+
+DumpRecord MakeRecord() {
+  DumpRecord record;
+  record.type = DumpRecord::LOG_MESSAGE;
+  record.time = base::Time::FromInternalValue(13038105599999999LL);
+  record.process_id = 1234;
+  record.thread_id = 5678;
+  record.level = -1;
+  record.line = 42;
+  record.address = 0xBEEF;
+  record.file = "foo.cc";
+  record.text = "Hello";
+  return record;
+}
+
+std::string Format(DumpFormatter::Format format, const DumpRecord& record) {
+  scoped_ptr<DumpFormatter> formatter(DumpFormatter::Create(format));
+  std::string out;
+  formatter->AppendRecord(record, &out);
+  return out;
+}
+
+TEST(DumpFormatterTest, Numbers) {
+  EXPECT_EQ("0", Decimal(0));
+  EXPECT_EQ("1234567890", Decimal(1234567890));
+  EXPECT_EQ("18446744073709551615", Decimal(0xFFFFFFFFFFFFFFFFULL));
+
+  EXPECT_EQ("0", SignedDecimal(0));
+  EXPECT_EQ("-42", SignedDecimal(-42));
+  EXPECT_EQ("-9223372036854775808", SignedDecimal(-kint64max - 1));
+
+  EXPECT_EQ("0x0", Hex(0));
+  EXPECT_EQ("0xDEADBEEF", Hex(0xDEADBEEF));
+  EXPECT_EQ("0xFFFFFFFFFFFFFFFF", Hex(0xFFFFFFFFFFFFFFFFULL));
+}
+
+TEST(DumpFormatterTest, Times) {
+  EXPECT_EQ("1601-01-01T00:00:00.000000Z", TimeString(0));
+  EXPECT_EQ("1970-01-01T00:00:00.000000Z", TimeString(11644473600000000LL));
+  EXPECT_EQ("2014-02-28T23:59:59.999999Z", TimeString(13038105599999999LL));
+  EXPECT_EQ("2000-02-29T12:34:56.000007Z", TimeString(12596301296000007LL));
+}
+
+TEST(DumpFormatterTest, ParseFormat) {
+  DumpFormatter::Format format = DumpFormatter::TSV;
+  EXPECT_TRUE(DumpFormatter::ParseFormat("csv", &format));
+  EXPECT_EQ(DumpFormatter::CSV, format);
+  EXPECT_TRUE(DumpFormatter::ParseFormat("jsonl", &format));
+  EXPECT_EQ(DumpFormatter::JSON_LINES, format);
+  EXPECT_TRUE(DumpFormatter::ParseFormat("binary", &format));
+  EXPECT_EQ(DumpFormatter::BINARY, format);
+  EXPECT_TRUE(DumpFormatter::ParseFormat("tsv", &format));
+  EXPECT_EQ(DumpFormatter::TSV, format);
+  EXPECT_FALSE(DumpFormatter::ParseFormat("xml", &format));
+}
+
+TEST(DumpFormatterTest, Tsv) {
+  DumpRecord record = MakeRecord();
+  EXPECT_EQ("log\t2014-02-28T23:59:59.999999Z\t1234\t5678\t-1\t42\t0xBEEF"
+            "\t0\t0\t0x0\t0\tfoo.cc\tHello\n",
+            Format(DumpFormatter::TSV, record));
+
+  record.text = "a\tb\nc\\";
+  std::string out = Format(DumpFormatter::TSV, record);
+  EXPECT_NE(std::string::npos, out.find("\tfoo.cc\ta\\tb\\nc\\\\\n"));
+
+  scoped_ptr<DumpFormatter> formatter(
+      DumpFormatter::Create(DumpFormatter::TSV));
+  std::string header;
+  formatter->AppendHeader(&header);
+  EXPECT_EQ(0U, header.find("type\ttime\tprocess_id"));
+}
+
+TEST(DumpFormatterTest, Csv) {
+  DumpRecord record = MakeRecord();
+  record.text = "plain";
+  std::string out = Format(DumpFormatter::CSV, record);
+  EXPECT_EQ(0U, out.find("log,2014-02-28T23:59:59.999999Z,1234,"));
+  EXPECT_NE(std::string::npos, out.find(",foo.cc,plain\n"));
+
+  record.text = "say \"hi\", then\nleave";
+  out = Format(DumpFormatter::CSV, record);
+  EXPECT_NE(std::string::npos,
+            out.find(",\"say \"\"hi\"\", then\nleave\"\n"));
+}
+
+TEST(DumpFormatterTest, JsonLines) {
+  DumpRecord record = MakeRecord();
+  record.text = "q\"b\\\x01";
+  EXPECT_EQ("{\"type\":\"log\",\"time\":\"2014-02-28T23:59:59.999999Z\","
+            "\"process_id\":1234,\"thread_id\":5678,\"level\":-1,"
+            "\"line\":42,\"address\":\"0xBEEF\",\"value\":\"0\","
+            "\"size\":\"0\",\"file_object\":\"0x0\",\"latency\":0,"
+            "\"file\":\"foo.cc\",\"text\":\"q\\\"b\\\\\\u0001\"}\n",
+            Format(DumpFormatter::JSON_LINES, record));
+}
+
+TEST(DumpFormatterTest, Binary) {
+  DumpRecord record = MakeRecord();
+  std::string out = Format(DumpFormatter::BINARY, record);
+
+  uint32 size = 0;
+  ASSERT_LE(sizeof(size), out.size());
+  memcpy(&size, out.data(), sizeof(size));
+  EXPECT_EQ(out.size(), size);
+  EXPECT_EQ(DumpRecord::LOG_MESSAGE, out[4]);
+
+  int64 time = 0;
+  memcpy(&time, out.data() + 5, sizeof(time));
+  EXPECT_EQ(record.time.ToInternalValue(), time);
+
+  uint32 process_id = 0;
+  memcpy(&process_id, out.data() + 13, sizeof(process_id));
+  EXPECT_EQ(1234U, process_id);
+
+  // The strings come last.
+  EXPECT_EQ(out.size() - 11, out.find("foo.ccHello"));
+
+  scoped_ptr<DumpFormatter> formatter(
+      DumpFormatter::Create(DumpFormatter::BINARY));
+  std::string header;
+  formatter->AppendHeader(&header);
+  EXPECT_EQ(std::string(DumpFormatter::kBinaryMagic,
+                        sizeof(DumpFormatter::kBinaryMagic)),
+            header);
+}
+
+}  // namespace
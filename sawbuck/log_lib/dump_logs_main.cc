@@ -12,68 +12,128 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 //
+#include <fcntl.h>
+#include <io.h>
+#include <stdio.h>
+#include <algorithm>
 #include <iostream>
 #include "base/at_exit.h"
 #include "base/command_line.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
 #include "base/logging.h"
+#include "base/memory/scoped_vector.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/string_piece.h"
 #include "base/strings/utf_string_conversions.h"
-#include "base/win/event_trace_consumer.h"
-#include "sawbuck/log_lib/kernel_log_consumer.h"
-#include "sawbuck/log_lib/log_consumer.h"
-
-
-// The log consumer class we use to parse the logs on our behalf.
-// There can only be one instance of this class in existence at a time.
-class DumpLogConsumer
-    : public base::win::EtwTraceConsumerBase<DumpLogConsumer>,
-      public KernelLogParser,
-      public LogParser {
- public:
-  DumpLogConsumer();
-  ~DumpLogConsumer();
-
-  static void ProcessEvent(EVENT_TRACE* event);
-
- private:
-  virtual void ProcessOneEvent(EVENT_TRACE* event);
-
-  // Our current instance pointer, used to route the
-  // log events to our sole instance.
-  static DumpLogConsumer* current_;
-};
-
-DumpLogConsumer* DumpLogConsumer::current_ = NULL;
-
-DumpLogConsumer::DumpLogConsumer() {
-  DCHECK(current_ == NULL);
-  current_ = this;
+#include "base/sys_info.h"
+#include "sawbuck/log_lib/dump_writer.h"
+#include "sawbuck/log_lib/etl_file_consumer.h"
+#include "sawbuck/log_lib/hard_fault_io_tracker.h"
+#include "sawbuck/log_lib/log_filter.h"
+#include "sawbuck/log_lib/page_fault_aggregator.h"
+#include "sawbuck/log_lib/sawlog_file.h"
+#include "sawbuck/log_lib/span_latency_stats.h"
+
+namespace {
+
+// Saved sessions, as written by the viewer, are recognized by extension.
+const wchar_t kSawlogExtension[] = L".sawlog";
+
+// The format events are dumped in, one of "tsv", the default, "csv",
+// "jsonl" or "binary".
+const char kFormatSwitch[] = "format";
+
+// A file of filters, as saved from the viewer's filter dialog. Only the
+// log and trace messages that match them are dumped or summarized.
+const char kFilterFileSwitch[] = "filter-file";
+
+// Restrict the log and trace messages dumped or summarized to those at
+// or after the start time, and before the end time, in any of the forms
+// base::Time::FromString takes, e.g. "2014-03-01 12:30:00".
+const char kStartTimeSwitch[] = "start-time";
+const char kEndTimeSwitch[] = "end-time";
+
+// Prints per-name latency summaries of the trace event spans, rather
+// than the events themselves.
+const char kSpanSummarySwitch[] = "span-summary";
+
+// Prints the modules and pages with the most hard faults, rather than the
+// events themselves.
+const char kPageFaultSummarySwitch[] = "page-fault-summary";
+
+// Prints the file reads behind hard faults, with seek statistics and a
+// heatmap of the offsets read, for each file object.
+const char kHardFaultIoSwitch[] = "hard-fault-io";
+
+// The most modules and pages the page fault summary lists, and the most
+// files the hard fault I/O summary lists.
+const size_t kMaxHotEntries = 25;
+
+// The width of the hard fault I/O offset heatmaps, and the characters
+// they're drawn with, from cold to hot.
+const size_t kHeatmapWidth = 64;
+const char kHeatmapShades[] = " .:-=+*#%@";
+const size_t kNumHeatmapShades = arraysize(kHeatmapShades) - 1;
+
+// Parses the time in switch @p name, if it's given, to @p time.
+// @returns false iff the switch is given, but isn't a time.
+bool ParseTimeSwitch(const CommandLine& cmd_line,
+                     const char* name,
+                     base::Time* time) {
+  if (!cmd_line.HasSwitch(name))
+    return true;
+
+  return base::Time::FromString(
+      cmd_line.GetSwitchValueASCII(name).c_str(), time);
 }
 
-DumpLogConsumer::~DumpLogConsumer() {
-  DCHECK(current_ == this);
-  current_ = NULL;
+// Issues the rows of @p session that match @p filter to @p sink, as log
+// messages.
+void ReplaySession(const SawlogFile& session,
+                   const LogFilter& filter,
+                   LogEvents* sink) {
+  for (size_t i = 0; i < session.num_rows(); ++i) {
+    base::StringPiece file = session.file_name(i);
+    base::StringPiece message = session.message(i);
+
+    LogEvents::LogMessage log_message;
+    log_message.time = session.time(i);
+    log_message.level = session.level(i);
+    log_message.process_id = session.process_id(i);
+    log_message.thread_id = session.thread_id(i);
+    log_message.traces = session.trace(i, &log_message.trace_depth);
+    log_message.message_len = message.size();
+    log_message.message = message.data();
+    log_message.file_len = file.size();
+    log_message.file = file.data();
+    log_message.line = session.line(i);
+    if (filter.MatchesLogMessage(log_message))
+      sink->OnLogMessage(log_message);
+  }
 }
 
-void DumpLogConsumer::ProcessEvent(EVENT_TRACE* event) {
-  DCHECK(current_);
-  if (current_ != NULL)
-    current_->ProcessOneEvent(event);
+bool HasMoreReads(const HardFaultIoTracker::FileReadsMap::value_type* a,
+                  const HardFaultIoTracker::FileReadsMap::value_type* b) {
+  return a->second.size() > b->second.size();
 }
 
-void DumpLogConsumer::ProcessOneEvent(EVENT_TRACE* event) {
-  if (!LogParser::ProcessOneEvent(event) &&
-      !KernelLogParser::ProcessOneEvent(event)) {
-    LOG(INFO) << "Unhandled event";
-  }
-}
+}  // namespace
+
 
+// Flattens the events it receives to dump records, which it adds to a
+// dump writer.
 class LogDumpHandler
     : public KernelModuleEvents,
       public KernelPageFaultEvents,
       public KernelProcessEvents,
-      public LogEvents {
+      public LogEvents,
+      public TraceEvents {
+ public:
+  // @param writer the writer to add records to, which must outlive us.
+  explicit LogDumpHandler(DumpWriter* writer) : writer_(writer) {
+  }
+
  protected:
   // KernelModuleEvents implementation.
   virtual void OnModuleIsLoaded(DWORD process_id,
@@ -144,24 +204,47 @@ class LogDumpHandler
       const TraceEvents::TraceMessage& trace_message);
   virtual void OnTraceEventInstant(
       const TraceEvents::TraceMessage& trace_message);
+
+ private:
+  // Adds a record of type @p type for the event at hand.
+  void AddModuleEvent(DumpRecord::Type type,
+                      DWORD process_id,
+                      const base::Time& time,
+                      const ModuleInformation& module_info);
+  void AddPageFault(DumpRecord::Type type,
+                    DWORD process_id,
+                    DWORD thread_id,
+                    const base::Time& time,
+                    sym_util::Address address,
+                    sym_util::Address program_counter);
+  DumpRecord* AddProcessEvent(DumpRecord::Type type,
+                              const base::Time& time,
+                              const ProcessInfo& process_info);
+  void AddTraceEvent(DumpRecord::Type type,
+                     const TraceEvents::TraceMessage& trace_message);
+
+  DumpWriter* writer_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogDumpHandler);
 };
 
 void LogDumpHandler::OnModuleIsLoaded(DWORD process_id,
                                       const base::Time& time,
                                       const ModuleInformation& module_info) {
-  // TODO(siggi): implement me..
+  AddModuleEvent(DumpRecord::MODULE_IS_LOADED, process_id, time,
+                 module_info);
 }
 
 void LogDumpHandler::OnModuleUnload(DWORD process_id,
                                     const base::Time& time,
                                     const ModuleInformation& module_info) {
-  // TODO(siggi): implement me..
+  AddModuleEvent(DumpRecord::MODULE_UNLOAD, process_id, time, module_info);
 }
 
 void LogDumpHandler::OnModuleLoad(DWORD process_id,
                                   const base::Time& time,
                                   const ModuleInformation& module_info) {
-  // TODO(siggi): implement me..
+  AddModuleEvent(DumpRecord::MODULE_LOAD, process_id, time, module_info);
 }
 
 
@@ -171,7 +254,8 @@ void LogDumpHandler::OnTransitionFault(DWORD process_id,
                                        const base::Time& time,
                                        sym_util::Address address,
                                        sym_util::Address program_counter) {
-  // TODO(siggi): implement me.
+  AddPageFault(DumpRecord::TRANSITION_FAULT, process_id, thread_id, time,
+               address, program_counter);
 }
 
 void LogDumpHandler::OnDemandZeroFault(DWORD process_id,
@@ -179,7 +263,8 @@ void LogDumpHandler::OnDemandZeroFault(DWORD process_id,
                                        const base::Time& time,
                                        sym_util::Address address,
                                        sym_util::Address program_counter) {
-  // TODO(siggi): implement me.
+  AddPageFault(DumpRecord::DEMAND_ZERO_FAULT, process_id, thread_id, time,
+               address, program_counter);
 }
 
 void LogDumpHandler::OnCopyOnWriteFault(DWORD process_id,
@@ -187,7 +272,8 @@ void LogDumpHandler::OnCopyOnWriteFault(DWORD process_id,
                                         const base::Time& time,
                                         sym_util::Address address,
                                         sym_util::Address program_counter) {
-  // TODO(siggi): implement me.
+  AddPageFault(DumpRecord::COPY_ON_WRITE_FAULT, process_id, thread_id, time,
+               address, program_counter);
 }
 
 void LogDumpHandler::OnGuardPageFault(DWORD process_id,
@@ -195,7 +281,8 @@ void LogDumpHandler::OnGuardPageFault(DWORD process_id,
                                       const base::Time& time,
                                       sym_util::Address address,
                                       sym_util::Address program_counter) {
-  // TODO(siggi): implement me.
+  AddPageFault(DumpRecord::GUARD_PAGE_FAULT, process_id, thread_id, time,
+               address, program_counter);
 }
 
 void LogDumpHandler::OnHardFault(DWORD process_id,
@@ -203,13 +290,15 @@ void LogDumpHandler::OnHardFault(DWORD process_id,
                                  const base::Time& time,
                                  sym_util::Address address,
                                  sym_util::Address program_counter) {
-  // TODO(siggi): implement me.
+  AddPageFault(DumpRecord::HARD_FAULT, process_id, thread_id, time,
+               address, program_counter);
 }
 
 void LogDumpHandler::OnAccessViolationFault(
     DWORD process_id, DWORD thread_id, const base::Time& time,
     sym_util::Address address, sym_util::Address program_counter) {
-  // TODO(siggi): implement me.
+  AddPageFault(DumpRecord::ACCESS_VIOLATION_FAULT, process_id, thread_id,
+               time, address, program_counter);
 }
 
 void LogDumpHandler::OnHardPageFault(DWORD thread_id,
@@ -219,97 +308,265 @@ void LogDumpHandler::OnHardPageFault(DWORD thread_id,
                                      sym_util::Address address,
                                      sym_util::Address file_object,
                                      sym_util::ByteCount byte_count) {
-  // TODO(siggi): implement me.
-}
-
-std::wostream& operator<< (std::wostream& str,
-    const KernelProcessEvents::ProcessInfo& process) {
-  str << L"{ \n"
-      << L"  " << process.process_id << L",  // process_id\n"
-      << L"  " << process.parent_id << L",  // parent_id\n"
-      << L"  " << process.session_id << L",  // session_id\n";
-
-  str << L"  {\n"
-      << L"    " << process.user_sid.Revision << L",  // Revision\n"
-      << L"    " << process.user_sid.SubAuthorityCount
-      << L",  // SubAuthorityCount\n";
-
-  str << L"    {";
-  int num_values = arraysize(process.user_sid.IdentifierAuthority.Value);
-  for (int i = 0; i < num_values; ++i) {
-    str << (i == 0 ? L" " : L", ")
-        << process.user_sid.IdentifierAuthority.Value[i];
-  }
-  str << L" },  // IdentifierAuthority\n";
-  str << L"    {";
-  for (int i = 0; i < process.user_sid.SubAuthorityCount; ++i) {
-    str << (i == 0 ? L" " : L", ")
-        << process.user_sid.SubAuthority[i];
-  }
-  str << L" },  // SubAuthority\n";
-  str << L"  },  // user_sid\n";
-
-  str << L"  \"" << base::UTF8ToWide(process.image_name)
-      << L"\", // image_name\n";
-
-  str << L"  L\"" << process.command_line << L"\",  // command_line\n";
-
-  str << L"},\n";
-
-  return str;
+  DumpRecord* record = writer_->AddRecord();
+  record->type = DumpRecord::HARD_PAGE_FAULT;
+  record->time = initial_time;
+  record->thread_id = thread_id;
+  record->address = address;
+  record->value = offset;
+  record->size = byte_count;
+  record->file_object = file_object;
+  record->latency = (time - initial_time).InMicroseconds();
 }
 
 // KernelProcessEvents implementation.
 void LogDumpHandler::OnProcessIsRunning(const base::Time& time,
                                         const ProcessInfo& process_info) {
-  std::wcout << L"Running:\n" << process_info;
+  AddProcessEvent(DumpRecord::PROCESS_IS_RUNNING, time, process_info);
 }
 
 void LogDumpHandler::OnProcessStarted(const base::Time& time,
                                       const ProcessInfo& process_info) {
-  std::wcout << L"Started:\n" << process_info;
+  AddProcessEvent(DumpRecord::PROCESS_STARTED, time, process_info);
 }
 
 void LogDumpHandler::OnProcessEnded(const base::Time& time,
                                     const ProcessInfo& process_info,
                                     ULONG exit_status) {
-  std::wcout << L"Ended:\n" << process_info;
+  DumpRecord* record =
+      AddProcessEvent(DumpRecord::PROCESS_ENDED, time, process_info);
+  record->value = exit_status;
 }
 
 // LogEvents implementation.
 void LogDumpHandler::OnLogMessage(const LogEvents::LogMessage& log_msg) {
-  // TODO(siggi): implement me..
+  DumpRecord* record = writer_->AddRecord();
+  record->type = DumpRecord::LOG_MESSAGE;
+  record->time = log_msg.time;
+  record->process_id = log_msg.process_id;
+  record->thread_id = log_msg.thread_id;
+  record->level = log_msg.level;
+  record->line = log_msg.line;
+  if (log_msg.file != NULL)
+    record->file.assign(log_msg.file, log_msg.file_len);
+  record->text.assign(log_msg.message, log_msg.message_len);
 }
 
 void LogDumpHandler::OnTraceEventBegin(
     const TraceEvents::TraceMessage& trace_message) {
-  // TODO(siggi): implement me..
+  AddTraceEvent(DumpRecord::TRACE_BEGIN, trace_message);
 }
 
 void LogDumpHandler::OnTraceEventEnd(
       const TraceEvents::TraceMessage& trace_message) {
-  // TODO(siggi): implement me..
+  AddTraceEvent(DumpRecord::TRACE_END, trace_message);
 }
 
 void LogDumpHandler::OnTraceEventInstant(
       const TraceEvents::TraceMessage& trace_message) {
-  // TODO(siggi): implement me..
+  AddTraceEvent(DumpRecord::TRACE_INSTANT, trace_message);
+}
+
+void LogDumpHandler::AddModuleEvent(DumpRecord::Type type,
+                                    DWORD process_id,
+                                    const base::Time& time,
+                                    const ModuleInformation& module_info) {
+  DumpRecord* record = writer_->AddRecord();
+  record->type = type;
+  record->time = time;
+  record->process_id = process_id;
+  record->address = module_info.base_address;
+  record->size = module_info.module_size;
+  base::WideToUTF8(module_info.image_file_name.c_str(),
+                   module_info.image_file_name.length(),
+                   &record->file);
 }
 
+void LogDumpHandler::AddPageFault(DumpRecord::Type type,
+                                  DWORD process_id,
+                                  DWORD thread_id,
+                                  const base::Time& time,
+                                  sym_util::Address address,
+                                  sym_util::Address program_counter) {
+  DumpRecord* record = writer_->AddRecord();
+  record->type = type;
+  record->time = time;
+  record->process_id = process_id;
+  record->thread_id = thread_id;
+  record->address = address;
+  record->value = program_counter;
+}
+
+DumpRecord* LogDumpHandler::AddProcessEvent(DumpRecord::Type type,
+                                            const base::Time& time,
+                                            const ProcessInfo& process_info) {
+  DumpRecord* record = writer_->AddRecord();
+  record->type = type;
+  record->time = time;
+  record->process_id = process_info.process_id;
+  record->value = process_info.parent_id;
+  record->file = process_info.image_name;
+  base::WideToUTF8(process_info.command_line.c_str(),
+                   process_info.command_line.length(),
+                   &record->text);
+  return record;
+}
+
+void LogDumpHandler::AddTraceEvent(
+    DumpRecord::Type type, const TraceEvents::TraceMessage& trace_message) {
+  DumpRecord* record = writer_->AddRecord();
+  record->type = type;
+  record->time = trace_message.time;
+  record->process_id = trace_message.process_id;
+  record->thread_id = trace_message.thread_id;
+  record->address = reinterpret_cast<uintptr_t>(trace_message.id);
+  record->text.assign(trace_message.name, trace_message.name_len);
+}
+
+// Reports @p error on stderr, as stdout may hold a binary dump.
+// @returns the process exit code for failure.
 int Error(const std::wstring& error) {
-  std::wcout << error << std::endl;
+  std::wcerr << error << std::endl;
 
   return 1;
 }
 
+void PrintSpanSummaries(const SpanLatencyStats& stats) {
+  std::vector<SpanLatencyStats::Summary> summaries;
+  stats.GetSummaries(&summaries);
+
+  std::cout << base::StringPrintf("%-40s %10s %10s %10s %10s %10s\n",
+                                  "Span", "Count", "p50 (us)", "p90 (us)",
+                                  "p99 (us)", "Max (us)");
+  for (size_t i = 0; i < summaries.size(); ++i) {
+    const SpanLatencyStats::Summary& summary = summaries[i];
+    std::cout << base::StringPrintf("%-40s %10I64u %10I64d %10I64d %10I64d "
+                                    "%10I64d\n",
+                                    summary.name.c_str(), summary.count,
+                                    summary.p50, summary.p90, summary.p99,
+                                    summary.max);
+  }
+
+  if (stats.num_dropped_spans() != 0) {
+    std::cout << stats.num_dropped_spans()
+              << " spans past the name limit were dropped." << std::endl;
+  }
+}
+
+void PrintPageFaultSummary(const PageFaultAggregator& aggregator) {
+  std::vector<const PageFaultAggregator::ModuleStats*> modules;
+  aggregator.GetHottestModules(kMaxHotEntries, &modules);
+
+  std::wcout << base::StringPrintf(L"%10ls %10ls  %ls\n",
+                                   L"Hard", L"Total", L"Module");
+  for (size_t i = 0; i < modules.size(); ++i) {
+    std::wcout << base::StringPrintf(
+        L"%10I64u %10I64u  %ls\n",
+        modules[i]->faults.counts[HARD_FAULT], modules[i]->faults.total(),
+        modules[i]->module.image_file_name.c_str());
+  }
+
+  std::vector<const PageFaultAggregator::PageStats*> pages;
+  aggregator.GetHottestPages(kMaxHotEntries, &pages);
+
+  std::wcout << base::StringPrintf(L"\n%10ls %10ls %10ls  %ls\n",
+                                   L"Hard", L"Total", L"Offset", L"Module");
+  for (size_t i = 0; i < pages.size(); ++i) {
+    const PageFaultAggregator::ModuleStats& module =
+        aggregator.modules()[pages[i]->module];
+    std::wcout << base::StringPrintf(
+        L"%10I64u %10I64u 0x%08I64X  %ls\n",
+        pages[i]->faults.counts[HARD_FAULT], pages[i]->faults.total(),
+        static_cast<uint64>(pages[i]->page) * PageFaultAggregator::kPageSize,
+        module.module.image_file_name.c_str());
+  }
+
+  if (aggregator.num_untracked_page_faults() != 0) {
+    std::wcout << aggregator.num_untracked_page_faults()
+               << L" faults past the page limit were not tracked by page."
+               << std::endl;
+  }
+}
+
+void PrintHardFaultIo(const HardFaultIoTracker& tracker) {
+  typedef HardFaultIoTracker::FileReadsMap FileReadsMap;
+  std::vector<const FileReadsMap::value_type*> files;
+  FileReadsMap::const_iterator it = tracker.files().begin();
+  for (; it != tracker.files().end(); ++it)
+    files.push_back(&*it);
+  std::sort(files.begin(), files.end(), HasMoreReads);
+  if (files.size() > kMaxHotEntries)
+    files.resize(kMaxHotEntries);
+
+  for (size_t i = 0; i < files.size(); ++i) {
+    HardFaultIoTracker::FileReads reads;
+    tracker.GetReadsInIssueOrder(files[i]->first, &reads);
+    HardFaultIoTracker::SeekStats stats;
+    HardFaultIoTracker::ComputeSeekStats(reads, &stats);
+
+    std::cout << base::StringPrintf(
+        "File object 0x%016I64X: %Iu reads, %I64u bytes\n",
+        files[i]->first, stats.num_reads, stats.bytes_read);
+    size_t num_seeks = stats.num_forward_seeks + stats.num_backward_seeks;
+    std::cout << base::StringPrintf(
+        "  %Iu sequential, %Iu forward seeks, %Iu backward seeks, "
+        "mean seek %I64u bytes\n",
+        stats.num_sequential, stats.num_forward_seeks,
+        stats.num_backward_seeks,
+        num_seeks == 0 ? 0 : stats.total_seek_distance / num_seeks);
+    std::cout << base::StringPrintf(
+        "  seek p50/p90: %I64d/%I64d bytes, "
+        "latency p50/p90/max: %I64d/%I64d/%I64d us\n",
+        stats.seek_distances.GetPercentile(50.0),
+        stats.seek_distances.GetPercentile(90.0),
+        stats.latencies.GetPercentile(50.0),
+        stats.latencies.GetPercentile(90.0), stats.latencies.max());
+
+    std::vector<size_t> buckets;
+    sym_util::Offset bucket_size = 0;
+    HardFaultIoTracker::ComputeHeatmap(reads, kHeatmapWidth, &buckets,
+                                       &bucket_size);
+    size_t max_count = *std::max_element(buckets.begin(), buckets.end());
+    size_t range = std::max(max_count - 1, static_cast<size_t>(1));
+    std::string heatmap;
+    for (size_t j = 0; j < buckets.size(); ++j) {
+      // Any reads at all get at least the coolest visible shade.
+      size_t shade = 0;
+      if (buckets[j] != 0)
+        shade = 1 + (buckets[j] - 1) * (kNumHeatmapShades - 2) / range;
+      heatmap += kHeatmapShades[shade];
+    }
+    std::cout << base::StringPrintf("  [%s] %I64u bytes per column\n",
+                                    heatmap.c_str(), bucket_size);
+  }
+
+  if (tracker.num_dropped_reads() != 0) {
+    std::cout << tracker.num_dropped_reads()
+              << " reads past the read limit were dropped." << std::endl;
+  }
+}
+
 int wmain(int argc, const wchar_t** argv) {
   base::AtExitManager at_exit;
   CommandLine::Init(0, NULL);
 
   CommandLine* cmd_line = CommandLine::ForCurrentProcess();
   std::vector<std::wstring> args = cmd_line->GetArgs();
-  DumpLogConsumer consumer;
+  EtlFileConsumer consumer;
+  consumer.set_num_threads(base::SysInfo::NumberOfProcessors());
+  ScopedVector<SawlogFile> sessions;
   for (size_t i = 0; i < args.size(); ++i) {
+    base::FilePath path(args[i]);
+    if (path.MatchesExtension(kSawlogExtension)) {
+      SawlogFile* session = new SawlogFile();
+      sessions.push_back(session);
+      if (!session->Open(path)) {
+        return Error(base::StringPrintf(L"Error opening saved session \"%ls\"",
+                                        args[i].c_str()));
+      }
+      continue;
+    }
+
     HRESULT hr = consumer.OpenFileSession(args[i].c_str());
 
     if (FAILED(hr))
@@ -317,16 +574,107 @@ int wmain(int argc, const wchar_t** argv) {
           base::StringPrintf(L"Error 0x%08X, opening file \"%ls\"",
                              hr, args[i].c_str()));
   }
+  if (!sessions.empty() && sessions.size() != args.size())
+    return Error(L"Saved sessions can't be dumped along with .etl files.");
+
+  bool span_summary = cmd_line->HasSwitch(kSpanSummarySwitch);
+  bool page_fault_summary = cmd_line->HasSwitch(kPageFaultSummarySwitch);
+  bool hard_fault_io = cmd_line->HasSwitch(kHardFaultIoSwitch);
+  if (page_fault_summary && hard_fault_io) {
+    return Error(L"Only one of --page-fault-summary and --hard-fault-io "
+                 L"can be given.");
+  }
+  if (!sessions.empty() &&
+      (span_summary || page_fault_summary || hard_fault_io)) {
+    return Error(L"Saved sessions hold only log messages, and can't be "
+                 L"summarized.");
+  }
 
-  LogDumpHandler handler;
-  consumer.set_module_event_sink(&handler);
-  consumer.set_page_fault_event_sink(&handler);
-  consumer.set_process_event_sink(&handler);
-  consumer.set_event_sink(&handler);
+  DumpFormatter::Format format = DumpFormatter::TSV;
+  if (cmd_line->HasSwitch(kFormatSwitch) &&
+      !DumpFormatter::ParseFormat(
+          cmd_line->GetSwitchValueASCII(kFormatSwitch), &format)) {
+    return Error(L"Unknown --format, expected one of tsv, csv, jsonl or "
+                 L"binary.");
+  }
+
+  LogFilter filter;
+  if (cmd_line->HasSwitch(kFilterFileSwitch)) {
+    base::FilePath filter_path =
+        cmd_line->GetSwitchValuePath(kFilterFileSwitch);
+    std::string serialized_filters;
+    if (!base::ReadFileToString(filter_path, &serialized_filters)) {
+      return Error(base::StringPrintf(L"Error reading filter file \"%ls\"",
+                                      filter_path.value().c_str()));
+    }
+    if (!filter.AddSerializedFilters(serialized_filters)) {
+      return Error(base::StringPrintf(L"Bad filters in filter file \"%ls\"",
+                                      filter_path.value().c_str()));
+    }
+  }
+
+  base::Time start_time;
+  base::Time end_time;
+  if (!ParseTimeSwitch(*cmd_line, kStartTimeSwitch, &start_time) ||
+      !ParseTimeSwitch(*cmd_line, kEndTimeSwitch, &end_time)) {
+    return Error(L"Bad --start-time or --end-time.");
+  }
+  filter.SetTimeRange(start_time, end_time);
+
+  // The filter is evaluated as events are parsed, so events it rules out
+  // are never copied or issued.
+  if (!filter.empty())
+    consumer.set_filter(&filter);
+
+  // Events are dumped unless one of the summaries is asked for. The
+  // formatters write their own line ends, and the binary format mustn't
+  // be translated at all, so the dump goes to stdout untranslated.
+  bool dump_events = !span_summary && !page_fault_summary && !hard_fault_io;
+  if (dump_events)
+    _setmode(_fileno(stdout), _O_BINARY);
+  DumpWriter writer(DumpFormatter::Create(format), stdout);
+  LogDumpHandler handler(&writer);
+  SpanLatencyStats span_stats(SpanLatencyStats::kDefaultMaxNames);
+  PageFaultAggregator page_faults(PageFaultAggregator::kDefaultMaxPages);
+  HardFaultIoTracker hard_fault_reads(HardFaultIoTracker::kDefaultMaxReads);
+  if (dump_events) {
+    consumer.set_module_event_sink(&handler);
+    consumer.set_page_fault_event_sink(&handler);
+    consumer.set_process_event_sink(&handler);
+    consumer.set_event_sink(&handler);
+    consumer.set_trace_sink(&handler);
+    writer.Start();
+  } else {
+    if (span_summary)
+      consumer.set_trace_sink(&span_stats);
+    if (page_fault_summary) {
+      consumer.set_module_event_sink(&page_faults);
+      consumer.set_page_fault_event_sink(&page_faults);
+      consumer.set_thread_event_sink(&page_faults);
+    }
+    if (hard_fault_io)
+      consumer.set_page_fault_event_sink(&hard_fault_reads);
+  }
 
-  HRESULT hr = consumer.Consume();
+  // Saved sessions are read in place, and have no events to parse.
+  HRESULT hr = S_OK;
+  if (sessions.empty()) {
+    hr = consumer.Consume();
+  } else {
+    for (size_t i = 0; i < sessions.size(); ++i)
+      ReplaySession(*sessions[i], filter, &handler);
+  }
+  if (dump_events && !writer.Finish())
+    return Error(L"Error writing the dump");
   if (FAILED(hr))
     return Error(base::StringPrintf(L"Error 0x%08X consuming log files", hr));
 
+  if (span_summary)
+    PrintSpanSummaries(span_stats);
+  if (page_fault_summary)
+    PrintPageFaultSummary(page_faults);
+  if (hard_fault_io)
+    PrintHardFaultIo(hard_fault_reads);
+
   return 0;
 }
@@ -0,0 +1,141 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Dump writer implementation.
+#include "sawbuck/log_lib/dump_writer.h"
+
+#include "base/logging.h"
+
+// static
+const size_t DumpWriter::kRecordsPerBatch;
+const size_t DumpWriter::kMaxBatches;
+const size_t DumpWriter::kWriteSize;
+
+DumpWriter::DumpWriter(DumpFormatter* formatter, FILE* file)
+    : formatter_(formatter),
+      file_(file),
+      current_(NULL),
+      write_failed_(false),
+      batch_submitted_(&lock_),
+      batch_freed_(&lock_),
+      finishing_(false) {
+  DCHECK(formatter != NULL);
+  DCHECK(file != NULL);
+
+  for (size_t i = 0; i < kMaxBatches; ++i) {
+    Batch* batch = new Batch();
+    batches_.push_back(batch);
+    free_.push_back(batch);
+  }
+}
+
+DumpWriter::~DumpWriter() {
+  DCHECK(thread_.get() == NULL);
+}
+
+void DumpWriter::Start() {
+  DCHECK(thread_.get() == NULL);
+
+  current_ = free_.back();
+  free_.pop_back();
+
+  formatter_->AppendHeader(&output_);
+  thread_.reset(new base::DelegateSimpleThread(this, "DumpWriter"));
+  thread_->Start();
+}
+
+DumpRecord* DumpWriter::AddRecord() {
+  DCHECK(current_ != NULL);
+
+  if (current_->num_records == kRecordsPerBatch)
+    SubmitBatch();
+
+  std::vector<DumpRecord>& records = current_->records;
+  if (current_->num_records == records.size()) {
+    records.push_back(DumpRecord());
+  } else {
+    records[current_->num_records].Clear();
+  }
+
+  return &records[current_->num_records++];
+}
+
+bool DumpWriter::Finish() {
+  DCHECK(thread_.get() != NULL);
+
+  {
+    base::AutoLock lock(lock_);
+    submitted_.push_back(current_);
+    current_ = NULL;
+    finishing_ = true;
+    batch_submitted_.Signal();
+  }
+
+  thread_->Join();
+  thread_.reset();
+
+  Write(0);
+  if (fflush(file_) != 0)
+    write_failed_ = true;
+
+  return !write_failed_;
+}
+
+void DumpWriter::Run() {
+  while (true) {
+    Batch* batch = NULL;
+    {
+      base::AutoLock lock(lock_);
+      while (submitted_.empty() && !finishing_)
+        batch_submitted_.Wait();
+
+      if (submitted_.empty())
+        break;
+
+      batch = submitted_.front();
+      submitted_.pop_front();
+    }
+
+    for (size_t i = 0; i < batch->num_records; ++i) {
+      formatter_->AppendRecord(batch->records[i], &output_);
+      Write(kWriteSize);
+    }
+
+    base::AutoLock lock(lock_);
+    batch->num_records = 0;
+    free_.push_back(batch);
+    batch_freed_.Signal();
+  }
+}
+
+void DumpWriter::SubmitBatch() {
+  base::AutoLock lock(lock_);
+  submitted_.push_back(current_);
+  batch_submitted_.Signal();
+
+  while (free_.empty())
+    batch_freed_.Wait();
+
+  current_ = free_.back();
+  free_.pop_back();
+}
+
+void DumpWriter::Write(size_t min_size) {
+  if (output_.empty() || output_.size() < min_size)
+    return;
+
+  if (fwrite(output_.data(), 1, output_.size(), file_) != output_.size())
+    write_failed_ = true;
+  output_.clear();
+}
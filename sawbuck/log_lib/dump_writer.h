@@ -0,0 +1,110 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Dump writer declaration.
+#ifndef SAWBUCK_LOG_LIB_DUMP_WRITER_H_
+#define SAWBUCK_LOG_LIB_DUMP_WRITER_H_
+
+#include <stdio.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/simple_thread.h"
+#include "sawbuck/log_lib/dump_formatter.h"
+
+// Writes dump records to a file, formatting them on a thread of its own.
+// Records are filled in place in batches, which go to the formatting
+// thread as they fill, and come back for reuse once formatted, strings
+// and all. The formatted output is written in large blocks.
+//
+// Records are added and the writer is started and finished on a single
+// thread.
+class DumpWriter : public base::DelegateSimpleThread::Delegate {
+ public:
+  static const size_t kRecordsPerBatch = 4096;
+  static const size_t kMaxBatches = 4;
+  static const size_t kWriteSize = 1024 * 1024;
+
+  // @param formatter the formatter, which we take ownership of.
+  // @param file the file to write to, which must outlive the writer.
+  DumpWriter(DumpFormatter* formatter, FILE* file);
+  ~DumpWriter();
+
+  // Starts the formatting thread, and writes the header.
+  void Start();
+
+  // @returns a cleared record to fill, which is valid until the next call
+  //     to AddRecord or Finish.
+  DumpRecord* AddRecord();
+
+  // Formats and writes all records added, and stops the formatting
+  // thread.
+  // @returns true iff all output was written.
+  bool Finish();
+
+  // DelegateSimpleThread::Delegate implementation.
+  virtual void Run();
+
+ private:
+  struct Batch {
+    Batch() : num_records(0) {
+    }
+
+    // The records, of which the first num_records are in use. Records
+    // past that are kept for their string capacity.
+    std::vector<DumpRecord> records;
+    size_t num_records;
+  };
+
+  // Hands the current batch to the formatting thread, and takes a free
+  // one, waiting for one if need be.
+  void SubmitBatch();
+
+  // Writes the formatted output, if there's at least @p min_size of it.
+  void Write(size_t min_size);
+
+  scoped_ptr<DumpFormatter> formatter_;
+  FILE* file_;
+  scoped_ptr<base::DelegateSimpleThread> thread_;
+
+  // The batch being filled, owned by the adding thread.
+  Batch* current_;
+
+  // The formatted output, owned by the formatting thread.
+  std::string output_;
+  bool write_failed_;
+
+  base::Lock lock_;
+  // Signaled as batches are submitted, or finishing starts, under lock_.
+  base::ConditionVariable batch_submitted_;
+  // Signaled as batches are freed, under lock_.
+  base::ConditionVariable batch_freed_;
+  // The batches submitted but not yet formatted, under lock_.
+  std::deque<Batch*> submitted_;
+  // The batches free for reuse, under lock_.
+  std::vector<Batch*> free_;
+  // True once Finish is called, under lock_.
+  bool finishing_;
+
+  // All our batches.
+  ScopedVector<Batch> batches_;
+
+  DISALLOW_COPY_AND_ASSIGN(DumpWriter);
+};
+
+#endif  // SAWBUCK_LOG_LIB_DUMP_WRITER_H_
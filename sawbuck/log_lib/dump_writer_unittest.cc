@@ -0,0 +1,87 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/log_lib/dump_writer.h"
+
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+class DumpWriterTest : public testing::Test {
+ public:
+  virtual void SetUp() {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.path().Append(L"dump.txt");
+  }
+
+  // Fills @p record as the @p i-th record.
+  static void FillRecord(size_t i, DumpRecord* record) {
+    record->type = static_cast<DumpRecord::Type>(i % DumpRecord::NUM_TYPES);
+    record->time = base::Time::FromInternalValue(12596301296000007LL + i);
+    record->process_id = static_cast<uint32>(i);
+    // Leave a field unset on every other record, to check that reused
+    // records come back cleared.
+    if (i % 2 == 0) {
+      record->line = static_cast<int32>(i);
+      record->text = "Message with \"quotes\", commas and\nnewlines";
+    }
+  }
+
+  // Writes @p num_records in @p format, and checks the output against
+  // formatting them directly.
+  void WriteAndCheck(DumpFormatter::Format format, size_t num_records) {
+    FILE* file = base::OpenFile(path_, "wb");
+    ASSERT_TRUE(file != NULL);
+
+    DumpWriter writer(DumpFormatter::Create(format), file);
+    writer.Start();
+    for (size_t i = 0; i < num_records; ++i)
+      FillRecord(i, writer.AddRecord());
+    EXPECT_TRUE(writer.Finish());
+    ASSERT_TRUE(base::CloseFile(file));
+
+    scoped_ptr<DumpFormatter> formatter(DumpFormatter::Create(format));
+    std::string expected;
+    formatter->AppendHeader(&expected);
+    for (size_t i = 0; i < num_records; ++i) {
+      DumpRecord record;
+      FillRecord(i, &record);
+      formatter->AppendRecord(record, &expected);
+    }
+
+    std::string written;
+    ASSERT_TRUE(base::ReadFileToString(path_, &written));
+    EXPECT_TRUE(expected == written);
+  }
+
+ protected:
+  base::ScopedTempDir temp_dir_;
+  base::FilePath path_;
+};
+
+TEST_F(DumpWriterTest, Empty) {
+  WriteAndCheck(DumpFormatter::CSV, 0);
+}
+
+TEST_F(DumpWriterTest, WritesAllRecordsInOrder) {
+  // Enough to cycle through the batches several times.
+  const size_t kNumRecords =
+      3 * DumpWriter::kMaxBatches * DumpWriter::kRecordsPerBatch + 17;
+  WriteAndCheck(DumpFormatter::TSV, kNumRecords);
+  WriteAndCheck(DumpFormatter::JSON_LINES, kNumRecords);
+  WriteAndCheck(DumpFormatter::BINARY, kNumRecords);
+}
+
+}  // namespace
@@ -0,0 +1,419 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Event recorder implementation.
+#include "sawbuck/log_lib/etl_event_recorder.h"
+
+#include "base/logging.h"
+
+EtlEventRecorder::EtlEventRecorder() {
+}
+
+EtlEventRecorder::~EtlEventRecorder() {
+}
+
+const base::Time& EtlEventRecorder::event_time(size_t index) const {
+  DCHECK_LT(index, events_.size());
+  return events_[index].time;
+}
+
+void EtlEventRecorder::Replay(size_t begin,
+                              size_t end,
+                              const Sinks& sinks) const {
+  DCHECK_LE(begin, end);
+  DCHECK_LE(end, events_.size());
+
+  size_t i = begin;
+  while (i < end) {
+    EventType type = events_[i].type;
+    if (type != LOG_MESSAGE && type != TRACE_EVENT) {
+      ReplayOne(i++, sinks);
+      continue;
+    }
+
+    // Runs of the same type are stored contiguously, so they can be
+    // issued straight out of our vectors.
+    size_t first = events_[i].index;
+    size_t count = 0;
+    for (; i < end && events_[i].type == type; ++i)
+      ++count;
+
+    if (type == LOG_MESSAGE && sinks.log_sink != NULL)
+      sinks.log_sink->OnLogMessages(&log_messages_[first], count);
+    else if (type == TRACE_EVENT && sinks.trace_sink != NULL)
+      sinks.trace_sink->OnTraceEvents(&trace_events_[first], count);
+  }
+}
+
+void EtlEventRecorder::ReplayOne(size_t index, const Sinks& sinks) const {
+  DCHECK_LT(index, events_.size());
+  const Event& event = events_[index];
+
+  switch (event.type) {
+    case LOG_MESSAGE:
+      if (sinks.log_sink != NULL)
+        sinks.log_sink->OnLogMessage(log_messages_[event.index]);
+      break;
+
+    case TRACE_EVENT:
+      if (sinks.trace_sink != NULL)
+        sinks.trace_sink->OnTraceEvents(&trace_events_[event.index], 1);
+      break;
+
+    case MODULE_IS_LOADED:
+    case MODULE_UNLOAD:
+    case MODULE_LOAD: {
+        if (sinks.module_sink == NULL)
+          break;
+
+        const ModuleEvent& module = module_events_[event.index];
+        if (event.type == MODULE_IS_LOADED) {
+          sinks.module_sink->OnModuleIsLoaded(module.process_id, event.time,
+                                              module.module_info);
+        } else if (event.type == MODULE_UNLOAD) {
+          sinks.module_sink->OnModuleUnload(module.process_id, event.time,
+                                            module.module_info);
+        } else {
+          sinks.module_sink->OnModuleLoad(module.process_id, event.time,
+                                          module.module_info);
+        }
+      }
+      break;
+
+    case TRANSITION_FAULT:
+    case DEMAND_ZERO_FAULT:
+    case COPY_ON_WRITE_FAULT:
+    case GUARD_PAGE_FAULT:
+    case HARD_FAULT:
+    case ACCESS_VIOLATION_FAULT: {
+        KernelPageFaultEvents* sink = sinks.page_fault_sink;
+        if (sink == NULL)
+          break;
+
+        const PageFaultEvent& fault = page_fault_events_[event.index];
+        typedef void (KernelPageFaultEvents::*FaultMethod)(
+            DWORD, DWORD, const base::Time&, sym_util::Address,
+            sym_util::Address);
+        FaultMethod method = NULL;
+        switch (event.type) {
+          case TRANSITION_FAULT:
+            method = &KernelPageFaultEvents::OnTransitionFault;
+            break;
+          case DEMAND_ZERO_FAULT:
+            method = &KernelPageFaultEvents::OnDemandZeroFault;
+            break;
+          case COPY_ON_WRITE_FAULT:
+            method = &KernelPageFaultEvents::OnCopyOnWriteFault;
+            break;
+          case GUARD_PAGE_FAULT:
+            method = &KernelPageFaultEvents::OnGuardPageFault;
+            break;
+          case HARD_FAULT:
+            method = &KernelPageFaultEvents::OnHardFault;
+            break;
+          case ACCESS_VIOLATION_FAULT:
+            method = &KernelPageFaultEvents::OnAccessViolationFault;
+            break;
+        }
+        DCHECK(method != NULL);
+        (sink->*method)(fault.process_id, fault.thread_id, event.time,
+                        fault.address, fault.program_counter);
+      }
+      break;
+
+    case HARD_PAGE_FAULT: {
+        if (sinks.page_fault_sink == NULL)
+          break;
+
+        const HardPageFaultEvent& fault =
+            hard_page_fault_events_[event.index];
+        sinks.page_fault_sink->OnHardPageFault(fault.thread_id,
+                                               event.time,
+                                               fault.initial_time,
+                                               fault.offset,
+                                               fault.address,
+                                               fault.file_object,
+                                               fault.byte_count);
+      }
+      break;
+
+    case PROCESS_IS_RUNNING:
+    case PROCESS_STARTED:
+    case PROCESS_ENDED: {
+        if (sinks.process_sink == NULL)
+          break;
+
+        const ProcessEvent& process = process_events_[event.index];
+        if (event.type == PROCESS_IS_RUNNING) {
+          sinks.process_sink->OnProcessIsRunning(event.time,
+                                                 process.process_info);
+        } else if (event.type == PROCESS_STARTED) {
+          sinks.process_sink->OnProcessStarted(event.time,
+                                               process.process_info);
+        } else {
+          sinks.process_sink->OnProcessEnded(event.time,
+                                             process.process_info,
+                                             process.exit_status);
+        }
+      }
+      break;
+
+    case THREAD_IS_RUNNING:
+    case THREAD_STARTED:
+    case THREAD_ENDED: {
+        if (sinks.thread_sink == NULL)
+          break;
+
+        const ThreadEvent& thread = thread_events_[event.index];
+        if (event.type == THREAD_IS_RUNNING) {
+          sinks.thread_sink->OnThreadIsRunning(event.time, thread.process_id,
+                                               thread.thread_id);
+        } else if (event.type == THREAD_STARTED) {
+          sinks.thread_sink->OnThreadStarted(event.time, thread.process_id,
+                                             thread.thread_id);
+        } else {
+          sinks.thread_sink->OnThreadEnded(event.time, thread.process_id,
+                                           thread.thread_id);
+        }
+      }
+      break;
+
+    default:
+      NOTREACHED() << "Unknown event type " << event.type;
+      break;
+  }
+}
+
+void EtlEventRecorder::Clear() {
+  events_.clear();
+  log_messages_.clear();
+  trace_events_.clear();
+  module_events_.clear();
+  page_fault_events_.clear();
+  hard_page_fault_events_.clear();
+  process_events_.clear();
+  thread_events_.clear();
+}
+
+void EtlEventRecorder::OnLogMessage(const LogMessage& log_message) {
+  AddEvent(LOG_MESSAGE, log_message.time, log_messages_.size());
+  log_messages_.push_back(log_message);
+}
+
+void EtlEventRecorder::OnTraceEventBegin(const TraceMessage& trace_message) {
+  AddTraceEvent(TRACE_EVENT_TYPE_BEGIN, trace_message);
+}
+
+void EtlEventRecorder::OnTraceEventEnd(const TraceMessage& trace_message) {
+  AddTraceEvent(TRACE_EVENT_TYPE_END, trace_message);
+}
+
+void EtlEventRecorder::OnTraceEventInstant(const TraceMessage& trace_message) {
+  AddTraceEvent(TRACE_EVENT_TYPE_INSTANT, trace_message);
+}
+
+void EtlEventRecorder::OnModuleIsLoaded(DWORD process_id,
+                                        const base::Time& time,
+                                        const ModuleInformation& module_info) {
+  AddModuleEvent(MODULE_IS_LOADED, process_id, time, module_info);
+}
+
+void EtlEventRecorder::OnModuleUnload(DWORD process_id,
+                                      const base::Time& time,
+                                      const ModuleInformation& module_info) {
+  AddModuleEvent(MODULE_UNLOAD, process_id, time, module_info);
+}
+
+void EtlEventRecorder::OnModuleLoad(DWORD process_id,
+                                    const base::Time& time,
+                                    const ModuleInformation& module_info) {
+  AddModuleEvent(MODULE_LOAD, process_id, time, module_info);
+}
+
+void EtlEventRecorder::OnTransitionFault(DWORD process_id,
+                                         DWORD thread_id,
+                                         const base::Time& time,
+                                         sym_util::Address address,
+                                         sym_util::Address program_counter) {
+  AddPageFaultEvent(TRANSITION_FAULT, process_id, thread_id, time, address,
+                    program_counter);
+}
+
+void EtlEventRecorder::OnDemandZeroFault(DWORD process_id,
+                                         DWORD thread_id,
+                                         const base::Time& time,
+                                         sym_util::Address address,
+                                         sym_util::Address program_counter) {
+  AddPageFaultEvent(DEMAND_ZERO_FAULT, process_id, thread_id, time, address,
+                    program_counter);
+}
+
+void EtlEventRecorder::OnCopyOnWriteFault(DWORD process_id,
+                                          DWORD thread_id,
+                                          const base::Time& time,
+                                          sym_util::Address address,
+                                          sym_util::Address program_counter) {
+  AddPageFaultEvent(COPY_ON_WRITE_FAULT, process_id, thread_id, time, address,
+                    program_counter);
+}
+
+void EtlEventRecorder::OnGuardPageFault(DWORD process_id,
+                                        DWORD thread_id,
+                                        const base::Time& time,
+                                        sym_util::Address address,
+                                        sym_util::Address program_counter) {
+  AddPageFaultEvent(GUARD_PAGE_FAULT, process_id, thread_id, time, address,
+                    program_counter);
+}
+
+void EtlEventRecorder::OnHardFault(DWORD process_id,
+                                   DWORD thread_id,
+                                   const base::Time& time,
+                                   sym_util::Address address,
+                                   sym_util::Address program_counter) {
+  AddPageFaultEvent(HARD_FAULT, process_id, thread_id, time, address,
+                    program_counter);
+}
+
+void EtlEventRecorder::OnAccessViolationFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+  AddPageFaultEvent(ACCESS_VIOLATION_FAULT, process_id, thread_id, time,
+                    address, program_counter);
+}
+
+void EtlEventRecorder::OnHardPageFault(DWORD thread_id,
+                                       const base::Time& time,
+                                       const base::Time& initial_time,
+                                       sym_util::Offset offset,
+                                       sym_util::Address address,
+                                       sym_util::Address file_object,
+                                       sym_util::ByteCount byte_count) {
+  AddEvent(HARD_PAGE_FAULT, time, hard_page_fault_events_.size());
+
+  HardPageFaultEvent fault;
+  fault.thread_id = thread_id;
+  fault.initial_time = initial_time;
+  fault.offset = offset;
+  fault.address = address;
+  fault.file_object = file_object;
+  fault.byte_count = byte_count;
+  hard_page_fault_events_.push_back(fault);
+}
+
+void EtlEventRecorder::OnProcessIsRunning(const base::Time& time,
+                                          const ProcessInfo& process_info) {
+  AddProcessEvent(PROCESS_IS_RUNNING, time, process_info, 0);
+}
+
+void EtlEventRecorder::OnProcessStarted(const base::Time& time,
+                                        const ProcessInfo& process_info) {
+  AddProcessEvent(PROCESS_STARTED, time, process_info, 0);
+}
+
+void EtlEventRecorder::OnProcessEnded(const base::Time& time,
+                                      const ProcessInfo& process_info,
+                                      ULONG exit_status) {
+  AddProcessEvent(PROCESS_ENDED, time, process_info, exit_status);
+}
+
+void EtlEventRecorder::OnThreadIsRunning(const base::Time& time,
+                                         DWORD process_id,
+                                         DWORD thread_id) {
+  AddThreadEvent(THREAD_IS_RUNNING, time, process_id, thread_id);
+}
+
+void EtlEventRecorder::OnThreadStarted(const base::Time& time,
+                                       DWORD process_id,
+                                       DWORD thread_id) {
+  AddThreadEvent(THREAD_STARTED, time, process_id, thread_id);
+}
+
+void EtlEventRecorder::OnThreadEnded(const base::Time& time,
+                                     DWORD process_id,
+                                     DWORD thread_id) {
+  AddThreadEvent(THREAD_ENDED, time, process_id, thread_id);
+}
+
+void EtlEventRecorder::AddEvent(EventType type,
+                                const base::Time& time,
+                                size_t index) {
+  Event event;
+  event.type = type;
+  event.time = time;
+  event.index = index;
+  events_.push_back(event);
+}
+
+void EtlEventRecorder::AddTraceEvent(TraceEventType type,
+                                     const TraceMessage& trace_message) {
+  AddEvent(TRACE_EVENT, trace_message.time, trace_events_.size());
+
+  TraceEvent trace_event;
+  trace_event.type = type;
+  trace_event.message = trace_message;
+  trace_events_.push_back(trace_event);
+}
+
+void EtlEventRecorder::AddModuleEvent(EventType type,
+                                      DWORD process_id,
+                                      const base::Time& time,
+                                      const ModuleInformation& module_info) {
+  AddEvent(type, time, module_events_.size());
+
+  ModuleEvent module;
+  module.process_id = process_id;
+  module.module_info = module_info;
+  module_events_.push_back(module);
+}
+
+void EtlEventRecorder::AddPageFaultEvent(EventType type,
+                                         DWORD process_id,
+                                         DWORD thread_id,
+                                         const base::Time& time,
+                                         sym_util::Address address,
+                                         sym_util::Address program_counter) {
+  AddEvent(type, time, page_fault_events_.size());
+
+  PageFaultEvent fault;
+  fault.process_id = process_id;
+  fault.thread_id = thread_id;
+  fault.address = address;
+  fault.program_counter = program_counter;
+  page_fault_events_.push_back(fault);
+}
+
+void EtlEventRecorder::AddProcessEvent(EventType type,
+                                       const base::Time& time,
+                                       const ProcessInfo& process_info,
+                                       ULONG exit_status) {
+  AddEvent(type, time, process_events_.size());
+
+  ProcessEvent process;
+  process.process_info = process_info;
+  process.exit_status = exit_status;
+  process_events_.push_back(process);
+}
+
+void EtlEventRecorder::AddThreadEvent(EventType type,
+                                      const base::Time& time,
+                                      DWORD process_id,
+                                      DWORD thread_id) {
+  AddEvent(type, time, thread_events_.size());
+
+  ThreadEvent thread;
+  thread.process_id = process_id;
+  thread.thread_id = thread_id;
+  thread_events_.push_back(thread);
+}
@@ -0,0 +1,243 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// An event sink that records parser notifications for later replay.
+#ifndef SAWBUCK_LOG_LIB_ETL_EVENT_RECORDER_H_
+#define SAWBUCK_LOG_LIB_ETL_EVENT_RECORDER_H_
+
+#include <vector>
+#include "sawbuck/log_lib/kernel_log_consumer.h"
+#include "sawbuck/log_lib/log_consumer.h"
+
+// Records the notifications LogParser and KernelLogParser issue for the
+// events of one buffer, so that they can be replayed to the real sinks
+// in timestamp order once the buffers of all processors are merged.
+// @note The recorded log and trace messages point into the buffer the
+//     events were parsed from, so that buffer must outlive the recorder's
+//     contents.
+class EtlEventRecorder
+    : public LogEvents,
+      public TraceEvents,
+      public KernelModuleEvents,
+      public KernelPageFaultEvents,
+      public KernelProcessEvents,
+      public KernelThreadEvents {
+ public:
+  // The sinks recorded events are replayed to. Any of these may be NULL,
+  // in which case the corresponding events are dropped.
+  struct Sinks {
+    Sinks() : log_sink(NULL), trace_sink(NULL), module_sink(NULL),
+        page_fault_sink(NULL), process_sink(NULL), thread_sink(NULL) {
+    }
+
+    LogEvents* log_sink;
+    TraceEvents* trace_sink;
+    KernelModuleEvents* module_sink;
+    KernelPageFaultEvents* page_fault_sink;
+    KernelProcessEvents* process_sink;
+    KernelThreadEvents* thread_sink;
+  };
+
+  EtlEventRecorder();
+  ~EtlEventRecorder();
+
+  // @returns the number of recorded events.
+  size_t num_events() const { return events_.size(); }
+
+  // @returns the time of recorded event @p index.
+  const base::Time& event_time(size_t index) const;
+
+  // Issues the recorded events in the range [@p begin, @p end) to the
+  // matching sinks in @p sinks. Runs of log messages and trace events
+  // are issued in batches.
+  void Replay(size_t begin, size_t end, const Sinks& sinks) const;
+
+  // Discards all recorded events.
+  void Clear();
+
+  // LogEvents implementation.
+  virtual void OnLogMessage(const LogMessage& log_message);
+
+  // TraceEvents implementation.
+  virtual void OnTraceEventBegin(const TraceMessage& trace_message);
+  virtual void OnTraceEventEnd(const TraceMessage& trace_message);
+  virtual void OnTraceEventInstant(const TraceMessage& trace_message);
+
+  // KernelModuleEvents implementation.
+  virtual void OnModuleIsLoaded(DWORD process_id,
+                                const base::Time& time,
+                                const ModuleInformation& module_info);
+  virtual void OnModuleUnload(DWORD process_id,
+                              const base::Time& time,
+                              const ModuleInformation& module_info);
+  virtual void OnModuleLoad(DWORD process_id,
+                            const base::Time& time,
+                            const ModuleInformation& module_info);
+
+  // KernelPageFaultEvents implementation.
+  virtual void OnTransitionFault(DWORD process_id,
+                                 DWORD thread_id,
+                                 const base::Time& time,
+                                 sym_util::Address address,
+                                 sym_util::Address program_counter);
+  virtual void OnDemandZeroFault(DWORD process_id,
+                                 DWORD thread_id,
+                                 const base::Time& time,
+                                 sym_util::Address address,
+                                 sym_util::Address program_counter);
+  virtual void OnCopyOnWriteFault(DWORD process_id,
+                                  DWORD thread_id,
+                                  const base::Time& time,
+                                  sym_util::Address address,
+                                  sym_util::Address program_counter);
+  virtual void OnGuardPageFault(DWORD process_id,
+                                DWORD thread_id,
+                                const base::Time& time,
+                                sym_util::Address address,
+                                sym_util::Address program_counter);
+  virtual void OnHardFault(DWORD process_id,
+                           DWORD thread_id,
+                           const base::Time& time,
+                           sym_util::Address address,
+                           sym_util::Address program_counter);
+  virtual void OnAccessViolationFault(DWORD process_id,
+                                      DWORD thread_id,
+                                      const base::Time& time,
+                                      sym_util::Address address,
+                                      sym_util::Address program_counter);
+  virtual void OnHardPageFault(DWORD thread_id,
+                               const base::Time& time,
+                               const base::Time& initial_time,
+                               sym_util::Offset offset,
+                               sym_util::Address address,
+                               sym_util::Address file_object,
+                               sym_util::ByteCount byte_count);
+
+  // KernelProcessEvents implementation.
+  virtual void OnProcessIsRunning(const base::Time& time,
+                                  const ProcessInfo& process_info);
+  virtual void OnProcessStarted(const base::Time& time,
+                                const ProcessInfo& process_info);
+  virtual void OnProcessEnded(const base::Time& time,
+                              const ProcessInfo& process_info,
+                              ULONG exit_status);
+
+  // KernelThreadEvents implementation.
+  virtual void OnThreadIsRunning(const base::Time& time,
+                                 DWORD process_id,
+                                 DWORD thread_id);
+  virtual void OnThreadStarted(const base::Time& time,
+                               DWORD process_id,
+                               DWORD thread_id);
+  virtual void OnThreadEnded(const base::Time& time,
+                             DWORD process_id,
+                             DWORD thread_id);
+
+ private:
+  enum EventType {
+    LOG_MESSAGE,
+    TRACE_EVENT,
+    MODULE_IS_LOADED,
+    MODULE_UNLOAD,
+    MODULE_LOAD,
+    TRANSITION_FAULT,
+    DEMAND_ZERO_FAULT,
+    COPY_ON_WRITE_FAULT,
+    GUARD_PAGE_FAULT,
+    HARD_FAULT,
+    ACCESS_VIOLATION_FAULT,
+    HARD_PAGE_FAULT,
+    PROCESS_IS_RUNNING,
+    PROCESS_STARTED,
+    PROCESS_ENDED,
+    THREAD_IS_RUNNING,
+    THREAD_STARTED,
+    THREAD_ENDED,
+  };
+
+  // Each recorded event refers to an entry in the vector for its type.
+  struct Event {
+    EventType type;
+    base::Time time;
+    size_t index;
+  };
+
+  struct ModuleEvent {
+    DWORD process_id;
+    ModuleInformation module_info;
+  };
+
+  struct PageFaultEvent {
+    DWORD process_id;
+    DWORD thread_id;
+    sym_util::Address address;
+    sym_util::Address program_counter;
+  };
+
+  struct HardPageFaultEvent {
+    DWORD thread_id;
+    base::Time initial_time;
+    sym_util::Offset offset;
+    sym_util::Address address;
+    sym_util::Address file_object;
+    sym_util::ByteCount byte_count;
+  };
+
+  struct ProcessEvent {
+    ProcessInfo process_info;
+    ULONG exit_status;
+  };
+
+  struct ThreadEvent {
+    DWORD process_id;
+    DWORD thread_id;
+  };
+
+  // Issues the single recorded event @p index.
+  void ReplayOne(size_t index, const Sinks& sinks) const;
+
+  void AddEvent(EventType type, const base::Time& time, size_t index);
+  void AddTraceEvent(TraceEventType type, const TraceMessage& trace_message);
+  void AddModuleEvent(EventType type,
+                      DWORD process_id,
+                      const base::Time& time,
+                      const ModuleInformation& module_info);
+  void AddPageFaultEvent(EventType type,
+                         DWORD process_id,
+                         DWORD thread_id,
+                         const base::Time& time,
+                         sym_util::Address address,
+                         sym_util::Address program_counter);
+  void AddProcessEvent(EventType type,
+                       const base::Time& time,
+                       const ProcessInfo& process_info,
+                       ULONG exit_status);
+  void AddThreadEvent(EventType type,
+                      const base::Time& time,
+                      DWORD process_id,
+                      DWORD thread_id);
+
+  std::vector<Event> events_;
+  std::vector<LogMessage> log_messages_;
+  std::vector<TraceEvent> trace_events_;
+  std::vector<ModuleEvent> module_events_;
+  std::vector<PageFaultEvent> page_fault_events_;
+  std::vector<HardPageFaultEvent> hard_page_fault_events_;
+  std::vector<ProcessEvent> process_events_;
+  std::vector<ThreadEvent> thread_events_;
+
+  DISALLOW_COPY_AND_ASSIGN(EtlEventRecorder);
+};
+
+#endif  // SAWBUCK_LOG_LIB_ETL_EVENT_RECORDER_H_
@@ -0,0 +1,473 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Etl file consumer implementation.
+#include "sawbuck/log_lib/etl_file_consumer.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/simple_thread.h"
+#include "sawbuck/log_lib/etl_event_recorder.h"
+
+namespace {
+
+// The number of buffers of a single stream that may be read and parsed
+// ahead of the merge. This bounds memory use to a few buffers per
+// processor, regardless of the size of the files.
+const size_t kMaxBuffersAheadPerStream = 4;
+
+// @returns true iff the event at @p time in stream @p stream precedes
+//     the event at @p other_time in stream @p other_stream.
+bool Precedes(const base::Time& time, size_t stream,
+              const base::Time& other_time, size_t other_stream) {
+  if (time != other_time)
+    return time < other_time;
+
+  // Break ties in stream order, which is file order.
+  return stream < other_stream;
+}
+
+class ParallelDecoder;
+
+// Parses a single buffer, and records the resulting notifications.
+class BufferJob
+    : public base::DelegateSimpleThread::Delegate,
+      public EtlEventSink {
+ public:
+  BufferJob(ParallelDecoder* owner,
+            const EtlLogInfo& log_info,
+            bool is_64_bit_log,
+            const EtlEventRecorder::Sinks& sinks,
+            const LogMessageFilter* filter);
+
+  EtlBuffer* buffer() { return &buffer_; }
+  size_t unhandled_events() const { return unhandled_events_; }
+
+  // Accessors for the merge, valid once the job is done.
+  bool exhausted() const { return next_event_ >= recorder_.num_events(); }
+  const base::Time& next_event_time() const {
+    return recorder_.event_time(next_event_);
+  }
+
+  // Replays our events up to, but not including, the first one that
+  // doesn't precede @p other_job's next event in stream order.
+  // @param other_job may be NULL, in which case all remaining events
+  //     are replayed.
+  void ReplayEventsPreceding(size_t stream,
+                             const BufferJob* other_job,
+                             size_t other_stream,
+                             const EtlEventRecorder::Sinks& sinks);
+
+  // These are only accessed under the owner's lock.
+  bool done() const { return done_; }
+  void set_done() { done_ = true; }
+
+  // DelegateSimpleThread::Delegate implementation.
+  virtual void Run();
+
+ private:
+  // EtlEventSink implementation.
+  virtual void OnEtlEvent(EVENT_TRACE* event);
+
+  ParallelDecoder* owner_;
+  bool done_;
+  const EtlLogInfo& log_info_;
+  EtlBuffer buffer_;
+  LogParser log_parser_;
+  KernelLogParser kernel_parser_;
+  EtlEventRecorder recorder_;
+  size_t unhandled_events_;
+  size_t next_event_;
+
+  DISALLOW_COPY_AND_ASSIGN(BufferJob);
+};
+
+// Dispatches the buffers of a set of files to a pool of worker threads,
+// and merges the parsed buffers back to timestamp order.
+class ParallelDecoder {
+ public:
+  ParallelDecoder(EtlFileConsumer* consumer,
+                  const std::vector<EtlFileReader*>& readers);
+  ~ParallelDecoder();
+
+  // Parses all buffers of our files and issues their events in order.
+  HRESULT Decode();
+
+  size_t unhandled_events() const { return unhandled_events_; }
+
+  // Invoked on the worker threads as each job completes.
+  void OnJobDone(BufferJob* job);
+
+ private:
+  // The buffers filled by one processor in one file, in file order.
+  struct Stream {
+    Stream() : reader(NULL) {
+    }
+
+    EtlFileReader* reader;
+    // Buffers yet to be dispatched.
+    std::deque<size_t> pending;
+    // Buffers dispatched, but not yet merged.
+    std::deque<BufferJob*> jobs;
+  };
+
+  static const size_t kNoStream = static_cast<size_t>(-1);
+
+  // Reads the processor number of each buffer to build our streams.
+  bool BuildStreams();
+
+  // Reads and dispatches buffers until the workers are busy, or each
+  // stream has enough buffers in flight.
+  HRESULT DispatchJobs();
+
+  // Discards the front job of @p stream.
+  void RetireJob(Stream* stream);
+
+  EtlFileConsumer* consumer_;
+  std::vector<EtlFileReader*> readers_;
+  EtlEventRecorder::Sinks sinks_;
+  std::vector<Stream> streams_;
+  scoped_ptr<base::DelegateSimpleThreadPool> pool_;
+  size_t max_jobs_in_flight_;
+  size_t unhandled_events_;
+
+  base::Lock lock_;
+  // Signaled as jobs complete, under lock_.
+  base::ConditionVariable job_done_;
+  // The number of dispatched jobs not yet done, under lock_.
+  size_t jobs_in_flight_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelDecoder);
+};
+
+BufferJob::BufferJob(ParallelDecoder* owner,
+                     const EtlLogInfo& log_info,
+                     bool is_64_bit_log,
+                     const EtlEventRecorder::Sinks& sinks,
+                     const LogMessageFilter* filter)
+    : owner_(owner),
+      done_(false),
+      log_info_(log_info),
+      unhandled_events_(0),
+      next_event_(0) {
+  DCHECK(owner != NULL);
+
+  // Only hook up the sinks our consumer has, as the parsers only handle
+  // events for which there's a listener.
+  if (sinks.log_sink != NULL)
+    log_parser_.set_event_sink(&recorder_);
+  if (sinks.trace_sink != NULL)
+    log_parser_.set_trace_sink(&recorder_);
+  if (sinks.module_sink != NULL)
+    kernel_parser_.set_module_event_sink(&recorder_);
+  if (sinks.page_fault_sink != NULL)
+    kernel_parser_.set_page_fault_event_sink(&recorder_);
+  if (sinks.process_sink != NULL)
+    kernel_parser_.set_process_event_sink(&recorder_);
+  if (sinks.thread_sink != NULL)
+    kernel_parser_.set_thread_event_sink(&recorder_);
+  log_parser_.set_filter(filter);
+
+  // Only the first buffer of a file has the logfile header, so the
+  // bitness is decided up front for all buffers.
+  kernel_parser_.set_infer_bitness_from_log(false);
+  kernel_parser_.set_is_64_bit_log(is_64_bit_log);
+}
+
+void BufferJob::Run() {
+  EtlFileReader::DecodeBuffer(log_info_, buffer_, this, NULL);
+  owner_->OnJobDone(this);
+  // Note: this may be deleted at this point.
+}
+
+void BufferJob::ReplayEventsPreceding(size_t stream,
+                                      const BufferJob* other_job,
+                                      size_t other_stream,
+                                      const EtlEventRecorder::Sinks& sinks) {
+  DCHECK(!exhausted());
+
+  // Always replay at least one event, as we're the earliest stream.
+  size_t end = next_event_ + 1;
+  if (other_job == NULL) {
+    end = recorder_.num_events();
+  } else {
+    const base::Time& other_time = other_job->next_event_time();
+    while (end < recorder_.num_events() &&
+           Precedes(recorder_.event_time(end), stream,
+                    other_time, other_stream)) {
+      ++end;
+    }
+  }
+
+  recorder_.Replay(next_event_, end, sinks);
+  next_event_ = end;
+}
+
+void BufferJob::OnEtlEvent(EVENT_TRACE* event) {
+  if (!log_parser_.ProcessOneEvent(event) &&
+      !kernel_parser_.ProcessOneEvent(event)) {
+    ++unhandled_events_;
+  }
+}
+
+ParallelDecoder::ParallelDecoder(EtlFileConsumer* consumer,
+                                 const std::vector<EtlFileReader*>& readers)
+    : consumer_(consumer),
+      readers_(readers),
+      max_jobs_in_flight_(2 * consumer->num_threads()),
+      unhandled_events_(0),
+      job_done_(&lock_),
+      jobs_in_flight_(0) {
+  DCHECK(consumer != NULL);
+
+  sinks_.log_sink = consumer->event_sink();
+  sinks_.trace_sink = consumer->trace_sink();
+  sinks_.module_sink = consumer->module_event_sink();
+  sinks_.page_fault_sink = consumer->page_fault_event_sink();
+  sinks_.process_sink = consumer->process_event_sink();
+  sinks_.thread_sink = consumer->thread_event_sink();
+}
+
+ParallelDecoder::~ParallelDecoder() {
+  DCHECK(pool_.get() == NULL);
+
+  for (size_t i = 0; i < streams_.size(); ++i) {
+    while (!streams_[i].jobs.empty())
+      RetireJob(&streams_[i]);
+  }
+}
+
+HRESULT ParallelDecoder::Decode() {
+  if (!BuildStreams())
+    return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+
+  if (consumer_->num_threads() > 1) {
+    pool_.reset(new base::DelegateSimpleThreadPool(
+        "EtlFileConsumer", static_cast<int>(consumer_->num_threads())));
+    pool_->Start();
+  }
+
+  HRESULT hr = S_OK;
+  while (true) {
+    hr = DispatchJobs();
+    if (FAILED(hr))
+      break;
+
+    // Retire the consumed buffers, and find the streams with the
+    // earliest and second earliest next events. We can only merge
+    // when the next buffer of every stream has been parsed.
+    size_t earliest = kNoStream;
+    size_t second = kNoStream;
+    bool blocked = false;
+    bool needs_dispatch = false;
+    {
+      base::AutoLock lock(lock_);
+      for (size_t i = 0; i < streams_.size(); ++i) {
+        Stream& stream = streams_[i];
+        while (!stream.jobs.empty() && stream.jobs.front()->done() &&
+               stream.jobs.front()->exhausted()) {
+          RetireJob(&stream);
+        }
+
+        if (stream.jobs.empty()) {
+          if (!stream.pending.empty())
+            blocked = needs_dispatch = true;
+          continue;
+        }
+
+        BufferJob* job = stream.jobs.front();
+        if (!job->done()) {
+          blocked = true;
+          continue;
+        }
+
+        if (earliest == kNoStream ||
+            Precedes(job->next_event_time(), i,
+                     streams_[earliest].jobs.front()->next_event_time(),
+                     earliest)) {
+          second = earliest;
+          earliest = i;
+        } else if (second == kNoStream ||
+                   Precedes(job->next_event_time(), i,
+                            streams_[second].jobs.front()->next_event_time(),
+                            second)) {
+          second = i;
+        }
+      }
+
+      if (blocked) {
+        // Wait for a buffer to complete, unless there's a buffer to
+        // dispatch and room to dispatch it.
+        if (jobs_in_flight_ != 0 &&
+            (!needs_dispatch || jobs_in_flight_ >= max_jobs_in_flight_)) {
+          job_done_.Wait();
+        }
+        continue;
+      }
+    }
+
+    if (earliest == kNoStream)
+      break;
+
+    // Replay the earliest stream's events up to the next event of any
+    // other stream.
+    BufferJob* job = streams_[earliest].jobs.front();
+    const BufferJob* second_job =
+        second == kNoStream ? NULL : streams_[second].jobs.front();
+    job->ReplayEventsPreceding(earliest, second_job, second, sinks_);
+  }
+
+  if (pool_.get() != NULL) {
+    pool_->JoinAll();
+    pool_.reset();
+  }
+
+  return hr;
+}
+
+void ParallelDecoder::OnJobDone(BufferJob* job) {
+  base::AutoLock lock(lock_);
+  DCHECK(!job->done());
+  job->set_done();
+  if (pool_.get() != NULL) {
+    DCHECK_NE(0U, jobs_in_flight_);
+    --jobs_in_flight_;
+  }
+  job_done_.Signal();
+}
+
+bool ParallelDecoder::BuildStreams() {
+  for (size_t i = 0; i < readers_.size(); ++i) {
+    EtlFileReader* reader = readers_[i];
+
+    // Order the streams of each file by processor number.
+    typedef std::map<uint8, Stream> StreamMap;
+    StreamMap streams;
+    for (size_t j = 0; j < reader->num_buffers(); ++j) {
+      uint8 processor_number = 0;
+      if (!reader->ReadBufferProcessor(j, &processor_number))
+        return false;
+
+      Stream& stream = streams[processor_number];
+      stream.reader = reader;
+      stream.pending.push_back(j);
+    }
+
+    StreamMap::const_iterator it(streams.begin());
+    for (; it != streams.end(); ++it)
+      streams_.push_back(it->second);
+  }
+
+  return true;
+}
+
+HRESULT ParallelDecoder::DispatchJobs() {
+  while (true) {
+    if (pool_.get() != NULL) {
+      base::AutoLock lock(lock_);
+      if (jobs_in_flight_ >= max_jobs_in_flight_)
+        return S_OK;
+    }
+
+    // Pick the stream with the fewest buffers in flight, which favors
+    // the streams the merge is waiting for.
+    Stream* next = NULL;
+    for (size_t i = 0; i < streams_.size(); ++i) {
+      Stream& stream = streams_[i];
+      if (stream.pending.empty() ||
+          stream.jobs.size() >= kMaxBuffersAheadPerStream) {
+        continue;
+      }
+
+      if (next == NULL || stream.jobs.size() < next->jobs.size())
+        next = &stream;
+    }
+
+    if (next == NULL)
+      return S_OK;
+
+    EtlFileReader* reader = next->reader;
+    bool is_64_bit_log = consumer_->infer_bitness_from_log() ?
+        reader->log_info().is_64_bit_log() : consumer_->is_64_bit_log();
+    scoped_ptr<BufferJob> job(
+        new BufferJob(this, reader->log_info(), is_64_bit_log, sinks_,
+                      consumer_->filter()));
+    if (!reader->ReadBuffer(next->pending.front(), job->buffer()))
+      return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+
+    next->pending.pop_front();
+    next->jobs.push_back(job.get());
+    if (pool_.get() != NULL) {
+      {
+        base::AutoLock lock(lock_);
+        ++jobs_in_flight_;
+      }
+      pool_->AddWork(job.release());
+    } else {
+      job.release()->Run();
+    }
+  }
+}
+
+void ParallelDecoder::RetireJob(Stream* stream) {
+  DCHECK(stream != NULL && !stream->jobs.empty());
+
+  BufferJob* job = stream->jobs.front();
+  stream->jobs.pop_front();
+  unhandled_events_ += job->unhandled_events();
+  delete job;
+}
+
+}  // namespace
+
+EtlFileConsumer::EtlFileConsumer() : num_threads_(1), unhandled_events_(0) {
+}
+
+EtlFileConsumer::~EtlFileConsumer() {
+  Close();
+}
+
+void EtlFileConsumer::set_num_threads(size_t num_threads) {
+  DCHECK_NE(0U, num_threads);
+  num_threads_ = std::max(num_threads, static_cast<size_t>(1));
+}
+
+HRESULT EtlFileConsumer::OpenFileSession(const wchar_t* file_name) {
+  DCHECK(file_name != NULL);
+
+  scoped_ptr<EtlFileReader> reader(new EtlFileReader());
+  if (!reader->Open(base::FilePath(file_name)))
+    return HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+
+  readers_.push_back(reader.release());
+  return S_OK;
+}
+
+HRESULT EtlFileConsumer::Consume() {
+  ParallelDecoder decoder(this, readers_.get());
+  HRESULT hr = decoder.Decode();
+  unhandled_events_ += decoder.unhandled_events();
+
+  return hr;
+}
+
+HRESULT EtlFileConsumer::Close() {
+  readers_.clear();
+  return S_OK;
+}
@@ -0,0 +1,66 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A log file consumer that reads .etl files with EtlFileReader.
+#ifndef SAWBUCK_LOG_LIB_ETL_FILE_CONSUMER_H_
+#define SAWBUCK_LOG_LIB_ETL_FILE_CONSUMER_H_
+
+#include "base/memory/scoped_vector.h"
+#include "sawbuck/log_lib/etl_file_reader.h"
+#include "sawbuck/log_lib/kernel_log_consumer.h"
+#include "sawbuck/log_lib/log_consumer.h"
+
+// Parses log and kernel events out of .etl files. This stands in for
+// EtwTraceConsumerBase in file sessions, but decodes the files itself,
+// so it needs no static instance pointer, and any number of instances
+// can coexist.
+//
+// The buffers of the files are parsed in parallel on a pool of worker
+// threads. As each buffer holds the events of a single processor in
+// time order, the parsed buffers are then merged across processors and
+// files, and the events are issued to the sinks in timestamp order on
+// the thread that calls Consume.
+class EtlFileConsumer
+    : public KernelLogParser,
+      public LogParser {
+ public:
+  EtlFileConsumer();
+  ~EtlFileConsumer();
+
+  // The number of threads buffers are parsed on. With a single thread,
+  // buffers are parsed on the thread that calls Consume. Defaults to 1.
+  size_t num_threads() const { return num_threads_; }
+  void set_num_threads(size_t num_threads);
+
+  // Opens the .etl file at @p file_name for consumption.
+  HRESULT OpenFileSession(const wchar_t* file_name);
+
+  // Consumes the opened files, and issues their events to our sinks.
+  HRESULT Consume();
+
+  // Closes all opened files.
+  HRESULT Close();
+
+  // The number of events consumed that none of our parsers handled.
+  size_t unhandled_events() const { return unhandled_events_; }
+
+ private:
+  ScopedVector<EtlFileReader> readers_;
+  size_t num_threads_;
+  size_t unhandled_events_;
+
+  DISALLOW_COPY_AND_ASSIGN(EtlFileConsumer);
+};
+
+#endif  // SAWBUCK_LOG_LIB_ETL_FILE_CONSUMER_H_
@@ -0,0 +1,186 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Measures the throughput of EtlFileConsumer with 1 to N threads.
+#include "sawbuck/log_lib/etl_file_consumer.h"
+
+#include <vector>
+#include "base/file_util.h"
+#include "base/files/file.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/logging_win.h"
+#include "base/strings/stringprintf.h"
+#include "base/sys_info.h"
+#include "base/test/perf_time_logger.h"
+#include "base/time/time.h"
+#include "gtest/gtest.h"
+#include "sawbuck/log_lib/kernel_log_types.h"  // NOLINT - must be last.
+
+namespace {
+
+const uint32 kBufferSize = 64 * 1024;
+const size_t kBufferHeaderSize = 72;
+const size_t kNumProcessors = 8;
+// 256 MB worth of buffers.
+const size_t kNumBuffers = 4096;
+const int64 kPerfFrequency = 10000000;
+const int64 kStartTime = 129488146035903615LL;
+
+const char kMessage[] =
+    "[1234:5678:0514/123456:INFO:chrome_browser_main.cc(1234)] "
+    "Some moderately long log message, as logged by a chatty provider.";
+
+// Writes a synthetic .etl file of log messages, interleaved across
+// kNumProcessors processors.
+class SyntheticLogWriter {
+ public:
+  SyntheticLogWriter() : buffer_(kBufferSize), used_(0), timestamp_(0) {
+  }
+
+  bool Write(const base::FilePath& path, size_t* num_events) {
+    base::File file(path,
+                    base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+    if (!file.IsValid())
+      return false;
+
+    *num_events = 0;
+    WriteHeaderBuffer();
+    if (!Flush(&file, 0))
+      return false;
+
+    for (size_t i = 1; i < kNumBuffers; ++i) {
+      uint8 processor = static_cast<uint8>(i % kNumProcessors);
+      BeginBuffer(processor);
+      while (AddLogMessage())
+        ++(*num_events);
+      if (!Flush(&file, i))
+        return false;
+    }
+
+    return true;
+  }
+
+ private:
+  void BeginBuffer(uint8 processor) {
+    std::fill(buffer_.begin(), buffer_.end(), 0xFF);
+    memset(&buffer_[0], 0, kBufferHeaderSize);
+    Put(0, kBufferSize);
+    buffer_[40] = processor;
+    buffer_[41] = 8;  // Alignment.
+    used_ = kBufferHeaderSize;
+  }
+
+  void WriteHeaderBuffer() {
+    BeginBuffer(0);
+
+    kernel_log_types::LogFileHeader32 header = {};
+    header.BufferSize = kBufferSize;
+    header.PointerSize = 4;
+    header.PerfFrequency = kPerfFrequency;
+    header.StartTime = kStartTime;
+    header.ReservedFlags = 1;  // QPC clock.
+
+    const size_t kSystemHeaderSize = 32;
+    uint16 size = static_cast<uint16>(kSystemHeaderSize + sizeof(header));
+    memset(&buffer_[used_], 0, size);
+    Put(used_ + 2, static_cast<uint8>(1));  // SYSTEM32 header type.
+    Put(used_ + 3, static_cast<uint8>(0xC0));
+    Put(used_ + 4, size);
+    Put(used_ + 16, timestamp_);
+    memcpy(&buffer_[used_ + kSystemHeaderSize], &header, sizeof(header));
+    used_ += (size + 7) & ~7;
+  }
+
+  bool AddLogMessage() {
+    size_t size = sizeof(EVENT_TRACE_HEADER) + sizeof(kMessage);
+    if (used_ + size > kBufferSize)
+      return false;
+
+    EVENT_TRACE_HEADER header = {};
+    header.Size = static_cast<USHORT>(size);
+    header.HeaderType = 10;  // FULL_HEADER32.
+    header.MarkerFlags = 0xC0;
+    header.Class.Type = logging::LOG_MESSAGE;
+    header.Class.Level = TRACE_LEVEL_INFORMATION;
+    header.ThreadId = 5678;
+    header.ProcessId = 1234;
+    header.TimeStamp.QuadPart = ++timestamp_;
+    header.Guid = logging::kLogEventId;
+    memcpy(&buffer_[used_], &header, sizeof(header));
+    memcpy(&buffer_[used_ + sizeof(header)], kMessage, sizeof(kMessage));
+    used_ += (size + 7) & ~7;
+
+    return true;
+  }
+
+  bool Flush(base::File* file, size_t index) {
+    Put(48, static_cast<uint32>(used_));
+    int64 offset = static_cast<int64>(index) * kBufferSize;
+    return file->Write(offset, reinterpret_cast<char*>(&buffer_[0]),
+                       kBufferSize) == static_cast<int>(kBufferSize);
+  }
+
+  template <class Type>
+  void Put(size_t pos, Type value) {
+    memcpy(&buffer_[pos], &value, sizeof(value));
+  }
+
+  std::vector<uint8> buffer_;
+  size_t used_;
+  int64 timestamp_;
+};
+
+class CountingLogEvents : public LogEvents {
+ public:
+  CountingLogEvents() : num_messages_(0), last_time_() {
+  }
+
+  virtual void OnLogMessage(const LogMessage& log_message) {
+    EXPECT_LE(last_time_, log_message.time);
+    last_time_ = log_message.time;
+    ++num_messages_;
+  }
+
+  size_t num_messages_;
+  base::Time last_time_;
+};
+
+TEST(EtlFileConsumerPerfTest, ConsumeThroughput) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath path = temp_dir.path().Append(L"synthetic.etl");
+
+  SyntheticLogWriter writer;
+  size_t num_events = 0;
+  ASSERT_TRUE(writer.Write(path, &num_events));
+
+  size_t max_threads = base::SysInfo::NumberOfProcessors();
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    EtlFileConsumer consumer;
+    CountingLogEvents events;
+    consumer.set_num_threads(threads);
+    consumer.set_event_sink(&events);
+    ASSERT_HRESULT_SUCCEEDED(consumer.OpenFileSession(path.value().c_str()));
+
+    std::string name = base::StringPrintf("etl_consume_%dthreads",
+                                          static_cast<int>(threads));
+    base::PerfTimeLogger timer(name.c_str());
+    ASSERT_HRESULT_SUCCEEDED(consumer.Consume());
+    timer.Done();
+
+    EXPECT_EQ(num_events, events.num_messages_);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,542 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Native .etl file reader implementation.
+#include "sawbuck/log_lib/etl_file_reader.h"
+
+#include "base/logging.h"
+#include "sawbuck/common/buffer_parser.h"
+// Note: no initguid.h here, the GUIDs are defined in kernel_log_consumer.cc.
+#include "sawbuck/log_lib/kernel_log_types.h"  // NOLINT - must be last
+
+namespace {
+
+using namespace kernel_log_types;
+
+// The layouts below are gleaned from the DDK headers and from hex dumps
+// of .etl files. An .etl file is a sequence of fixed-size buffers, each of
+// which starts with a WmiBufferHeader, followed by 8 byte aligned event
+// records, each of which starts with one of the trace headers below.
+
+// This is WMI_BUFFER_HEADER from the DDK.
+struct WmiBufferHeader {
+  ULONG BufferSize;
+  ULONG SavedOffset;
+  ULONG CurrentOffset;
+  LONG ReferenceCount;
+  LONGLONG TimeStamp;
+  LONGLONG SequenceNumber;
+  ULONGLONG ClockTypeAndFrequency;
+  UCHAR ProcessorNumber;
+  UCHAR Alignment;
+  USHORT LoggerId;
+  ULONG State;
+  ULONG Offset;
+  USHORT BufferFlag;
+  USHORT BufferType;
+  ULONGLONG Padding[2];
+};
+COMPILE_ASSERT(sizeof(WmiBufferHeader) == 72, wmi_buffer_header_is_72_bytes);
+
+// The trace header types, found in the third byte of each record.
+enum {
+  kTraceHeaderTypeSystem32 = 1,
+  kTraceHeaderTypeSystem64 = 2,
+  kTraceHeaderTypeCompact32 = 3,
+  kTraceHeaderTypeCompact64 = 4,
+  kTraceHeaderTypeFullHeader32 = 10,
+  kTraceHeaderTypeInstance32 = 11,
+  kTraceHeaderTypeError = 13,
+  kTraceHeaderTypeWnodeHeader = 14,
+  kTraceHeaderTypeMessage = 15,
+  kTraceHeaderTypePerfInfo32 = 16,
+  kTraceHeaderTypePerfInfo64 = 17,
+  kTraceHeaderTypeEventHeader32 = 18,
+  kTraceHeaderTypeEventHeader64 = 19,
+  kTraceHeaderTypeFullHeader64 = 20,
+  kTraceHeaderTypeInstance64 = 21,
+};
+
+// The high bit of the fourth byte is set for all valid records.
+const UCHAR kTraceHeaderFlag = 0x80;
+
+// This is SYSTEM_TRACE_HEADER from the DDK. The compact variant omits
+// the trailing KernelTime and UserTime.
+struct SystemTraceHeader {
+  USHORT Version;
+  UCHAR HeaderType;
+  UCHAR MarkerFlags;
+  USHORT Size;
+  USHORT HookId;
+  ULONG ThreadId;
+  ULONG ProcessId;
+  LONGLONG SystemTime;
+  ULONG KernelTime;
+  ULONG UserTime;
+};
+COMPILE_ASSERT(sizeof(SystemTraceHeader) == 32, system_header_is_32_bytes);
+const size_t kCompactTraceHeaderSize = 24;
+
+// This is PERFINFO_TRACE_HEADER from the DDK.
+struct PerfInfoTraceHeader {
+  USHORT Version;
+  UCHAR HeaderType;
+  UCHAR MarkerFlags;
+  USHORT Size;
+  USHORT HookId;
+  LONGLONG SystemTime;
+};
+COMPILE_ASSERT(sizeof(PerfInfoTraceHeader) == 16, perfinfo_header_is_16_bytes);
+
+// Full headers are laid out as EVENT_TRACE_HEADER, with the GUID inline.
+COMPILE_ASSERT(sizeof(EVENT_TRACE_HEADER) == 48, full_header_is_48_bytes);
+
+// The first eight bytes of any record, enough to determine its type
+// and size.
+struct TraceRecordPrefix {
+  USHORT SizeOrVersion;
+  UCHAR HeaderType;
+  UCHAR MarkerFlags;
+  USHORT SystemSize;
+  USHORT HookId;
+};
+
+// Perfinfo events carry no process or thread id.
+const ULONG kInvalidId = static_cast<ULONG>(-1);
+
+const GUID kNullGuid = {};
+
+// System headers carry a hook id of (group | event type) in place of
+// an event class GUID, this maps them back to the GUIDs ProcessTrace
+// would report.
+const GUID& GetSystemEventClass(USHORT hook_id) {
+  switch (hook_id & 0xFF00) {
+    case kEventTraceGroupHeader:
+      return kEventTraceEventClass;
+    case kEventTraceGroupMemory:
+      return kPageFaultEventClass;
+    case kEventTraceGroupProcess:
+      // XP logs image loads in the process group.
+      if ((hook_id & 0xFF) == kImageNotifyLoadEvent)
+        return kImageLoadEventClass;
+      return kProcessEventClass;
+    case kEventTraceGroupThread:
+      return kThreadEventClass;
+    case kEventTraceGroupImage:
+      return kImageLoadEventClass;
+  }
+
+  return kNullGuid;
+}
+
+void SetTimeStamp(const EtlLogInfo& log_info, LONGLONG raw_timestamp,
+                  EVENT_TRACE* event) {
+  event->Header.TimeStamp.QuadPart = log_info.ToFileTime(raw_timestamp);
+}
+
+size_t AlignUp(size_t value, size_t alignment) {
+  DCHECK((alignment & (alignment - 1)) == 0);
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// The outcome of decoding a single record.
+enum DecodeResult {
+  // A record was decoded to an event.
+  DECODED_EVENT,
+  // A well-formed record of a type we don't decode.
+  SKIPPED_RECORD,
+  // The end of the buffer's data, or a malformed record.
+  END_OF_BUFFER,
+};
+
+// Decodes the record at @p pos in @p parser to @p event.
+// @param record_size on success returns the size of the record, not
+//     including alignment padding.
+DecodeResult DecodeRecord(const EtlLogInfo& log_info,
+                          BinaryBufferParser* parser,
+                          size_t pos,
+                          EVENT_TRACE* event,
+                          size_t* record_size) {
+  DCHECK(parser != NULL && event != NULL && record_size != NULL);
+
+  const TraceRecordPrefix* prefix = NULL;
+  if (!parser->GetAt(pos, &prefix) ||
+      (prefix->MarkerFlags & kTraceHeaderFlag) == 0) {
+    return END_OF_BUFFER;
+  }
+
+  size_t header_size = 0;
+  size_t size = 0;
+  switch (prefix->HeaderType) {
+    case kTraceHeaderTypeSystem32:
+    case kTraceHeaderTypeSystem64:
+    case kTraceHeaderTypeCompact32:
+    case kTraceHeaderTypeCompact64: {
+        bool is_compact = prefix->HeaderType == kTraceHeaderTypeCompact32 ||
+            prefix->HeaderType == kTraceHeaderTypeCompact64;
+        header_size = is_compact ? kCompactTraceHeaderSize :
+                                   sizeof(SystemTraceHeader);
+        const SystemTraceHeader* header = NULL;
+        size = prefix->SystemSize;
+        if (size < header_size || !parser->GetAt(pos, size, &header))
+          return END_OF_BUFFER;
+
+        event->Header.Class.Type = header->HookId & 0xFF;
+        event->Header.Class.Version = header->Version;
+        event->Header.ThreadId = header->ThreadId;
+        event->Header.ProcessId = header->ProcessId;
+        event->Header.Guid = GetSystemEventClass(header->HookId);
+        if (!is_compact) {
+          event->Header.KernelTime = header->KernelTime;
+          event->Header.UserTime = header->UserTime;
+        }
+        SetTimeStamp(log_info, header->SystemTime, event);
+      }
+      break;
+
+    case kTraceHeaderTypePerfInfo32:
+    case kTraceHeaderTypePerfInfo64: {
+        header_size = sizeof(PerfInfoTraceHeader);
+        const PerfInfoTraceHeader* header = NULL;
+        size = prefix->SystemSize;
+        if (size < header_size || !parser->GetAt(pos, size, &header))
+          return END_OF_BUFFER;
+
+        event->Header.Class.Type = header->HookId & 0xFF;
+        event->Header.Class.Version = header->Version;
+        event->Header.ThreadId = kInvalidId;
+        event->Header.ProcessId = kInvalidId;
+        event->Header.Guid = GetSystemEventClass(header->HookId);
+        SetTimeStamp(log_info, header->SystemTime, event);
+      }
+      break;
+
+    case kTraceHeaderTypeFullHeader32:
+    case kTraceHeaderTypeFullHeader64: {
+        header_size = sizeof(EVENT_TRACE_HEADER);
+        const EVENT_TRACE_HEADER* header = NULL;
+        size = prefix->SizeOrVersion;
+        if (size < header_size || !parser->GetAt(pos, size, &header))
+          return END_OF_BUFFER;
+
+        event->Header = *header;
+        SetTimeStamp(log_info, header->TimeStamp.QuadPart, event);
+      }
+      break;
+
+    case kTraceHeaderTypeInstance32:
+    case kTraceHeaderTypeInstance64:
+    case kTraceHeaderTypeEventHeader32:
+    case kTraceHeaderTypeEventHeader64:
+    case kTraceHeaderTypeError:
+    case kTraceHeaderTypeMessage:
+      // These all lead with their size.
+      size = prefix->SizeOrVersion;
+      if (size < sizeof(*prefix) || !parser->Contains(pos, size))
+        return END_OF_BUFFER;
+
+      *record_size = size;
+      return SKIPPED_RECORD;
+
+    default:
+      // Either the 0xFF fill at the end of the buffer, or something
+      // we don't know how to size.
+      return END_OF_BUFFER;
+  }
+
+  const void* payload = NULL;
+  bool contained = parser->GetAt(pos + header_size, size - header_size,
+                                 &payload);
+  DCHECK(contained);
+  event->Header.Size = static_cast<USHORT>(size);
+  event->MofData = const_cast<void*>(payload);
+  event->MofLength = static_cast<ULONG>(size - header_size);
+  *record_size = size;
+
+  return DECODED_EVENT;
+}
+
+}  // namespace
+
+int64 EtlLogInfo::ToFileTime(int64 raw_timestamp) const {
+  const int64 kFileTimeUnitsPerSecond = 10000000;
+
+  int64 frequency = 0;
+  switch (clock_type) {
+    case CLOCK_SYSTEM_TIME:
+      // Already in FILETIME units.
+      return raw_timestamp;
+
+    case CLOCK_QUERY_PERFORMANCE_COUNTER:
+      frequency = perf_frequency;
+      break;
+
+    case CLOCK_CPU_CYCLE_COUNTER:
+      frequency = static_cast<int64>(cpu_speed_mhz) * 1000000;
+      break;
+
+    default:
+      break;
+  }
+
+  if (frequency <= 0)
+    return start_time;
+
+  // Scale the whole seconds and the remainder separately, as the
+  // product of the delta and the units overflows for long sessions
+  // on high frequency clocks.
+  int64 delta = raw_timestamp - reference_timestamp;
+  int64 seconds = delta / frequency;
+  int64 remainder = delta % frequency;
+
+  return start_time + seconds * kFileTimeUnitsPerSecond +
+      remainder * kFileTimeUnitsPerSecond / frequency;
+}
+
+EtlBuffer::EtlBuffer() : index_(0) {
+}
+
+EtlBuffer::~EtlBuffer() {
+}
+
+uint8 EtlBuffer::processor_number() const {
+  if (data_.size() < sizeof(WmiBufferHeader))
+    return 0;
+
+  return reinterpret_cast<const WmiBufferHeader*>(&data_[0])->ProcessorNumber;
+}
+
+size_t EtlBuffer::used_len() const {
+  if (data_.size() < sizeof(WmiBufferHeader))
+    return 0;
+
+  // Flushed buffers record their fill level in Offset, fall back to
+  // SavedOffset, and ultimately to the whole buffer, which is safe as
+  // decoding stops at the fill pattern.
+  const WmiBufferHeader* header =
+      reinterpret_cast<const WmiBufferHeader*>(&data_[0]);
+  if (header->Offset >= sizeof(*header) && header->Offset <= data_.size())
+    return header->Offset;
+  if (header->SavedOffset >= sizeof(*header) &&
+      header->SavedOffset <= data_.size()) {
+    return header->SavedOffset;
+  }
+
+  return data_.size();
+}
+
+void EtlBuffer::Assign(size_t index, const void* data, size_t data_len) {
+  const uint8* bytes = reinterpret_cast<const uint8*>(data);
+  index_ = index;
+  data_.assign(bytes, bytes + data_len);
+}
+
+EtlFileReader::EtlFileReader() : num_buffers_(0), skipped_events_(0) {
+}
+
+EtlFileReader::~EtlFileReader() {
+}
+
+bool EtlFileReader::Open(const base::FilePath& path) {
+  Close();
+
+  file_.Initialize(path, base::File::FLAG_OPEN | base::File::FLAG_READ);
+  if (!file_.IsValid()) {
+    LOG(ERROR) << "Unable to open \"" << path.value() << "\".";
+    return false;
+  }
+
+  // Read the first buffer header to get at the buffer size.
+  WmiBufferHeader header = {};
+  if (file_.Read(0, reinterpret_cast<char*>(&header), sizeof(header)) !=
+          sizeof(header) ||
+      header.BufferSize < sizeof(header)) {
+    LOG(ERROR) << "\"" << path.value() << "\" is not an event trace file.";
+    Close();
+    return false;
+  }
+
+  int64 file_length = file_.GetLength();
+  if (file_length < header.BufferSize) {
+    LOG(ERROR) << "\"" << path.value() << "\" is truncated.";
+    Close();
+    return false;
+  }
+
+  log_info_.buffer_size = header.BufferSize;
+  num_buffers_ = static_cast<size_t>(file_length / header.BufferSize);
+
+  EtlBuffer first;
+  if (!ReadBuffer(0, &first) || !ReadLogInfo(first, &log_info_)) {
+    LOG(ERROR) << "Unable to read the logfile header of \""
+               << path.value() << "\".";
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void EtlFileReader::Close() {
+  file_.Close();
+  log_info_ = EtlLogInfo();
+  num_buffers_ = 0;
+  skipped_events_ = 0;
+}
+
+bool EtlFileReader::ReadBuffer(size_t index, EtlBuffer* buffer) {
+  DCHECK(buffer != NULL);
+  if (!file_.IsValid() || index >= num_buffers_)
+    return false;
+
+  size_t buffer_size = log_info_.buffer_size;
+  buffer->data_.resize(buffer_size);
+  buffer->index_ = index;
+  int64 offset = static_cast<int64>(index) * buffer_size;
+  int read = file_.Read(offset,
+                        reinterpret_cast<char*>(&buffer->data_[0]),
+                        static_cast<int>(buffer_size));
+
+  return read == static_cast<int>(buffer_size);
+}
+
+bool EtlFileReader::ReadBufferProcessor(size_t index,
+                                        uint8* processor_number) {
+  DCHECK(processor_number != NULL);
+  if (!file_.IsValid() || index >= num_buffers_)
+    return false;
+
+  int64 offset = static_cast<int64>(index) * log_info_.buffer_size +
+      FIELD_OFFSET(WmiBufferHeader, ProcessorNumber);
+  return file_.Read(offset, reinterpret_cast<char*>(processor_number),
+                    sizeof(*processor_number)) == sizeof(*processor_number);
+}
+
+size_t EtlFileReader::DecodeBuffer(const EtlBuffer& buffer,
+                                   EtlEventSink* sink) {
+  return DecodeBuffer(log_info_, buffer, sink, &skipped_events_);
+}
+
+// static
+size_t EtlFileReader::DecodeBuffer(const EtlLogInfo& log_info,
+                                   const EtlBuffer& buffer,
+                                   EtlEventSink* sink,
+                                   size_t* skipped) {
+  DCHECK(sink != NULL);
+
+  BinaryBufferParser parser(buffer.data(), buffer.used_len());
+  const WmiBufferHeader* buffer_header = NULL;
+  if (!parser.GetAt(0, &buffer_header))
+    return 0;
+
+  size_t alignment = buffer_header->Alignment;
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    alignment = 8;
+
+  EVENT_TRACE event = {};
+  size_t num_events = 0;
+  size_t pos = sizeof(*buffer_header);
+  while (true) {
+    memset(&event, 0, sizeof(event));
+    event.BufferContext.ProcessorNumber = buffer_header->ProcessorNumber;
+    event.BufferContext.LoggerId = buffer_header->LoggerId;
+
+    size_t record_size = 0;
+    DecodeResult result =
+        DecodeRecord(log_info, &parser, pos, &event, &record_size);
+    if (result == END_OF_BUFFER)
+      break;
+
+    if (result == DECODED_EVENT) {
+      sink->OnEtlEvent(&event);
+      ++num_events;
+    } else if (skipped != NULL) {
+      ++(*skipped);
+    }
+
+    pos += AlignUp(record_size, alignment);
+  }
+
+  return num_events;
+}
+
+// static
+bool EtlFileReader::ReadLogInfo(const EtlBuffer& buffer,
+                                EtlLogInfo* log_info) {
+  DCHECK(log_info != NULL);
+
+  // The logfile header is the first record in the first buffer.
+  BinaryBufferParser parser(buffer.data(), buffer.used_len());
+  EVENT_TRACE event = {};
+  size_t record_size = 0;
+  // Decode with a pass-through clock to get at the raw timestamp.
+  EtlLogInfo raw_clock;
+  raw_clock.clock_type = EtlLogInfo::CLOCK_SYSTEM_TIME;
+  if (DecodeRecord(raw_clock, &parser, sizeof(WmiBufferHeader), &event,
+                   &record_size) != DECODED_EVENT ||
+      event.Header.Guid != kEventTraceEventClass ||
+      event.Header.Class.Type != kLogFileHeaderEvent) {
+    return false;
+  }
+
+  // The pointer size is at the same offset for both bitnesses.
+  BinaryBufferParser payload(event.MofData, event.MofLength);
+  const LogFileHeader32* header32 = NULL;
+  if (!payload.GetAt(0, FIELD_OFFSET(LogFileHeader32, LoggerName), &header32))
+    return false;
+
+  log_info->buffer_size = header32->BufferSize;
+  log_info->pointer_size = header32->PointerSize;
+  log_info->cpu_speed_mhz = header32->CPUSpeed;
+
+  ULONGLONG perf_frequency = 0;
+  ULONGLONG start_time = 0;
+  ULONG clock_type = 0;
+  if (header32->PointerSize == 8) {
+    const LogFileHeader64* header64 = NULL;
+    if (!payload.GetAt(0, &header64))
+      return false;
+    perf_frequency = header64->PerfFrequency;
+    start_time = header64->StartTime;
+    clock_type = header64->ReservedFlags;
+  } else {
+    if (!payload.GetAt(0, &header32))
+      return false;
+    perf_frequency = header32->PerfFrequency;
+    start_time = header32->StartTime;
+    clock_type = header32->ReservedFlags;
+  }
+
+  switch (clock_type) {
+    case 0:  // The default is the QPC clock.
+    case EtlLogInfo::CLOCK_QUERY_PERFORMANCE_COUNTER:
+      log_info->clock_type = EtlLogInfo::CLOCK_QUERY_PERFORMANCE_COUNTER;
+      break;
+    case EtlLogInfo::CLOCK_SYSTEM_TIME:
+      log_info->clock_type = EtlLogInfo::CLOCK_SYSTEM_TIME;
+      break;
+    case EtlLogInfo::CLOCK_CPU_CYCLE_COUNTER:
+      log_info->clock_type = EtlLogInfo::CLOCK_CPU_CYCLE_COUNTER;
+      break;
+    default:
+      LOG(ERROR) << "Unknown clock type " << clock_type;
+      return false;
+  }
+
+  log_info->perf_frequency = static_cast<int64>(perf_frequency);
+  log_info->start_time = static_cast<int64>(start_time);
+  log_info->reference_timestamp = event.Header.TimeStamp.QuadPart;
+
+  return true;
+}
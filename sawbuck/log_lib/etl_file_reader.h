@@ -0,0 +1,167 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A native .etl file reader, which decodes the WMI buffer layout directly
+// instead of going through OpenTrace/ProcessTrace. This does away with the
+// ETW runtime, but not with the Windows SDK: the reader yields the SDK's
+// EVENT_TRACE records, and kernel event GUIDs, which is what LogParser and
+// KernelLogParser consume. It builds on Windows only, as they do.
+#ifndef SAWBUCK_LOG_LIB_ETL_FILE_READER_H_
+#define SAWBUCK_LOG_LIB_ETL_FILE_READER_H_
+
+#include <windows.h>
+#include <wmistr.h>
+#include <evntrace.h>
+#include <vector>
+#include "base/basictypes.h"
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+
+// Describes the session that wrote an .etl file, as gleaned from the
+// logfile header event at the start of the file.
+struct EtlLogInfo {
+  // The clock types a session can be configured with, see the
+  // documentation for WNODE_HEADER::ClientContext.
+  enum ClockType {
+    CLOCK_UNKNOWN = 0,
+    CLOCK_QUERY_PERFORMANCE_COUNTER = 1,
+    CLOCK_SYSTEM_TIME = 2,
+    CLOCK_CPU_CYCLE_COUNTER = 3,
+  };
+
+  EtlLogInfo() : buffer_size(0), pointer_size(0), clock_type(CLOCK_UNKNOWN),
+      perf_frequency(0), cpu_speed_mhz(0), start_time(0),
+      reference_timestamp(0) {
+  }
+
+  bool is_64_bit_log() const { return pointer_size == 8; }
+
+  // Converts a raw event timestamp to FILETIME units, the way ProcessTrace
+  // would have done.
+  // @param raw_timestamp a timestamp in units of @p clock_type.
+  // @returns the corresponding time in 100ns units since 1601.
+  int64 ToFileTime(int64 raw_timestamp) const;
+
+  // Size of each buffer in the file, in bytes.
+  uint32 buffer_size;
+  // Pointer size of the logging system, either 4 or 8.
+  uint32 pointer_size;
+  ClockType clock_type;
+  // Frequency of the QPC clock, for CLOCK_QUERY_PERFORMANCE_COUNTER.
+  int64 perf_frequency;
+  // Nominal CPU speed, for CLOCK_CPU_CYCLE_COUNTER.
+  uint32 cpu_speed_mhz;
+  // The session start time, in FILETIME units.
+  int64 start_time;
+  // The raw timestamp of the logfile header event, which was written
+  // at start_time.
+  int64 reference_timestamp;
+};
+
+// Implemented by clients of EtlFileReader to receive decoded events.
+class EtlEventSink {
+ public:
+  // Issued for each event decoded from a buffer, in buffer order.
+  // @note @p event and the data it points to are only valid until the
+  //     buffer it was decoded from is released or reused.
+  virtual void OnEtlEvent(EVENT_TRACE* event) = 0;
+};
+
+// Holds the raw contents of one buffer of an .etl file.
+class EtlBuffer {
+ public:
+  EtlBuffer();
+  ~EtlBuffer();
+
+  // Accessors.
+  const uint8* data() const { return data_.empty() ? NULL : &data_[0]; }
+  size_t data_len() const { return data_.size(); }
+  // The index of this buffer in its file.
+  size_t index() const { return index_; }
+  // The processor that filled this buffer.
+  uint8 processor_number() const;
+  // The number of bytes of event data in this buffer, including the
+  // buffer header.
+  size_t used_len() const;
+
+  // Replaces the contents of this buffer.
+  void Assign(size_t index, const void* data, size_t data_len);
+
+ private:
+  friend class EtlFileReader;
+
+  std::vector<uint8> data_;
+  size_t index_;
+
+  DISALLOW_COPY_AND_ASSIGN(EtlBuffer);
+};
+
+// Reads the buffers of an .etl file, and decodes them to EVENT_TRACE
+// records equivalent to what ProcessTrace delivers for classic events.
+// @note This handles the system, compact, perfinfo and full trace headers.
+//     Instance headers and manifest-based EVENT_HEADER records are counted
+//     and skipped, as none of our parsers consume them.
+class EtlFileReader {
+ public:
+  EtlFileReader();
+  ~EtlFileReader();
+
+  // Opens @p path and reads the logfile header from its first buffer.
+  // @returns true on success.
+  bool Open(const base::FilePath& path);
+  void Close();
+
+  // Accessors.
+  const EtlLogInfo& log_info() const { return log_info_; }
+  size_t num_buffers() const { return num_buffers_; }
+  size_t skipped_events() const { return skipped_events_; }
+
+  // Reads the buffer at @p index into @p buffer.
+  // @returns true on success.
+  bool ReadBuffer(size_t index, EtlBuffer* buffer);
+
+  // Reads the number of the processor that filled the buffer at @p index,
+  // without reading the rest of the buffer.
+  // @returns true on success.
+  bool ReadBufferProcessor(size_t index, uint8* processor_number);
+
+  // Decodes the events in @p buffer and issues them to @p sink.
+  // @returns the number of events issued.
+  size_t DecodeBuffer(const EtlBuffer& buffer, EtlEventSink* sink);
+
+  // Decodes the events in @p buffer with @p log_info and issues them to
+  // @p sink. This is safe to call concurrently for different buffers.
+  // @param skipped if non-NULL, is incremented by the number of records
+  //     that were skipped for having an unsupported header type.
+  // @returns the number of events issued.
+  static size_t DecodeBuffer(const EtlLogInfo& log_info,
+                             const EtlBuffer& buffer,
+                             EtlEventSink* sink,
+                             size_t* skipped);
+
+  // Parses the logfile header event out of @p buffer, which must be the
+  // first buffer of a file.
+  // @returns true on success.
+  static bool ReadLogInfo(const EtlBuffer& buffer, EtlLogInfo* log_info);
+
+ private:
+  base::File file_;
+  EtlLogInfo log_info_;
+  size_t num_buffers_;
+  size_t skipped_events_;
+
+  DISALLOW_COPY_AND_ASSIGN(EtlFileReader);
+};
+
+#endif  // SAWBUCK_LOG_LIB_ETL_FILE_READER_H_
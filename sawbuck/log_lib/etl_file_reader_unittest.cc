@@ -0,0 +1,583 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/log_lib/etl_file_reader.h"
+
+#include <string>
+#include <vector>
+#include "base/path_service.h"
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/logging_win.h"
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "sawbuck/log_lib/etl_file_consumer.h"
+#include "sawbuck/log_lib/kernel_log_unittest_data.h"
+#include "sawbuck/log_lib/kernel_log_types.h"  // NOLINT - must be last.
+
+namespace {
+
+using testing::_;
+using testing::ByRef;
+using testing::Eq;
+using testing::Field;
+using testing::InSequence;
+using testing::StrEq;
+using testing::StrictMock;
+
+// The values of the logfile header of image_data_32_v2.etl.
+const uint32 kTestBufferSize = 65536;
+const int64 kTestPerfFrequency = 2337949;
+const int64 kTestStartTime = 129488146035903615LL;
+const int64 kTestReferenceTimestamp = 795713088966LL;
+
+class RecordingEtlEventSink : public EtlEventSink {
+ public:
+  struct Event {
+    EVENT_TRACE_HEADER header;
+    ETW_BUFFER_CONTEXT buffer_context;
+    std::vector<uint8> data;
+  };
+
+  virtual void OnEtlEvent(EVENT_TRACE* event) {
+    Event recorded;
+    recorded.header = event->Header;
+    recorded.buffer_context = event->BufferContext;
+    const uint8* data = reinterpret_cast<const uint8*>(event->MofData);
+    recorded.data.assign(data, data + event->MofLength);
+    events_.push_back(recorded);
+  }
+
+  std::vector<Event> events_;
+};
+
+// Builds a buffer in the .etl file layout, for testing header types and
+// buffer orders that don't occur in the test data.
+class TestBufferBuilder {
+ public:
+  static const size_t kBufferHeaderSize = 72;
+
+  explicit TestBufferBuilder(uint8 processor_number)
+      : data_(kBufferHeaderSize, 0) {
+    Put32(0, kTestBufferSize);
+    data_[40] = processor_number;
+    data_[41] = 8;  // Alignment.
+  }
+
+  // Appends a system or perfinfo header record with @p header_type.
+  void AddSystemRecord(uint8 header_type, uint16 hook_id, uint32 thread_id,
+                       uint32 process_id, int64 timestamp,
+                       const std::string& payload) {
+    bool is_perfinfo = header_type == 16 || header_type == 17;
+    size_t header_size = is_perfinfo ? 16 : 32;
+    size_t pos = BeginRecord(header_size, payload);
+
+    Put16(pos, 2);  // Version.
+    data_[pos + 2] = header_type;
+    data_[pos + 3] = 0xC0;
+    Put16(pos + 4, static_cast<uint16>(header_size + payload.size()));
+    Put16(pos + 6, hook_id);
+    if (is_perfinfo) {
+      Put64(pos + 8, timestamp);
+    } else {
+      Put32(pos + 8, thread_id);
+      Put32(pos + 12, process_id);
+      Put64(pos + 16, timestamp);
+    }
+  }
+
+  // Appends a logfile header event with the values of our test data.
+  void AddLogFileHeader() {
+    kernel_log_types::LogFileHeader32 header = {};
+    header.BufferSize = kTestBufferSize;
+    header.PointerSize = 4;
+    header.PerfFrequency = kTestPerfFrequency;
+    header.StartTime = kTestStartTime;
+    header.ReservedFlags = EtlLogInfo::CLOCK_QUERY_PERFORMANCE_COUNTER;
+
+    AddSystemRecord(1, kernel_log_types::kEventTraceGroupHeader |
+                           kernel_log_types::kLogFileHeaderEvent,
+                    0, 0, kTestReferenceTimestamp,
+                    std::string(reinterpret_cast<const char*>(&header),
+                                sizeof(header)));
+  }
+
+  // Appends a log message with a full header.
+  void AddLogMessage(int64 timestamp, const char* message) {
+    std::string payload(message, strlen(message) + 1);
+    size_t pos = BeginRecord(sizeof(EVENT_TRACE_HEADER), payload);
+
+    EVENT_TRACE_HEADER header = {};
+    header.Size = static_cast<USHORT>(sizeof(header) + payload.size());
+    header.HeaderType = 10;  // 32 bit full header.
+    header.MarkerFlags = 0xC0;
+    header.Class.Type = logging::LOG_MESSAGE;
+    header.TimeStamp.QuadPart = timestamp;
+    header.Guid = logging::kLogEventId;
+    memcpy(&data_[pos], &header, sizeof(header));
+  }
+
+  // Appends a record with a header type we don't decode.
+  void AddEventHeaderRecord(const std::string& payload) {
+    const size_t kEventHeaderSize = 80;
+    size_t pos = BeginRecord(kEventHeaderSize, payload);
+
+    Put16(pos, static_cast<uint16>(kEventHeaderSize + payload.size()));
+    data_[pos + 2] = 19;  // 64 bit EVENT_HEADER.
+    data_[pos + 3] = 0xC0;
+  }
+
+  // Pads out to the full buffer size with the fill pattern.
+  const std::vector<uint8>& Finish() {
+    Put32(48, static_cast<uint32>(data_.size()));
+    data_.resize(kTestBufferSize, 0xFF);
+    return data_;
+  }
+
+  void Finish(EtlBuffer* buffer) {
+    Finish();
+    buffer->Assign(1, &data_[0], data_.size());
+  }
+
+ private:
+  size_t BeginRecord(size_t header_size, const std::string& payload) {
+    size_t pos = (data_.size() + 7) & ~7;
+    data_.resize(pos + header_size, 0);
+    data_.insert(data_.end(), payload.begin(), payload.end());
+    return pos;
+  }
+
+  void Put16(size_t pos, uint16 value) {
+    memcpy(&data_[pos], &value, sizeof(value));
+  }
+  void Put32(size_t pos, uint32 value) {
+    memcpy(&data_[pos], &value, sizeof(value));
+  }
+  void Put64(size_t pos, int64 value) {
+    memcpy(&data_[pos], &value, sizeof(value));
+  }
+
+  std::vector<uint8> data_;
+};
+
+EtlLogInfo CreateQpcLogInfo() {
+  EtlLogInfo log_info;
+  log_info.buffer_size = kTestBufferSize;
+  log_info.pointer_size = 4;
+  log_info.clock_type = EtlLogInfo::CLOCK_QUERY_PERFORMANCE_COUNTER;
+  log_info.perf_frequency = kTestPerfFrequency;
+  log_info.start_time = kTestStartTime;
+  log_info.reference_timestamp = kTestReferenceTimestamp;
+
+  return log_info;
+}
+
+class EtlFileReaderTest: public testing::Test {
+ public:
+  virtual void SetUp() {
+    base::FilePath src_root;
+    ASSERT_TRUE(PathService::Get(base::DIR_SOURCE_ROOT, &src_root));
+    test_data_dir_ = src_root.AppendASCII("sawbuck\\log_lib\\test_data");
+  }
+
+ protected:
+  base::FilePath test_data_dir_;
+};
+
+TEST_F(EtlFileReaderTest, OpenReadsLogInfo) {
+  EtlFileReader reader;
+  ASSERT_TRUE(reader.Open(test_data_dir_.Append(L"image_data_32_v2.etl")));
+
+  const EtlLogInfo& log_info = reader.log_info();
+  EXPECT_EQ(kTestBufferSize, log_info.buffer_size);
+  EXPECT_EQ(4, log_info.pointer_size);
+  EXPECT_FALSE(log_info.is_64_bit_log());
+  EXPECT_EQ(EtlLogInfo::CLOCK_QUERY_PERFORMANCE_COUNTER, log_info.clock_type);
+  EXPECT_EQ(kTestPerfFrequency, log_info.perf_frequency);
+  EXPECT_EQ(kTestStartTime, log_info.start_time);
+  EXPECT_EQ(kTestReferenceTimestamp, log_info.reference_timestamp);
+  EXPECT_EQ(2, reader.num_buffers());
+}
+
+TEST_F(EtlFileReaderTest, OpenFailsOnMissingFile) {
+  EtlFileReader reader;
+  EXPECT_FALSE(reader.Open(test_data_dir_.Append(L"nonexistent.etl")));
+  EXPECT_EQ(0, reader.num_buffers());
+}
+
+TEST_F(EtlFileReaderTest, DecodesAllEvents) {
+  EtlFileReader reader;
+  ASSERT_TRUE(reader.Open(test_data_dir_.Append(L"image_data_32_v2.etl")));
+
+  RecordingEtlEventSink sink;
+  EtlBuffer buffer;
+  for (size_t i = 0; i < reader.num_buffers(); ++i) {
+    ASSERT_TRUE(reader.ReadBuffer(i, &buffer));
+    EXPECT_EQ(i, buffer.index());
+    reader.DecodeBuffer(buffer, &sink);
+  }
+  EXPECT_FALSE(reader.ReadBuffer(reader.num_buffers(), &buffer));
+
+  // The logfile header, one unload, one load, and the rundown.
+  ASSERT_EQ(2 + testing::kNumModules + 1, sink.events_.size());
+  EXPECT_EQ(0, reader.skipped_events());
+
+  const RecordingEtlEventSink::Event& header = sink.events_[0];
+  EXPECT_TRUE(header.header.Guid == kernel_log_types::kEventTraceEventClass);
+  EXPECT_EQ(kernel_log_types::kLogFileHeaderEvent, header.header.Class.Type);
+  EXPECT_EQ(kTestStartTime, header.header.TimeStamp.QuadPart);
+
+  for (size_t i = 1; i < sink.events_.size(); ++i) {
+    const RecordingEtlEventSink::Event& event = sink.events_[i];
+    EXPECT_TRUE(event.header.Guid == kernel_log_types::kImageLoadEventClass);
+    EXPECT_EQ(2, event.header.Class.Version);
+    EXPECT_LE(kTestStartTime, event.header.TimeStamp.QuadPart);
+    EXPECT_FALSE(event.data.empty());
+  }
+}
+
+TEST(EtlLogInfoTest, ToFileTimeQpc) {
+  EtlLogInfo log_info = CreateQpcLogInfo();
+
+  EXPECT_EQ(kTestStartTime, log_info.ToFileTime(kTestReferenceTimestamp));
+  EXPECT_EQ(kTestStartTime + 10000000,
+            log_info.ToFileTime(kTestReferenceTimestamp + kTestPerfFrequency));
+  EXPECT_EQ(kTestStartTime - 10000000,
+            log_info.ToFileTime(kTestReferenceTimestamp - kTestPerfFrequency));
+}
+
+TEST(EtlLogInfoTest, ToFileTimeDoesNotOverflow) {
+  EtlLogInfo log_info = CreateQpcLogInfo();
+  log_info.clock_type = EtlLogInfo::CLOCK_CPU_CYCLE_COUNTER;
+  log_info.cpu_speed_mhz = 3000;
+
+  // A year's worth of cycles at 3GHz, which overflows when multiplied
+  // by the 10^7 FILETIME units per second.
+  const int64 kSecondsPerYear = 365 * 24 * 3600LL;
+  int64 cycles = kSecondsPerYear * 3000000000LL;
+  EXPECT_EQ(kTestStartTime + kSecondsPerYear * 10000000,
+            log_info.ToFileTime(kTestReferenceTimestamp + cycles));
+}
+
+TEST(EtlLogInfoTest, ToFileTimeSystemTime) {
+  EtlLogInfo log_info = CreateQpcLogInfo();
+  log_info.clock_type = EtlLogInfo::CLOCK_SYSTEM_TIME;
+
+  EXPECT_EQ(kTestStartTime + 1234, log_info.ToFileTime(kTestStartTime + 1234));
+}
+
+TEST(EtlFileReaderDecodeTest, DecodesSystemAndPerfInfoHeaders) {
+  TestBufferBuilder builder(3);
+  builder.AddSystemRecord(2, kernel_log_types::kEventTraceGroupMemory |
+                              kernel_log_types::kTransitionFaultEvent,
+                          10, 20, kTestReferenceTimestamp, "fault");
+  builder.AddEventHeaderRecord("skipped");
+  builder.AddSystemRecord(17, kernel_log_types::kEventTraceGroupMemory |
+                              kernel_log_types::kHardPageFaultEvent,
+                          0, 0, kTestReferenceTimestamp + kTestPerfFrequency,
+                          "hard fault");
+  builder.AddSystemRecord(1, kernel_log_types::kEventTraceGroupProcess |
+                              kernel_log_types::kImageNotifyLoadEvent,
+                          11, 21, kTestReferenceTimestamp, "xp image");
+  builder.AddSystemRecord(1, kernel_log_types::kEventTraceGroupThread |
+                              kernel_log_types::kThreadStartEvent,
+                          12, 22, kTestReferenceTimestamp, "thread");
+  EtlBuffer buffer;
+  builder.Finish(&buffer);
+  EXPECT_EQ(3, buffer.processor_number());
+
+  RecordingEtlEventSink sink;
+  size_t skipped = 0;
+  EXPECT_EQ(4, EtlFileReader::DecodeBuffer(CreateQpcLogInfo(), buffer,
+                                           &sink, &skipped));
+  EXPECT_EQ(1, skipped);
+  ASSERT_EQ(4, sink.events_.size());
+
+  const RecordingEtlEventSink::Event& fault = sink.events_[0];
+  EXPECT_TRUE(fault.header.Guid == kernel_log_types::kPageFaultEventClass);
+  EXPECT_EQ(kernel_log_types::kTransitionFaultEvent, fault.header.Class.Type);
+  EXPECT_EQ(10, fault.header.ThreadId);
+  EXPECT_EQ(20, fault.header.ProcessId);
+  EXPECT_EQ(kTestStartTime, fault.header.TimeStamp.QuadPart);
+  EXPECT_EQ(3, fault.buffer_context.ProcessorNumber);
+  EXPECT_EQ("fault", std::string(fault.data.begin(), fault.data.end()));
+
+  const RecordingEtlEventSink::Event& hard = sink.events_[1];
+  EXPECT_TRUE(hard.header.Guid == kernel_log_types::kPageFaultEventClass);
+  EXPECT_EQ(kernel_log_types::kHardPageFaultEvent, hard.header.Class.Type);
+  EXPECT_EQ(static_cast<ULONG>(-1), hard.header.ThreadId);
+  EXPECT_EQ(kTestStartTime + 10000000, hard.header.TimeStamp.QuadPart);
+  EXPECT_EQ("hard fault", std::string(hard.data.begin(), hard.data.end()));
+
+  const RecordingEtlEventSink::Event& image = sink.events_[2];
+  EXPECT_TRUE(image.header.Guid == kernel_log_types::kImageLoadEventClass);
+  EXPECT_EQ(kernel_log_types::kImageNotifyLoadEvent, image.header.Class.Type);
+
+  const RecordingEtlEventSink::Event& thread = sink.events_[3];
+  EXPECT_TRUE(thread.header.Guid == kernel_log_types::kThreadEventClass);
+  EXPECT_EQ(kernel_log_types::kThreadStartEvent, thread.header.Class.Type);
+}
+
+class MockLogEvents: public LogEvents {
+ public:
+  MOCK_METHOD1(OnLogMessage, void(const LogEvents::LogMessage& message));
+};
+
+class MockKernelModuleEvents: public KernelModuleEvents {
+ public:
+  MOCK_METHOD3(OnModuleIsLoaded, void(DWORD process_id,
+                                      const base::Time& time,
+                                      const ModuleInformation& module_info));
+  MOCK_METHOD3(OnModuleUnload, void(DWORD process_id,
+                                    const base::Time& time,
+                                    const ModuleInformation& module_info));
+  MOCK_METHOD3(OnModuleLoad, void(DWORD process_id,
+                                  const base::Time& time,
+                                  const ModuleInformation& module_info));
+};
+
+class MockKernelProcessEvents: public KernelProcessEvents{
+ public:
+  MOCK_METHOD2(OnProcessIsRunning, void (const base::Time& time,
+                                         const ProcessInfo& process_info));
+  MOCK_METHOD2(OnProcessStarted, void (const base::Time& time,
+                                       const ProcessInfo& process_info));
+  MOCK_METHOD3(OnProcessEnded, void (const base::Time& time,
+                                     const ProcessInfo& process_info,
+                                     ULONG exit_status));
+};
+
+class MockKernelThreadEvents: public KernelThreadEvents {
+ public:
+  MOCK_METHOD3(OnThreadIsRunning, void(const base::Time& time,
+                                       DWORD process_id,
+                                       DWORD thread_id));
+  MOCK_METHOD3(OnThreadStarted, void(const base::Time& time,
+                                     DWORD process_id,
+                                     DWORD thread_id));
+  MOCK_METHOD3(OnThreadEnded, void(const base::Time& time,
+                                   DWORD process_id,
+                                   DWORD thread_id));
+};
+
+// Checks that EtlFileConsumer issues the same events as KernelLogConsumer
+// for the kernel log test data.
+class EtlFileConsumerTest: public EtlFileReaderTest {
+ public:
+  void ExpectModules() {
+    InSequence in;
+
+    for (size_t i = 0; i < testing::kNumModules; ++i) {
+      EXPECT_CALL(module_events_,
+                  OnModuleIsLoaded(_, _, Eq(ByRef(testing::module_list[i]))))
+          .Times(1);
+    }
+
+    EXPECT_CALL(module_events_, OnModuleUnload(_, _, testing::module_list[0]))
+        .Times(1);
+    EXPECT_CALL(module_events_, OnModuleLoad(_, _, testing::module_list[0]))
+        .Times(1);
+
+    consumer_.set_module_event_sink(&module_events_);
+  }
+
+  void ExpectProcesses() {
+    InSequence in;
+
+    for (size_t i = 0; i < testing::kNumProcesses - 1; ++i) {
+      EXPECT_CALL(process_events_,
+                  OnProcessIsRunning(_, testing::process_list[i]))
+          .Times(1);
+    }
+
+    const KernelProcessEvents::ProcessInfo& process =
+        testing::process_list[testing::kNumProcesses - 1];
+    EXPECT_CALL(process_events_, OnProcessStarted(_, process))
+        .Times(1);
+    EXPECT_CALL(process_events_, OnProcessEnded(_, process, ERROR_SUCCESS))
+        .Times(1);
+
+    consumer_.set_process_event_sink(&process_events_);
+  }
+
+  void Consume(const wchar_t* file_name) {
+    base::FilePath file_path = test_data_dir_.Append(file_name);
+
+    // As for KernelLogConsumer, the test logs were created on a 32 bit
+    // logger, so their bitness can't be sniffed from the header.
+    consumer_.set_infer_bitness_from_log(false);
+
+    ASSERT_HRESULT_SUCCEEDED(
+        consumer_.OpenFileSession(file_path.value().c_str()));
+    ASSERT_HRESULT_SUCCEEDED(consumer_.Consume());
+    ASSERT_HRESULT_SUCCEEDED(consumer_.Close());
+  }
+
+ protected:
+  StrictMock<MockKernelModuleEvents> module_events_;
+  StrictMock<MockKernelProcessEvents> process_events_;
+  EtlFileConsumer consumer_;
+};
+
+TEST_F(EtlFileConsumerTest, ImageEventsLog32Version2) {
+  consumer_.set_is_64_bit_log(false);
+  ExpectModules();
+  Consume(L"image_data_32_v2.etl");
+}
+
+TEST_F(EtlFileConsumerTest, ImageEventsLog64Version2) {
+  consumer_.set_is_64_bit_log(true);
+  ExpectModules();
+  Consume(L"image_data_64_v2.etl");
+}
+
+TEST_F(EtlFileConsumerTest, ProcessEventsLog32Version3) {
+  consumer_.set_is_64_bit_log(false);
+  ExpectProcesses();
+  Consume(L"process_data_32_v3.etl");
+}
+
+TEST_F(EtlFileConsumerTest, ProcessEventsLog64Version3) {
+  consumer_.set_is_64_bit_log(true);
+  ExpectProcesses();
+  Consume(L"process_data_64_v3.etl");
+}
+
+TEST_F(EtlFileConsumerTest, ImageEventsLog32Version2Parallel) {
+  consumer_.set_num_threads(4);
+  consumer_.set_is_64_bit_log(false);
+  ExpectModules();
+  Consume(L"image_data_32_v2.etl");
+}
+
+TEST_F(EtlFileConsumerTest, ProcessEventsLog64Version3Parallel) {
+  consumer_.set_num_threads(4);
+  consumer_.set_is_64_bit_log(true);
+  ExpectProcesses();
+  Consume(L"process_data_64_v3.etl");
+}
+
+// Writes a log with the messages "1" through "9" spread across the
+// buffers of two processors, and checks that they're merged back into
+// timestamp order.
+void ExpectMessagesMergedInOrder(size_t num_threads) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath path = temp_dir.path().Append(L"merge.etl");
+  base::File file(path,
+                  base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+  ASSERT_TRUE(file.IsValid());
+
+  // The processor and messages of each buffer, in file order.
+  struct {
+    uint8 processor;
+    const char* messages;
+  } buffers[] = {
+    { 0, "" },  // The logfile header.
+    { 0, "145" },
+    { 1, "236" },
+    { 1, "" },
+    { 1, "8" },
+    { 0, "79" },
+  };
+
+  for (size_t i = 0; i < arraysize(buffers); ++i) {
+    TestBufferBuilder builder(buffers[i].processor);
+    if (i == 0)
+      builder.AddLogFileHeader();
+
+    for (const char* message = buffers[i].messages; *message; ++message) {
+      const char text[] = { *message, '\0' };
+      builder.AddLogMessage(kTestReferenceTimestamp + *message - '0', text);
+    }
+
+    const std::vector<uint8>& data = builder.Finish();
+    ASSERT_EQ(static_cast<int>(data.size()),
+              file.Write(i * kTestBufferSize,
+                         reinterpret_cast<const char*>(&data[0]),
+                         static_cast<int>(data.size())));
+  }
+  file.Close();
+
+  StrictMock<MockLogEvents> log_events;
+  {
+    InSequence in;
+    const char* kExpected[] = { "1", "2", "3", "4", "5", "6", "7", "8", "9" };
+    for (size_t i = 0; i < arraysize(kExpected); ++i) {
+      EXPECT_CALL(log_events,
+          OnLogMessage(Field(&LogEvents::LogMessage::message,
+                             StrEq(kExpected[i]))));
+    }
+  }
+
+  EtlFileConsumer consumer;
+  consumer.set_num_threads(num_threads);
+  consumer.set_event_sink(&log_events);
+  ASSERT_HRESULT_SUCCEEDED(consumer.OpenFileSession(path.value().c_str()));
+  ASSERT_HRESULT_SUCCEEDED(consumer.Consume());
+  ASSERT_HRESULT_SUCCEEDED(consumer.Close());
+}
+
+TEST(EtlFileConsumerMergeTest, MergesBuffersInTimestampOrder) {
+  ExpectMessagesMergedInOrder(1);
+}
+
+TEST(EtlFileConsumerMergeTest, MergesBuffersInTimestampOrderInParallel) {
+  ExpectMessagesMergedInOrder(3);
+}
+
+TEST(EtlFileConsumerThreadTest, IssuesThreadEvents) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath path = temp_dir.path().Append(L"threads.etl");
+  base::File file(path,
+                  base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+  ASSERT_TRUE(file.IsValid());
+
+  kernel_log_types::ThreadInfoV1 info = { 20, 10 };
+  std::string payload(reinterpret_cast<const char*>(&info), sizeof(info));
+  TestBufferBuilder builder(0);
+  builder.AddLogFileHeader();
+  builder.AddSystemRecord(1, kernel_log_types::kEventTraceGroupThread |
+                              kernel_log_types::kThreadIsRunningEvent,
+                          10, 20, kTestReferenceTimestamp + 1, payload);
+  builder.AddSystemRecord(1, kernel_log_types::kEventTraceGroupThread |
+                              kernel_log_types::kThreadEndEvent,
+                          10, 20, kTestReferenceTimestamp + 2, payload);
+  const std::vector<uint8>& data = builder.Finish();
+  ASSERT_EQ(static_cast<int>(data.size()),
+            file.Write(0, reinterpret_cast<const char*>(&data[0]),
+                       static_cast<int>(data.size())));
+  file.Close();
+
+  StrictMock<MockKernelThreadEvents> thread_events;
+  {
+    InSequence in;
+    EXPECT_CALL(thread_events, OnThreadIsRunning(_, 20, 10));
+    EXPECT_CALL(thread_events, OnThreadEnded(_, 20, 10));
+  }
+
+  EtlFileConsumer consumer;
+  consumer.set_thread_event_sink(&thread_events);
+  ASSERT_HRESULT_SUCCEEDED(consumer.OpenFileSession(path.value().c_str()));
+  ASSERT_HRESULT_SUCCEEDED(consumer.Consume());
+  ASSERT_HRESULT_SUCCEEDED(consumer.Close());
+}
+
+TEST_F(EtlFileConsumerTest, OpenFileSessionFailsOnMissingFile) {
+  base::FilePath file_path = test_data_dir_.Append(L"nonexistent.etl");
+  EXPECT_HRESULT_FAILED(consumer_.OpenFileSession(file_path.value().c_str()));
+}
+
+}  // namespace
@@ -0,0 +1,173 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Hard fault I/O tracker implementation.
+#include "sawbuck/log_lib/hard_fault_io_tracker.h"
+
+#include <algorithm>
+#include "base/logging.h"
+
+namespace {
+
+// Heatmap ranges are a whole number of these.
+const sym_util::Offset kPageSize = 4096;
+
+}  // namespace
+
+// static
+const size_t HardFaultIoTracker::kDefaultMaxReads;
+
+HardFaultIoTracker::SeekStats::SeekStats()
+    : num_reads(0),
+      bytes_read(0),
+      num_sequential(0),
+      num_forward_seeks(0),
+      num_backward_seeks(0),
+      total_seek_distance(0) {
+}
+
+HardFaultIoTracker::HardFaultIoTracker(size_t max_reads)
+    : max_reads_(max_reads), num_reads_(0), num_dropped_reads_(0) {
+}
+
+HardFaultIoTracker::~HardFaultIoTracker() {
+}
+
+void HardFaultIoTracker::OnTransitionFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+}
+
+void HardFaultIoTracker::OnDemandZeroFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+}
+
+void HardFaultIoTracker::OnCopyOnWriteFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+}
+
+void HardFaultIoTracker::OnGuardPageFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+}
+
+void HardFaultIoTracker::OnHardFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+  // The read shows up in the matching OnHardPageFault.
+}
+
+void HardFaultIoTracker::OnAccessViolationFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+}
+
+void HardFaultIoTracker::OnHardPageFault(DWORD thread_id,
+                                         const base::Time& time,
+                                         const base::Time& initial_time,
+                                         sym_util::Offset offset,
+                                         sym_util::Address address,
+                                         sym_util::Address file_object,
+                                         sym_util::ByteCount byte_count) {
+  if (num_reads_ >= max_reads_) {
+    ++num_dropped_reads_;
+    return;
+  }
+
+  FileRead read = {};
+  read.issue_time = initial_time;
+  // Clamp reads that complete before they're issued, which clock skew
+  // between processors can produce.
+  read.latency = std::max(time - initial_time, base::TimeDelta());
+  read.offset = offset;
+  read.byte_count = byte_count;
+  read.thread_id = thread_id;
+
+  files_[file_object].push_back(read);
+  ++num_reads_;
+}
+
+bool HardFaultIoTracker::GetReadsInIssueOrder(sym_util::Address file_object,
+                                              FileReads* reads) const {
+  DCHECK(reads != NULL);
+
+  FileReadsMap::const_iterator it = files_.find(file_object);
+  if (it == files_.end())
+    return false;
+
+  *reads = it->second;
+  std::stable_sort(reads->begin(), reads->end());
+  return true;
+}
+
+// static
+void HardFaultIoTracker::ComputeSeekStats(const FileReads& reads,
+                                          SeekStats* stats) {
+  DCHECK(stats != NULL);
+  *stats = SeekStats();
+
+  for (size_t i = 0; i < reads.size(); ++i) {
+    const FileRead& read = reads[i];
+    ++stats->num_reads;
+    stats->bytes_read += read.byte_count;
+    stats->latencies.Record(read.latency.InMicroseconds());
+    if (i == 0)
+      continue;
+
+    sym_util::Offset previous_end =
+        reads[i - 1].offset + reads[i - 1].byte_count;
+    uint64 distance = 0;
+    if (read.offset == previous_end) {
+      ++stats->num_sequential;
+    } else if (read.offset > previous_end) {
+      ++stats->num_forward_seeks;
+      distance = read.offset - previous_end;
+    } else {
+      ++stats->num_backward_seeks;
+      distance = previous_end - read.offset;
+    }
+    stats->total_seek_distance += distance;
+    stats->seek_distances.Record(static_cast<int64>(distance));
+  }
+}
+
+// static
+void HardFaultIoTracker::ComputeHeatmap(const FileReads& reads,
+                                        size_t num_buckets,
+                                        std::vector<size_t>* buckets,
+                                        sym_util::Offset* bucket_size) {
+  DCHECK_LT(0U, num_buckets);
+  DCHECK(buckets != NULL);
+  DCHECK(bucket_size != NULL);
+
+  sym_util::Offset end = 0;
+  for (size_t i = 0; i < reads.size(); ++i)
+    end = std::max(end, reads[i].offset + reads[i].byte_count);
+
+  // Round the range size up to a whole number of pages.
+  sym_util::Offset pages = (end + kPageSize - 1) / kPageSize;
+  *bucket_size = std::max(static_cast<sym_util::Offset>(1),
+                          (pages + num_buckets - 1) / num_buckets) *
+                 kPageSize;
+
+  buckets->assign(num_buckets, 0);
+  for (size_t i = 0; i < reads.size(); ++i) {
+    // Only an empty read at the very end falls past the last range.
+    size_t bucket = std::min(
+        static_cast<size_t>(reads[i].offset / *bucket_size), num_buckets - 1);
+    ++(*buckets)[bucket];
+  }
+}
@@ -0,0 +1,153 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Hard fault I/O tracker declaration.
+#ifndef SAWBUCK_LOG_LIB_HARD_FAULT_IO_TRACKER_H_
+#define SAWBUCK_LOG_LIB_HARD_FAULT_IO_TRACKER_H_
+
+#include <map>
+#include <vector>
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "sawbuck/log_lib/kernel_log_consumer.h"
+#include "sawbuck/log_lib/latency_histogram.h"
+
+// Reconstructs the file reads behind hard page faults. Each hard page
+// fault event completes a read of a file object, issued at the event's
+// initial time. The tracker keeps the reads of each file object, from
+// which it derives the order the file was read in, how far each read
+// seeked from the end of the one before, and where in the file the
+// reads land.
+//
+// The tracker keeps up to max_reads reads in all; reads past that are
+// only counted.
+// @note This class is not thread safe.
+class HardFaultIoTracker : public KernelPageFaultEvents {
+ public:
+  static const size_t kDefaultMaxReads = 1024 * 1024;
+
+  // A read of a file, to resolve a hard fault.
+  struct FileRead {
+    bool operator<(const FileRead& other) const {
+      return issue_time < other.issue_time;
+    }
+
+    base::Time issue_time;
+    base::TimeDelta latency;
+    sym_util::Offset offset;
+    sym_util::ByteCount byte_count;
+    DWORD thread_id;
+  };
+  typedef std::vector<FileRead> FileReads;
+
+  // The reads of each file object, in the order they completed.
+  typedef std::map<sym_util::Address, FileReads> FileReadsMap;
+
+  // The seek statistics of a sequence of reads. Seeks are measured from
+  // the end of each read to the start of the next.
+  struct SeekStats {
+    SeekStats();
+
+    size_t num_reads;
+    uint64 bytes_read;
+    // Reads that start where the one before ended. The first read counts
+    // as neither sequential nor a seek.
+    size_t num_sequential;
+    size_t num_forward_seeks;
+    size_t num_backward_seeks;
+    // In bytes, either way.
+    uint64 total_seek_distance;
+    LatencyHistogram seek_distances;
+    // Read latencies, in microseconds.
+    LatencyHistogram latencies;
+  };
+
+  explicit HardFaultIoTracker(size_t max_reads);
+  ~HardFaultIoTracker();
+
+  // KernelPageFaultEvents implementation.
+  virtual void OnTransitionFault(DWORD process_id,
+                                 DWORD thread_id,
+                                 const base::Time& time,
+                                 sym_util::Address address,
+                                 sym_util::Address program_counter);
+  virtual void OnDemandZeroFault(DWORD process_id,
+                                 DWORD thread_id,
+                                 const base::Time& time,
+                                 sym_util::Address address,
+                                 sym_util::Address program_counter);
+  virtual void OnCopyOnWriteFault(DWORD process_id,
+                                  DWORD thread_id,
+                                  const base::Time& time,
+                                  sym_util::Address address,
+                                  sym_util::Address program_counter);
+  virtual void OnGuardPageFault(DWORD process_id,
+                                DWORD thread_id,
+                                const base::Time& time,
+                                sym_util::Address address,
+                                sym_util::Address program_counter);
+  virtual void OnHardFault(DWORD process_id,
+                           DWORD thread_id,
+                           const base::Time& time,
+                           sym_util::Address address,
+                           sym_util::Address program_counter);
+  virtual void OnAccessViolationFault(DWORD process_id,
+                                      DWORD thread_id,
+                                      const base::Time& time,
+                                      sym_util::Address address,
+                                      sym_util::Address program_counter);
+  virtual void OnHardPageFault(DWORD thread_id,
+                               const base::Time& time,
+                               const base::Time& initial_time,
+                               sym_util::Offset offset,
+                               sym_util::Address address,
+                               sym_util::Address file_object,
+                               sym_util::ByteCount byte_count);
+
+  // Accessors.
+  const FileReadsMap& files() const { return files_; }
+  size_t num_reads() const { return num_reads_; }
+  size_t num_dropped_reads() const { return num_dropped_reads_; }
+
+  // Retrieves the reads of @p file_object in the order they were issued.
+  // @param reads on success returns the reads.
+  // @returns true iff @p file_object was read.
+  bool GetReadsInIssueOrder(sym_util::Address file_object,
+                            FileReads* reads) const;
+
+  // Computes the seek statistics of @p reads, in the order given.
+  // @param stats returns the statistics.
+  static void ComputeSeekStats(const FileReads& reads, SeekStats* stats);
+
+  // Computes a heatmap of where in the file @p reads land, by counting
+  // the reads that start in each of @p num_buckets equal ranges of the
+  // file. The ranges are a whole number of pages, and together cover the
+  // furthest read.
+  // @param buckets returns the read counts.
+  // @param bucket_size returns the size of each range, in bytes.
+  static void ComputeHeatmap(const FileReads& reads,
+                             size_t num_buckets,
+                             std::vector<size_t>* buckets,
+                             sym_util::Offset* bucket_size);
+
+ private:
+  FileReadsMap files_;
+  size_t max_reads_;
+  size_t num_reads_;
+  size_t num_dropped_reads_;
+
+  DISALLOW_COPY_AND_ASSIGN(HardFaultIoTracker);
+};
+
+#endif  // SAWBUCK_LOG_LIB_HARD_FAULT_IO_TRACKER_H_
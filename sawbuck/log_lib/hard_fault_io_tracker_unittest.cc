@@ -0,0 +1,135 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/log_lib/hard_fault_io_tracker.h"
+
+#include "gtest/gtest.h"
+#include "sawbuck/common/test_time.h"
+
+namespace {
+
+using testing::TimeAt;
+
+const DWORD kThreadId = 1;
+const sym_util::Address kFile = 0x80001000;
+const sym_util::Address kOtherFile = 0x80002000;
+
+class HardFaultIoTrackerTest : public testing::Test {
+ public:
+  HardFaultIoTrackerTest()
+      : tracker_(HardFaultIoTracker::kDefaultMaxReads) {
+  }
+
+  void Read(int64 issue_time,
+            int64 complete_time,
+            sym_util::Address file_object,
+            sym_util::Offset offset,
+            sym_util::ByteCount byte_count) {
+    tracker_.OnHardPageFault(kThreadId, TimeAt(complete_time),
+                             TimeAt(issue_time), offset, 0, file_object,
+                             byte_count);
+  }
+
+ protected:
+  HardFaultIoTracker tracker_;
+};
+
+TEST_F(HardFaultIoTrackerTest, KeepsReadsPerFile) {
+  Read(10, 50, kFile, 0x2000, 0x1000);
+  // Issued earlier, but completed later.
+  Read(5, 60, kFile, 0x0000, 0x1000);
+  Read(20, 30, kOtherFile, 0x8000, 0x4000);
+
+  EXPECT_EQ(2U, tracker_.files().size());
+  EXPECT_EQ(3U, tracker_.num_reads());
+
+  HardFaultIoTracker::FileReads reads;
+  ASSERT_TRUE(tracker_.GetReadsInIssueOrder(kFile, &reads));
+  ASSERT_EQ(2U, reads.size());
+  EXPECT_EQ(0x0000U, reads[0].offset);
+  EXPECT_EQ(55, reads[0].latency.InMicroseconds());
+  EXPECT_EQ(0x2000U, reads[1].offset);
+  EXPECT_EQ(40, reads[1].latency.InMicroseconds());
+
+  EXPECT_FALSE(tracker_.GetReadsInIssueOrder(0x1234, &reads));
+}
+
+TEST_F(HardFaultIoTrackerTest, ClampsLatency) {
+  Read(100, 90, kFile, 0, 0x1000);
+
+  HardFaultIoTracker::FileReads reads;
+  ASSERT_TRUE(tracker_.GetReadsInIssueOrder(kFile, &reads));
+  EXPECT_EQ(0, reads[0].latency.InMicroseconds());
+}
+
+TEST_F(HardFaultIoTrackerTest, SeekStats) {
+  Read(1, 2, kFile, 0x0000, 0x1000);
+  Read(2, 3, kFile, 0x1000, 0x1000);  // Sequential.
+  Read(3, 4, kFile, 0x8000, 0x1000);  // 0x6000 forward.
+  Read(4, 5, kFile, 0x4000, 0x2000);  // 0x5000 back.
+  Read(5, 6, kFile, 0x6000, 0x1000);  // Sequential.
+
+  HardFaultIoTracker::FileReads reads;
+  ASSERT_TRUE(tracker_.GetReadsInIssueOrder(kFile, &reads));
+  HardFaultIoTracker::SeekStats stats;
+  HardFaultIoTracker::ComputeSeekStats(reads, &stats);
+
+  EXPECT_EQ(5U, stats.num_reads);
+  EXPECT_EQ(0x6000U, stats.bytes_read);
+  EXPECT_EQ(2U, stats.num_sequential);
+  EXPECT_EQ(1U, stats.num_forward_seeks);
+  EXPECT_EQ(1U, stats.num_backward_seeks);
+  EXPECT_EQ(0xB000U, stats.total_seek_distance);
+  EXPECT_EQ(4U, stats.seek_distances.count());
+  EXPECT_EQ(0x6000, stats.seek_distances.max());
+  EXPECT_EQ(5U, stats.latencies.count());
+  EXPECT_EQ(1, stats.latencies.max());
+}
+
+TEST_F(HardFaultIoTrackerTest, Heatmap) {
+  Read(1, 2, kFile, 0x0000, 0x1000);
+  Read(2, 3, kFile, 0x0800, 0x1000);
+  Read(3, 4, kFile, 0x7000, 0x1000);
+
+  HardFaultIoTracker::FileReads reads;
+  ASSERT_TRUE(tracker_.GetReadsInIssueOrder(kFile, &reads));
+  std::vector<size_t> buckets;
+  sym_util::Offset bucket_size = 0;
+  HardFaultIoTracker::ComputeHeatmap(reads, 4, &buckets, &bucket_size);
+
+  EXPECT_EQ(0x2000U, bucket_size);
+  ASSERT_EQ(4U, buckets.size());
+  EXPECT_EQ(2U, buckets[0]);
+  EXPECT_EQ(0U, buckets[1]);
+  EXPECT_EQ(0U, buckets[2]);
+  EXPECT_EQ(1U, buckets[3]);
+
+  // Small files still get whole pages.
+  reads.resize(1);
+  HardFaultIoTracker::ComputeHeatmap(reads, 4, &buckets, &bucket_size);
+  EXPECT_EQ(0x1000U, bucket_size);
+  EXPECT_EQ(1U, buckets[0]);
+}
+
+TEST_F(HardFaultIoTrackerTest, CapsReads) {
+  HardFaultIoTracker tracker(2);
+  for (int i = 0; i < 3; ++i) {
+    tracker.OnHardPageFault(kThreadId, TimeAt(i + 1), TimeAt(i), i * 0x1000,
+                            0, kFile, 0x1000);
+  }
+
+  EXPECT_EQ(2U, tracker.num_reads());
+  EXPECT_EQ(1U, tracker.num_dropped_reads());
+}
+
+}  // namespace
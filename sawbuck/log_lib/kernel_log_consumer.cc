@@ -15,165 +15,56 @@
 // Kernel log consumer implementation.
 #include "sawbuck/log_lib/kernel_log_consumer.h"
 
+#include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "sawbuck/common/buffer_parser.h"
 #include <initguid.h>  // NOLINT - must precede kernel_log_types.
-#include "sawbuck/log_lib/kernel_log_types.h"  // NOLINT - must be last
+#include "sawbuck/log_lib/kernel_log_schema.h"  // NOLINT - must be last
 
 namespace {
 
 using namespace kernel_log_types;
 
-// The functions named ConvertModuleInformationFromLogEvent below all serve
-// the purpose of parsing a particular version and bitness of an NT Kernel
-// Logger module information event to the common ModuleInformation format.
+// Parses any version and bitness of an NT Kernel Logger module
+// information event to the common ModuleInformation format.
+// @param process_id returns the process id, or zero if the event
+//     version doesn't carry it.
+template <class ImageLoadType>
 bool ConvertModuleInformationFromLogEvent(
-    const ImageLoad32V0* data, size_t data_len, DWORD* process_id,
+    const void* data, size_t data_len, DWORD* process_id,
     KernelModuleEvents::ModuleInformation* info) {
-  DCHECK(data != NULL && info != NULL);
-  if (data_len < FIELD_OFFSET(ImageLoad32V0, ImageFileName))
+  typedef EventSchema<ImageLoadType> Schema;
+  DCHECK(info != NULL);
+  const ImageLoadType* event = GetEvent<ImageLoadType>(data, data_len);
+  if (event == NULL)
     return false;
 
-  info->base_address = data->BaseAddress;
-  info->module_size = data->ModuleSize;
-  size_t max_len = (data_len -
-      FIELD_OFFSET(ImageLoad32V0, ImageFileName)) / sizeof(wchar_t);
-  size_t string_len = wcsnlen_s(data->ImageFileName, max_len);
-  info->image_file_name.assign(data->ImageFileName, string_len);
+  info->base_address = Schema::base_address(*event);
+  info->module_size = Schema::module_size(*event);
+  info->image_checksum = Schema::image_checksum(*event);
+  info->time_date_stamp = Schema::time_date_stamp(*event);
+  *process_id = Schema::process_id(*event);
 
-  return true;
-}
-
-bool ConvertModuleInformationFromLogEvent(
-    const ImageLoad64V0* data, size_t data_len, DWORD* process_id,
-    KernelModuleEvents::ModuleInformation* info) {
-  DCHECK(data != NULL && info != NULL);
-  if (data_len < FIELD_OFFSET(ImageLoad64V0, ImageFileName))
-    return false;
-
-  info->base_address = data->BaseAddress;
-  info->module_size = data->ModuleSize;
-  size_t max_len = (data_len -
-      FIELD_OFFSET(ImageLoad64V0, ImageFileName)) / sizeof(wchar_t);
-  size_t string_len = wcsnlen_s(data->ImageFileName, max_len);
-  info->image_file_name.assign(data->ImageFileName, string_len);
-
-  return true;
-}
-
-bool ConvertModuleInformationFromLogEvent(
-    const ImageLoad32V1* data, size_t data_len, DWORD* process_id,
-    KernelModuleEvents::ModuleInformation* info) {
-  DCHECK(data != NULL && info != NULL);
-  if (data_len < FIELD_OFFSET(ImageLoad32V1, ImageFileName))
-    return false;
-
-  info->base_address = data->BaseAddress;
-  info->module_size = data->ModuleSize;
-  *process_id = data->ProcessId;
-  size_t max_len = (data_len -
-      FIELD_OFFSET(ImageLoad32V1, ImageFileName)) / sizeof(wchar_t);
-  size_t string_len = wcsnlen_s(data->ImageFileName, max_len);
-  info->image_file_name.assign(data->ImageFileName, string_len);
-
-  return true;
-}
-
-bool ConvertModuleInformationFromLogEvent(
-    const ImageLoad64V1* data, size_t data_len, DWORD* process_id,
-    KernelModuleEvents::ModuleInformation* info) {
-  DCHECK(data != NULL && info != NULL);
-  if (data_len < FIELD_OFFSET(ImageLoad64V1, ImageFileName))
-    return false;
-
-  info->base_address = data->BaseAddress;
-  // TODO(chrisha): Make ModuleInformation::module_size 64-bit?
-  info->module_size = static_cast<sym_util::ModuleSize>(data->ModuleSize);
-  *process_id = data->ProcessId;
-  size_t max_len = (data_len -
-      FIELD_OFFSET(ImageLoad64V1, ImageFileName)) / sizeof(wchar_t);
-  size_t string_len = wcsnlen_s(data->ImageFileName, max_len);
-  info->image_file_name.assign(data->ImageFileName, string_len);
-
-  return true;
-}
-
-bool ConvertModuleInformationFromLogEvent(
-    const ImageLoad32V2* data, size_t data_len, DWORD* process_id,
-    KernelModuleEvents::ModuleInformation* info) {
-  DCHECK(data != NULL && info != NULL);
-  if (data_len < FIELD_OFFSET(ImageLoad32V2, ImageFileName))
-    return false;
-
-  info->base_address = data->BaseAddress;
-  info->module_size = data->ModuleSize;
-  *process_id = data->ProcessId;
-  info->image_checksum = data->ImageChecksum;
-  info->time_date_stamp = data->TimeDateStamp;
-  size_t max_len = (data_len -
-      FIELD_OFFSET(ImageLoad32V2, ImageFileName)) / sizeof(wchar_t);
-  size_t string_len = wcsnlen_s(data->ImageFileName, max_len);
-  info->image_file_name.assign(data->ImageFileName, string_len);
-
-  return true;
-}
-
-bool ConvertModuleInformationFromLogEvent(
-    const ImageLoad64V2* data, size_t data_len, DWORD* process_id,
-    KernelModuleEvents::ModuleInformation* info) {
-  DCHECK(data != NULL && info != NULL);
-  if (data_len < FIELD_OFFSET(ImageLoad64V2, ImageFileName))
-    return false;
-
-  info->base_address = data->BaseAddress;
-  // TODO(chrisha): Maybe ModuleInformation::module_size should be 64-bit?
-  //     This has wide-spread repercussions.
-  info->module_size = static_cast<sym_util::ModuleSize>(data->ModuleSize);
-  *process_id = data->ProcessId;
-  info->image_checksum = data->ImageChecksum;
-  info->time_date_stamp = data->TimeDateStamp;
-  size_t max_len = (data_len -
-      FIELD_OFFSET(ImageLoad64V2, ImageFileName)) / sizeof(wchar_t);
-  size_t string_len = wcsnlen_s(data->ImageFileName, max_len);
-  info->image_file_name.assign(data->ImageFileName, string_len);
+  size_t max_len = (data_len - Schema::fixed_size()) / sizeof(wchar_t);
+  const wchar_t* image_file_name = Schema::image_file_name(*event);
+  size_t string_len = wcsnlen_s(image_file_name, max_len);
+  info->image_file_name.assign(image_file_name, string_len);
 
   return true;
 }
 
-// A traits class to deal with the minor differences in event parsing.
-template <class ProcessInfoType>
-class ProcessInfoTypeTraits {
- public:
-  static const bool has_command_line = true;
-};
-
-template <>
-class ProcessInfoTypeTraits<ProcessInfo32V0> {
- public:
-  static const bool has_command_line = false;
-};
-
-template <>
-class ProcessInfoTypeTraits<ProcessInfo32V1> {
- public:
-  static const bool has_command_line = false;
-};
-
-template <>
-class ProcessInfoTypeTraits<ProcessInfo64V1> {
- public:
-  static const bool has_command_line = false;
-};
-
 template <class ProcessInfoType>
 bool ParseProcessEvent(const void* data, size_t data_len,
     KernelProcessEvents::ProcessInfo* process_info, DWORD* exit_status) {
-  BinaryBufferReader reader(data, data_len);
-  const ProcessInfoType* info = NULL;
-  // Probe the info struct header and a get a pointer to it.
-  if (!reader.Read(FIELD_OFFSET(ProcessInfoType, UserSID), &info))
+  typedef EventSchema<ProcessInfoType> Schema;
+  const ProcessInfoType* info = GetEvent<ProcessInfoType>(data, data_len);
+  if (info == NULL)
     return false;
 
+  BinaryBufferReader reader(data, data_len);
+  bool consumed = reader.Consume(Schema::fixed_size());
+  DCHECK(consumed);
+
   // Probe the front of the SID structure.
   const SID* sid = NULL;
   if (!reader.Peek(FIELD_OFFSET(SID, SubAuthority), &sid) ||
@@ -195,370 +86,393 @@ bool ParseProcessEvent(const void* data, size_t data_len,
   // And then the command line for the variants that have it.
   const wchar_t* image_path = NULL;
   size_t image_path_len = 0;
-  if (ProcessInfoTypeTraits<ProcessInfoType>::has_command_line &&
+  if (Schema::has_command_line &&
       !reader.ReadString(&image_path, &image_path_len))
     return false;
 
-  process_info->process_id = info->ProcessId;
-  process_info->parent_id = info->ParentId;
-  process_info->session_id = info->SessionId;
+  process_info->process_id = Schema::process_id(*info);
+  process_info->parent_id = Schema::parent_id(*info);
+  process_info->session_id = Schema::session_id(*info);
   memcpy(&process_info->user_sid, sid, sid_len);
   process_info->image_name.assign(image_name, image_name_len);
   process_info->command_line.assign(image_path, image_path_len);
 
-  *exit_status = info->ExitStatus;
+  *exit_status = Schema::exit_status(*info);
 
   return true;
 }
 
-}  // namespace
-
-bool KernelProcessEvents::ProcessInfo::operator == (
-    const ProcessInfo& other) const {
-  return process_id == other.process_id &&
-      parent_id == other.parent_id &&
-      session_id == other.session_id &&
-      ::EqualSid(const_cast<SID*>(&user_sid),
-                 const_cast<SID*>(&other.user_sid)) &&
-      image_name == other.image_name &&
-      command_line == other.command_line;
+base::Time EventTime(const EVENT_TRACE* event) {
+  return base::Time::FromFileTime(
+      reinterpret_cast<const FILETIME&>(event->Header.TimeStamp));
 }
 
-KernelLogParser::KernelLogParser() : module_event_sink_(NULL),
-    page_fault_event_sink_(NULL), process_event_sink_(NULL),
-    infer_bitness_from_log_(true),
-    is_64_bit_log_(false) {
-}
-
-KernelLogParser::~KernelLogParser() {
-}
+// Decodes one kind of kernel event and issues the matching notification.
+// @returns true iff the event resulted in a notification.
+typedef bool (*EventDecoder)(KernelLogParser* parser, EVENT_TRACE* event);
 
-bool KernelLogParser::ProcessImageLoadEvent(EVENT_TRACE* event) {
-  DCHECK(event && event->Header.Guid == kImageLoadEventClass);
+typedef void (KernelModuleEvents::*ModuleEventHandler)(
+    DWORD process_id,
+    const base::Time& time,
+    const KernelModuleEvents::ModuleInformation& module_info);
 
-  if (module_event_sink_ == NULL)
+template <class ImageLoadType, ModuleEventHandler kHandler>
+bool DecodeImageEvent(KernelLogParser* parser, EVENT_TRACE* event) {
+  KernelModuleEvents* sink = parser->module_event_sink();
+  if (sink == NULL)
     return false;
 
-  base::Time time(base::Time::FromFileTime(
-      reinterpret_cast<FILETIME&>(event->Header.TimeStamp)));
   KernelModuleEvents::ModuleInformation info = {};
   DWORD process_id = 0;
+  if (!ConvertModuleInformationFromLogEvent<ImageLoadType>(event->MofData,
+                                                           event->MofLength,
+                                                           &process_id,
+                                                           &info)) {
+    return false;
+  }
+
+  if (process_id == 0)
+    process_id = event->Header.ProcessId;
+  (sink->*kHandler)(process_id, EventTime(event), info);
+  return true;
+}
+
+typedef void (KernelPageFaultEvents::*PageFaultEventHandler)(
+    DWORD process_id,
+    DWORD thread_id,
+    const base::Time& time,
+    sym_util::Address address,
+    sym_util::Address program_counter);
+
+template <class PageFaultType, PageFaultEventHandler kHandler>
+bool DecodePageFaultEvent(KernelLogParser* parser, EVENT_TRACE* event) {
+  typedef EventSchema<PageFaultType> Schema;
+  KernelPageFaultEvents* sink = parser->page_fault_event_sink();
+  if (sink == NULL)
+    return false;
 
-#define EVENT_HANDLER(type, version, event_type, handler) \
-  if (event->Header.Class.Type == type && \
-      event->Header.Class.Version == version) { \
-    event_type* data = reinterpret_cast<event_type*>(event->MofData); \
-    if (ConvertModuleInformationFromLogEvent(data, \
-                                             event->MofLength, \
-                                             &process_id, \
-                                             &info)) { \
-      if (process_id == 0) \
-        process_id = event->Header.ProcessId; \
-      module_event_sink_->handler(process_id, time, info); \
-      return true; \
-    } \
+  const PageFaultType* data =
+      GetEvent<PageFaultType>(event->MofData, event->MofLength);
+  if (data == NULL) {
+    LOG(ERROR) << "Short page fault event";
+    return false;
   }
 
-  if (is_64_bit_log_) {
-    EVENT_HANDLER(kImageNotifyUnloadEvent, 0, ImageLoad64V0, OnModuleUnload)
-    EVENT_HANDLER(kImageNotifyIsLoadedEvent, 0, ImageLoad64V0,
-        OnModuleIsLoaded)
-    EVENT_HANDLER(kImageNotifyLoadEvent, 0, ImageLoad64V0, OnModuleLoad);
-    EVENT_HANDLER(kImageNotifyUnloadEvent, 1, ImageLoad64V1, OnModuleUnload)
-    EVENT_HANDLER(kImageNotifyIsLoadedEvent, 1, ImageLoad64V1,
-        OnModuleIsLoaded)
-    EVENT_HANDLER(kImageNotifyLoadEvent, 1, ImageLoad64V1, OnModuleLoad);
-    EVENT_HANDLER(kImageNotifyUnloadEvent, 2, ImageLoad64V2, OnModuleUnload)
-    EVENT_HANDLER(kImageNotifyIsLoadedEvent, 2, ImageLoad64V2,
-        OnModuleIsLoaded)
-    EVENT_HANDLER(kImageNotifyLoadEvent, 2, ImageLoad64V2, OnModuleLoad);
-  } else {
-    EVENT_HANDLER(kImageNotifyUnloadEvent, 0, ImageLoad32V0, OnModuleUnload)
-    EVENT_HANDLER(kImageNotifyIsLoadedEvent, 0, ImageLoad32V0,
-        OnModuleIsLoaded)
-    EVENT_HANDLER(kImageNotifyLoadEvent, 0, ImageLoad32V0, OnModuleLoad);
-    EVENT_HANDLER(kImageNotifyUnloadEvent, 1, ImageLoad32V1, OnModuleUnload)
-    EVENT_HANDLER(kImageNotifyIsLoadedEvent, 1, ImageLoad32V1,
-        OnModuleIsLoaded)
-    EVENT_HANDLER(kImageNotifyLoadEvent, 1, ImageLoad32V1, OnModuleLoad);
-    EVENT_HANDLER(kImageNotifyUnloadEvent, 2, ImageLoad32V2, OnModuleUnload)
-    EVENT_HANDLER(kImageNotifyIsLoadedEvent, 2, ImageLoad32V2,
-        OnModuleIsLoaded)
-    EVENT_HANDLER(kImageNotifyLoadEvent, 2, ImageLoad32V2, OnModuleLoad);
+  (sink->*kHandler)(event->Header.ProcessId,
+                    event->Header.ThreadId,
+                    EventTime(event),
+                    Schema::virtual_address(*data),
+                    Schema::program_counter(*data));
+  return true;
+}
+
+template <class HardPageFaultType>
+bool DecodeHardPageFaultEvent(KernelLogParser* parser, EVENT_TRACE* event) {
+  typedef EventSchema<HardPageFaultType> Schema;
+  KernelPageFaultEvents* sink = parser->page_fault_event_sink();
+  if (sink == NULL)
+    return false;
+
+  const HardPageFaultType* data =
+      GetEvent<HardPageFaultType>(event->MofData, event->MofLength);
+  if (data == NULL) {
+    LOG(ERROR) << "Short hard fault event";
+    return false;
   }
 
-#undef EVENT_HANDLER
+  // TODO(siggi): Is this right?
+  ULONGLONG initial_file_time = Schema::initial_time(*data);
+  base::Time initial_time(base::Time::FromFileTime(
+      reinterpret_cast<const FILETIME&>(initial_file_time)));
 
-  return false;
+  sink->OnHardPageFault(Schema::thread_id(*data), EventTime(event),
+                        initial_time, Schema::read_offset(*data),
+                        Schema::virtual_address(*data),
+                        Schema::file_object(*data),
+                        Schema::byte_count(*data));
+  return true;
 }
 
-bool KernelLogParser::ProcessPageFaultEvent(EVENT_TRACE* event) {
-  DCHECK(event && event->Header.Guid == kPageFaultEventClass);
+template <class ProcessInfoType, UCHAR kEventType>
+bool DecodeProcessEvent(KernelLogParser* parser, EVENT_TRACE* event) {
+  KernelProcessEvents* sink = parser->process_event_sink();
+  if (sink == NULL)
+    return false;
 
-  if (page_fault_event_sink_ == NULL)
+  KernelProcessEvents::ProcessInfo process_info;
+  ULONG exit_status = 0;
+  if (!ParseProcessEvent<ProcessInfoType>(event->MofData,
+                                          event->MofLength,
+                                          &process_info,
+                                          &exit_status)) {
     return false;
+  }
+
+  base::Time time(EventTime(event));
+  switch (kEventType) {
+    case kProcessIsRunningEvent:
+      sink->OnProcessIsRunning(time, process_info);
+      break;
+
+    case kProcessStartEvent:
+      sink->OnProcessStarted(time, process_info);
+      break;
+
+    case kProcessEndEvent:
+      sink->OnProcessEnded(time, process_info, exit_status);
+      break;
+  }
 
-  if (event->Header.Class.Version != 2)
+  return true;
+}
+
+template <UCHAR kEventType>
+bool DecodeThreadEvent(KernelLogParser* parser, EVENT_TRACE* event) {
+  KernelThreadEvents* sink = parser->thread_event_sink();
+  if (sink == NULL)
     return false;
 
-  base::Time time(base::Time::FromFileTime(
-      reinterpret_cast<FILETIME&>(event->Header.TimeStamp)));
-  DWORD process_id = event->Header.ProcessId;
-  DWORD thread_id = event->Header.ThreadId;
-
-  BinaryBufferReader reader(event->MofData, event->MofLength);
-  if (event->Header.Class.Type == kHardPageFaultEvent) {
-    if (is_64_bit_log()) {
-      const HardPageFault64V2* data = NULL;
-      if (!reader.Read(&data)) {
-        LOG(ERROR) << "Short hard fault event";
-        return false;
-      }
+  typedef EventSchema<ThreadInfoV1> Schema;
+  const ThreadInfoV1* data =
+      GetEvent<ThreadInfoV1>(event->MofData, event->MofLength);
+  if (data == NULL) {
+    LOG(ERROR) << "Short thread event";
+    return false;
+  }
 
-      // TODO(siggi): Is this right?
-      base::Time initial_time(base::Time::FromFileTime(
-          reinterpret_cast<const FILETIME&>(data->InitialTime)));
-
-      page_fault_event_sink_->OnHardPageFault(
-          data->ThreadId, time, initial_time, data->ReadOffset,
-          data->VirtualAddress, data->FileObject, data->ByteCount);
-    } else {
-      const HardPageFault32V2* data = NULL;
-      if (!reader.Read(&data)) {
-        LOG(ERROR) << "Short hard fault event";
-        return false;
-      }
+  base::Time time(EventTime(event));
+  DWORD process_id = Schema::process_id(*data);
+  DWORD thread_id = Schema::thread_id(*data);
+  switch (kEventType) {
+    case kThreadIsRunningEvent:
+      sink->OnThreadIsRunning(time, process_id, thread_id);
+      break;
+
+    case kThreadStartEvent:
+      sink->OnThreadStarted(time, process_id, thread_id);
+      break;
+
+    case kThreadEndEvent:
+      sink->OnThreadEnded(time, process_id, thread_id);
+      break;
+  }
 
-      // TODO(siggi): Is this right?
-      base::Time initial_time(base::Time::FromFileTime(
-          reinterpret_cast<const FILETIME&>(data->InitialTime)));
+  return true;
+}
 
-      page_fault_event_sink_->OnHardPageFault(
-          data->ThreadId, time, initial_time, data->ReadOffset,
-          data->VirtualAddress, data->FileObject, data->ByteCount);
-    }
-    return true;
-  } else {
-    // Check the event type.
-    switch (event->Header.Class.Type) {
-      case kTransitionFaultEvent:
-      case kDemandZeroFaultEvent:
-      case kCopyOnWriteEvent:
-      case kGuardPageFaultEvent:
-      case kHardEvent:
-      case kAccessViolationEvent:
-        break;
-
-      default:
-        LOG(ERROR) << "Unknown page fault event type: "
-            << static_cast<int>(event->Header.Class.Type);
-        return false;
-    }
+// The kernel event classes we decode.
+enum EventClass {
+  IMAGE_LOAD_EVENT_CLASS,
+  PAGE_FAULT_EVENT_CLASS,
+  PROCESS_EVENT_CLASS,
+  THREAD_EVENT_CLASS,
 
-    // Read the data with the right bitness.
-    sym_util::Address virtual_address = 0;
-    sym_util::Address program_counter = 0;
-    if (is_64_bit_log()) {
-      const PageFault64V2* data = NULL;
-      if (!reader.Read(&data)) {
-        LOG(ERROR) << "Short page fault event";
-        return false;
-      }
+  // Must be last.
+  NUM_EVENT_CLASSES
+};
 
-      virtual_address = data->VirtualAddress;
-      program_counter = data->ProgramCounter;
-    } else {
-      const PageFault32V2* data = NULL;
-      if (!reader.Read(&data)) {
-        LOG(ERROR) << "Short page fault event";
-        return false;
-      }
+struct EventClassInfo {
+  const GUID* guid;
+  EventClass event_class;
+};
 
-      virtual_address = data->VirtualAddress;
-      program_counter = data->ProgramCounter;
-    }
+const EventClassInfo kEventClasses[] = {
+  { &kImageLoadEventClass, IMAGE_LOAD_EVENT_CLASS },
+  { &kPageFaultEventClass, PAGE_FAULT_EVENT_CLASS },
+  { &kProcessEventClass, PROCESS_EVENT_CLASS },
+  { &kThreadEventClass, THREAD_EVENT_CLASS },
+};
 
-    // And dispatch the callback.
-    switch (event->Header.Class.Type) {
-      case kTransitionFaultEvent:
-        page_fault_event_sink_->OnTransitionFault(process_id,
-                                                  thread_id,
-                                                  time,
-                                                  virtual_address,
-                                                  program_counter);
-        break;
-
-      case kDemandZeroFaultEvent:
-        page_fault_event_sink_->OnDemandZeroFault(process_id,
-                                                  thread_id,
-                                                  time,
-                                                  virtual_address,
-                                                  program_counter);
-        break;
-
-      case kCopyOnWriteEvent:
-        page_fault_event_sink_->OnCopyOnWriteFault(process_id,
-                                                   thread_id,
-                                                   time,
-                                                   virtual_address,
-                                                   program_counter);
-        break;
-
-      case kGuardPageFaultEvent:
-        page_fault_event_sink_->OnGuardPageFault(process_id,
-                                                 thread_id,
-                                                 time,
-                                                 virtual_address,
-                                                 program_counter);
-        break;
-
-      case kHardEvent:
-        page_fault_event_sink_->OnHardFault(process_id,
-                                            thread_id,
-                                            time,
-                                            virtual_address,
-                                            program_counter);
-        break;
-
-      case kAccessViolationEvent:
-        page_fault_event_sink_->OnAccessViolationFault(process_id,
-                                                       thread_id,
-                                                       time,
-                                                       virtual_address,
-                                                       program_counter);
-        break;
-
-      default:
-        NOTREACHED() << "Impossible page fault type";
-        break;
+// @returns true iff @p guid is one of kEventClasses, and if so returns
+//     its class in @p event_class.
+bool GetEventClass(const GUID& guid, EventClass* event_class) {
+  for (size_t i = 0; i < arraysize(kEventClasses); ++i) {
+    // The class GUIDs differ in their first field, so check that first.
+    const GUID& class_guid = *kEventClasses[i].guid;
+    if (guid.Data1 == class_guid.Data1 && guid == class_guid) {
+      *event_class = kEventClasses[i].event_class;
+      return true;
     }
-
-    return true;
   }
 
   return false;
 }
 
-bool KernelLogParser::ProcessProcessEvent(EVENT_TRACE* event) {
-  DCHECK(event && event->Header.Guid == kProcessEventClass);
-
-  switch (event->Header.Class.Type) {
-      case kProcessIsRunningEvent:
-      case kProcessStartEvent:
-      case kProcessEndEvent:
-        // Add other known event types here.
-        break;
+// Describes the decoder for one type, version and bitness of an event
+// class. Adding support for a new kind of kernel event comes down to
+// adding a decoder and an entry to kEventDecoders.
+struct EventDecoderInfo {
+  EventClass event_class;
+  UCHAR type;
+  USHORT version;
+  bool is_64_bit;
+  EventDecoder decoder;
+};
 
-    default:
-      // Unknown event type.
-      return false;
-  }
+#define IMAGE_EVENT(type, version, bits, handler) \
+  { IMAGE_LOAD_EVENT_CLASS, type, version, bits == 64, \
+    &DecodeImageEvent<ImageLoad##bits##V##version, \
+                      &KernelModuleEvents::handler> }
+
+#define PAGE_FAULT_EVENT(type, bits, handler) \
+  { PAGE_FAULT_EVENT_CLASS, type, 2, bits == 64, \
+    &DecodePageFaultEvent<PageFault##bits##V2, \
+                          &KernelPageFaultEvents::handler> }
+
+#define PROCESS_EVENT(type, version, bits) \
+  { PROCESS_EVENT_CLASS, type, version, bits == 64, \
+    &DecodeProcessEvent<ProcessInfo##bits##V##version, type> }
+
+#define PROCESS_EVENTS(version, bits) \
+  PROCESS_EVENT(kProcessIsRunningEvent, version, bits), \
+  PROCESS_EVENT(kProcessStartEvent, version, bits), \
+  PROCESS_EVENT(kProcessEndEvent, version, bits)
+
+#define THREAD_EVENT(type, version, bits) \
+  { THREAD_EVENT_CLASS, type, version, bits == 64, \
+    &DecodeThreadEvent<type> }
+
+#define THREAD_EVENTS(version, bits) \
+  THREAD_EVENT(kThreadIsRunningEvent, version, bits), \
+  THREAD_EVENT(kThreadStartEvent, version, bits), \
+  THREAD_EVENT(kThreadEndEvent, version, bits)
+
+const EventDecoderInfo kEventDecoders[] = {
+  IMAGE_EVENT(kImageNotifyUnloadEvent, 0, 32, OnModuleUnload),
+  IMAGE_EVENT(kImageNotifyIsLoadedEvent, 0, 32, OnModuleIsLoaded),
+  IMAGE_EVENT(kImageNotifyLoadEvent, 0, 32, OnModuleLoad),
+  IMAGE_EVENT(kImageNotifyUnloadEvent, 1, 32, OnModuleUnload),
+  IMAGE_EVENT(kImageNotifyIsLoadedEvent, 1, 32, OnModuleIsLoaded),
+  IMAGE_EVENT(kImageNotifyLoadEvent, 1, 32, OnModuleLoad),
+  IMAGE_EVENT(kImageNotifyUnloadEvent, 2, 32, OnModuleUnload),
+  IMAGE_EVENT(kImageNotifyIsLoadedEvent, 2, 32, OnModuleIsLoaded),
+  IMAGE_EVENT(kImageNotifyLoadEvent, 2, 32, OnModuleLoad),
+  IMAGE_EVENT(kImageNotifyUnloadEvent, 0, 64, OnModuleUnload),
+  IMAGE_EVENT(kImageNotifyIsLoadedEvent, 0, 64, OnModuleIsLoaded),
+  IMAGE_EVENT(kImageNotifyLoadEvent, 0, 64, OnModuleLoad),
+  IMAGE_EVENT(kImageNotifyUnloadEvent, 1, 64, OnModuleUnload),
+  IMAGE_EVENT(kImageNotifyIsLoadedEvent, 1, 64, OnModuleIsLoaded),
+  IMAGE_EVENT(kImageNotifyLoadEvent, 1, 64, OnModuleLoad),
+  IMAGE_EVENT(kImageNotifyUnloadEvent, 2, 64, OnModuleUnload),
+  IMAGE_EVENT(kImageNotifyIsLoadedEvent, 2, 64, OnModuleIsLoaded),
+  IMAGE_EVENT(kImageNotifyLoadEvent, 2, 64, OnModuleLoad),
+
+  PAGE_FAULT_EVENT(kTransitionFaultEvent, 32, OnTransitionFault),
+  PAGE_FAULT_EVENT(kDemandZeroFaultEvent, 32, OnDemandZeroFault),
+  PAGE_FAULT_EVENT(kCopyOnWriteEvent, 32, OnCopyOnWriteFault),
+  PAGE_FAULT_EVENT(kGuardPageFaultEvent, 32, OnGuardPageFault),
+  PAGE_FAULT_EVENT(kHardEvent, 32, OnHardFault),
+  PAGE_FAULT_EVENT(kAccessViolationEvent, 32, OnAccessViolationFault),
+  PAGE_FAULT_EVENT(kTransitionFaultEvent, 64, OnTransitionFault),
+  PAGE_FAULT_EVENT(kDemandZeroFaultEvent, 64, OnDemandZeroFault),
+  PAGE_FAULT_EVENT(kCopyOnWriteEvent, 64, OnCopyOnWriteFault),
+  PAGE_FAULT_EVENT(kGuardPageFaultEvent, 64, OnGuardPageFault),
+  PAGE_FAULT_EVENT(kHardEvent, 64, OnHardFault),
+  PAGE_FAULT_EVENT(kAccessViolationEvent, 64, OnAccessViolationFault),
+  { PAGE_FAULT_EVENT_CLASS, kHardPageFaultEvent, 2, false,
+    &DecodeHardPageFaultEvent<HardPageFault32V2> },
+  { PAGE_FAULT_EVENT_CLASS, kHardPageFaultEvent, 2, true,
+    &DecodeHardPageFaultEvent<HardPageFault64V2> },
+
+  PROCESS_EVENTS(1, 32),
+  PROCESS_EVENTS(2, 32),
+  PROCESS_EVENTS(3, 32),
+  PROCESS_EVENTS(2, 64),
+  PROCESS_EVENTS(3, 64),
+
+  THREAD_EVENTS(1, 32),
+  THREAD_EVENTS(2, 32),
+  THREAD_EVENTS(3, 32),
+  THREAD_EVENTS(2, 64),
+  THREAD_EVENTS(3, 64),
+};
 
-  if (process_event_sink_ == NULL)
-    return false;
+#undef THREAD_EVENTS
+#undef THREAD_EVENT
+#undef PROCESS_EVENTS
+#undef PROCESS_EVENT
+#undef PAGE_FAULT_EVENT
+#undef IMAGE_EVENT
 
-  KernelProcessEvents::ProcessInfo process_info;
-  base::Time time(base::Time::FromFileTime(
-      reinterpret_cast<FILETIME&>(event->Header.TimeStamp)));
-  bool has_info = false;
-  ULONG exit_status = 0;
+// The event types and versions we decode are all below these bounds.
+const size_t kNumEventTypes = 64;
+const size_t kNumEventVersions = 4;
 
-  if (is_64_bit_log_) {
-    switch (event->Header.Class.Version) {
-      case 0:
-        NOTREACHED();  // TODO(siggi): writeme.
-        break;
-      case 1:
-        NOTREACHED();  // TODO(siggi): writeme.
-        break;
-      case 2: {
-          has_info =
-              ParseProcessEvent<ProcessInfo64V2>(event->MofData,
-                                                 event->MofLength,
-                                                 &process_info,
-                                                 &exit_status);
-        }
-        break;
-      case 3: {
-          has_info =
-              ParseProcessEvent<ProcessInfo64V3>(event->MofData,
-                                                 event->MofLength,
-                                                 &process_info,
-                                                 &exit_status);
-        }
-        break;
-
-      default:
-        LOG(ERROR) << "Unexpected process info version "
-            << event->Header.Class.Version;
-        break;
-    }
-  } else {
-    switch (event->Header.Class.Version) {
-      case 0:
-        NOTREACHED();  // TODO(siggi): writeme.
-        break;
-      case 1: {
-          has_info =
-              ParseProcessEvent<ProcessInfo32V1>(event->MofData,
-                                                 event->MofLength,
-                                                 &process_info,
-                                                 &exit_status);
-        }
-        break;
-      case 2: {
-          has_info =
-              ParseProcessEvent<ProcessInfo32V2>(event->MofData,
-                                                 event->MofLength,
-                                                 &process_info,
-                                                 &exit_status);
-        }
-        break;
-      case 3: {
-          has_info =
-              ParseProcessEvent<ProcessInfo32V3>(event->MofData,
-                                                 event->MofLength,
-                                                 &process_info,
-                                                 &exit_status);
-        }
-        break;
-
-      default:
-        LOG(ERROR) << "Unexpected process info version "
-            << event->Header.Class.Version;
-        break;
+// Indexes kEventDecoders by class, bitness, version and type, for
+// constant time lookup.
+class EventDecoderTable {
+ public:
+  EventDecoderTable() {
+    memset(decoders_, 0, sizeof(decoders_));
+    for (size_t i = 0; i < arraysize(kEventDecoders); ++i) {
+      const EventDecoderInfo& info = kEventDecoders[i];
+      DCHECK_LT(info.type, kNumEventTypes);
+      DCHECK_LT(info.version, kNumEventVersions);
+
+      EventDecoder& decoder =
+          decoders_[info.event_class][info.is_64_bit][info.version][info.type];
+      DCHECK(decoder == NULL) << "Duplicate event decoder.";
+      decoder = info.decoder;
     }
   }
 
-  if (has_info) {
-    switch (event->Header.Class.Type) {
-      case kProcessIsRunningEvent:
-        process_event_sink_->OnProcessIsRunning(time, process_info);
-        break;
+  // @returns the decoder for the given kind of event, or NULL if we
+  //     don't decode it.
+  EventDecoder Lookup(EventClass event_class,
+                      bool is_64_bit,
+                      USHORT version,
+                      UCHAR type) const {
+    DCHECK_LT(event_class, NUM_EVENT_CLASSES);
+    if (version >= kNumEventVersions || type >= kNumEventTypes)
+      return NULL;
+    return decoders_[event_class][is_64_bit][version][type];
+  }
 
-      case kProcessStartEvent:
-        process_event_sink_->OnProcessStarted(time, process_info);
-        break;
+ private:
+  EventDecoder decoders_[NUM_EVENT_CLASSES][2][kNumEventVersions]
+                        [kNumEventTypes];
 
-      case kProcessEndEvent:
-        process_event_sink_->OnProcessEnded(time, process_info, exit_status);
-        break;
-    }
+  DISALLOW_COPY_AND_ASSIGN(EventDecoderTable);
+};
 
-    return true;
-  }
+base::LazyInstance<EventDecoderTable>::Leaky g_event_decoders =
+    LAZY_INSTANCE_INITIALIZER;
 
-  return false;
+}  // namespace
+
+bool KernelProcessEvents::ProcessInfo::operator == (
+    const ProcessInfo& other) const {
+  return process_id == other.process_id &&
+      parent_id == other.parent_id &&
+      session_id == other.session_id &&
+      ::EqualSid(const_cast<SID*>(&user_sid),
+                 const_cast<SID*>(&other.user_sid)) &&
+      image_name == other.image_name &&
+      command_line == other.command_line;
+}
+
+KernelLogParser::KernelLogParser() : module_event_sink_(NULL),
+    page_fault_event_sink_(NULL), process_event_sink_(NULL),
+    thread_event_sink_(NULL),
+    infer_bitness_from_log_(true),
+    is_64_bit_log_(false) {
+}
+
+KernelLogParser::~KernelLogParser() {
 }
 
 bool KernelLogParser::ProcessOneEvent(EVENT_TRACE* event) {
-  if (event->Header.Guid == kImageLoadEventClass) {
-    return ProcessImageLoadEvent(event);
-  } else if (event->Header.Guid == kPageFaultEventClass) {
-    return ProcessPageFaultEvent(event);
-  } else if (event->Header.Guid == kProcessEventClass) {
-    return ProcessProcessEvent(event);
-  } else if (event->Header.Guid == kEventTraceEventClass) {
+  EventClass event_class = NUM_EVENT_CLASSES;
+  if (GetEventClass(event->Header.Guid, &event_class)) {
+    EventDecoder decoder =
+        g_event_decoders.Get().Lookup(event_class,
+                                      is_64_bit_log_,
+                                      event->Header.Class.Version,
+                                      event->Header.Class.Type);
+    return decoder != NULL && decoder(this, event);
+  }
+
+  if (event->Header.Guid == kEventTraceEventClass) {
     if (event->Header.Class.Type == kLogFileHeaderEvent) {
       LogFileHeader32* data =
           reinterpret_cast<LogFileHeader32*>(event->MofData);
@@ -115,6 +115,22 @@ class KernelProcessEvents {
   // TODO(siggi): Data collection end event?
 };
 
+class KernelThreadEvents {
+ public:
+  // Issued for threads running before the trace session started.
+  virtual void OnThreadIsRunning(const base::Time& time,
+                                 DWORD process_id,
+                                 DWORD thread_id) = 0;
+  // Issued for threads starting after the trace session started.
+  virtual void OnThreadStarted(const base::Time& time,
+                               DWORD process_id,
+                               DWORD thread_id) = 0;
+  // Issued for threads ending.
+  virtual void OnThreadEnded(const base::Time& time,
+                             DWORD process_id,
+                             DWORD thread_id) = 0;
+};
+
 class KernelLogParser {
  public:
   KernelLogParser();
@@ -130,15 +146,28 @@ class KernelLogParser {
     is_64_bit_log_ = is_64_bit_log;
   }
 
+  KernelModuleEvents* module_event_sink() const { return module_event_sink_; }
   void set_module_event_sink(KernelModuleEvents* module_event_sink) {
     module_event_sink_ = module_event_sink;
   }
+  KernelPageFaultEvents* page_fault_event_sink() const {
+    return page_fault_event_sink_;
+  }
   void set_page_fault_event_sink(KernelPageFaultEvents* page_fault_event_sink) {
     page_fault_event_sink_ = page_fault_event_sink;
   }
+  KernelProcessEvents* process_event_sink() const {
+    return process_event_sink_;
+  }
   void set_process_event_sink(KernelProcessEvents* process_event_sink) {
     process_event_sink_ = process_event_sink;
   }
+  KernelThreadEvents* thread_event_sink() const {
+    return thread_event_sink_;
+  }
+  void set_thread_event_sink(KernelThreadEvents* thread_event_sink) {
+    thread_event_sink_ = thread_event_sink;
+  }
 
   // Process an event, issue callbacks to event sinks as appropriate.
   // @param event the event to process.
@@ -146,16 +175,14 @@ class KernelLogParser {
   bool ProcessOneEvent(EVENT_TRACE* event);
 
  private:
-  bool ProcessImageLoadEvent(EVENT_TRACE* event);
-  bool ProcessPageFaultEvent(EVENT_TRACE* event);
-  bool ProcessProcessEvent(EVENT_TRACE* event);
-
   // Our module event sink.
   KernelModuleEvents* module_event_sink_;
   // Our page fault event sink.
   KernelPageFaultEvents* page_fault_event_sink_;
   // Our process event sink.
   KernelProcessEvents* process_event_sink_;
+  // Our thread event sink.
+  KernelThreadEvents* thread_event_sink_;
 
   // If true, we should infer the log bitness from the event stream,
   // e.g. from the pointer size field of the log file header event.
@@ -0,0 +1,255 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Measures the cost of decoding each kind of kernel event.
+#include "sawbuck/log_lib/kernel_log_consumer.h"
+
+#include <vector>
+#include "base/basictypes.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/perf_time_logger.h"
+#include "base/time/time.h"
+#include "gtest/gtest.h"
+#include "sawbuck/log_lib/kernel_log_types.h"  // NOLINT - must be last.
+
+namespace {
+
+using namespace kernel_log_types;
+
+// A million iterations, so that the milliseconds logged for a run read
+// as nanoseconds per event.
+const size_t kNumIterations = 1000000;
+
+const wchar_t kImageFileName[] = L"C:\\Windows\\System32\\kernel32.dll";
+const char kProcessImageName[] = "chrome.exe";
+const wchar_t kProcessCommandLine[] = L"chrome.exe --type=renderer";
+
+// Counts the notifications it receives.
+class CountingKernelEvents
+    : public KernelModuleEvents,
+      public KernelPageFaultEvents,
+      public KernelProcessEvents {
+ public:
+  CountingKernelEvents() : num_events_(0) {
+  }
+
+  virtual void OnModuleIsLoaded(DWORD process_id,
+                                const base::Time& time,
+                                const ModuleInformation& module_info) {
+    ++num_events_;
+  }
+  virtual void OnModuleUnload(DWORD process_id,
+                              const base::Time& time,
+                              const ModuleInformation& module_info) {
+    ++num_events_;
+  }
+  virtual void OnModuleLoad(DWORD process_id,
+                            const base::Time& time,
+                            const ModuleInformation& module_info) {
+    ++num_events_;
+  }
+
+  virtual void OnTransitionFault(DWORD process_id,
+                                 DWORD thread_id,
+                                 const base::Time& time,
+                                 sym_util::Address address,
+                                 sym_util::Address program_counter) {
+    ++num_events_;
+  }
+  virtual void OnDemandZeroFault(DWORD process_id,
+                                 DWORD thread_id,
+                                 const base::Time& time,
+                                 sym_util::Address address,
+                                 sym_util::Address program_counter) {
+    ++num_events_;
+  }
+  virtual void OnCopyOnWriteFault(DWORD process_id,
+                                  DWORD thread_id,
+                                  const base::Time& time,
+                                  sym_util::Address address,
+                                  sym_util::Address program_counter) {
+    ++num_events_;
+  }
+  virtual void OnGuardPageFault(DWORD process_id,
+                                DWORD thread_id,
+                                const base::Time& time,
+                                sym_util::Address address,
+                                sym_util::Address program_counter) {
+    ++num_events_;
+  }
+  virtual void OnHardFault(DWORD process_id,
+                           DWORD thread_id,
+                           const base::Time& time,
+                           sym_util::Address address,
+                           sym_util::Address program_counter) {
+    ++num_events_;
+  }
+  virtual void OnAccessViolationFault(DWORD process_id,
+                                      DWORD thread_id,
+                                      const base::Time& time,
+                                      sym_util::Address address,
+                                      sym_util::Address program_counter) {
+    ++num_events_;
+  }
+  virtual void OnHardPageFault(DWORD thread_id,
+                               const base::Time& time,
+                               const base::Time& initial_time,
+                               sym_util::Offset offset,
+                               sym_util::Address address,
+                               sym_util::Address file_object,
+                               sym_util::ByteCount byte_count) {
+    ++num_events_;
+  }
+
+  virtual void OnProcessIsRunning(const base::Time& time,
+                                  const ProcessInfo& process_info) {
+    ++num_events_;
+  }
+  virtual void OnProcessStarted(const base::Time& time,
+                                const ProcessInfo& process_info) {
+    ++num_events_;
+  }
+  virtual void OnProcessEnded(const base::Time& time,
+                              const ProcessInfo& process_info,
+                              ULONG exit_status) {
+    ++num_events_;
+  }
+
+  size_t num_events_;
+};
+
+// A synthetic kernel event and the data it refers to.
+class SyntheticEvent {
+ public:
+  SyntheticEvent(const GUID& event_class, UCHAR type, USHORT version) {
+    memset(&event_, 0, sizeof(event_));
+    event_.Header.Guid = event_class;
+    event_.Header.Class.Type = type;
+    event_.Header.Class.Version = version;
+    event_.Header.ProcessId = 1234;
+    event_.Header.ThreadId = 5678;
+    event_.Header.TimeStamp.QuadPart = 129488146035903615LL;
+  }
+
+  void Append(const void* data, size_t data_len) {
+    const uint8* bytes = reinterpret_cast<const uint8*>(data);
+    data_.insert(data_.end(), bytes, bytes + data_len);
+  }
+
+  template <class Type>
+  void Append(const Type& value) {
+    Append(&value, sizeof(value));
+  }
+
+  EVENT_TRACE* Get() {
+    event_.MofData = &data_[0];
+    event_.MofLength = static_cast<ULONG>(data_.size());
+    return &event_;
+  }
+
+ private:
+  EVENT_TRACE event_;
+  std::vector<uint8> data_;
+};
+
+SyntheticEvent ImageLoadEvent() {
+  SyntheticEvent event(kImageLoadEventClass, kImageNotifyLoadEvent, 2);
+  ImageLoad32V2 data = {};
+  data.BaseAddress = 0x76000000;
+  data.ModuleSize = 0x00110000;
+  data.ProcessId = 1234;
+  event.Append(&data, FIELD_OFFSET(ImageLoad32V2, ImageFileName));
+  event.Append(kImageFileName, sizeof(kImageFileName));
+  return event;
+}
+
+SyntheticEvent PageFaultEvent() {
+  SyntheticEvent event(kPageFaultEventClass, kHardEvent, 2);
+  PageFault32V2 data = {};
+  data.VirtualAddress = 0x76001000;
+  data.ProgramCounter = 0x76000500;
+  event.Append(data);
+  return event;
+}
+
+SyntheticEvent HardPageFaultEvent() {
+  SyntheticEvent event(kPageFaultEventClass, kHardPageFaultEvent, 2);
+  HardPageFault32V2 data = {};
+  data.InitialTime = 129488146035903615LL;
+  data.ReadOffset = 0x1000;
+  data.VirtualAddress = 0x76001000;
+  data.ThreadId = 5678;
+  data.ByteCount = 0x8000;
+  event.Append(data);
+  return event;
+}
+
+SyntheticEvent ProcessStartEvent() {
+  SyntheticEvent event(kProcessEventClass, kProcessStartEvent, 3);
+  ProcessInfo32V3 data = {};
+  data.ProcessId = 1234;
+  data.ParentId = 4321;
+  data.SessionId = 1;
+  event.Append(&data, FIELD_OFFSET(ProcessInfo32V3, UserSID));
+
+  // S-1-5-18, the local system account.
+  SID sid = {};
+  sid.Revision = 1;
+  sid.SubAuthorityCount = 1;
+  sid.IdentifierAuthority.Value[5] = 5;
+  sid.SubAuthority[0] = 18;
+  event.Append(sid);
+  event.Append(kProcessImageName, sizeof(kProcessImageName));
+  event.Append(kProcessCommandLine, sizeof(kProcessCommandLine));
+  return event;
+}
+
+void MeasureDecode(const char* name, SyntheticEvent event) {
+  CountingKernelEvents events;
+  KernelLogParser parser;
+  parser.set_infer_bitness_from_log(false);
+  parser.set_is_64_bit_log(false);
+  parser.set_module_event_sink(&events);
+  parser.set_page_fault_event_sink(&events);
+  parser.set_process_event_sink(&events);
+
+  EVENT_TRACE* trace = event.Get();
+  ASSERT_TRUE(parser.ProcessOneEvent(trace));
+
+  std::string timer_name = base::StringPrintf("kernel_decode_%s", name);
+  base::PerfTimeLogger timer(timer_name.c_str());
+  for (size_t i = 0; i < kNumIterations; ++i)
+    parser.ProcessOneEvent(trace);
+  timer.Done();
+
+  EXPECT_EQ(kNumIterations + 1, events.num_events_);
+}
+
+TEST(KernelLogParserPerfTest, DecodeImageLoad) {
+  MeasureDecode("image_load", ImageLoadEvent());
+}
+
+TEST(KernelLogParserPerfTest, DecodePageFault) {
+  MeasureDecode("page_fault", PageFaultEvent());
+}
+
+TEST(KernelLogParserPerfTest, DecodeHardPageFault) {
+  MeasureDecode("hard_page_fault", HardPageFaultEvent());
+}
+
+TEST(KernelLogParserPerfTest, DecodeProcessStart) {
+  MeasureDecode("process_start", ProcessStartEvent());
+}
+
+}  // namespace
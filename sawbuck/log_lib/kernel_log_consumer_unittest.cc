@@ -20,6 +20,7 @@
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 #include "sawbuck/log_lib/kernel_log_unittest_data.h"
+#include "sawbuck/log_lib/kernel_log_types.h"  // NOLINT - must be last.
 
 namespace {
 
@@ -53,6 +54,61 @@ class MockKernelProcessEvents: public KernelProcessEvents{
                                      ULONG exit_status));
 };
 
+class MockKernelThreadEvents: public KernelThreadEvents {
+ public:
+  MOCK_METHOD3(OnThreadIsRunning, void(const base::Time& time,
+                                       DWORD process_id,
+                                       DWORD thread_id));
+  MOCK_METHOD3(OnThreadStarted, void(const base::Time& time,
+                                     DWORD process_id,
+                                     DWORD thread_id));
+  MOCK_METHOD3(OnThreadEnded, void(const base::Time& time,
+                                   DWORD process_id,
+                                   DWORD thread_id));
+};
+
+class MockKernelPageFaultEvents: public KernelPageFaultEvents {
+ public:
+  MOCK_METHOD5(OnTransitionFault, void(DWORD process_id,
+                                       DWORD thread_id,
+                                       const base::Time& time,
+                                       sym_util::Address address,
+                                       sym_util::Address program_counter));
+  MOCK_METHOD5(OnDemandZeroFault, void(DWORD process_id,
+                                       DWORD thread_id,
+                                       const base::Time& time,
+                                       sym_util::Address address,
+                                       sym_util::Address program_counter));
+  MOCK_METHOD5(OnCopyOnWriteFault, void(DWORD process_id,
+                                        DWORD thread_id,
+                                        const base::Time& time,
+                                        sym_util::Address address,
+                                        sym_util::Address program_counter));
+  MOCK_METHOD5(OnGuardPageFault, void(DWORD process_id,
+                                      DWORD thread_id,
+                                      const base::Time& time,
+                                      sym_util::Address address,
+                                      sym_util::Address program_counter));
+  MOCK_METHOD5(OnHardFault, void(DWORD process_id,
+                                 DWORD thread_id,
+                                 const base::Time& time,
+                                 sym_util::Address address,
+                                 sym_util::Address program_counter));
+  MOCK_METHOD5(OnAccessViolationFault,
+               void(DWORD process_id,
+                    DWORD thread_id,
+                    const base::Time& time,
+                    sym_util::Address address,
+                    sym_util::Address program_counter));
+  MOCK_METHOD7(OnHardPageFault, void(DWORD thread_id,
+                                     const base::Time& time,
+                                     const base::Time& initial_time,
+                                     sym_util::Offset offset,
+                                     sym_util::Address address,
+                                     sym_util::Address file_object,
+                                     sym_util::ByteCount byte_count));
+};
+
 class KernelLogConsumerTest: public testing::Test {
  public:
   KernelLogConsumerTest() {
@@ -220,4 +276,101 @@ TEST_F(KernelLogConsumerTest, ProcessEventsLog64Version3) {
   Consume(L"process_data_64_v3.etl");
 }
 
+// Makes a 32 bit page fault event referring to @p data.
+EVENT_TRACE PageFaultEvent(UCHAR type,
+                           USHORT version,
+                           kernel_log_types::PageFault32V2* data) {
+  EVENT_TRACE event = {};
+  event.Header.Guid = kernel_log_types::kPageFaultEventClass;
+  event.Header.Class.Type = type;
+  event.Header.Class.Version = version;
+  event.Header.ProcessId = 1234;
+  event.Header.ThreadId = 5678;
+  event.MofData = data;
+  event.MofLength = sizeof(*data);
+  return event;
+}
+
+TEST(KernelLogParserTest, DispatchesPageFaultEvents) {
+  StrictMock<MockKernelPageFaultEvents> events;
+  KernelLogParser parser;
+  parser.set_is_64_bit_log(false);
+  parser.set_page_fault_event_sink(&events);
+
+  kernel_log_types::PageFault32V2 data = { 0x1000, 0x2000 };
+  EVENT_TRACE event = {};
+
+  EXPECT_CALL(events, OnTransitionFault(1234, 5678, _, 0x1000, 0x2000));
+  event = PageFaultEvent(kernel_log_types::kTransitionFaultEvent, 2, &data);
+  EXPECT_TRUE(parser.ProcessOneEvent(&event));
+
+  EXPECT_CALL(events, OnDemandZeroFault(1234, 5678, _, 0x1000, 0x2000));
+  event = PageFaultEvent(kernel_log_types::kDemandZeroFaultEvent, 2, &data);
+  EXPECT_TRUE(parser.ProcessOneEvent(&event));
+
+  EXPECT_CALL(events, OnAccessViolationFault(1234, 5678, _, 0x1000, 0x2000));
+  event = PageFaultEvent(kernel_log_types::kAccessViolationEvent, 2, &data);
+  EXPECT_TRUE(parser.ProcessOneEvent(&event));
+
+  // Unknown versions and types, and short events, are rejected.
+  event = PageFaultEvent(kernel_log_types::kTransitionFaultEvent, 3, &data);
+  EXPECT_FALSE(parser.ProcessOneEvent(&event));
+  event.Header.Class.Version = 0xFFFF;
+  EXPECT_FALSE(parser.ProcessOneEvent(&event));
+  event = PageFaultEvent(0xFF, 2, &data);
+  EXPECT_FALSE(parser.ProcessOneEvent(&event));
+  event = PageFaultEvent(kernel_log_types::kTransitionFaultEvent, 2, &data);
+  event.MofLength = sizeof(data) - 1;
+  EXPECT_FALSE(parser.ProcessOneEvent(&event));
+
+  // As are events of other classes.
+  event = PageFaultEvent(kernel_log_types::kTransitionFaultEvent, 2, &data);
+  event.Header.Guid.Data1 ^= 1;
+  EXPECT_FALSE(parser.ProcessOneEvent(&event));
+}
+
+// Makes a thread event referring to @p data.
+EVENT_TRACE ThreadEvent(UCHAR type,
+                        USHORT version,
+                        kernel_log_types::ThreadInfoV1* data) {
+  EVENT_TRACE event = {};
+  event.Header.Guid = kernel_log_types::kThreadEventClass;
+  event.Header.Class.Type = type;
+  event.Header.Class.Version = version;
+  event.MofData = data;
+  event.MofLength = sizeof(*data);
+  return event;
+}
+
+TEST(KernelLogParserTest, DispatchesThreadEvents) {
+  StrictMock<MockKernelThreadEvents> events;
+  KernelLogParser parser;
+  parser.set_is_64_bit_log(true);
+  parser.set_thread_event_sink(&events);
+
+  kernel_log_types::ThreadInfoV1 data = { 1234, 5678 };
+  EVENT_TRACE event = {};
+
+  EXPECT_CALL(events, OnThreadIsRunning(_, 1234, 5678));
+  event = ThreadEvent(kernel_log_types::kThreadIsRunningEvent, 2, &data);
+  EXPECT_TRUE(parser.ProcessOneEvent(&event));
+
+  EXPECT_CALL(events, OnThreadStarted(_, 1234, 5678));
+  event = ThreadEvent(kernel_log_types::kThreadStartEvent, 3, &data);
+  EXPECT_TRUE(parser.ProcessOneEvent(&event));
+
+  EXPECT_CALL(events, OnThreadEnded(_, 1234, 5678));
+  event = ThreadEvent(kernel_log_types::kThreadEndEvent, 2, &data);
+  EXPECT_TRUE(parser.ProcessOneEvent(&event));
+
+  // Version 0 events, and the rundown end, aren't decoded.
+  event = ThreadEvent(kernel_log_types::kThreadStartEvent, 0, &data);
+  EXPECT_FALSE(parser.ProcessOneEvent(&event));
+  event = ThreadEvent(kernel_log_types::kThreadCollectionEnded, 2, &data);
+  EXPECT_FALSE(parser.ProcessOneEvent(&event));
+  event = ThreadEvent(kernel_log_types::kThreadStartEvent, 2, &data);
+  event.MofLength = sizeof(data) - 1;
+  EXPECT_FALSE(parser.ProcessOneEvent(&event));
+}
+
 }  // namespace
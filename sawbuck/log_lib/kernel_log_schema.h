@@ -0,0 +1,260 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Schemas for the NT Kernel log structures in kernel_log_types.h.
+//
+// Each event structure declares its schema once, as a specialization of
+// EventSchema. A schema gives the size of the fixed part of the event,
+// which is the only bounds check a decoder needs before reading fields,
+// and typed accessors for its fields. Fields that only some versions of
+// an event have read as zero in the versions that lack them, so one
+// decoder template serves every version and bitness of an event.
+#ifndef SAWBUCK_LOG_LIB_KERNEL_LOG_SCHEMA_H_
+#define SAWBUCK_LOG_LIB_KERNEL_LOG_SCHEMA_H_
+
+#include "base/basictypes.h"
+#include "sawbuck/sym_util/types.h"
+#include "sawbuck/log_lib/kernel_log_types.h"  // NOLINT - must be last.
+
+namespace kernel_log_types {
+
+// Selects between the accessors of present and absent fields.
+template <bool kPresent>
+struct FieldPresence {
+};
+
+typedef FieldPresence<true> FieldPresent;
+typedef FieldPresence<false> FieldAbsent;
+
+// The schema of event structure EventType.
+template <class EventType>
+class EventSchema;
+
+// @returns the event at @p data if @p data_len bytes cover its fixed part,
+//     or NULL otherwise.
+template <class EventType>
+const EventType* GetEvent(const void* data, size_t data_len) {
+  if (data == NULL || data_len < EventSchema<EventType>::fixed_size())
+    return NULL;
+  return reinterpret_cast<const EventType*>(data);
+}
+
+// Image load events all have a base address, size and trailing file name.
+// Version 1 adds the process id, and version 2 the image checksum and time
+// date stamp.
+template <class EventType, bool kHasProcessId, bool kHasImageStamps>
+class ImageLoadSchema {
+ public:
+  static size_t fixed_size() {
+    return FIELD_OFFSET(EventType, ImageFileName);
+  }
+
+  static sym_util::ModuleBase base_address(const EventType& event) {
+    return event.BaseAddress;
+  }
+  // TODO(chrisha): Maybe ModuleInformation::module_size should be 64-bit?
+  //     This has wide-spread repercussions.
+  static sym_util::ModuleSize module_size(const EventType& event) {
+    return static_cast<sym_util::ModuleSize>(event.ModuleSize);
+  }
+  static DWORD process_id(const EventType& event) {
+    return process_id(event, FieldPresence<kHasProcessId>());
+  }
+  static sym_util::ModuleChecksum image_checksum(const EventType& event) {
+    return image_checksum(event, FieldPresence<kHasImageStamps>());
+  }
+  static sym_util::ModuleTimeDateStamp time_date_stamp(
+      const EventType& event) {
+    return time_date_stamp(event, FieldPresence<kHasImageStamps>());
+  }
+  // The file name runs to its terminator or the end of the event,
+  // whichever comes first.
+  static const wchar_t* image_file_name(const EventType& event) {
+    return event.ImageFileName;
+  }
+
+ private:
+  static DWORD process_id(const EventType& event, FieldPresent) {
+    return event.ProcessId;
+  }
+  static DWORD process_id(const EventType& event, FieldAbsent) {
+    return 0;
+  }
+  static sym_util::ModuleChecksum image_checksum(const EventType& event,
+                                                 FieldPresent) {
+    return event.ImageChecksum;
+  }
+  static sym_util::ModuleChecksum image_checksum(const EventType& event,
+                                                 FieldAbsent) {
+    return 0;
+  }
+  static sym_util::ModuleTimeDateStamp time_date_stamp(
+      const EventType& event, FieldPresent) {
+    return event.TimeDateStamp;
+  }
+  static sym_util::ModuleTimeDateStamp time_date_stamp(
+      const EventType& event, FieldAbsent) {
+    return 0;
+  }
+};
+
+template <>
+class EventSchema<ImageLoad32V0>
+    : public ImageLoadSchema<ImageLoad32V0, false, false> {
+};
+template <>
+class EventSchema<ImageLoad64V0>
+    : public ImageLoadSchema<ImageLoad64V0, false, false> {
+};
+template <>
+class EventSchema<ImageLoad32V1>
+    : public ImageLoadSchema<ImageLoad32V1, true, false> {
+};
+template <>
+class EventSchema<ImageLoad64V1>
+    : public ImageLoadSchema<ImageLoad64V1, true, false> {
+};
+template <>
+class EventSchema<ImageLoad32V2>
+    : public ImageLoadSchema<ImageLoad32V2, true, true> {
+};
+template <>
+class EventSchema<ImageLoad64V2>
+    : public ImageLoadSchema<ImageLoad64V2, true, true> {
+};
+
+// Page fault events are fixed size.
+template <class EventType>
+class PageFaultSchema {
+ public:
+  static size_t fixed_size() { return sizeof(EventType); }
+
+  static sym_util::Address virtual_address(const EventType& event) {
+    return event.VirtualAddress;
+  }
+  static sym_util::Address program_counter(const EventType& event) {
+    return event.ProgramCounter;
+  }
+};
+
+template <>
+class EventSchema<PageFault32V2> : public PageFaultSchema<PageFault32V2> {
+};
+template <>
+class EventSchema<PageFault64V2> : public PageFaultSchema<PageFault64V2> {
+};
+
+template <class EventType>
+class HardPageFaultSchema {
+ public:
+  static size_t fixed_size() { return sizeof(EventType); }
+
+  static ULONGLONG initial_time(const EventType& event) {
+    return event.InitialTime;
+  }
+  static sym_util::Offset read_offset(const EventType& event) {
+    return event.ReadOffset;
+  }
+  static sym_util::Address virtual_address(const EventType& event) {
+    return event.VirtualAddress;
+  }
+  static sym_util::Address file_object(const EventType& event) {
+    return event.FileObject;
+  }
+  static DWORD thread_id(const EventType& event) {
+    return event.ThreadId;
+  }
+  static sym_util::ByteCount byte_count(const EventType& event) {
+    return event.ByteCount;
+  }
+};
+
+template <>
+class EventSchema<HardPageFault32V2>
+    : public HardPageFaultSchema<HardPageFault32V2> {
+};
+template <>
+class EventSchema<HardPageFault64V2>
+    : public HardPageFaultSchema<HardPageFault64V2> {
+};
+
+// Process events have a variable length user SID, followed by the image
+// name and, from version 2 on, the command line.
+template <class EventType, bool kHasCommandLine>
+class ProcessInfoSchema {
+ public:
+  static const bool has_command_line = kHasCommandLine;
+
+  static size_t fixed_size() { return FIELD_OFFSET(EventType, UserSID); }
+
+  static DWORD process_id(const EventType& event) {
+    return event.ProcessId;
+  }
+  static DWORD parent_id(const EventType& event) {
+    return event.ParentId;
+  }
+  static DWORD session_id(const EventType& event) {
+    return event.SessionId;
+  }
+  static DWORD exit_status(const EventType& event) {
+    return event.ExitStatus;
+  }
+};
+
+template <>
+class EventSchema<ProcessInfo32V1>
+    : public ProcessInfoSchema<ProcessInfo32V1, false> {
+};
+template <>
+class EventSchema<ProcessInfo64V1>
+    : public ProcessInfoSchema<ProcessInfo64V1, false> {
+};
+template <>
+class EventSchema<ProcessInfo32V2>
+    : public ProcessInfoSchema<ProcessInfo32V2, true> {
+};
+template <>
+class EventSchema<ProcessInfo64V2>
+    : public ProcessInfoSchema<ProcessInfo64V2, true> {
+};
+template <>
+class EventSchema<ProcessInfo32V3>
+    : public ProcessInfoSchema<ProcessInfo32V3, true> {
+};
+template <>
+class EventSchema<ProcessInfo64V3>
+    : public ProcessInfoSchema<ProcessInfo64V3, true> {
+};
+
+// Thread events are fixed size, and the same for either bitness.
+template <class EventType>
+class ThreadInfoSchema {
+ public:
+  static size_t fixed_size() { return sizeof(EventType); }
+
+  static DWORD process_id(const EventType& event) {
+    return event.ProcessId;
+  }
+  static DWORD thread_id(const EventType& event) {
+    return event.ThreadId;
+  }
+};
+
+template <>
+class EventSchema<ThreadInfoV1> : public ThreadInfoSchema<ThreadInfoV1> {
+};
+
+}  // namespace kernel_log_types
+
+#endif  // SAWBUCK_LOG_LIB_KERNEL_LOG_SCHEMA_H_
@@ -0,0 +1,103 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "gtest/gtest.h"
+#include "sawbuck/log_lib/kernel_log_schema.h"  // NOLINT - must be last.
+
+namespace {
+
+using namespace kernel_log_types;
+
+TEST(KernelLogSchemaTest, GetEventChecksFixedSize) {
+  ImageLoad32V2 image_load = {};
+  size_t fixed_size = FIELD_OFFSET(ImageLoad32V2, ImageFileName);
+  EXPECT_EQ(fixed_size, EventSchema<ImageLoad32V2>::fixed_size());
+  EXPECT_EQ(&image_load, GetEvent<ImageLoad32V2>(&image_load, fixed_size));
+  EXPECT_TRUE(GetEvent<ImageLoad32V2>(&image_load, fixed_size - 1) == NULL);
+  EXPECT_TRUE(GetEvent<ImageLoad32V2>(NULL, fixed_size) == NULL);
+
+  ProcessInfo64V3 process_info = {};
+  fixed_size = FIELD_OFFSET(ProcessInfo64V3, UserSID);
+  EXPECT_EQ(fixed_size, EventSchema<ProcessInfo64V3>::fixed_size());
+  EXPECT_EQ(&process_info,
+            GetEvent<ProcessInfo64V3>(&process_info, fixed_size));
+  EXPECT_TRUE(
+      GetEvent<ProcessInfo64V3>(&process_info, fixed_size - 1) == NULL);
+
+  PageFault64V2 page_fault = {};
+  EXPECT_EQ(&page_fault,
+            GetEvent<PageFault64V2>(&page_fault, sizeof(page_fault)));
+  EXPECT_TRUE(
+      GetEvent<PageFault64V2>(&page_fault, sizeof(page_fault) - 1) == NULL);
+}
+
+TEST(KernelLogSchemaTest, ImageLoadFields) {
+  ImageLoad32V0 v0 = {};
+  v0.BaseAddress = 0x10000000;
+  v0.ModuleSize = 0x1000;
+  typedef EventSchema<ImageLoad32V0> V0Schema;
+  EXPECT_EQ(0x10000000, V0Schema::base_address(v0));
+  EXPECT_EQ(0x1000, V0Schema::module_size(v0));
+  // Version 0 has neither process id nor image stamps.
+  EXPECT_EQ(0, V0Schema::process_id(v0));
+  EXPECT_EQ(0, V0Schema::image_checksum(v0));
+  EXPECT_EQ(0, V0Schema::time_date_stamp(v0));
+
+  ImageLoad64V1 v1 = {};
+  v1.BaseAddress = 0x7FF00000000ULL;
+  v1.ProcessId = 1234;
+  typedef EventSchema<ImageLoad64V1> V1Schema;
+  EXPECT_EQ(0x7FF00000000ULL, V1Schema::base_address(v1));
+  EXPECT_EQ(1234, V1Schema::process_id(v1));
+  EXPECT_EQ(0, V1Schema::image_checksum(v1));
+
+  ImageLoad64V2 v2 = {};
+  v2.ProcessId = 1234;
+  v2.ImageChecksum = 0xCAFE;
+  v2.TimeDateStamp = 0xF00D;
+  typedef EventSchema<ImageLoad64V2> V2Schema;
+  EXPECT_EQ(1234, V2Schema::process_id(v2));
+  EXPECT_EQ(0xCAFE, V2Schema::image_checksum(v2));
+  EXPECT_EQ(0xF00D, V2Schema::time_date_stamp(v2));
+  EXPECT_EQ(v2.ImageFileName, V2Schema::image_file_name(v2));
+}
+
+TEST(KernelLogSchemaTest, ProcessInfoFields) {
+  EXPECT_FALSE(EventSchema<ProcessInfo32V1>::has_command_line);
+  EXPECT_TRUE(EventSchema<ProcessInfo32V2>::has_command_line);
+  EXPECT_TRUE(EventSchema<ProcessInfo64V3>::has_command_line);
+
+  ProcessInfo32V3 info = {};
+  info.ProcessId = 1;
+  info.ParentId = 2;
+  info.SessionId = 3;
+  info.ExitStatus = 4;
+  typedef EventSchema<ProcessInfo32V3> Schema;
+  EXPECT_EQ(1, Schema::process_id(info));
+  EXPECT_EQ(2, Schema::parent_id(info));
+  EXPECT_EQ(3, Schema::session_id(info));
+  EXPECT_EQ(4, Schema::exit_status(info));
+}
+
+TEST(KernelLogSchemaTest, ThreadInfoFields) {
+  ThreadInfoV1 info = {};
+  info.ProcessId = 1234;
+  info.ThreadId = 5678;
+  typedef EventSchema<ThreadInfoV1> Schema;
+  EXPECT_EQ(sizeof(info), Schema::fixed_size());
+  EXPECT_EQ(1234, Schema::process_id(info));
+  EXPECT_EQ(5678, Schema::thread_id(info));
+  EXPECT_TRUE(GetEvent<ThreadInfoV1>(&info, sizeof(info) - 1) == NULL);
+}
+
+}  // namespace
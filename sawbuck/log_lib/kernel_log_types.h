@@ -30,6 +30,16 @@ enum {
   kLogFileHeaderEvent = 0,
 };
 
+// The event groups of the hook ids in system trace headers, which stand
+// in for the event class GUIDs in events logged by the kernel.
+enum {
+  kEventTraceGroupHeader = 0x0000,
+  kEventTraceGroupMemory = 0x0200,
+  kEventTraceGroupProcess = 0x0300,
+  kEventTraceGroupThread = 0x0500,
+  kEventTraceGroupImage = 0x1000,
+};
+
 struct LogFileHeader32 {
   ULONG BufferSize;
   ULONG Version;
@@ -294,6 +304,27 @@ struct ProcessInfo64V3 {
   // ImageFileName, ItemWString
 };
 
+// Thread-related events.
+
+enum {
+  kThreadStartEvent = 1,
+  kThreadEndEvent = 2,
+  kThreadIsRunningEvent = 3,
+  kThreadCollectionEnded = 4,
+};
+
+DEFINE_GUID(kThreadEventClass,
+  0x3d6fa8d1, 0xfe05, 0x11d0, 0x9d, 0xda, 0x00, 0xc0, 0x4f, 0xd7, 0xba, 0x7c);
+
+// The leading fields of the thread start and end events of versions 1 to
+// 3, on 32 and 64 bit alike, which are all we read. Version 0 events have
+// them the other way around.
+struct ThreadInfoV1 {
+  ULONG ProcessId;  // ItemULong
+  ULONG ThreadId;  // ItemULong
+  // StackBase, StackLimit and so on, ItemPtr
+};
+
 }  // namespace kernel_log_types
 
 #endif  // SAWBUCK_LOG_LIB_KERNEL_LOG_TYPES_H_
@@ -0,0 +1,133 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Latency histogram implementation.
+#include "sawbuck/log_lib/latency_histogram.h"
+
+#include <algorithm>
+#include <string.h>
+#include "base/logging.h"
+
+namespace {
+
+// @returns the index of the highest bit set in @p value, which must not
+//     be zero.
+int HighestBit(uint64 value) {
+  DCHECK_NE(0U, value);
+  int bit = 0;
+  for (int shift = 32; shift > 0; shift /= 2) {
+    if (value >> shift) {
+      value >>= shift;
+      bit += shift;
+    }
+  }
+  return bit;
+}
+
+}  // namespace
+
+// static
+const size_t LatencyHistogram::kSubBucketCount;
+const size_t LatencyHistogram::kNumBuckets;
+
+LatencyHistogram::LatencyHistogram() {
+  Clear();
+}
+
+void LatencyHistogram::Record(int64 value) {
+  if (value < 0)
+    value = 0;
+
+  if (count_ == 0) {
+    min_ = value;
+    max_ = value;
+  } else {
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+  ++count_;
+  sum_ += value;
+  ++buckets_[GetBucket(value)];
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  if (other.count_ == 0)
+    return;
+
+  if (count_ == 0) {
+    min_ = other.min_;
+    max_ = other.max_;
+  } else {
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  for (size_t i = 0; i < kNumBuckets; ++i)
+    buckets_[i] += other.buckets_[i];
+}
+
+void LatencyHistogram::Clear() {
+  count_ = 0;
+  min_ = 0;
+  max_ = 0;
+  sum_ = 0;
+  memset(buckets_, 0, sizeof(buckets_));
+}
+
+int64 LatencyHistogram::GetPercentile(double percentile) const {
+  if (count_ == 0)
+    return 0;
+
+  // The rank of the value sought, counting from one.
+  percentile = std::min(std::max(percentile, 0.0), 100.0);
+  uint64 rank = static_cast<uint64>(percentile * count_ / 100.0 + 0.5);
+  rank = std::min(std::max(rank, static_cast<uint64>(1)), count_);
+
+  uint64 seen = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    seen += buckets_[i];
+    if (seen >= rank)
+      return std::max(min_, std::min(max_, GetBucketUpperBound(i)));
+  }
+
+  NOTREACHED();
+  return max_;
+}
+
+// static
+size_t LatencyHistogram::GetBucket(int64 value) {
+  DCHECK_LE(0, value);
+  uint64 v = static_cast<uint64>(value);
+  if (v < 2 * kSubBucketCount)
+    return static_cast<size_t>(v);
+
+  // Past the linear range, the top kSubBucketBits + 1 bits of the value
+  // pick the bucket within its power of two.
+  int shift = HighestBit(v) - kSubBucketBits;
+  size_t bucket = (shift + 1) * kSubBucketCount +
+      static_cast<size_t>(v >> shift) - kSubBucketCount;
+  return std::min(bucket, kNumBuckets - 1);
+}
+
+// static
+int64 LatencyHistogram::GetBucketUpperBound(size_t bucket) {
+  DCHECK_LT(bucket, kNumBuckets);
+  if (bucket < 2 * kSubBucketCount)
+    return bucket;
+
+  int shift = static_cast<int>(bucket / kSubBucketCount) - 1;
+  uint64 sub_bucket = bucket % kSubBucketCount + kSubBucketCount;
+  return static_cast<int64>(((sub_bucket + 1) << shift) - 1);
+}
@@ -0,0 +1,71 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Latency histogram declaration.
+#ifndef SAWBUCK_LOG_LIB_LATENCY_HISTOGRAM_H_
+#define SAWBUCK_LOG_LIB_LATENCY_HISTOGRAM_H_
+
+#include "base/basictypes.h"
+
+// A fixed-size histogram of non-negative values, such as span durations
+// in microseconds. Values below 2 * kSubBucketCount have a bucket each.
+// Above that, each power of two is split into kSubBucketCount buckets,
+// so every value is recorded to within a relative error of
+// 1 / kSubBucketCount. Values of 2^kMaxValueBits and up share the top
+// bucket. Histograms with the same layout merge by adding their buckets.
+class LatencyHistogram {
+ public:
+  static const int kSubBucketBits = 5;
+  static const size_t kSubBucketCount = 1 << kSubBucketBits;
+  static const int kMaxValueBits = 40;
+  static const size_t kNumBuckets =
+      (kMaxValueBits - kSubBucketBits + 1) * kSubBucketCount;
+
+  LatencyHistogram();
+
+  // Records @p value, which is clamped to zero if negative.
+  void Record(int64 value);
+
+  // Adds the values recorded in @p other to this histogram.
+  void Merge(const LatencyHistogram& other);
+
+  // Discards all recorded values.
+  void Clear();
+
+  // @returns the value at or below which @p percentile percent of the
+  //     recorded values fall, to within the histogram's precision, or
+  //     zero if no values are recorded. Never exceeds max().
+  int64 GetPercentile(double percentile) const;
+
+  // Accessors.
+  uint64 count() const { return count_; }
+  int64 min() const { return min_; }
+  int64 max() const { return max_; }
+  int64 sum() const { return sum_; }
+
+  // @returns the bucket @p value is recorded in.
+  static size_t GetBucket(int64 value);
+
+  // @returns the largest value recorded in bucket @p bucket.
+  static int64 GetBucketUpperBound(size_t bucket);
+
+ private:
+  uint64 count_;
+  int64 min_;
+  int64 max_;
+  int64 sum_;
+  uint64 buckets_[kNumBuckets];
+};
+
+#endif  // SAWBUCK_LOG_LIB_LATENCY_HISTOGRAM_H_
@@ -0,0 +1,134 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/log_lib/latency_histogram.h"
+
+#include <algorithm>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+
+// @returns the exact @p percentile of @p values, by the same rank rule
+//     as the histogram.
+int64 ExactPercentile(std::vector<int64> values, double percentile) {
+  std::sort(values.begin(), values.end());
+  size_t rank = static_cast<size_t>(percentile * values.size() / 100.0 + 0.5);
+  rank = std::min(std::max(rank, static_cast<size_t>(1)), values.size());
+  return values[rank - 1];
+}
+
+TEST(LatencyHistogramTest, Empty) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0U, histogram.count());
+  EXPECT_EQ(0, histogram.max());
+  EXPECT_EQ(0, histogram.GetPercentile(50.0));
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+  LatencyHistogram histogram;
+  for (int64 i = 1; i <= 50; ++i)
+    histogram.Record(i);
+
+  EXPECT_EQ(50U, histogram.count());
+  EXPECT_EQ(1, histogram.min());
+  EXPECT_EQ(50, histogram.max());
+  EXPECT_EQ(25 * 51, histogram.sum());
+  EXPECT_EQ(25, histogram.GetPercentile(50.0));
+  EXPECT_EQ(45, histogram.GetPercentile(90.0));
+  EXPECT_EQ(50, histogram.GetPercentile(99.0));
+  EXPECT_EQ(50, histogram.GetPercentile(100.0));
+  EXPECT_EQ(1, histogram.GetPercentile(0.0));
+}
+
+TEST(LatencyHistogramTest, NegativeValuesClampToZero) {
+  LatencyHistogram histogram;
+  histogram.Record(-10);
+  EXPECT_EQ(0, histogram.min());
+  EXPECT_EQ(0, histogram.GetPercentile(50.0));
+}
+
+TEST(LatencyHistogramTest, BucketsAreContiguous) {
+  EXPECT_EQ(0U, LatencyHistogram::GetBucket(0));
+  for (size_t i = 0; i + 1 < LatencyHistogram::kNumBuckets; ++i) {
+    int64 upper = LatencyHistogram::GetBucketUpperBound(i);
+    ASSERT_EQ(i, LatencyHistogram::GetBucket(upper));
+    ASSERT_EQ(i + 1, LatencyHistogram::GetBucket(upper + 1));
+  }
+
+  // Huge values share the top bucket.
+  EXPECT_EQ(LatencyHistogram::kNumBuckets - 1,
+            LatencyHistogram::GetBucket(kint64max));
+}
+
+TEST(LatencyHistogramTest, PercentilesWithinPrecision) {
+  LatencyHistogram histogram;
+  std::vector<int64> values;
+  uint32 state = 42;
+  for (size_t i = 0; i < 100000; ++i) {
+    state = state * 1103515245 + 12345;
+    // Spread the values over several orders of magnitude.
+    int64 value = static_cast<int64>(state >> 8) >> ((state >> 3) % 20);
+    values.push_back(value);
+    histogram.Record(value);
+  }
+
+  const double kPercentiles[] = { 1.0, 25.0, 50.0, 90.0, 99.0, 99.9 };
+  for (size_t i = 0; i < arraysize(kPercentiles); ++i) {
+    int64 expected = ExactPercentile(values, kPercentiles[i]);
+    int64 found = histogram.GetPercentile(kPercentiles[i]);
+    EXPECT_GE(found, expected);
+    EXPECT_LE(found - expected,
+              expected / static_cast<int64>(LatencyHistogram::kSubBucketCount))
+        << "Percentile " << kPercentiles[i];
+  }
+
+  EXPECT_EQ(*std::max_element(values.begin(), values.end()),
+            histogram.max());
+}
+
+TEST(LatencyHistogramTest, Merge) {
+  LatencyHistogram low;
+  LatencyHistogram high;
+  LatencyHistogram both;
+  for (int64 i = 0; i < 1000; ++i) {
+    low.Record(i);
+    high.Record(i + 1000000);
+    both.Record(i);
+    both.Record(i + 1000000);
+  }
+
+  LatencyHistogram merged;
+  merged.Merge(low);
+  merged.Merge(high);
+  merged.Merge(LatencyHistogram());
+  EXPECT_EQ(both.count(), merged.count());
+  EXPECT_EQ(both.min(), merged.min());
+  EXPECT_EQ(both.max(), merged.max());
+  EXPECT_EQ(both.sum(), merged.sum());
+  EXPECT_EQ(both.GetPercentile(50.0), merged.GetPercentile(50.0));
+  EXPECT_EQ(both.GetPercentile(99.0), merged.GetPercentile(99.0));
+}
+
+TEST(LatencyHistogramTest, Clear) {
+  LatencyHistogram histogram;
+  histogram.Record(100);
+  histogram.Clear();
+  EXPECT_EQ(0U, histogram.count());
+  EXPECT_EQ(0, histogram.GetPercentile(50.0));
+
+  histogram.Record(5);
+  EXPECT_EQ(5, histogram.min());
+}
+
+}  // namespace
@@ -21,10 +21,78 @@
 #include "sawbuck/common/buffer_parser.h"
 #include <initguid.h>  // NOLINT - must be last include.
 
-LogParser::LogParser() : log_event_sink_(NULL), trace_event_sink_(NULL) {
+namespace {
+
+// Marks a NULL pointer in a batched message.
+const size_t kNoOffset = static_cast<size_t>(-1);
+
+// @returns the offset of @p ptr in the copy of @p event's data at
+//     @p data_offset.
+size_t OffsetInCopy(const EVENT_TRACE* event, size_t data_offset,
+                    const void* ptr) {
+  if (ptr == NULL)
+    return kNoOffset;
+
+  const char* data = reinterpret_cast<const char*>(event->MofData);
+  const char* p = reinterpret_cast<const char*>(ptr);
+  DCHECK(p >= data && p <= data + event->MofLength);
+
+  return data_offset + (p - data);
+}
+
+const char* PointerInCopy(const std::vector<char>& batch_data,
+                          size_t offset) {
+  if (offset == kNoOffset || batch_data.empty())
+    return NULL;
+
+  return &batch_data[0] + offset;
+}
+
+}  // namespace
+
+void LogEvents::OnLogMessages(const LogMessage* log_messages, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    OnLogMessage(log_messages[i]);
+}
+
+void TraceEvents::OnTraceEvents(const TraceEvent* trace_events,
+                                size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    const TraceEvent& trace_event = trace_events[i];
+    switch (trace_event.type) {
+      case TRACE_EVENT_TYPE_BEGIN:
+        OnTraceEventBegin(trace_event.message);
+        break;
+      case TRACE_EVENT_TYPE_END:
+        OnTraceEventEnd(trace_event.message);
+        break;
+      case TRACE_EVENT_TYPE_INSTANT:
+        OnTraceEventInstant(trace_event.message);
+        break;
+      default:
+        NOTREACHED() << "Unknown trace event type " << trace_event.type;
+        break;
+    }
+  }
+}
+
+LogParser::LogParser()
+    : log_event_sink_(NULL),
+      trace_event_sink_(NULL),
+      filter_(NULL),
+      batch_mode_(false) {
 }
 
 LogParser::~LogParser() {
+  DCHECK(batched_log_messages_.empty());
+  DCHECK(batched_trace_events_.empty());
+}
+
+void LogParser::set_batch_mode(bool batch_mode) {
+  if (batch_mode_ && !batch_mode)
+    FlushBatch();
+
+  batch_mode_ = batch_mode;
 }
 
 bool LogParser::ProcessOneEvent(EVENT_TRACE* event) {
@@ -47,6 +115,10 @@ bool LogParser::ParseLogEvent(EVENT_TRACE* event) {
   if (log_event_sink_ == NULL)
     return false;
 
+  // Nor for events the filter rules out from the header alone.
+  if (filter_ != NULL && !filter_->MatchesHeader(event->Header))
+    return true;
+
   BinaryBufferReader reader(event->MofData, event->MofLength);
   LogEvents::LogMessage msg;
 
@@ -59,7 +131,7 @@ bool LogParser::ParseLogEvent(EVENT_TRACE* event) {
   if (event->Header.Class.Type == logging::LOG_MESSAGE &&
       event->Header.Class.Version == 0) {
     if (reader.ReadString(&msg.message, &msg.message_len)) {
-      log_event_sink_->OnLogMessage(msg);
+      IssueLogMessage(event, msg);
     } else {
       DLOG(ERROR) << "Failed to read message from event";
     }
@@ -77,7 +149,7 @@ bool LogParser::ParseLogEvent(EVENT_TRACE* event) {
         reader.Read(*depth * sizeof(void*), &msg.traces) &&
         reader.ReadString(&msg.message, &msg.message_len)) {
       msg.trace_depth = *depth;
-      log_event_sink_->OnLogMessage(msg);
+      IssueLogMessage(event, msg);
     } else {
       DLOG(ERROR) << "Failed to read stack trace or message from event";
     }
@@ -102,7 +174,7 @@ bool LogParser::ParseLogEvent(EVENT_TRACE* event) {
       msg.trace_depth = *depth;
       msg.line = *line;
 
-      log_event_sink_->OnLogMessage(msg);
+      IssueLogMessage(event, msg);
 
       // Event is handled.
       return true;
@@ -138,6 +210,9 @@ bool LogParser::ParseTraceEvent(EVENT_TRACE* event) {
     return false;
   }
 
+  if (filter_ != NULL && !filter_->MatchesHeader(event->Header))
+    return true;
+
   TraceEvents::TraceMessage trace;
 
   trace.time = base::Time::FromFileTime(
@@ -154,20 +229,23 @@ bool LogParser::ParseTraceEvent(EVENT_TRACE* event) {
     DCHECK(id != NULL);
     trace.id = *id;
 
+    TraceEvents::TraceEvent trace_event;
     switch (event->Header.Class.Type) {
       case base::debug::kTraceEventTypeBegin:
-        trace_event_sink_->OnTraceEventBegin(trace);
+        trace_event.type = TraceEvents::TRACE_EVENT_TYPE_BEGIN;
         break;
       case base::debug::kTraceEventTypeEnd:
-        trace_event_sink_->OnTraceEventEnd(trace);
+        trace_event.type = TraceEvents::TRACE_EVENT_TYPE_END;
         break;
       case base::debug::kTraceEventTypeInstant:
-        trace_event_sink_->OnTraceEventInstant(trace);
+        trace_event.type = TraceEvents::TRACE_EVENT_TYPE_INSTANT;
         break;
       default:
         NOTREACHED();
         break;
     }
+    trace_event.message = trace;
+    IssueTraceEvent(event, trace_event);
 
     return true;
   }
@@ -175,16 +253,118 @@ bool LogParser::ParseTraceEvent(EVENT_TRACE* event) {
   return false;
 }
 
+void LogParser::IssueLogMessage(EVENT_TRACE* event,
+                                const LogEvents::LogMessage& msg) {
+  DCHECK(log_event_sink_ != NULL);
+  if (filter_ != NULL && !filter_->MatchesLogMessage(msg))
+    return;
+
+  if (!batch_mode_) {
+    log_event_sink_->OnLogMessage(msg);
+    return;
+  }
+
+  // Issue the trace events parsed before this message first.
+  if (!batched_trace_events_.empty())
+    FlushBatch();
+
+  size_t data_offset = CopyEventData(event);
+  BatchedLogMessage batched;
+  batched.message = msg;
+  batched.message_offset = OffsetInCopy(event, data_offset, msg.message);
+  batched.file_offset = OffsetInCopy(event, data_offset, msg.file);
+  batched.traces_offset = OffsetInCopy(event, data_offset, msg.traces);
+  batched_log_messages_.push_back(batched);
+}
+
+void LogParser::IssueTraceEvent(EVENT_TRACE* event,
+                                const TraceEvents::TraceEvent& trace_event) {
+  DCHECK(trace_event_sink_ != NULL);
+  if (filter_ != NULL && !filter_->MatchesTraceMessage(trace_event.message))
+    return;
+
+  if (!batch_mode_) {
+    trace_event_sink_->OnTraceEvents(&trace_event, 1);
+    return;
+  }
+
+  // Issue the log messages parsed before this event first.
+  if (!batched_log_messages_.empty())
+    FlushBatch();
+
+  const TraceEvents::TraceMessage& trace = trace_event.message;
+  size_t data_offset = CopyEventData(event);
+  BatchedTraceEvent batched;
+  batched.event = trace_event;
+  batched.name_offset = OffsetInCopy(event, data_offset, trace.name);
+  batched.extra_offset = OffsetInCopy(event, data_offset, trace.extra);
+  batched.traces_offset = OffsetInCopy(event, data_offset, trace.traces);
+  batched_trace_events_.push_back(batched);
+}
+
+size_t LogParser::CopyEventData(EVENT_TRACE* event) {
+  size_t offset = batch_data_.size();
+  const char* data = reinterpret_cast<const char*>(event->MofData);
+  batch_data_.insert(batch_data_.end(), data, data + event->MofLength);
+
+  return offset;
+}
+
+void LogParser::FlushBatch() {
+  if (!batched_log_messages_.empty()) {
+    DCHECK(log_event_sink_ != NULL);
+
+    flush_log_messages_.resize(batched_log_messages_.size());
+    for (size_t i = 0; i < batched_log_messages_.size(); ++i) {
+      const BatchedLogMessage& batched = batched_log_messages_[i];
+      LogEvents::LogMessage& msg = flush_log_messages_[i];
+      msg = batched.message;
+      msg.message = PointerInCopy(batch_data_, batched.message_offset);
+      msg.file = PointerInCopy(batch_data_, batched.file_offset);
+      msg.traces = reinterpret_cast<void* const*>(
+          PointerInCopy(batch_data_, batched.traces_offset));
+    }
+
+    log_event_sink_->OnLogMessages(&flush_log_messages_[0],
+                                   flush_log_messages_.size());
+  }
+
+  if (!batched_trace_events_.empty()) {
+    DCHECK(trace_event_sink_ != NULL);
+
+    flush_trace_events_.resize(batched_trace_events_.size());
+    for (size_t i = 0; i < batched_trace_events_.size(); ++i) {
+      const BatchedTraceEvent& batched = batched_trace_events_[i];
+      TraceEvents::TraceEvent& trace_event = flush_trace_events_[i];
+      trace_event = batched.event;
+      TraceEvents::TraceMessage& trace = trace_event.message;
+      trace.name = PointerInCopy(batch_data_, batched.name_offset);
+      trace.extra = PointerInCopy(batch_data_, batched.extra_offset);
+      trace.traces = reinterpret_cast<void* const*>(
+          PointerInCopy(batch_data_, batched.traces_offset));
+    }
+
+    trace_event_sink_->OnTraceEvents(&flush_trace_events_[0],
+                                     flush_trace_events_.size());
+  }
+
+  batch_data_.clear();
+  batched_log_messages_.clear();
+  batched_trace_events_.clear();
+}
+
 LogConsumer* LogConsumer::current_ = NULL;
 
 LogConsumer::LogConsumer() {
   DCHECK(current_ == NULL);
 
   current_ = this;
+  set_batch_mode(true);
 }
 
 LogConsumer::~LogConsumer() {
   DCHECK(current_ == this);
+  FlushBatch();
   current_ = NULL;
 }
 
@@ -193,6 +373,14 @@ void LogConsumer::ProcessEvent(PEVENT_TRACE event) {
   current_->ProcessOneEvent(event);
 }
 
+bool LogConsumer::ProcessBuffer(EVENT_TRACE_LOGFILE* buffer) {
+  DCHECK(current_ != NULL);
+  current_->FlushBatch();
+
+  // Keep going.
+  return true;
+}
+
 DWORD WINAPI LogConsumer::ThreadProc(LPVOID param) {
   LogConsumer* consumer = reinterpret_cast<LogConsumer*>(param);
 
@@ -16,6 +16,7 @@
 #ifndef SAWBUCK_LOG_LIB_LOG_CONSUMER_H_
 #define SAWBUCK_LOG_LIB_LOG_CONSUMER_H_
 
+#include <vector>
 #include "base/time/time.h"
 #include "base/win/event_trace_consumer.h"
 
@@ -54,6 +55,12 @@ class LogEvents {
   // Note: log_message is not valid beyond the call, any strings
   //    you need to hold on to must be copied.
   virtual void OnLogMessage(const LogMessage& log_message) = 0;
+
+  // Issued for batches of log messages, in order. The default
+  // implementation issues OnLogMessage for each message, sinks that
+  // lock or notify per message can override this to do so per batch.
+  // Note: log_messages are not valid beyond the call.
+  virtual void OnLogMessages(const LogMessage* log_messages, size_t count);
 };
 
 // Implemented by clients of LogParser to receive trace message notifications.
@@ -70,12 +77,47 @@ class TraceEvents {
     const char* extra;
   };
 
+  enum TraceEventType {
+    TRACE_EVENT_TYPE_BEGIN,
+    TRACE_EVENT_TYPE_END,
+    TRACE_EVENT_TYPE_INSTANT,
+  };
+
+  struct TraceEvent {
+    TraceEvent() : type(TRACE_EVENT_TYPE_INSTANT) {
+    }
+
+    TraceEventType type;
+    TraceMessage message;
+  };
+
   // Issued for trace events.
   // Note: trace_message is not valid beyond the call, any strings
   //    you need to hold on to must be copied.
   virtual void OnTraceEventBegin(const TraceMessage& trace_message) = 0;
   virtual void OnTraceEventEnd(const TraceMessage& trace_message) = 0;
   virtual void OnTraceEventInstant(const TraceMessage& trace_message) = 0;
+
+  // Issued for batches of trace events, in order. The default
+  // implementation dispatches each event to the callbacks above.
+  // Note: trace_events are not valid beyond the call.
+  virtual void OnTraceEvents(const TraceEvent* trace_events, size_t count);
+};
+
+// Implemented by clients of LogParser to drop messages as they're parsed,
+// before they're copied or issued. Filters are invoked on the threads
+// events are parsed on, and so must be thread safe.
+class LogMessageFilter {
+ public:
+  // @returns false iff no message with @p header can match, in which case
+  //     the event's data isn't parsed at all.
+  virtual bool MatchesHeader(const EVENT_TRACE_HEADER& header) const = 0;
+
+  // @returns true iff @p log_message or @p trace_message match.
+  virtual bool MatchesLogMessage(
+      const LogEvents::LogMessage& log_message) const = 0;
+  virtual bool MatchesTraceMessage(
+      const TraceEvents::TraceMessage& trace_message) const = 0;
 };
 
 class LogParser {
@@ -83,24 +125,79 @@ class LogParser {
   LogParser();
   ~LogParser();
 
+  LogEvents* event_sink() const { return log_event_sink_; }
   void set_event_sink(LogEvents* log_event_sink){
     log_event_sink_ = log_event_sink;
   }
+  TraceEvents* trace_sink() const { return trace_event_sink_; }
   void set_trace_sink(TraceEvents* trace_event_sink){
     trace_event_sink_ = trace_event_sink;
   }
 
+  // Only messages that match the filter, if one is set, are issued.
+  const LogMessageFilter* filter() const { return filter_; }
+  void set_filter(const LogMessageFilter* filter) { filter_ = filter; }
+
+  // In batch mode, parsed messages are held back until FlushBatch, and
+  // then issued through OnLogMessages and OnTraceEvents. The event data
+  // is copied, so events need not outlive ProcessOneEvent.
+  bool batch_mode() const { return batch_mode_; }
+  void set_batch_mode(bool batch_mode);
+
   bool ProcessOneEvent(EVENT_TRACE* event);
 
+  // Issues the messages held back in batch mode to our sinks, in the
+  // order they were parsed.
+  void FlushBatch();
+
  private:
+  // A log message held back in batch mode. The pointers in message are
+  // stored as offsets into batch_data_ until the batch is flushed.
+  struct BatchedLogMessage {
+    LogEvents::LogMessage message;
+    size_t message_offset;
+    size_t file_offset;
+    size_t traces_offset;
+  };
+
+  // A trace event held back in batch mode, as above.
+  struct BatchedTraceEvent {
+    TraceEvents::TraceEvent event;
+    size_t name_offset;
+    size_t extra_offset;
+    size_t traces_offset;
+  };
+
   bool ParseLogEvent(EVENT_TRACE* event);
   bool ParseTraceEvent(EVENT_TRACE* event);
 
+  // Issues or batches a parsed message.
+  void IssueLogMessage(EVENT_TRACE* event, const LogEvents::LogMessage& msg);
+  void IssueTraceEvent(EVENT_TRACE* event,
+                       const TraceEvents::TraceEvent& trace_event);
+
+  // Copies the data of @p event to batch_data_.
+  // @returns the offset of the copy.
+  size_t CopyEventData(EVENT_TRACE* event);
+
   // Our log event sink.
   LogEvents* log_event_sink_;
 
   // Our trace event sink.
   TraceEvents* trace_event_sink_;
+
+  // Our filter, if any.
+  const LogMessageFilter* filter_;
+
+  // Batch mode state. A batch holds only log messages or only trace
+  // events, so that the two kinds are issued in the order they were parsed.
+  bool batch_mode_;
+  std::vector<char> batch_data_;
+  std::vector<BatchedLogMessage> batched_log_messages_;
+  std::vector<BatchedTraceEvent> batched_trace_events_;
+  // Scratch space for flushing, kept to amortize allocations.
+  std::vector<LogEvents::LogMessage> flush_log_messages_;
+  std::vector<TraceEvents::TraceEvent> flush_trace_events_;
 };
 
 class LogConsumer
@@ -112,6 +209,8 @@ class LogConsumer
 
   static DWORD WINAPI ThreadProc(LPVOID param);
   static void ProcessEvent(EVENT_TRACE* event);
+  // Flushes the messages batched from each buffer.
+  static bool ProcessBuffer(EVENT_TRACE_LOGFILE* buffer);
  private:
   static LogConsumer* current_;
 };
@@ -14,6 +14,8 @@
 #include "sawbuck/log_lib/log_consumer.h"
 
 #include <cguid.h>
+#include <string>
+#include "base/debug/trace_event_win.h"
 #include "base/logging_win.h"
 #include "base/time/time.h"
 #include "gtest/gtest.h"
@@ -33,6 +35,8 @@ using testing::ElementsAreArray;
 using testing::Field;
 using testing::IsNull;
 using testing::NotNull;
+using testing::Pointee;
+using testing::Return;
 using testing::StrictMock;
 using testing::StrEq;
 
@@ -41,6 +45,44 @@ class MockLogEvents: public LogEvents {
   MOCK_METHOD1(OnLogMessage, void(const LogEvents::LogMessage& msg));
 };
 
+class MockBatchLogEvents: public LogEvents {
+ public:
+  MOCK_METHOD1(OnLogMessage, void(const LogEvents::LogMessage& msg));
+  MOCK_METHOD2(OnLogMessages, void(const LogEvents::LogMessage* msgs,
+                                   size_t count));
+};
+
+// Records the kind of each event issued to it, in order.
+class EventOrderRecorder : public LogEvents, public TraceEvents {
+ public:
+  virtual void OnLogMessage(const LogEvents::LogMessage& msg) {
+    order_.push_back('L');
+  }
+  virtual void OnTraceEventBegin(const TraceMessage& trace_message) {
+    order_.push_back('B');
+  }
+  virtual void OnTraceEventEnd(const TraceMessage& trace_message) {
+    order_.push_back('E');
+  }
+  virtual void OnTraceEventInstant(const TraceMessage& trace_message) {
+    order_.push_back('I');
+  }
+
+  const std::string& order() const { return order_; }
+
+ private:
+  std::string order_;
+};
+
+class MockLogMessageFilter : public LogMessageFilter {
+ public:
+  MOCK_CONST_METHOD1(MatchesHeader, bool(const EVENT_TRACE_HEADER& header));
+  MOCK_CONST_METHOD1(MatchesLogMessage,
+                     bool(const LogEvents::LogMessage& log_message));
+  MOCK_CONST_METHOD1(MatchesTraceMessage,
+                     bool(const TraceEvents::TraceMessage& trace_message));
+};
+
 class EventTrace: public EVENT_TRACE {
  public:
   EventTrace(const GUID& provider_name, UCHAR type, UCHAR level,
@@ -121,6 +163,31 @@ TEST_F(LogParserTest, ParseLogEvent) {
   EXPECT_TRUE(parser_.ProcessOneEvent(&log_msg_));
 }
 
+TEST_F(LogParserTest, FilterRejectsFromHeader) {
+  StrictMock<MockLogMessageFilter> filter;
+  parser_.set_filter(&filter);
+
+  // The event is handled, but neither parsed further nor issued.
+  EXPECT_CALL(filter, MatchesHeader(_)).WillOnce(Return(false));
+  EXPECT_TRUE(parser_.ProcessOneEvent(&log_msg_));
+}
+
+TEST_F(LogParserTest, FilterRejectsParsedMessage) {
+  StrictMock<MockLogMessageFilter> filter;
+  parser_.set_filter(&filter);
+
+  EXPECT_CALL(filter, MatchesHeader(_)).WillOnce(Return(true));
+  EXPECT_CALL(filter, MatchesLogMessage(
+      Field(&LogEvents::LogMessage::message, StrEq(kMsgText))))
+          .WillOnce(Return(false));
+  EXPECT_TRUE(parser_.ProcessOneEvent(&log_msg_));
+
+  EXPECT_CALL(filter, MatchesHeader(_)).WillOnce(Return(true));
+  EXPECT_CALL(filter, MatchesLogMessage(_)).WillOnce(Return(true));
+  EXPECT_CALL(events_, OnLogMessage(_));
+  EXPECT_TRUE(parser_.ProcessOneEvent(&log_msg_));
+}
+
 TEST_F(LogParserTest, ParseLogEventWithStackTrace) {
   void* backtrace[32];
   int depth = ::CaptureStackBackTrace(0,
@@ -163,4 +230,80 @@ TEST_F(LogParserTest, ParseLogEventWithStackTrace) {
   EXPECT_TRUE(parser_.ProcessOneEvent(&log_msg_));
 }
 
+TEST_F(LogParserTest, BatchModeHoldsMessagesUntilFlush) {
+  char text[sizeof(kMsgText)];
+  memcpy(text, kMsgText, sizeof(kMsgText));
+  log_msg_.MofData = text;
+
+  parser_.set_batch_mode(true);
+  EXPECT_TRUE(parser_.ProcessOneEvent(&log_msg_));
+
+  // The batched message must not refer to the event data.
+  memset(text, 'X', sizeof(text) - 1);
+
+  // The default OnLogMessages implementation forwards to OnLogMessage.
+  typedef LogEvents::LogMessage Msg;
+  EXPECT_CALL(events_, OnLogMessage(AllOf(
+      Field(&Msg::process_id, ::GetCurrentProcessId()),
+      Field(&Msg::message_len, strlen(kMsgText)),
+      Field(&Msg::message, StrEq(kMsgText)))))
+      .Times(1);
+
+  parser_.FlushBatch();
+
+  // Nothing more to flush.
+  parser_.FlushBatch();
+}
+
+TEST_F(LogParserTest, BatchModeIssuesBatches) {
+  StrictMock<MockBatchLogEvents> batch_events;
+  parser_.set_event_sink(&batch_events);
+  parser_.set_batch_mode(true);
+
+  const size_t kNumMessages = 3;
+  for (size_t i = 0; i < kNumMessages; ++i)
+    EXPECT_TRUE(parser_.ProcessOneEvent(&log_msg_));
+
+  typedef LogEvents::LogMessage Msg;
+  EXPECT_CALL(batch_events, OnLogMessages(
+      Pointee(Field(&Msg::message, StrEq(kMsgText))), kNumMessages))
+      .Times(1);
+
+  // Turning batch mode off flushes the batch.
+  parser_.set_batch_mode(false);
+
+  // Out of batch mode, messages are issued singly.
+  EXPECT_CALL(batch_events, OnLogMessage(
+      Field(&Msg::message, StrEq(kMsgText))))
+      .Times(1);
+  EXPECT_TRUE(parser_.ProcessOneEvent(&log_msg_));
+}
+
+TEST_F(LogParserTest, BatchModeKeepsLogAndTraceEventsInOrder) {
+  EventOrderRecorder recorder;
+  parser_.set_event_sink(&recorder);
+  parser_.set_trace_sink(&recorder);
+  parser_.set_batch_mode(true);
+
+  // A trace event's data is its name, its id and its extra data.
+  char trace_data[sizeof("Span") + sizeof(void*) + 1] = "Span";
+  memset(trace_data + sizeof("Span"), 0, sizeof(void*) + 1);
+  EventTrace begin(base::debug::kTraceEventClass32,
+                   base::debug::kTraceEventTypeBegin, TRACE_LEVEL_INFORMATION,
+                   ::GetCurrentProcessId(), ::GetCurrentThreadId(),
+                   base::Time::Now(), sizeof(trace_data), trace_data);
+  EventTrace end(begin);
+  end.Header.Class.Type = base::debug::kTraceEventTypeEnd;
+
+  EXPECT_TRUE(parser_.ProcessOneEvent(&log_msg_));
+  EXPECT_TRUE(parser_.ProcessOneEvent(&begin));
+  EXPECT_TRUE(parser_.ProcessOneEvent(&log_msg_));
+  EXPECT_TRUE(parser_.ProcessOneEvent(&log_msg_));
+  EXPECT_TRUE(parser_.ProcessOneEvent(&end));
+  EXPECT_TRUE(parser_.ProcessOneEvent(&begin));
+  parser_.FlushBatch();
+
+  EXPECT_EQ("LBLLEB", recorder.order());
+}
+
 }  // namespace
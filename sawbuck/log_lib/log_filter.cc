@@ -0,0 +1,302 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Log filter implementation.
+#include "sawbuck/log_lib/log_filter.h"
+
+#include <vector>
+#include "base/json/json_reader.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/values.h"
+#include "pcrecpp.h"  // NOLINT
+
+namespace {
+
+const size_t kNumLevels = 256;
+
+// @returns the name the viewer shows for @p level.
+const char* GetSeverityText(UCHAR level) {
+  switch (level) {
+    case TRACE_LEVEL_NONE:
+      return "NONE";
+    case TRACE_LEVEL_FATAL:
+      return "FATAL";
+    case TRACE_LEVEL_ERROR:
+      return "ERROR";
+    case TRACE_LEVEL_WARNING:
+      return "WARNING";
+    case TRACE_LEVEL_INFORMATION:
+      return "INFORMATION";
+    case TRACE_LEVEL_VERBOSE:
+      return "VERBOSE";
+    case TRACE_LEVEL_RESERVED6:
+      return "RESERVED6";
+    case TRACE_LEVEL_RESERVED7:
+      return "RESERVED7";
+    case TRACE_LEVEL_RESERVED8:
+      return "RESERVED8";
+    case TRACE_LEVEL_RESERVED9:
+      return "RESERVED9";
+  }
+
+  return "UNKNOWN";
+}
+
+// @returns @p time as the viewer shows it.
+std::string FormatTime(const base::Time& time) {
+  base::Time::Exploded exploded;
+  time.LocalExplode(&exploded);
+  return base::StringPrintf("%02d:%02d:%02d-%03d",
+                            exploded.hour,
+                            exploded.minute,
+                            exploded.second,
+                            exploded.millisecond);
+}
+
+}  // namespace
+
+struct LogFilter::Predicate {
+  Predicate(Column column, Relation relation, const std::string& value)
+      : column(column), relation(relation), value(value), int_value(0) {
+  }
+
+  // @returns true iff @p check_value matches, as the viewer matches
+  //     numbers.
+  bool MatchesInt(int check_value) const {
+    if (relation == IS)
+      return check_value == int_value;
+
+    return base::IntToString(check_value).find(value) != std::string::npos;
+  }
+
+  // @returns true iff @p check_string matches.
+  bool MatchesString(const base::StringPiece& check_string) const {
+    DCHECK(re.get() != NULL);
+    pcrecpp::StringPiece subject(check_string.data(), check_string.size());
+    if (relation == IS)
+      return re->FullMatch(subject);
+
+    return re->PartialMatch(subject);
+  }
+
+  // @returns true iff this predicate needs the parsed event.
+  bool NeedsEventData() const {
+    return column == FILE || column == LINE || column == MESSAGE;
+  }
+
+  Column column;
+  Relation relation;
+  std::string value;
+
+  // The value as a number, for the process id, thread id and line.
+  int int_value;
+  // The value as a regular expression, for the time, file and message.
+  scoped_ptr<pcrecpp::RE> re;
+  // Whether each level matches, for the severity.
+  std::vector<bool> level_matches;
+};
+
+LogFilter::LogFilter() {
+}
+
+LogFilter::~LogFilter() {
+}
+
+void LogFilter::AddFilter(Column column,
+                          Relation relation,
+                          Action action,
+                          const std::string& value) {
+  DCHECK_LT(column, NUM_COLUMNS);
+  DCHECK_LT(relation, NUM_RELATIONS);
+  DCHECK_LT(action, NUM_ACTIONS);
+
+  scoped_ptr<Predicate> predicate(new Predicate(column, relation, value));
+  switch (column) {
+    case PROCESS_ID:
+    case THREAD_ID:
+    case LINE:
+      // As in the viewer, values that aren't numbers match as far as
+      // they parse.
+      base::StringToInt(value, &predicate->int_value);
+      break;
+
+    case SEVERITY:
+    case TIME:
+    case FILE:
+    case MESSAGE:
+      predicate->re.reset(new pcrecpp::RE(value.c_str(),
+          PCRE_NEWLINE_ANYCRLF | PCRE_DOTALL | PCRE_UTF8 | PCRE_CASELESS));
+      break;
+
+    default:
+      NOTREACHED() << "Invalid column type in filter!";
+      break;
+  }
+
+  // The severity is matched by name, so match each level's name once.
+  if (column == SEVERITY) {
+    predicate->level_matches.resize(kNumLevels);
+    for (size_t i = 0; i < kNumLevels; ++i) {
+      predicate->level_matches[i] =
+          predicate->MatchesString(GetSeverityText(static_cast<UCHAR>(i)));
+    }
+  }
+
+  if (action == INCLUDE)
+    includes_.push_back(predicate.release());
+  else
+    excludes_.push_back(predicate.release());
+}
+
+bool LogFilter::AddSerializedFilters(const std::string& serialized) {
+  scoped_ptr<base::Value> parsed_value(
+      base::JSONReader::Read(serialized, true));
+  if (parsed_value.get() == NULL ||
+      !parsed_value->IsType(base::Value::TYPE_LIST)) {
+    LOG(ERROR) << "Failed to parse filter list: " << serialized;
+    return false;
+  }
+
+  const base::ListValue* filters =
+      static_cast<const base::ListValue*>(parsed_value.get());
+  for (size_t i = 0; i < filters->GetSize(); ++i) {
+    const base::DictionaryValue* filter = NULL;
+    std::string value;
+    int column = -1;
+    int relation = -1;
+    int action = -1;
+    if (!filters->GetDictionary(i, &filter) ||
+        !filter->GetString("value", &value) ||
+        !filter->GetInteger("column", &column) ||
+        !filter->GetInteger("relation", &relation) ||
+        !filter->GetInteger("action", &action) ||
+        column < 0 || column >= NUM_COLUMNS ||
+        relation < 0 || relation >= NUM_RELATIONS ||
+        action < 0 || action >= NUM_ACTIONS) {
+      LOG(ERROR) << "Bad filter " << i << " in filter list.";
+      return false;
+    }
+
+    AddFilter(static_cast<Column>(column),
+              static_cast<Relation>(relation),
+              static_cast<Action>(action),
+              value);
+  }
+
+  return true;
+}
+
+void LogFilter::SetTimeRange(const base::Time& start, const base::Time& end) {
+  start_time_ = start;
+  end_time_ = end;
+}
+
+bool LogFilter::empty() const {
+  return includes_.empty() && excludes_.empty() &&
+      start_time_.is_null() && end_time_.is_null();
+}
+
+bool LogFilter::MatchesHeader(const EVENT_TRACE_HEADER& header) const {
+  Fields fields;
+  fields.level = header.Class.Level;
+  fields.process_id = header.ProcessId;
+  fields.thread_id = header.ThreadId;
+  fields.time = base::Time::FromFileTime(
+      reinterpret_cast<const FILETIME&>(header.TimeStamp));
+
+  return Matches(fields, true);
+}
+
+bool LogFilter::MatchesLogMessage(
+    const LogEvents::LogMessage& log_message) const {
+  Fields fields;
+  fields.level = log_message.level;
+  fields.process_id = log_message.process_id;
+  fields.thread_id = log_message.thread_id;
+  fields.time = log_message.time;
+  if (log_message.file != NULL)
+    fields.file.set(log_message.file, log_message.file_len);
+  fields.line = log_message.line;
+  fields.message.set(log_message.message, log_message.message_len);
+
+  return Matches(fields, false);
+}
+
+bool LogFilter::MatchesTraceMessage(
+    const TraceEvents::TraceMessage& trace_message) const {
+  Fields fields;
+  fields.level = trace_message.level;
+  fields.process_id = trace_message.process_id;
+  fields.thread_id = trace_message.thread_id;
+  fields.time = trace_message.time;
+  fields.message.set(trace_message.name, trace_message.name_len);
+
+  return Matches(fields, false);
+}
+
+bool LogFilter::Matches(const Fields& fields, bool header_only) const {
+  if (!start_time_.is_null() && fields.time < start_time_)
+    return false;
+  if (!end_time_.is_null() && fields.time >= end_time_)
+    return false;
+
+  for (size_t i = 0; i < excludes_.size(); ++i) {
+    if (header_only && excludes_[i]->NeedsEventData())
+      continue;
+    if (PredicateMatches(*excludes_[i], fields))
+      return false;
+  }
+
+  if (includes_.empty())
+    return true;
+
+  bool undecided = false;
+  for (size_t i = 0; i < includes_.size(); ++i) {
+    if (header_only && includes_[i]->NeedsEventData()) {
+      undecided = true;
+      continue;
+    }
+    if (PredicateMatches(*includes_[i], fields))
+      return true;
+  }
+
+  return undecided;
+}
+
+// static
+bool LogFilter::PredicateMatches(const Predicate& predicate,
+                                 const Fields& fields) {
+  switch (predicate.column) {
+    case SEVERITY:
+      return predicate.level_matches[fields.level];
+    case PROCESS_ID:
+      return predicate.MatchesInt(fields.process_id);
+    case THREAD_ID:
+      return predicate.MatchesInt(fields.thread_id);
+    case TIME:
+      return predicate.MatchesString(FormatTime(fields.time));
+    case FILE:
+      return predicate.MatchesString(fields.file);
+    case LINE:
+      return predicate.MatchesInt(fields.line);
+    case MESSAGE:
+      return predicate.MatchesString(fields.message);
+    default:
+      NOTREACHED() << "Invalid column type in filter!";
+      return false;
+  }
+}
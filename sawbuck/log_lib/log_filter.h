@@ -0,0 +1,130 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Log filter declaration.
+#ifndef SAWBUCK_LOG_LIB_LOG_FILTER_H_
+#define SAWBUCK_LOG_LIB_LOG_FILTER_H_
+
+#include <string>
+#include "base/basictypes.h"
+#include "base/memory/scoped_vector.h"
+#include "base/strings/string_piece.h"
+#include "base/time/time.h"
+#include "sawbuck/log_lib/log_consumer.h"
+
+// Matches log and trace messages against filters like those the viewer
+// keeps, which can be read in the form Filter::SerializeFilters writes
+// them, and against an optional time range. As in the viewer, a message
+// matches if it matches any of the include filters, or there are none,
+// and none of the exclude filters.
+//
+// The severity, process id, thread id and time filters, and the time
+// range, are decided from the event header, so events they rule out are
+// never parsed. Trace messages have their name matched as the message,
+// and have no file or line.
+class LogFilter : public LogMessageFilter {
+ public:
+  // These must match Filter::Column, Filter::Relation and Filter::Action
+  // in the viewer.
+  enum Column {
+    SEVERITY,
+    PROCESS_ID,
+    THREAD_ID,
+    TIME,
+    FILE,
+    LINE,
+    MESSAGE,
+    NUM_COLUMNS
+  };
+
+  enum Relation {
+    IS,
+    CONTAINS,
+    NUM_RELATIONS
+  };
+
+  enum Action {
+    INCLUDE,
+    EXCLUDE,
+    NUM_ACTIONS
+  };
+
+  LogFilter();
+  ~LogFilter();
+
+  // Adds a filter.
+  // @param value a case insensitive regular expression for the severity,
+  //     time, file and message columns, and a number for the others. As
+  //     in the viewer, severities are matched by name, and times as
+  //     local "HH:MM:SS-mmm".
+  void AddFilter(Column column,
+                 Relation relation,
+                 Action action,
+                 const std::string& value);
+
+  // Adds the filters in @p serialized, as written by
+  // Filter::SerializeFilters.
+  // @returns true iff @p serialized is a list of valid filters.
+  bool AddSerializedFilters(const std::string& serialized);
+
+  // Restricts matches to messages in [@p start, @p end). A null time
+  // leaves that end of the range open.
+  void SetTimeRange(const base::Time& start, const base::Time& end);
+
+  // @returns true iff no filters or time range are set.
+  bool empty() const;
+
+  // LogMessageFilter implementation.
+  virtual bool MatchesHeader(const EVENT_TRACE_HEADER& header) const;
+  virtual bool MatchesLogMessage(
+      const LogEvents::LogMessage& log_message) const;
+  virtual bool MatchesTraceMessage(
+      const TraceEvents::TraceMessage& trace_message) const;
+
+ private:
+  struct Predicate;
+
+  // The fields of a message that filters match. The file, line and
+  // message are only valid once the event is parsed.
+  struct Fields {
+    Fields() : level(0), process_id(0), thread_id(0), line(0) {
+    }
+
+    UCHAR level;
+    DWORD process_id;
+    DWORD thread_id;
+    base::Time time;
+    base::StringPiece file;
+    int line;
+    base::StringPiece message;
+  };
+
+  // @returns true iff @p fields may match. When @p header_only is true,
+  //     only the predicates on header fields are evaluated, and any
+  //     other include predicate is taken to match.
+  bool Matches(const Fields& fields, bool header_only) const;
+
+  // @returns true iff @p predicate matches @p fields.
+  static bool PredicateMatches(const Predicate& predicate,
+                               const Fields& fields);
+
+  ScopedVector<Predicate> includes_;
+  ScopedVector<Predicate> excludes_;
+  base::Time start_time_;
+  base::Time end_time_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogFilter);
+};
+
+#endif  // SAWBUCK_LOG_LIB_LOG_FILTER_H_
@@ -0,0 +1,190 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/log_lib/log_filter.h"
+
+#include <string.h>
+#include "gtest/gtest.h"
+
+namespace {
+
+const DWORD kProcessId = 1234;
+const DWORD kThreadId = 5678;
+const char kFile[] = "sawbuck/log_lib/log_filter.cc";
+const char kMessage[] = "Consumed 42 events";
+
+class LogFilterTest : public testing::Test {
+ public:
+  LogFilterTest() {
+    memset(&header_, 0, sizeof(header_));
+    header_.Class.Level = TRACE_LEVEL_WARNING;
+    header_.ProcessId = kProcessId;
+    header_.ThreadId = kThreadId;
+    SetTime(base::Time::FromInternalValue(1000));
+
+    log_message_.level = TRACE_LEVEL_WARNING;
+    log_message_.process_id = kProcessId;
+    log_message_.thread_id = kThreadId;
+    log_message_.time = base::Time::FromInternalValue(1000);
+    log_message_.file = kFile;
+    log_message_.file_len = strlen(kFile);
+    log_message_.line = 314;
+    log_message_.message = kMessage;
+    log_message_.message_len = strlen(kMessage);
+  }
+
+  void SetTime(const base::Time& time) {
+    reinterpret_cast<FILETIME&>(header_.TimeStamp) = time.ToFileTime();
+    log_message_.time = time;
+  }
+
+  // @returns true iff both the header and the log message match.
+  bool Matches() {
+    return filter_.MatchesHeader(header_) &&
+        filter_.MatchesLogMessage(log_message_);
+  }
+
+ protected:
+  EVENT_TRACE_HEADER header_;
+  LogEvents::LogMessage log_message_;
+  LogFilter filter_;
+};
+
+TEST_F(LogFilterTest, EmptyMatchesAll) {
+  EXPECT_TRUE(filter_.empty());
+  EXPECT_TRUE(Matches());
+}
+
+TEST_F(LogFilterTest, ExcludesFromHeader) {
+  filter_.AddFilter(LogFilter::PROCESS_ID, LogFilter::IS, LogFilter::EXCLUDE,
+                    "1234");
+  EXPECT_FALSE(filter_.empty());
+  EXPECT_FALSE(filter_.MatchesHeader(header_));
+
+  header_.ProcessId = kProcessId + 1;
+  EXPECT_TRUE(filter_.MatchesHeader(header_));
+}
+
+TEST_F(LogFilterTest, MatchesNumbersAsTheViewerDoes) {
+  filter_.AddFilter(LogFilter::THREAD_ID, LogFilter::CONTAINS,
+                    LogFilter::INCLUDE, "67");
+  EXPECT_TRUE(Matches());
+
+  header_.ThreadId = 1111;
+  EXPECT_FALSE(filter_.MatchesHeader(header_));
+}
+
+TEST_F(LogFilterTest, MatchesSeverityByName) {
+  filter_.AddFilter(LogFilter::SEVERITY, LogFilter::IS, LogFilter::INCLUDE,
+                    "error|warning");
+  EXPECT_TRUE(filter_.MatchesHeader(header_));
+
+  header_.Class.Level = TRACE_LEVEL_INFORMATION;
+  EXPECT_FALSE(filter_.MatchesHeader(header_));
+  header_.Class.Level = TRACE_LEVEL_ERROR;
+  EXPECT_TRUE(filter_.MatchesHeader(header_));
+}
+
+TEST_F(LogFilterTest, IncludesAnyOf) {
+  filter_.AddFilter(LogFilter::PROCESS_ID, LogFilter::IS, LogFilter::INCLUDE,
+                    "1");
+  filter_.AddFilter(LogFilter::MESSAGE, LogFilter::CONTAINS,
+                    LogFilter::INCLUDE, "CONSUMED");
+
+  // The message include leaves the header undecided.
+  EXPECT_TRUE(filter_.MatchesHeader(header_));
+  EXPECT_TRUE(filter_.MatchesLogMessage(log_message_));
+
+  log_message_.message = "Nothing";
+  log_message_.message_len = strlen(log_message_.message);
+  EXPECT_FALSE(filter_.MatchesLogMessage(log_message_));
+
+  log_message_.process_id = 1;
+  EXPECT_TRUE(filter_.MatchesLogMessage(log_message_));
+}
+
+TEST_F(LogFilterTest, ExcludesOverrideIncludes) {
+  filter_.AddFilter(LogFilter::FILE, LogFilter::CONTAINS, LogFilter::INCLUDE,
+                    "log_lib");
+  filter_.AddFilter(LogFilter::LINE, LogFilter::IS, LogFilter::EXCLUDE,
+                    "314");
+  EXPECT_TRUE(filter_.MatchesHeader(header_));
+  EXPECT_FALSE(filter_.MatchesLogMessage(log_message_));
+
+  log_message_.line = 315;
+  EXPECT_TRUE(filter_.MatchesLogMessage(log_message_));
+}
+
+TEST_F(LogFilterTest, MatchesTraceNamesAsMessages) {
+  filter_.AddFilter(LogFilter::MESSAGE, LogFilter::IS, LogFilter::INCLUDE,
+                    "Load.*");
+
+  TraceEvents::TraceMessage trace_message;
+  trace_message.name = "LoadModule";
+  trace_message.name_len = strlen(trace_message.name);
+  EXPECT_TRUE(filter_.MatchesTraceMessage(trace_message));
+
+  trace_message.name = "Unload";
+  trace_message.name_len = strlen(trace_message.name);
+  EXPECT_FALSE(filter_.MatchesTraceMessage(trace_message));
+}
+
+TEST_F(LogFilterTest, TimeRange) {
+  filter_.SetTimeRange(base::Time::FromInternalValue(1000),
+                       base::Time::FromInternalValue(2000));
+  EXPECT_FALSE(filter_.empty());
+  EXPECT_TRUE(Matches());
+
+  SetTime(base::Time::FromInternalValue(999));
+  EXPECT_FALSE(filter_.MatchesHeader(header_));
+  SetTime(base::Time::FromInternalValue(2000));
+  EXPECT_FALSE(filter_.MatchesHeader(header_));
+
+  // A null end leaves the range open.
+  filter_.SetTimeRange(base::Time::FromInternalValue(1000), base::Time());
+  EXPECT_TRUE(filter_.MatchesHeader(header_));
+}
+
+TEST_F(LogFilterTest, AddSerializedFilters) {
+  // As Filter::SerializeFilters writes them.
+  const char kSerialized[] =
+      "[ {\n"
+      "   \"action\": 1,\n"
+      "   \"column\": 1,\n"
+      "   \"relation\": 0,\n"
+      "   \"value\": \"1234\"\n"
+      "}, {\n"
+      "   \"action\": 0,\n"
+      "   \"column\": 6,\n"
+      "   \"relation\": 1,\n"
+      "   \"value\": \"events\"\n"
+      "} ]\n";
+  ASSERT_TRUE(filter_.AddSerializedFilters(kSerialized));
+  EXPECT_FALSE(filter_.MatchesHeader(header_));
+
+  header_.ProcessId = kProcessId + 1;
+  log_message_.process_id = kProcessId + 1;
+  EXPECT_TRUE(Matches());
+}
+
+TEST_F(LogFilterTest, RejectsBadSerializedFilters) {
+  EXPECT_FALSE(filter_.AddSerializedFilters("not json"));
+  EXPECT_FALSE(filter_.AddSerializedFilters("{}"));
+  // There's no column 7.
+  EXPECT_FALSE(filter_.AddSerializedFilters(
+      "[ { \"action\": 0, \"column\": 7, \"relation\": 0, "
+      "\"value\": \"\" } ]"));
+  EXPECT_FALSE(filter_.AddSerializedFilters("[ { \"action\": 0 } ]"));
+}
+
+}  // namespace
@@ -27,17 +27,47 @@
       'target_name': 'log_lib',
       'type': 'static_library',
       'sources': [
+        'dump_formatter.cc',
+        'dump_formatter.h',
+        'dump_writer.cc',
+        'dump_writer.h',
+        'etl_event_recorder.cc',
+        'etl_event_recorder.h',
+        'etl_file_consumer.cc',
+        'etl_file_consumer.h',
+        'etl_file_reader.cc',
+        'etl_file_reader.h',
+        'hard_fault_io_tracker.cc',
+        'hard_fault_io_tracker.h',
         'kernel_log_consumer.cc',
         'kernel_log_consumer.h',
+        'kernel_log_schema.h',
+        'latency_histogram.cc',
+        'latency_histogram.h',
         'log_consumer.cc',
         'log_consumer.h',
+        'log_filter.cc',
+        'log_filter.h',
+        'page_fault_aggregator.cc',
+        'page_fault_aggregator.h',
+        'page_order_optimizer.cc',
+        'page_order_optimizer.h',
         'process_info_service.cc',
         'process_info_service.h',
+        'sawlog_file.cc',
+        'sawlog_file.h',
+        'span_latency_stats.cc',
+        'span_latency_stats.h',
         'symbol_lookup_service.cc',
         'symbol_lookup_service.h',
+        'trace_span_index.cc',
+        'trace_span_index.h',
+        'trace_span_tracker.cc',
+        'trace_span_tracker.h',
       ],
       'dependencies': [
         '<(DEPTH)/base/base.gyp:base',
+        '<(DEPTH)/third_party/pcre/pcre.gyp:pcre_lib',
         '../common/common.gyp:common',
         '../sym_util/sym_util.gyp:sym_util',
       ],
@@ -66,20 +96,48 @@
       'target_name': 'log_lib_unittests',
       'type': 'executable',
       'sources': [
+        'dump_formatter_unittest.cc',
+        'dump_writer_unittest.cc',
+        'etl_file_reader_unittest.cc',
+        'hard_fault_io_tracker_unittest.cc',
         'kernel_log_consumer_unittest.cc',
+        'kernel_log_schema_unittest.cc',
+        'latency_histogram_unittest.cc',
         'log_consumer_unittest.cc',
+        'log_filter_unittest.cc',
         'log_lib_unittest_main.cc',
+        'page_fault_aggregator_unittest.cc',
+        'page_order_optimizer_unittest.cc',
         'process_info_service_unittest.cc',
+        'sawlog_file_unittest.cc',
+        'span_latency_stats_unittest.cc',
         'symbol_lookup_service_unittest.cc',
+        'trace_span_index_unittest.cc',
+        'trace_span_tracker_unittest.cc',
       ],
       'dependencies': [
         'log_lib',
         'test_common',
+        '../common/common.gyp:common_test_utils',
         '<(DEPTH)/base/base.gyp:base',
         '<(DEPTH)/testing/gmock.gyp:gmock',
         '<(DEPTH)/testing/gtest.gyp:gtest',
       ],
     },
+    {
+      'target_name': 'log_lib_perftests',
+      'type': 'executable',
+      'sources': [
+        'etl_file_consumer_perftest.cc',
+        'kernel_log_consumer_perftest.cc',
+      ],
+      'dependencies': [
+        'log_lib',
+        '<(DEPTH)/base/base.gyp:base',
+        '<(DEPTH)/base/base.gyp:test_support_perf',
+        '<(DEPTH)/testing/gtest.gyp:gtest',
+      ],
+    },
     {
       'target_name': 'dump_logs',
       'type': 'executable',
@@ -91,6 +149,18 @@
         '<(DEPTH)/base/base.gyp:base',
       ],          
     },
+    {
+      'target_name': 'page_order',
+      'type': 'executable',
+      'sources': [
+        'page_order_main.cc',
+      ],
+      'dependencies': [
+        'log_lib',
+        '../sym_util/sym_util.gyp:sym_util',
+        '<(DEPTH)/base/base.gyp:base',
+      ],
+    },
     {
       'target_name': 'test_logger',
       'type': 'executable',
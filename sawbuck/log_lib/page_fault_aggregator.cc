@@ -0,0 +1,343 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Page fault aggregator implementation.
+#include "sawbuck/log_lib/page_fault_aggregator.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace {
+
+// The initial width of timeline buckets, in microseconds.
+const int64 kInitialBucketWidth = 1000;
+
+// @returns true iff @p a is hotter than @p b.
+bool IsHotter(const PageFaultCounts& a, const PageFaultCounts& b) {
+  if (a.counts[HARD_FAULT] != b.counts[HARD_FAULT])
+    return a.counts[HARD_FAULT] > b.counts[HARD_FAULT];
+  return a.total() > b.total();
+}
+
+// Orders stats hottest first, with ties kept in their original order.
+template <class Stats>
+bool IsHotterStats(const Stats* a, const Stats* b) {
+  if (IsHotter(a->faults, b->faults))
+    return true;
+  if (IsHotter(b->faults, a->faults))
+    return false;
+  return a < b;
+}
+
+// Retrieves the @p max_stats hottest of @p all_stats into @p stats.
+template <class Stats>
+void GetHottest(const std::vector<Stats>& all_stats,
+                size_t max_stats,
+                std::vector<const Stats*>* stats) {
+  DCHECK(stats != NULL);
+  stats->clear();
+  for (size_t i = 0; i < all_stats.size(); ++i)
+    stats->push_back(&all_stats[i]);
+
+  max_stats = std::min(max_stats, stats->size());
+  std::partial_sort(stats->begin(), stats->begin() + max_stats, stats->end(),
+                    IsHotterStats<Stats>);
+  stats->resize(max_stats);
+}
+
+}  // namespace
+
+PageFaultCounts::PageFaultCounts() {
+  memset(counts, 0, sizeof(counts));
+}
+
+uint64 PageFaultCounts::total() const {
+  uint64 total = 0;
+  for (size_t i = 0; i < NUM_PAGE_FAULT_TYPES; ++i)
+    total += counts[i];
+  return total;
+}
+
+// static
+const size_t FaultTimeline::kNumBuckets;
+
+FaultTimeline::FaultTimeline()
+    : count_(0), bucket_width_(kInitialBucketWidth) {
+  memset(buckets_, 0, sizeof(buckets_));
+}
+
+void FaultTimeline::Record(const base::Time& time) {
+  if (count_ == 0)
+    start_time_ = time;
+  ++count_;
+
+  int64 offset = std::max((time - start_time_).InMicroseconds(),
+                          static_cast<int64>(0));
+  while (offset / bucket_width_ >= static_cast<int64>(kNumBuckets))
+    Fold();
+
+  ++buckets_[offset / bucket_width_];
+}
+
+void FaultTimeline::Fold() {
+  for (size_t i = 0; i < kNumBuckets / 2; ++i)
+    buckets_[i] = buckets_[2 * i] + buckets_[2 * i + 1];
+  memset(buckets_ + kNumBuckets / 2, 0, sizeof(buckets_) / 2);
+  bucket_width_ *= 2;
+}
+
+// static
+const size_t PageFaultAggregator::kPageSize;
+const size_t PageFaultAggregator::kDefaultMaxPages;
+const size_t PageFaultAggregator::kMaxLoadStates;
+
+PageFaultAggregator::PageFaultAggregator(size_t max_pages)
+    : max_pages_(max_pages), num_untracked_page_faults_(0),
+      num_unattributed_hard_faults_(0) {
+}
+
+PageFaultAggregator::~PageFaultAggregator() {
+}
+
+void PageFaultAggregator::OnModuleIsLoaded(
+    DWORD process_id, const base::Time& time,
+    const ModuleInformation& module_info) {
+  // As in SymbolLookupService, modules loaded before the trace started
+  // might as well have been loaded from the beginning of time.
+  OnModuleLoad(process_id, base::Time(), module_info);
+}
+
+void PageFaultAggregator::OnModuleUnload(
+    DWORD process_id, const base::Time& time,
+    const ModuleInformation& module_info) {
+  module_cache_.ModuleUnloaded(process_id, time, module_info);
+}
+
+void PageFaultAggregator::OnModuleLoad(
+    DWORD process_id, const base::Time& time,
+    const ModuleInformation& module_info) {
+  module_cache_.ModuleLoaded(process_id, time, module_info);
+}
+
+void PageFaultAggregator::OnTransitionFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+  OnFault(TRANSITION_FAULT, process_id, thread_id, time, address);
+}
+
+void PageFaultAggregator::OnDemandZeroFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+  OnFault(DEMAND_ZERO_FAULT, process_id, thread_id, time, address);
+}
+
+void PageFaultAggregator::OnCopyOnWriteFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+  OnFault(COPY_ON_WRITE_FAULT, process_id, thread_id, time, address);
+}
+
+void PageFaultAggregator::OnGuardPageFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+  OnFault(GUARD_PAGE_FAULT, process_id, thread_id, time, address);
+}
+
+void PageFaultAggregator::OnHardFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+  OnFault(HARD_FAULT, process_id, thread_id, time, address);
+  counted_hard_faults_[thread_id] = address / kPageSize;
+}
+
+void PageFaultAggregator::OnAccessViolationFault(
+    DWORD process_id, DWORD thread_id, const base::Time& time,
+    sym_util::Address address, sym_util::Address program_counter) {
+  OnFault(ACCESS_VIOLATION_FAULT, process_id, thread_id, time, address);
+}
+
+void PageFaultAggregator::OnHardPageFault(DWORD thread_id,
+                                          const base::Time& time,
+                                          const base::Time& initial_time,
+                                          sym_util::Offset offset,
+                                          sym_util::Address address,
+                                          sym_util::Address file_object,
+                                          sym_util::ByteCount byte_count) {
+  // The fault was counted as it was taken if its thread last took a hard
+  // fault on the same page.
+  ThreadPageMap::iterator counted = counted_hard_faults_.find(thread_id);
+  if (counted != counted_hard_faults_.end() &&
+      counted->second == address / kPageSize) {
+    counted_hard_faults_.erase(counted);
+    return;
+  }
+
+  // These carry no process id, so go by the thread's.
+  ThreadProcessMap::const_iterator it = thread_processes_.find(thread_id);
+  if (it == thread_processes_.end()) {
+    ++num_unattributed_hard_faults_;
+    return;
+  }
+
+  OnFault(HARD_FAULT, it->second, thread_id, time, address);
+}
+
+void PageFaultAggregator::OnThreadIsRunning(const base::Time& time,
+                                            DWORD process_id,
+                                            DWORD thread_id) {
+  thread_processes_[thread_id] = process_id;
+}
+
+void PageFaultAggregator::OnThreadStarted(const base::Time& time,
+                                          DWORD process_id,
+                                          DWORD thread_id) {
+  thread_processes_[thread_id] = process_id;
+}
+
+void PageFaultAggregator::OnThreadEnded(const base::Time& time,
+                                        DWORD process_id,
+                                        DWORD thread_id) {
+  // The thread id may be reused by another process.
+  thread_processes_.erase(thread_id);
+  counted_hard_faults_.erase(thread_id);
+}
+
+void PageFaultAggregator::GetHottestModules(
+    size_t max_modules, std::vector<const ModuleStats*>* modules) const {
+  GetHottest(modules_, max_modules, modules);
+}
+
+void PageFaultAggregator::GetHottestPages(
+    size_t max_pages, std::vector<const PageStats*>* pages) const {
+  GetHottest(pages_, max_pages, pages);
+}
+
+void PageFaultAggregator::OnFault(PageFaultType type,
+                                  DWORD process_id,
+                                  DWORD thread_id,
+                                  const base::Time& time,
+                                  sym_util::Address address) {
+  thread_processes_[thread_id] = process_id;
+
+  ProcessStats& process = processes_[process_id];
+  ++process.faults.counts[type];
+  process.timeline.Record(time);
+  if (type == HARD_FAULT)
+    process.hard_fault_timeline.Record(time);
+
+  // Find the module the address falls in, if any.
+  const LoadedModuleList& loaded_modules =
+      GetLoadedModules(process_id, time);
+  LoadedModule key = {};
+  key.base_address = address;
+  LoadedModuleList::const_iterator it =
+      std::upper_bound(loaded_modules.begin(), loaded_modules.end(), key);
+  if (it == loaded_modules.begin()) {
+    ++process.unattributed_faults;
+    return;
+  }
+  --it;
+  sym_util::Offset offset = address - it->base_address;
+  if (offset >= it->module_size) {
+    ++process.unattributed_faults;
+    return;
+  }
+
+  ++modules_[it->module].faults.counts[type];
+
+  PageStats* page = GetPageStats(it->module, offset, time);
+  if (page == NULL) {
+    ++num_untracked_page_faults_;
+    return;
+  }
+  ++page->faults.counts[type];
+}
+
+const PageFaultAggregator::LoadedModuleList&
+PageFaultAggregator::GetLoadedModules(DWORD process_id,
+                                      const base::Time& time) {
+  using sym_util::ModuleCache;
+
+  ModuleCache::ModuleLoadStateId id =
+      module_cache_.GetStateId(process_id, time);
+  LoadedModuleMap::iterator it = loaded_modules_.find(id);
+  if (it == loaded_modules_.end()) {
+    // We have a miss, evict the least recently used element if need be.
+    if (loaded_modules_.size() == kMaxLoadStates) {
+      ModuleCache::ModuleLoadStateId to_evict = lru_load_states_.front();
+      lru_load_states_.erase(lru_load_states_.begin());
+      loaded_modules_.erase(to_evict);
+    }
+
+    it = loaded_modules_.insert(std::make_pair(id, LoadedModuleList())).first;
+    LoadedModuleList& loaded_modules = it->second;
+
+    std::vector<ModuleInformation> modules;
+    module_cache_.GetProcessModuleState(process_id, time, &modules);
+    for (size_t i = 0; i < modules.size(); ++i) {
+      LoadedModule loaded_module = {};
+      loaded_module.base_address = modules[i].base_address;
+      loaded_module.module_size = modules[i].module_size;
+      loaded_module.module = GetModuleIndex(modules[i]);
+      loaded_modules.push_back(loaded_module);
+    }
+    std::sort(loaded_modules.begin(), loaded_modules.end());
+  } else {
+    // We have a hit, manage the LRU by removing our ID.
+    // It will be pushed to the back of the LRU just below.
+    lru_load_states_.erase(
+        std::find(lru_load_states_.begin(), lru_load_states_.end(), id));
+  }
+
+  // Push our id to the back of the lru list.
+  lru_load_states_.push_back(id);
+  return it->second;
+}
+
+size_t PageFaultAggregator::GetModuleIndex(
+    const ModuleInformation& module_info) {
+  ModuleInformation key = module_info;
+  key.base_address = 0;
+
+  ModuleIndexMap::iterator it = module_indexes_.find(key);
+  if (it != module_indexes_.end())
+    return it->second;
+
+  size_t index = modules_.size();
+  module_indexes_.insert(std::make_pair(key, index));
+  modules_.push_back(ModuleStats());
+  modules_.back().module = module_info;
+  return index;
+}
+
+PageFaultAggregator::PageStats* PageFaultAggregator::GetPageStats(
+    size_t module, sym_util::Offset offset, const base::Time& time) {
+  uint32 page = static_cast<uint32>(offset / kPageSize);
+  uint64 key = (static_cast<uint64>(module) << 32) | page;
+  PageIndexMap::iterator it = page_indexes_.find(key);
+  if (it != page_indexes_.end())
+    return &pages_[it->second];
+
+  if (pages_.size() >= max_pages_)
+    return NULL;
+
+  page_indexes_.insert(std::make_pair(key, pages_.size()));
+  pages_.push_back(PageStats());
+  PageStats& stats = pages_.back();
+  stats.module = module;
+  stats.page = page;
+  stats.first_fault_time = time;
+  stats.first_fault_offset = offset;
+  return &stats;
+}
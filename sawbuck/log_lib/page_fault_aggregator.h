@@ -0,0 +1,311 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Page fault aggregator declaration.
+#ifndef SAWBUCK_LOG_LIB_PAGE_FAULT_AGGREGATOR_H_
+#define SAWBUCK_LOG_LIB_PAGE_FAULT_AGGREGATOR_H_
+
+#include <map>
+#include <vector>
+#include "base/basictypes.h"
+#include "base/containers/hash_tables.h"
+#include "base/logging.h"
+#include "base/time/time.h"
+#include "sawbuck/log_lib/kernel_log_consumer.h"
+#include "sawbuck/sym_util/module_cache.h"
+
+// The kinds of page fault PageFaultAggregator tells apart.
+enum PageFaultType {
+  TRANSITION_FAULT,
+  DEMAND_ZERO_FAULT,
+  COPY_ON_WRITE_FAULT,
+  GUARD_PAGE_FAULT,
+  HARD_FAULT,
+  ACCESS_VIOLATION_FAULT,
+  NUM_PAGE_FAULT_TYPES
+};
+
+// Page fault counts by type.
+struct PageFaultCounts {
+  PageFaultCounts();
+
+  // @returns the count of faults of all types.
+  uint64 total() const;
+
+  uint64 counts[NUM_PAGE_FAULT_TYPES];
+};
+
+// A histogram of event times over a fixed number of buckets. The buckets
+// start out a millisecond wide, and whenever an event falls past the last
+// bucket, neighbouring buckets are merged pairwise to double their width.
+// The histogram thus covers any length of time in fixed memory.
+class FaultTimeline {
+ public:
+  static const size_t kNumBuckets = 128;
+
+  FaultTimeline();
+
+  // Records an event at @p time. Events before the first event recorded
+  // count towards the first bucket.
+  void Record(const base::Time& time);
+
+  // Accessors.
+  uint64 count() const { return count_; }
+  base::Time start_time() const { return start_time_; }
+  base::TimeDelta bucket_width() const {
+    return base::TimeDelta::FromMicroseconds(bucket_width_);
+  }
+  uint64 bucket(size_t bucket) const {
+    DCHECK_LT(bucket, kNumBuckets);
+    return buckets_[bucket];
+  }
+
+ private:
+  // Merges neighbouring buckets pairwise, doubling the bucket width.
+  void Fold();
+
+  uint64 count_;
+  base::Time start_time_;
+  // The width of each bucket, in microseconds.
+  int64 bucket_width_;
+  uint64 buckets_[kNumBuckets];
+};
+
+// Aggregates page faults per process, per module and per module page.
+// Faults are attributed to the module loaded at the faulting address at
+// the time of the fault, and the same image loaded in different processes
+// or at different addresses aggregates to the same module. Pages are
+// identified by their offset from the module base, so they too aggregate
+// across processes.
+//
+// A hard fault may be logged twice: as it's taken, when all page faults
+// are captured, and as its read completes, when hard faults are. The
+// latter names the thread but not the process. Each hard fault counts
+// once, from the former where it's seen, else from the latter through the
+// process of its thread.
+//
+// Memory is bounded by the number of processes, threads and modules seen,
+// and the number of pages tracked, which is capped. Faults on pages past
+// the cap still count towards their process and module.
+// @note This class is not thread safe.
+class PageFaultAggregator
+    : public KernelModuleEvents,
+      public KernelPageFaultEvents,
+      public KernelThreadEvents {
+ public:
+  static const size_t kPageSize = 4096;
+  static const size_t kDefaultMaxPages = 256 * 1024;
+
+  // The faults of a process.
+  struct ProcessStats {
+    ProcessStats() : unattributed_faults(0) {
+    }
+
+    PageFaultCounts faults;
+    // Faults at addresses in no module.
+    uint64 unattributed_faults;
+    FaultTimeline timeline;
+    FaultTimeline hard_fault_timeline;
+  };
+  typedef std::map<DWORD, ProcessStats> ProcessStatsMap;
+
+  // The faults in a module.
+  struct ModuleStats {
+    // The module as first seen loaded.
+    ModuleInformation module;
+    PageFaultCounts faults;
+  };
+
+  // The faults on a page of a module.
+  struct PageStats {
+    // Indexes modules().
+    size_t module;
+    // The page's offset from the module base, in pages.
+    uint32 page;
+    PageFaultCounts faults;
+    base::Time first_fault_time;
+    // The offset from the module base of the first fault on the page.
+    sym_util::Offset first_fault_offset;
+  };
+
+  explicit PageFaultAggregator(size_t max_pages);
+  ~PageFaultAggregator();
+
+  // KernelModuleEvents implementation.
+  virtual void OnModuleIsLoaded(DWORD process_id,
+                                const base::Time& time,
+                                const ModuleInformation& module_info);
+  virtual void OnModuleUnload(DWORD process_id,
+                              const base::Time& time,
+                              const ModuleInformation& module_info);
+  virtual void OnModuleLoad(DWORD process_id,
+                            const base::Time& time,
+                            const ModuleInformation& module_info);
+
+  // KernelPageFaultEvents implementation.
+  virtual void OnTransitionFault(DWORD process_id,
+                                 DWORD thread_id,
+                                 const base::Time& time,
+                                 sym_util::Address address,
+                                 sym_util::Address program_counter);
+  virtual void OnDemandZeroFault(DWORD process_id,
+                                 DWORD thread_id,
+                                 const base::Time& time,
+                                 sym_util::Address address,
+                                 sym_util::Address program_counter);
+  virtual void OnCopyOnWriteFault(DWORD process_id,
+                                  DWORD thread_id,
+                                  const base::Time& time,
+                                  sym_util::Address address,
+                                  sym_util::Address program_counter);
+  virtual void OnGuardPageFault(DWORD process_id,
+                                DWORD thread_id,
+                                const base::Time& time,
+                                sym_util::Address address,
+                                sym_util::Address program_counter);
+  virtual void OnHardFault(DWORD process_id,
+                           DWORD thread_id,
+                           const base::Time& time,
+                           sym_util::Address address,
+                           sym_util::Address program_counter);
+  virtual void OnAccessViolationFault(DWORD process_id,
+                                      DWORD thread_id,
+                                      const base::Time& time,
+                                      sym_util::Address address,
+                                      sym_util::Address program_counter);
+  virtual void OnHardPageFault(DWORD thread_id,
+                               const base::Time& time,
+                               const base::Time& initial_time,
+                               sym_util::Offset offset,
+                               sym_util::Address address,
+                               sym_util::Address file_object,
+                               sym_util::ByteCount byte_count);
+
+  // KernelThreadEvents implementation.
+  virtual void OnThreadIsRunning(const base::Time& time,
+                                 DWORD process_id,
+                                 DWORD thread_id);
+  virtual void OnThreadStarted(const base::Time& time,
+                               DWORD process_id,
+                               DWORD thread_id);
+  virtual void OnThreadEnded(const base::Time& time,
+                             DWORD process_id,
+                             DWORD thread_id);
+
+  // Accessors.
+  const ProcessStatsMap& processes() const { return processes_; }
+  const std::vector<ModuleStats>& modules() const { return modules_; }
+  const std::vector<PageStats>& pages() const { return pages_; }
+
+  // @returns the number of faults on pages past the page cap.
+  uint64 num_untracked_page_faults() const {
+    return num_untracked_page_faults_;
+  }
+
+  // @returns the number of hard faults seen only as their read completed,
+  //     on threads of no known process.
+  uint64 num_unattributed_hard_faults() const {
+    return num_unattributed_hard_faults_;
+  }
+
+  // Retrieves the modules with the most hard faults, with ties broken by
+  // their total faults.
+  // @param max_modules the most modules to retrieve.
+  // @param modules on success returns the modules, hottest first.
+  void GetHottestModules(size_t max_modules,
+                         std::vector<const ModuleStats*>* modules) const;
+
+  // Retrieves the pages with the most hard faults, with ties broken by
+  // their total faults.
+  // @param max_pages the most pages to retrieve.
+  // @param pages on success returns the pages, hottest first.
+  void GetHottestPages(size_t max_pages,
+                       std::vector<const PageStats*>* pages) const;
+
+ private:
+  // A module loaded at an address, in a module load state.
+  struct LoadedModule {
+    bool operator<(const LoadedModule& other) const {
+      return base_address < other.base_address;
+    }
+
+    sym_util::ModuleBase base_address;
+    sym_util::ModuleSize module_size;
+    // Indexes modules_.
+    size_t module;
+  };
+  typedef std::vector<LoadedModule> LoadedModuleList;
+
+  // Counts a fault of type @p type.
+  void OnFault(PageFaultType type,
+               DWORD process_id,
+               DWORD thread_id,
+               const base::Time& time,
+               sym_util::Address address);
+
+  // @returns the modules loaded in @p process_id at @p time, ordered by
+  //     base address.
+  const LoadedModuleList& GetLoadedModules(DWORD process_id,
+                                           const base::Time& time);
+
+  // @returns the index of @p module_info in modules_, adding it if new.
+  size_t GetModuleIndex(const ModuleInformation& module_info);
+
+  // @returns the stats of the page at @p offset in module @p module,
+  //     or NULL if the page is new and the page cap is reached.
+  PageStats* GetPageStats(size_t module,
+                          sym_util::Offset offset,
+                          const base::Time& time);
+
+  sym_util::ModuleCache module_cache_;
+
+  // We keep the loaded modules of the most recently used module load
+  // states, with an lru replacement policy.
+  typedef std::map<sym_util::ModuleCache::ModuleLoadStateId,
+      LoadedModuleList> LoadedModuleMap;
+  static const size_t kMaxLoadStates = 16;
+  typedef std::vector<sym_util::ModuleCache::ModuleLoadStateId>
+      LoadStateVector;
+  LoadStateVector lru_load_states_;
+  LoadedModuleMap loaded_modules_;
+
+  ProcessStatsMap processes_;
+
+  // The modules, and their indexes by module information with the base
+  // address cleared.
+  std::vector<ModuleStats> modules_;
+  typedef std::map<ModuleInformation, size_t> ModuleIndexMap;
+  ModuleIndexMap module_indexes_;
+
+  // The pages, and their indexes by module index and page.
+  std::vector<PageStats> pages_;
+  typedef base::hash_map<uint64, size_t> PageIndexMap;
+  PageIndexMap page_indexes_;
+  size_t max_pages_;
+  uint64 num_untracked_page_faults_;
+
+  // The process of each thread, from thread events and fault events.
+  typedef base::hash_map<DWORD, DWORD> ThreadProcessMap;
+  ThreadProcessMap thread_processes_;
+
+  // The page of the last hard fault counted as it was taken, by thread, so
+  // that it isn't counted again as its read completes.
+  typedef base::hash_map<DWORD, sym_util::Address> ThreadPageMap;
+  ThreadPageMap counted_hard_faults_;
+  uint64 num_unattributed_hard_faults_;
+
+  DISALLOW_COPY_AND_ASSIGN(PageFaultAggregator);
+};
+
+#endif  // SAWBUCK_LOG_LIB_PAGE_FAULT_AGGREGATOR_H_
@@ -0,0 +1,229 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/log_lib/page_fault_aggregator.h"
+
+#include "gtest/gtest.h"
+#include "sawbuck/common/test_time.h"
+
+namespace {
+
+using testing::TimeAt;
+
+const DWORD kProcessId = 1234;
+const DWORD kOtherProcessId = 5678;
+const DWORD kThreadId = 1;
+
+const sym_util::ModuleBase kExeBase = 0x400000;
+const sym_util::ModuleBase kDllBase = 0x10000000;
+const sym_util::ModuleBase kOtherDllBase = 0x20000000;
+
+sym_util::ModuleInformation MakeModule(sym_util::ModuleBase base,
+                                       sym_util::ModuleSize size,
+                                       const wchar_t* name) {
+  sym_util::ModuleInformation module = {};
+  module.base_address = base;
+  module.module_size = size;
+  module.image_checksum = 0xCAFE;
+  module.time_date_stamp = 0xBABE;
+  module.image_file_name = name;
+  return module;
+}
+
+class PageFaultAggregatorTest : public testing::Test {
+ public:
+  PageFaultAggregatorTest()
+      : aggregator_(PageFaultAggregator::kDefaultMaxPages),
+        exe_(MakeModule(kExeBase, 0x10000, L"C:\\foo.exe")),
+        dll_(MakeModule(kDllBase, 0x20000, L"C:\\bar.dll")) {
+  }
+
+  virtual void SetUp() {
+    aggregator_.OnModuleIsLoaded(kProcessId, TimeAt(0), exe_);
+    aggregator_.OnModuleIsLoaded(kProcessId, TimeAt(0), dll_);
+  }
+
+ protected:
+  PageFaultAggregator aggregator_;
+  sym_util::ModuleInformation exe_;
+  sym_util::ModuleInformation dll_;
+};
+
+TEST(FaultTimelineTest, FoldsToFit) {
+  FaultTimeline timeline;
+  const int64 kWidth = timeline.bucket_width().InMicroseconds();
+
+  timeline.Record(TimeAt(1000));
+  timeline.Record(TimeAt(1000 + kWidth));
+  // Out of order events count towards the first bucket.
+  timeline.Record(TimeAt(0));
+  EXPECT_EQ(TimeAt(1000), timeline.start_time());
+  EXPECT_EQ(2U, timeline.bucket(0));
+  EXPECT_EQ(1U, timeline.bucket(1));
+
+  // Twice past the end folds twice.
+  timeline.Record(
+      TimeAt(1000 + 2 * kWidth * FaultTimeline::kNumBuckets + kWidth));
+  EXPECT_EQ(4U, timeline.count());
+  EXPECT_EQ(4 * kWidth, timeline.bucket_width().InMicroseconds());
+  EXPECT_EQ(3U, timeline.bucket(0));
+  EXPECT_EQ(1U, timeline.bucket(FaultTimeline::kNumBuckets / 2));
+}
+
+TEST_F(PageFaultAggregatorTest, CountsByProcess) {
+  aggregator_.OnHardFault(kProcessId, kThreadId, TimeAt(10),
+                          kExeBase + 0x1000, kExeBase);
+  aggregator_.OnDemandZeroFault(kProcessId, kThreadId, TimeAt(20),
+                                0x7FFF0000, kExeBase);
+  aggregator_.OnTransitionFault(kOtherProcessId, kThreadId, TimeAt(30),
+                                kExeBase, kExeBase);
+
+  const PageFaultAggregator::ProcessStatsMap& processes =
+      aggregator_.processes();
+  ASSERT_EQ(2U, processes.size());
+  const PageFaultAggregator::ProcessStats& process =
+      processes.find(kProcessId)->second;
+  EXPECT_EQ(2U, process.faults.total());
+  EXPECT_EQ(1U, process.faults.counts[HARD_FAULT]);
+  EXPECT_EQ(1U, process.faults.counts[DEMAND_ZERO_FAULT]);
+  EXPECT_EQ(1U, process.unattributed_faults);
+  EXPECT_EQ(2U, process.timeline.count());
+  EXPECT_EQ(1U, process.hard_fault_timeline.count());
+
+  // The other process has no modules loaded.
+  EXPECT_EQ(1U, processes.find(kOtherProcessId)->second.unattributed_faults);
+}
+
+TEST_F(PageFaultAggregatorTest, AttributesToModulePages) {
+  aggregator_.OnHardFault(kProcessId, kThreadId, TimeAt(10),
+                          kDllBase + 0x1234, 0);
+  aggregator_.OnHardFault(kProcessId, kThreadId, TimeAt(20),
+                          kDllBase + 0x1FFF, 0);
+  aggregator_.OnTransitionFault(kProcessId, kThreadId, TimeAt(30),
+                                kDllBase + 0x3000, 0);
+  // Just past the end of the module.
+  aggregator_.OnTransitionFault(kProcessId, kThreadId, TimeAt(30),
+                                kDllBase + 0x20000, 0);
+
+  // The same DLL loaded elsewhere in another process.
+  sym_util::ModuleInformation other_dll = dll_;
+  other_dll.base_address = kOtherDllBase;
+  aggregator_.OnModuleLoad(kOtherProcessId, TimeAt(40), other_dll);
+  aggregator_.OnHardFault(kOtherProcessId, kThreadId, TimeAt(50),
+                          kOtherDllBase + 0x1000, 0);
+
+  ASSERT_EQ(2U, aggregator_.modules().size());
+  std::vector<const PageFaultAggregator::ModuleStats*> modules;
+  aggregator_.GetHottestModules(10, &modules);
+  ASSERT_EQ(2U, modules.size());
+  EXPECT_EQ(dll_.image_file_name, modules[0]->module.image_file_name);
+  EXPECT_EQ(3U, modules[0]->faults.counts[HARD_FAULT]);
+  EXPECT_EQ(4U, modules[0]->faults.total());
+  EXPECT_EQ(0U, modules[1]->faults.total());
+
+  std::vector<const PageFaultAggregator::PageStats*> pages;
+  aggregator_.GetHottestPages(10, &pages);
+  ASSERT_EQ(2U, pages.size());
+  EXPECT_EQ(1U, pages[0]->page);
+  EXPECT_EQ(3U, pages[0]->faults.counts[HARD_FAULT]);
+  EXPECT_EQ(TimeAt(10), pages[0]->first_fault_time);
+  EXPECT_EQ(0x1234U, pages[0]->first_fault_offset);
+  EXPECT_EQ(3U, pages[1]->page);
+  EXPECT_EQ(1U, pages[1]->faults.total());
+  EXPECT_EQ(modules[0], &aggregator_.modules()[pages[0]->module]);
+
+  aggregator_.GetHottestPages(1, &pages);
+  EXPECT_EQ(1U, pages.size());
+}
+
+TEST_F(PageFaultAggregatorTest, FollowsUnloads) {
+  aggregator_.OnModuleUnload(kProcessId, TimeAt(100), dll_);
+  aggregator_.OnHardFault(kProcessId, kThreadId, TimeAt(50),
+                          kDllBase, 0);
+  aggregator_.OnHardFault(kProcessId, kThreadId, TimeAt(150),
+                          kDllBase, 0);
+
+  EXPECT_EQ(1U, aggregator_.processes().begin()->second.unattributed_faults);
+}
+
+TEST_F(PageFaultAggregatorTest, CountsHardFaultsAsReadsComplete) {
+  // Only the reads of hard faults are captured, and the thread events
+  // give their process.
+  aggregator_.OnThreadIsRunning(TimeAt(0), kProcessId, kThreadId);
+  for (int i = 0; i < 3; ++i) {
+    aggregator_.OnHardPageFault(kThreadId, TimeAt(10 + i), TimeAt(5), 0,
+                                kDllBase + 0x1000, 0,
+                                PageFaultAggregator::kPageSize);
+  }
+
+  const PageFaultAggregator::ProcessStats& process =
+      aggregator_.processes().find(kProcessId)->second;
+  EXPECT_EQ(3U, process.faults.counts[HARD_FAULT]);
+  EXPECT_EQ(3U, process.hard_fault_timeline.count());
+
+  std::vector<const PageFaultAggregator::ModuleStats*> modules;
+  aggregator_.GetHottestModules(1, &modules);
+  ASSERT_EQ(1U, modules.size());
+  EXPECT_EQ(dll_.image_file_name, modules[0]->module.image_file_name);
+  EXPECT_EQ(3U, modules[0]->faults.counts[HARD_FAULT]);
+
+  std::vector<const PageFaultAggregator::PageStats*> pages;
+  aggregator_.GetHottestPages(1, &pages);
+  ASSERT_EQ(1U, pages.size());
+  EXPECT_EQ(1U, pages[0]->page);
+  EXPECT_EQ(3U, pages[0]->faults.counts[HARD_FAULT]);
+
+  // Once the thread is gone, its faults can't be attributed.
+  aggregator_.OnThreadEnded(TimeAt(20), kProcessId, kThreadId);
+  aggregator_.OnHardPageFault(kThreadId, TimeAt(30), TimeAt(25), 0,
+                              kDllBase + 0x1000, 0,
+                              PageFaultAggregator::kPageSize);
+  EXPECT_EQ(3U, process.faults.counts[HARD_FAULT]);
+  EXPECT_EQ(1U, aggregator_.num_unattributed_hard_faults());
+}
+
+TEST_F(PageFaultAggregatorTest, CountsEachHardFaultOnce) {
+  // The fault as taken counts, and its read doesn't count it again.
+  aggregator_.OnHardFault(kProcessId, kThreadId, TimeAt(10),
+                          kDllBase + 0x1234, 0);
+  aggregator_.OnHardPageFault(kThreadId, TimeAt(20), TimeAt(10), 0,
+                              kDllBase + 0x1000, 0,
+                              PageFaultAggregator::kPageSize);
+
+  // A read with no fault taken before it counts, by the thread's process
+  // as given by its faults.
+  aggregator_.OnHardPageFault(kThreadId, TimeAt(30), TimeAt(25), 0,
+                              kDllBase + 0x5000, 0,
+                              PageFaultAggregator::kPageSize);
+
+  const PageFaultAggregator::ProcessStats& process =
+      aggregator_.processes().find(kProcessId)->second;
+  EXPECT_EQ(2U, process.faults.counts[HARD_FAULT]);
+  EXPECT_EQ(2U, aggregator_.pages().size());
+  EXPECT_EQ(0U, aggregator_.num_unattributed_hard_faults());
+}
+
+TEST_F(PageFaultAggregatorTest, CapsPages) {
+  PageFaultAggregator aggregator(2);
+  aggregator.OnModuleIsLoaded(kProcessId, TimeAt(0), dll_);
+  for (int i = 0; i < 4; ++i) {
+    aggregator.OnHardFault(kProcessId, kThreadId, TimeAt(10),
+                           kDllBase + i * PageFaultAggregator::kPageSize, 0);
+  }
+
+  EXPECT_EQ(2U, aggregator.pages().size());
+  EXPECT_EQ(2U, aggregator.num_untracked_page_faults());
+  EXPECT_EQ(4U, aggregator.modules()[0].faults.total());
+}
+
+}  // namespace
@@ -0,0 +1,273 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Recommends a page order for a module from the page faults it took in
+// one or more recorded runs, each an .etl file holding kernel page fault
+// and image load events. The order is written either as the RVAs of the
+// module's pages, one per line, or with --symbols, as the decorated names
+// of the functions first faulted on each page, which makes a linker order
+// file.
+#include <iostream>
+#include <map>
+#include <set>
+#include "base/at_exit.h"
+#include "base/command_line.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/strings/utf_string_conversions.h"
+#include "sawbuck/log_lib/etl_file_consumer.h"
+#include "sawbuck/log_lib/page_fault_aggregator.h"
+#include "sawbuck/log_lib/page_order_optimizer.h"
+#include "sawbuck/sym_util/symbol_cache.h"
+
+namespace {
+
+const char kModuleSwitch[] = "module";
+const char kOutputSwitch[] = "output";
+const char kSymbolsSwitch[] = "symbols";
+const char kSymbolPathSwitch[] = "symbol-path";
+const char kClusterPagesSwitch[] = "cluster-pages";
+
+const wchar_t kUsage[] =
+    L"Usage: page_order --module=<name> [options] <run.etl>...\n"
+    L"\n"
+    L"Options:\n"
+    L"  --output=<file>        Write the order here rather than stdout.\n"
+    L"  --symbols              Write function names, for a linker order\n"
+    L"                         file, rather than page RVAs.\n"
+    L"  --symbol-path=<path>   The symbol path to resolve names with.\n"
+    L"  --cluster-pages=<n>    The pages read per hard fault, for the\n"
+    L"                         hard fault prediction. Defaults to 8.\n";
+
+int Error(const std::wstring& error) {
+  std::wcerr << error << std::endl;
+
+  return 1;
+}
+
+// The module's pages, as faulted in the runs.
+struct ModulePages {
+  ModulePages() : found(false) {
+  }
+
+  // True iff the module was seen in any run.
+  bool found;
+  // The module, as first seen.
+  sym_util::ModuleInformation module;
+  // The offset of the first fault on each page, in the first run to
+  // fault the page.
+  std::map<uint32, sym_util::Offset> first_fault_offsets;
+};
+
+// Consumes the run in @p file_name, and adds the pages of the module
+// named @p module_name it faulted to @p optimizer and @p module_pages.
+// @returns an error message, or the empty string on success.
+std::wstring AddRun(const std::wstring& file_name,
+                    const base::FilePath::StringType& module_name,
+                    PageOrderOptimizer* optimizer,
+                    ModulePages* module_pages) {
+  EtlFileConsumer consumer;
+  HRESULT hr = consumer.OpenFileSession(file_name.c_str());
+  if (FAILED(hr)) {
+    return base::StringPrintf(L"Error 0x%08X, opening file \"%ls\"",
+                              hr, file_name.c_str());
+  }
+
+  PageFaultAggregator aggregator(PageFaultAggregator::kDefaultMaxPages);
+  consumer.set_module_event_sink(&aggregator);
+  consumer.set_page_fault_event_sink(&aggregator);
+  consumer.set_thread_event_sink(&aggregator);
+  hr = consumer.Consume();
+  if (FAILED(hr)) {
+    return base::StringPrintf(L"Error 0x%08X, consuming file \"%ls\"",
+                              hr, file_name.c_str());
+  }
+
+  const std::vector<PageFaultAggregator::ModuleStats>& modules =
+      aggregator.modules();
+  size_t module = 0;
+  for (; module < modules.size(); ++module) {
+    base::FilePath path(modules[module].module.image_file_name);
+    if (base::FilePath::CompareEqualIgnoreCase(path.BaseName().value(),
+                                               module_name)) {
+      break;
+    }
+  }
+  if (module == modules.size()) {
+    std::wcerr << L"Warning: \"" << file_name << L"\" has no faults in "
+               << module_name << L"." << std::endl;
+    return L"";
+  }
+
+  if (!module_pages->found) {
+    module_pages->found = true;
+    module_pages->module = modules[module].module;
+  }
+
+  PageOrderOptimizer::PageTouches touches;
+  const std::vector<PageFaultAggregator::PageStats>& pages =
+      aggregator.pages();
+  for (size_t i = 0; i < pages.size(); ++i) {
+    if (pages[i].module != module)
+      continue;
+
+    PageOrderOptimizer::PageTouch touch = {};
+    touch.page = pages[i].page;
+    touch.first_touch_time = pages[i].first_fault_time;
+    touch.hard_faults = pages[i].faults.counts[HARD_FAULT];
+    touches.push_back(touch);
+
+    // Keeps the offset of the first run to fault the page.
+    module_pages->first_fault_offsets.insert(
+        std::make_pair(pages[i].page, pages[i].first_fault_offset));
+  }
+  optimizer->AddRun(touches);
+
+  if (aggregator.num_untracked_page_faults() != 0) {
+    std::wcerr << L"Warning: \"" << file_name << L"\" faulted more pages "
+               << L"than are tracked." << std::endl;
+  }
+
+  return L"";
+}
+
+// Writes the functions first faulted on each page of @p order to
+// @p output, each function once.
+// @returns an error message, or the empty string on success.
+std::wstring WriteSymbols(const std::vector<uint32>& order,
+                          const ModulePages& module_pages,
+                          const std::wstring& symbol_path,
+                          std::string* output) {
+  sym_util::SymbolCache symbols;
+  if (!symbol_path.empty())
+    symbols.SetSymbolPath(symbol_path.c_str());
+
+  sym_util::ModuleInformation module = module_pages.module;
+  if (!symbols.Initialize(1, &module))
+    return L"Unable to initialize the symbol cache.";
+
+  std::set<std::wstring> written;
+  size_t unresolved = 0;
+  for (size_t i = 0; i < order.size(); ++i) {
+    std::map<uint32, sym_util::Offset>::const_iterator it =
+        module_pages.first_fault_offsets.find(order[i]);
+    DCHECK(it != module_pages.first_fault_offsets.end());
+
+    sym_util::Symbol symbol;
+    if (!symbols.GetSymbolForAddress(module.base_address + it->second,
+                                     &symbol)) {
+      ++unresolved;
+      continue;
+    }
+
+    const std::wstring& name =
+        symbol.mangled_name.empty() ? symbol.name : symbol.mangled_name;
+    if (written.insert(name).second) {
+      output->append(base::WideToUTF8(name));
+      output->append("\n");
+    }
+  }
+
+  if (unresolved != 0) {
+    std::wcerr << L"Warning: " << unresolved << L" pages didn't resolve "
+               << L"to a function." << std::endl;
+  }
+
+  return L"";
+}
+
+}  // namespace
+
+int wmain(int argc, const wchar_t** argv) {
+  base::AtExitManager at_exit;
+  CommandLine::Init(0, NULL);
+
+  CommandLine* cmd_line = CommandLine::ForCurrentProcess();
+  base::FilePath::StringType module_name =
+      cmd_line->GetSwitchValueNative(kModuleSwitch);
+  std::vector<std::wstring> args = cmd_line->GetArgs();
+  if (module_name.empty() || args.empty())
+    return Error(kUsage);
+
+  size_t cluster_pages = PageOrderOptimizer::kDefaultClusterPages;
+  if (cmd_line->HasSwitch(kClusterPagesSwitch) &&
+      (!base::StringToSizeT(
+           cmd_line->GetSwitchValueASCII(kClusterPagesSwitch),
+           &cluster_pages) ||
+       cluster_pages == 0)) {
+    return Error(kUsage);
+  }
+
+  PageOrderOptimizer optimizer(cluster_pages);
+  ModulePages module_pages;
+  for (size_t i = 0; i < args.size(); ++i) {
+    std::wstring error = AddRun(args[i], module_name, &optimizer,
+                                &module_pages);
+    if (!error.empty())
+      return Error(error);
+  }
+  if (!module_pages.found)
+    return Error(L"No run has faults in " + module_name + L".");
+
+  std::vector<uint32> order;
+  optimizer.ComputeOrder(&order);
+
+  PageOrderOptimizer::Prediction prediction = {};
+  optimizer.PredictHardFaults(order, &prediction);
+  std::wcerr << base::StringPrintf(
+      L"%Iu pages over %Iu runs.\n"
+      L"Hard faults observed: %I64u, predicted as laid out: %I64u, "
+      L"predicted in order: %I64u",
+      order.size(), optimizer.num_runs(), prediction.observed_hard_faults,
+      prediction.original_hard_faults, prediction.ordered_hard_faults);
+  if (prediction.original_hard_faults != 0) {
+    std::wcerr << base::StringPrintf(
+        L" (%.1f%% fewer)",
+        100.0 * (1.0 - static_cast<double>(prediction.ordered_hard_faults) /
+                 prediction.original_hard_faults));
+  }
+  std::wcerr << std::endl;
+
+  std::string output;
+  if (cmd_line->HasSwitch(kSymbolsSwitch)) {
+    std::wstring error = WriteSymbols(
+        order, module_pages, cmd_line->GetSwitchValueNative(kSymbolPathSwitch),
+        &output);
+    if (!error.empty())
+      return Error(error);
+  } else {
+    for (size_t i = 0; i < order.size(); ++i) {
+      output.append(base::StringPrintf(
+          "0x%08X\n",
+          static_cast<uint32>(order[i] * PageFaultAggregator::kPageSize)));
+    }
+  }
+
+  if (!cmd_line->HasSwitch(kOutputSwitch)) {
+    std::cout << output;
+    return 0;
+  }
+
+  base::FilePath output_path = cmd_line->GetSwitchValuePath(kOutputSwitch);
+  int size = static_cast<int>(output.size());
+  if (base::WriteFile(output_path, output.data(), size) != size) {
+    return Error(base::StringPrintf(L"Unable to write \"%ls\"",
+                                    output_path.value().c_str()));
+  }
+
+  return 0;
+}
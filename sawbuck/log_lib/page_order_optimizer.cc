@@ -0,0 +1,132 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Page order optimizer implementation.
+#include "sawbuck/log_lib/page_order_optimizer.h"
+
+#include <algorithm>
+#include <map>
+#include "base/logging.h"
+
+namespace {
+
+bool IsTouchedEarlier(const PageOrderOptimizer::PageTouch& a,
+                      const PageOrderOptimizer::PageTouch& b) {
+  if (a.first_touch_time != b.first_touch_time)
+    return a.first_touch_time < b.first_touch_time;
+  return a.page < b.page;
+}
+
+// A page and its score, ordered by score.
+struct ScoredPage {
+  bool operator<(const ScoredPage& other) const {
+    if (score != other.score)
+      return score < other.score;
+    return page < other.page;
+  }
+
+  double score;
+  uint32 page;
+};
+
+}  // namespace
+
+// static
+const size_t PageOrderOptimizer::kDefaultClusterPages;
+
+PageOrderOptimizer::PageOrderOptimizer(size_t cluster_pages)
+    : cluster_pages_(cluster_pages) {
+  DCHECK_LT(0U, cluster_pages);
+}
+
+PageOrderOptimizer::~PageOrderOptimizer() {
+}
+
+void PageOrderOptimizer::AddRun(const PageTouches& touches) {
+  runs_.push_back(touches);
+  std::sort(runs_.back().begin(), runs_.back().end(), IsTouchedEarlier);
+}
+
+void PageOrderOptimizer::ComputeOrder(std::vector<uint32>* pages) const {
+  DCHECK(pages != NULL);
+  pages->clear();
+
+  // Sum the scores of the pages over the runs that touch them, and count
+  // those runs.
+  typedef std::map<uint32, std::pair<double, size_t> > ScoreMap;
+  ScoreMap scores;
+  for (size_t i = 0; i < runs_.size(); ++i) {
+    const PageTouches& run = runs_[i];
+    for (size_t j = 0; j < run.size(); ++j) {
+      std::pair<double, size_t>& score = scores[run[j].page];
+      score.first += static_cast<double>(j) / run.size();
+      ++score.second;
+    }
+  }
+
+  // The runs that don't touch a page score it 1.
+  std::vector<ScoredPage> scored_pages;
+  ScoreMap::const_iterator it = scores.begin();
+  for (; it != scores.end(); ++it) {
+    ScoredPage scored_page = {};
+    scored_page.page = it->first;
+    scored_page.score = (it->second.first + runs_.size() - it->second.second) /
+        runs_.size();
+    scored_pages.push_back(scored_page);
+  }
+  std::sort(scored_pages.begin(), scored_pages.end());
+
+  for (size_t i = 0; i < scored_pages.size(); ++i)
+    pages->push_back(scored_pages[i].page);
+}
+
+void PageOrderOptimizer::PredictHardFaults(const std::vector<uint32>& order,
+                                           Prediction* prediction) const {
+  DCHECK(prediction != NULL);
+
+  std::map<uint32, uint32> positions;
+  for (size_t i = 0; i < order.size(); ++i)
+    positions[order[i]] = static_cast<uint32>(i);
+
+  prediction->observed_hard_faults = 0;
+  prediction->original_hard_faults = 0;
+  prediction->ordered_hard_faults = 0;
+  for (size_t i = 0; i < runs_.size(); ++i) {
+    const PageTouches& run = runs_[i];
+    std::vector<uint32> original;
+    std::vector<uint32> ordered;
+    for (size_t j = 0; j < run.size(); ++j) {
+      prediction->observed_hard_faults += run[j].hard_faults;
+      original.push_back(run[j].page);
+
+      std::map<uint32, uint32>::const_iterator it =
+          positions.find(run[j].page);
+      DCHECK(it != positions.end());
+      ordered.push_back(it->second);
+    }
+
+    prediction->original_hard_faults += CountClusters(original);
+    prediction->ordered_hard_faults += CountClusters(ordered);
+  }
+}
+
+size_t PageOrderOptimizer::CountClusters(
+    const std::vector<uint32>& positions) const {
+  std::vector<uint32> clusters;
+  for (size_t i = 0; i < positions.size(); ++i)
+    clusters.push_back(static_cast<uint32>(positions[i] / cluster_pages_));
+
+  std::sort(clusters.begin(), clusters.end());
+  return std::unique(clusters.begin(), clusters.end()) - clusters.begin();
+}
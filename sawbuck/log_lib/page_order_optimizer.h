@@ -0,0 +1,90 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Page order optimizer declaration.
+#ifndef SAWBUCK_LOG_LIB_PAGE_ORDER_OPTIMIZER_H_
+#define SAWBUCK_LOG_LIB_PAGE_ORDER_OPTIMIZER_H_
+
+#include <vector>
+#include "base/basictypes.h"
+#include "base/time/time.h"
+
+// Recommends an order for the pages of a module, such that the pages
+// touched early in its runs come first, from the pages touched in each of
+// several runs.
+//
+// Each page is scored by its position in the first touch order of each
+// run, normalized to [0, 1), with runs that don't touch the page scoring
+// it 1. Pages go in order of their mean score. Pages touched early in
+// every run thus lead, and pages touched in few runs trail.
+//
+// The hard faults of an order are predicted by assuming that each hard
+// fault reads a cluster of cluster_pages pages, so that a run takes as
+// many hard faults as the distinct clusters it touches.
+class PageOrderOptimizer {
+ public:
+  // The pages read on a hard fault on an image page, by default.
+  static const size_t kDefaultClusterPages = 8;
+
+  // A page, as touched in a run.
+  struct PageTouch {
+    // The page's index in the module.
+    uint32 page;
+    base::Time first_touch_time;
+    uint64 hard_faults;
+  };
+  typedef std::vector<PageTouch> PageTouches;
+
+  // The hard faults of a module, summed over the runs.
+  struct Prediction {
+    // As observed in the runs.
+    uint64 observed_hard_faults;
+    // As predicted for the pages in their original order.
+    uint64 original_hard_faults;
+    // As predicted for the pages in the recommended order.
+    uint64 ordered_hard_faults;
+  };
+
+  explicit PageOrderOptimizer(size_t cluster_pages);
+  ~PageOrderOptimizer();
+
+  // Adds a run that touched @p touches, which should hold each page no
+  // more than once.
+  void AddRun(const PageTouches& touches);
+
+  // @returns the number of runs added.
+  size_t num_runs() const { return runs_.size(); }
+
+  // Computes the recommended order of the pages touched in any run.
+  // @param pages returns the pages, in order.
+  void ComputeOrder(std::vector<uint32>* pages) const;
+
+  // Predicts the hard faults of the runs, were the module laid out with
+  // @p order, which must hold the pages touched in any run.
+  // @param prediction returns the prediction.
+  void PredictHardFaults(const std::vector<uint32>& order,
+                         Prediction* prediction) const;
+
+ private:
+  // @returns the number of distinct clusters among @p positions.
+  size_t CountClusters(const std::vector<uint32>& positions) const;
+
+  size_t cluster_pages_;
+  // The pages each run touched, in the order they were first touched.
+  std::vector<PageTouches> runs_;
+
+  DISALLOW_COPY_AND_ASSIGN(PageOrderOptimizer);
+};
+
+#endif  // SAWBUCK_LOG_LIB_PAGE_ORDER_OPTIMIZER_H_
@@ -0,0 +1,99 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/log_lib/page_order_optimizer.h"
+
+#include <algorithm>
+#include "gtest/gtest.h"
+
+namespace {
+
+// Makes the touches of a run that touches @p pages in order, with a hard
+// fault each.
+PageOrderOptimizer::PageTouches MakeRun(const uint32* pages,
+                                        size_t num_pages) {
+  PageOrderOptimizer::PageTouches touches;
+  for (size_t i = 0; i < num_pages; ++i) {
+    PageOrderOptimizer::PageTouch touch = {};
+    touch.page = pages[i];
+    touch.first_touch_time = base::Time::FromInternalValue(100 + i);
+    touch.hard_faults = 1;
+    touches.push_back(touch);
+  }
+
+  // Add the run out of order, as the optimizer orders by time.
+  std::reverse(touches.begin(), touches.end());
+  return touches;
+}
+
+TEST(PageOrderOptimizerTest, Empty) {
+  PageOrderOptimizer optimizer(PageOrderOptimizer::kDefaultClusterPages);
+  std::vector<uint32> order(1);
+  optimizer.ComputeOrder(&order);
+  EXPECT_TRUE(order.empty());
+
+  PageOrderOptimizer::Prediction prediction = {};
+  optimizer.PredictHardFaults(order, &prediction);
+  EXPECT_EQ(0U, prediction.observed_hard_faults);
+  EXPECT_EQ(0U, prediction.ordered_hard_faults);
+}
+
+TEST(PageOrderOptimizerTest, OrdersByFirstTouch) {
+  PageOrderOptimizer optimizer(PageOrderOptimizer::kDefaultClusterPages);
+  const uint32 kRun[] = { 40, 3, 17 };
+  optimizer.AddRun(MakeRun(kRun, arraysize(kRun)));
+  EXPECT_EQ(1U, optimizer.num_runs());
+
+  std::vector<uint32> order;
+  optimizer.ComputeOrder(&order);
+  ASSERT_EQ(3U, order.size());
+  EXPECT_EQ(40U, order[0]);
+  EXPECT_EQ(3U, order[1]);
+  EXPECT_EQ(17U, order[2]);
+}
+
+TEST(PageOrderOptimizerTest, CommonPagesLead) {
+  PageOrderOptimizer optimizer(PageOrderOptimizer::kDefaultClusterPages);
+  // Page 9 is touched first in one run only, page 5 early in both.
+  const uint32 kFirstRun[] = { 9, 5, 6 };
+  const uint32 kSecondRun[] = { 5, 6 };
+  optimizer.AddRun(MakeRun(kFirstRun, arraysize(kFirstRun)));
+  optimizer.AddRun(MakeRun(kSecondRun, arraysize(kSecondRun)));
+
+  std::vector<uint32> order;
+  optimizer.ComputeOrder(&order);
+  ASSERT_EQ(3U, order.size());
+  EXPECT_EQ(5U, order[0]);
+  EXPECT_EQ(9U, order[1]);
+  EXPECT_EQ(6U, order[2]);
+}
+
+TEST(PageOrderOptimizerTest, PredictsHardFaults) {
+  PageOrderOptimizer optimizer(4);
+  // Scattered pages, in four clusters of four.
+  const uint32 kRun[] = { 0, 5, 10, 15 };
+  optimizer.AddRun(MakeRun(kRun, arraysize(kRun)));
+  optimizer.AddRun(MakeRun(kRun, arraysize(kRun)));
+
+  std::vector<uint32> order;
+  optimizer.ComputeOrder(&order);
+  PageOrderOptimizer::Prediction prediction = {};
+  optimizer.PredictHardFaults(order, &prediction);
+
+  EXPECT_EQ(8U, prediction.observed_hard_faults);
+  EXPECT_EQ(8U, prediction.original_hard_faults);
+  // Packed together, each run's pages fit one cluster.
+  EXPECT_EQ(2U, prediction.ordered_hard_faults);
+}
+
+}  // namespace
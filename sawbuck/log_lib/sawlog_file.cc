@@ -0,0 +1,591 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Saved log session (.sawlog) file implementation.
+#include "sawbuck/log_lib/sawlog_file.h"
+
+#include <string.h>
+#include <string>
+#include "base/files/file.h"
+#include "base/memory/scoped_vector.h"
+#include "sawbuck/common/string_table.h"
+#include "sawbuck/common/trace_table.h"
+
+namespace {
+
+const uint64 kSectionAlignment = 8;
+const size_t kWriteBufferSize = 64 * 1024;
+
+uint64 AlignUp(uint64 value) {
+  return (value + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+
+// Buffers sequential writes to one section of a file.
+class SectionWriter {
+ public:
+  SectionWriter(base::File* file, uint64 offset)
+      : file_(file), offset_(offset), failed_(false) {
+  }
+
+  void Append(const void* data, size_t size) {
+    buffer_.append(reinterpret_cast<const char*>(data), size);
+    if (buffer_.size() >= kWriteBufferSize)
+      Flush();
+  }
+
+  template <typename T>
+  void AppendValue(const T& value) {
+    Append(&value, sizeof(value));
+  }
+
+  // @returns true iff all appended data has been written.
+  bool Flush() {
+    if (!buffer_.empty() && !failed_) {
+      int size = static_cast<int>(buffer_.size());
+      failed_ = file_->Write(offset_, buffer_.data(), size) != size;
+      offset_ += size;
+    }
+    buffer_.clear();
+    return !failed_;
+  }
+
+ private:
+  base::File* file_;
+  uint64 offset_;
+  std::string buffer_;
+  bool failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(SectionWriter);
+};
+
+// Sets @p sizes to the sizes of the sections of a file with the counts of
+// @p header, and heaps of the given sizes.
+void GetSectionSizes(const SawlogHeader& header,
+                     uint64 message_text_size,
+                     uint64 file_name_text_size,
+                     uint64 num_trace_frames,
+                     uint64 sizes[SawlogHeader::NUM_SECTIONS]) {
+  const uint64 num_rows = header.num_rows;
+  sizes[SawlogHeader::TIMES] = num_rows * sizeof(int64);
+  sizes[SawlogHeader::PROCESS_IDS] = num_rows * sizeof(uint32);
+  sizes[SawlogHeader::THREAD_IDS] = num_rows * sizeof(uint32);
+  sizes[SawlogHeader::LEVELS] = num_rows * sizeof(uint8);
+  sizes[SawlogHeader::LINES] = num_rows * sizeof(int32);
+  sizes[SawlogHeader::FILE_IDS] = num_rows * sizeof(uint32);
+  sizes[SawlogHeader::TRACE_IDS] = num_rows * sizeof(uint32);
+  sizes[SawlogHeader::MESSAGE_OFFSETS] = (num_rows + 1) * sizeof(uint64);
+  sizes[SawlogHeader::MESSAGE_TEXT] = message_text_size;
+  sizes[SawlogHeader::FILE_NAME_OFFSETS] =
+      (header.num_file_names + 1) * sizeof(uint32);
+  sizes[SawlogHeader::FILE_NAME_TEXT] = file_name_text_size;
+  sizes[SawlogHeader::TRACE_OFFSETS] =
+      (header.num_traces + 1) * sizeof(uint32);
+  sizes[SawlogHeader::TRACE_FRAMES] = num_trace_frames * sizeof(void*);
+}
+
+// Checks that @p header heads a .sawlog file of @p length bytes that we
+// can read, and that its sections fit the file. Logs why not otherwise.
+// @returns true on success.
+bool ValidateHeader(const SawlogHeader& header,
+                    uint64 length,
+                    const base::FilePath& path) {
+  if (memcmp(header.magic, SawlogHeader::kMagic, sizeof(header.magic)) != 0 ||
+      header.version != SawlogHeader::kVersion) {
+    LOG(ERROR) << path.value() << " is not a saved log session.";
+    return false;
+  }
+  if (header.pointer_size != sizeof(void*)) {
+    LOG(ERROR) << path.value() << " was saved by a "
+               << header.pointer_size * 8 << " bit Sawbuck.";
+    return false;
+  }
+
+  // Every row, file name and trace takes at least a byte, so the counts
+  // are bounded by the file size, and the section sizes can't overflow.
+  const uint64 frames_size = header.sections[SawlogHeader::TRACE_FRAMES].size;
+  if (header.num_rows > length ||
+      header.num_file_names == 0 || header.num_file_names > length ||
+      header.num_traces == 0 || header.num_traces > length ||
+      frames_size % sizeof(void*) != 0) {
+    LOG(ERROR) << path.value() << " is corrupt.";
+    return false;
+  }
+
+  uint64 sizes[SawlogHeader::NUM_SECTIONS] = {};
+  GetSectionSizes(header,
+                  header.sections[SawlogHeader::MESSAGE_TEXT].size,
+                  header.sections[SawlogHeader::FILE_NAME_TEXT].size,
+                  frames_size / sizeof(void*),
+                  sizes);
+  for (size_t i = 0; i < SawlogHeader::NUM_SECTIONS; ++i) {
+    const SawlogHeader::SectionInfo& info = header.sections[i];
+    if (info.size != sizes[i] ||
+        info.offset % kSectionAlignment != 0 ||
+        info.offset > length ||
+        info.size > length - info.offset) {
+      LOG(ERROR) << path.value() << " is corrupt.";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Reads @p count values from value @p first on of the section @p info
+// of @p file into @p values.
+// @returns true on success.
+template <typename T>
+bool ReadValues(base::File* file,
+                const SawlogHeader::SectionInfo& info,
+                uint64 first,
+                size_t count,
+                std::vector<T>* values) {
+  DCHECK_LE((first + count) * sizeof(T), info.size);
+  values->resize(count);
+  if (count == 0)
+    return true;
+
+  if (count > kint32max / sizeof(T))
+    return false;
+  int size = static_cast<int>(count * sizeof(T));
+  return file->Read(info.offset + first * sizeof(T),
+                    reinterpret_cast<char*>(&(*values)[0]),
+                    size) == size;
+}
+
+}  // namespace
+
+// static
+const char SawlogHeader::kMagic[8] = { 'S', 'A', 'W', 'L', 'O', 'G', '0', '1' };
+
+// static
+bool SawlogWriter::Write(const base::FilePath& path,
+                         const SawlogRowSource& source) {
+  // Deduplicate the file names and traces, and size the message text.
+  const size_t num_rows = source.num_rows();
+  StringTable file_names;
+  TraceTable traces;
+  uint64 message_text_size = 0;
+  SawlogRow row;
+  for (size_t i = 0; i < num_rows; ++i) {
+    source.GetRow(i, &row);
+    file_names.Intern(row.file);
+    traces.Intern(row.trace, row.trace_depth);
+    message_text_size += row.message.size();
+  }
+
+  uint64 file_name_text_size = 0;
+  for (size_t i = 0; i < file_names.size(); ++i)
+    file_name_text_size += file_names.Get(i).size();
+  uint64 num_trace_frames = 0;
+  for (size_t i = 0; i < traces.size(); ++i)
+    num_trace_frames += traces.depth(i);
+  if (file_name_text_size > kuint32max || num_trace_frames > kuint32max) {
+    LOG(ERROR) << "Too many file names or traces to save.";
+    return false;
+  }
+
+  SawlogHeader header = {};
+  memcpy(header.magic, SawlogHeader::kMagic, sizeof(header.magic));
+  header.version = SawlogHeader::kVersion;
+  header.pointer_size = sizeof(void*);
+  header.num_rows = num_rows;
+  header.num_file_names = file_names.size();
+  header.num_traces = traces.size();
+
+  uint64 sizes[SawlogHeader::NUM_SECTIONS] = {};
+  GetSectionSizes(header, message_text_size, file_name_text_size,
+                  num_trace_frames, sizes);
+  uint64 offset = AlignUp(sizeof(header));
+  for (size_t i = 0; i < SawlogHeader::NUM_SECTIONS; ++i) {
+    header.sections[i].offset = offset;
+    header.sections[i].size = sizes[i];
+    offset = AlignUp(offset + sizes[i]);
+  }
+  const uint64 file_size = offset;
+
+  base::File file(path,
+                  base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+  if (!file.IsValid()) {
+    LOG(ERROR) << "Unable to create " << path.value() << ".";
+    return false;
+  }
+
+  ScopedVector<SectionWriter> writers;
+  for (size_t i = 0; i < SawlogHeader::NUM_SECTIONS; ++i)
+    writers.push_back(new SectionWriter(&file, header.sections[i].offset));
+
+  // Fill the per row sections.
+  uint64 message_offset = 0;
+  for (size_t i = 0; i < num_rows; ++i) {
+    source.GetRow(i, &row);
+    writers[SawlogHeader::TIMES]->AppendValue(row.time.ToInternalValue());
+    writers[SawlogHeader::PROCESS_IDS]->AppendValue<uint32>(row.process_id);
+    writers[SawlogHeader::THREAD_IDS]->AppendValue<uint32>(row.thread_id);
+    writers[SawlogHeader::LEVELS]->AppendValue<uint8>(row.level);
+    writers[SawlogHeader::LINES]->AppendValue<int32>(row.line);
+    writers[SawlogHeader::FILE_IDS]->AppendValue(
+        file_names.Intern(row.file));
+    writers[SawlogHeader::TRACE_IDS]->AppendValue(
+        traces.Intern(row.trace, row.trace_depth));
+    writers[SawlogHeader::MESSAGE_OFFSETS]->AppendValue(message_offset);
+    writers[SawlogHeader::MESSAGE_TEXT]->Append(row.message.data(),
+                                                row.message.size());
+    message_offset += row.message.size();
+  }
+  writers[SawlogHeader::MESSAGE_OFFSETS]->AppendValue(message_offset);
+
+  if (message_offset != message_text_size ||
+      file_names.size() != header.num_file_names ||
+      traces.size() != header.num_traces) {
+    LOG(ERROR) << "The log changed while it was being saved.";
+    return false;
+  }
+
+  uint32 file_name_offset = 0;
+  for (size_t i = 0; i < file_names.size(); ++i) {
+    base::StringPiece file_name = file_names.Get(i);
+    writers[SawlogHeader::FILE_NAME_OFFSETS]->AppendValue(file_name_offset);
+    writers[SawlogHeader::FILE_NAME_TEXT]->Append(file_name.data(),
+                                                  file_name.size());
+    file_name_offset += file_name.size();
+  }
+  writers[SawlogHeader::FILE_NAME_OFFSETS]->AppendValue(file_name_offset);
+
+  uint32 trace_offset = 0;
+  for (size_t i = 0; i < traces.size(); ++i) {
+    writers[SawlogHeader::TRACE_OFFSETS]->AppendValue(trace_offset);
+    writers[SawlogHeader::TRACE_FRAMES]->Append(
+        traces.frames(i), traces.depth(i) * sizeof(void*));
+    trace_offset += traces.depth(i);
+  }
+  writers[SawlogHeader::TRACE_OFFSETS]->AppendValue(trace_offset);
+
+  bool success = true;
+  for (size_t i = 0; i < writers.size(); ++i)
+    success = writers[i]->Flush() && success;
+
+  // Now that the sections are in place, write the header.
+  if (!success ||
+      !file.SetLength(file_size) ||
+      file.Write(0, reinterpret_cast<const char*>(&header), sizeof(header)) !=
+          sizeof(header)) {
+    LOG(ERROR) << "Unable to write " << path.value() << ".";
+    return false;
+  }
+
+  return true;
+}
+
+SawlogFile::SawlogFile()
+    : num_rows_(0),
+      times_(NULL),
+      process_ids_(NULL),
+      thread_ids_(NULL),
+      levels_(NULL),
+      lines_(NULL),
+      file_ids_(NULL),
+      trace_ids_(NULL),
+      message_offsets_(NULL),
+      message_text_(NULL),
+      message_text_size_(0),
+      num_file_names_(0),
+      file_name_offsets_(NULL),
+      file_name_text_(NULL),
+      file_name_text_size_(0),
+      num_traces_(0),
+      trace_offsets_(NULL),
+      trace_frames_(NULL),
+      num_trace_frames_(0) {
+}
+
+SawlogFile::~SawlogFile() {
+}
+
+bool SawlogFile::Open(const base::FilePath& path) {
+  DCHECK_EQ(0U, num_rows_);
+  if (!file_.Initialize(path)) {
+    LOG(ERROR) << "Unable to map " << path.value() << ".";
+    return false;
+  }
+
+  if (file_.length() < sizeof(SawlogHeader)) {
+    LOG(ERROR) << path.value() << " is not a saved log session.";
+    return false;
+  }
+
+  const SawlogHeader& header =
+      *reinterpret_cast<const SawlogHeader*>(file_.data());
+  if (!ValidateHeader(header, file_.length(), path))
+    return false;
+
+  const uint8* data = file_.data();
+  const SawlogHeader::SectionInfo* sections = header.sections;
+  num_rows_ = static_cast<size_t>(header.num_rows);
+  times_ = reinterpret_cast<const int64*>(
+      data + sections[SawlogHeader::TIMES].offset);
+  process_ids_ = reinterpret_cast<const uint32*>(
+      data + sections[SawlogHeader::PROCESS_IDS].offset);
+  thread_ids_ = reinterpret_cast<const uint32*>(
+      data + sections[SawlogHeader::THREAD_IDS].offset);
+  levels_ = data + sections[SawlogHeader::LEVELS].offset;
+  lines_ = reinterpret_cast<const int32*>(
+      data + sections[SawlogHeader::LINES].offset);
+  file_ids_ = reinterpret_cast<const uint32*>(
+      data + sections[SawlogHeader::FILE_IDS].offset);
+  trace_ids_ = reinterpret_cast<const uint32*>(
+      data + sections[SawlogHeader::TRACE_IDS].offset);
+  message_offsets_ = reinterpret_cast<const uint64*>(
+      data + sections[SawlogHeader::MESSAGE_OFFSETS].offset);
+  message_text_ = reinterpret_cast<const char*>(
+      data + sections[SawlogHeader::MESSAGE_TEXT].offset);
+  message_text_size_ = sections[SawlogHeader::MESSAGE_TEXT].size;
+
+  num_file_names_ = static_cast<size_t>(header.num_file_names);
+  file_name_offsets_ = reinterpret_cast<const uint32*>(
+      data + sections[SawlogHeader::FILE_NAME_OFFSETS].offset);
+  file_name_text_ = reinterpret_cast<const char*>(
+      data + sections[SawlogHeader::FILE_NAME_TEXT].offset);
+  file_name_text_size_ = sections[SawlogHeader::FILE_NAME_TEXT].size;
+
+  num_traces_ = static_cast<size_t>(header.num_traces);
+  trace_offsets_ = reinterpret_cast<const uint32*>(
+      data + sections[SawlogHeader::TRACE_OFFSETS].offset);
+  trace_frames_ = reinterpret_cast<void* const*>(
+      data + sections[SawlogHeader::TRACE_FRAMES].offset);
+  num_trace_frames_ = sections[SawlogHeader::TRACE_FRAMES].size /
+      sizeof(void*);
+
+  return true;
+}
+
+base::StringPiece SawlogFile::message(size_t row) const {
+  DCHECK_LT(row, num_rows_);
+  // The offsets are checked here, rather than on open, to keep opening
+  // independent of the number of rows.
+  uint64 begin = message_offsets_[row];
+  uint64 end = message_offsets_[row + 1];
+  if (begin > end || end > message_text_size_)
+    return base::StringPiece();
+
+  return base::StringPiece(message_text_ + begin,
+                           static_cast<size_t>(end - begin));
+}
+
+void* const* SawlogFile::trace(size_t row, size_t* depth) const {
+  DCHECK_LT(row, num_rows_);
+  DCHECK(depth != NULL);
+  *depth = 0;
+  uint32 trace_id = trace_ids_[row];
+  if (trace_id >= num_traces_)
+    return NULL;
+
+  uint32 begin = trace_offsets_[trace_id];
+  uint32 end = trace_offsets_[trace_id + 1];
+  if (begin >= end || end > num_trace_frames_)
+    return NULL;
+
+  *depth = end - begin;
+  return trace_frames_ + begin;
+}
+
+base::StringPiece SawlogFile::GetFileName(uint32 file_id) const {
+  if (file_id >= num_file_names_)
+    return base::StringPiece();
+
+  uint32 begin = file_name_offsets_[file_id];
+  uint32 end = file_name_offsets_[file_id + 1];
+  if (begin > end || end > file_name_text_size_)
+    return base::StringPiece();
+
+  return base::StringPiece(file_name_text_ + begin, end - begin);
+}
+
+SawlogPage::SawlogPage() : first_row(0) {
+}
+
+void SawlogPage::Reset(size_t first_row, size_t num_rows) {
+  this->first_row = first_row;
+  times.assign(num_rows, 0);
+  process_ids.assign(num_rows, 0);
+  thread_ids.assign(num_rows, 0);
+  levels.assign(num_rows, 0);
+  lines.assign(num_rows, 0);
+  file_ids.assign(num_rows, 0);
+  trace_ids.assign(num_rows, 0);
+  message_offsets.assign(num_rows + 1, 0);
+  message_text.clear();
+}
+
+base::StringPiece SawlogPage::message(size_t index) const {
+  DCHECK_LT(index, num_rows());
+  // As in SawlogFile, the offsets are checked as they're read.
+  uint64 text_begin = message_offsets[0];
+  uint64 begin = message_offsets[index];
+  uint64 end = message_offsets[index + 1];
+  if (begin < text_begin || begin > end ||
+      end - text_begin > message_text.size()) {
+    return base::StringPiece();
+  }
+
+  return base::StringPiece(
+      message_text.data() + static_cast<size_t>(begin - text_begin),
+      static_cast<size_t>(end - begin));
+}
+
+size_t SawlogPage::bytes() const {
+  return times.capacity() * sizeof(times[0]) +
+      process_ids.capacity() * sizeof(process_ids[0]) +
+      thread_ids.capacity() * sizeof(thread_ids[0]) +
+      levels.capacity() * sizeof(levels[0]) +
+      lines.capacity() * sizeof(lines[0]) +
+      file_ids.capacity() * sizeof(file_ids[0]) +
+      trace_ids.capacity() * sizeof(trace_ids[0]) +
+      message_offsets.capacity() * sizeof(message_offsets[0]) +
+      message_text.capacity();
+}
+
+SawlogPageReader::SawlogPageReader() : num_rows_(0) {
+  memset(&header_, 0, sizeof(header_));
+}
+
+SawlogPageReader::~SawlogPageReader() {
+}
+
+bool SawlogPageReader::Open(const base::FilePath& path) {
+  DCHECK(!file_.IsValid());
+  file_.Initialize(path, base::File::FLAG_OPEN | base::File::FLAG_READ);
+  if (!file_.IsValid()) {
+    LOG(ERROR) << "Unable to open " << path.value() << ".";
+    return false;
+  }
+
+  int64 length = file_.GetLength();
+  if (length < static_cast<int64>(sizeof(header_)) ||
+      file_.Read(0, reinterpret_cast<char*>(&header_), sizeof(header_)) !=
+          static_cast<int>(sizeof(header_))) {
+    LOG(ERROR) << path.value() << " is not a saved log session.";
+    return false;
+  }
+  if (!ValidateHeader(header_, length, path))
+    return false;
+
+  // Read the file names and traces the rows refer to.
+  const SawlogHeader::SectionInfo* sections = header_.sections;
+  std::vector<char> file_name_text;
+  if (!ReadValues(&file_, sections[SawlogHeader::FILE_NAME_OFFSETS], 0,
+                  static_cast<size_t>(header_.num_file_names + 1),
+                  &file_name_offsets_) ||
+      !ReadValues(&file_, sections[SawlogHeader::FILE_NAME_TEXT], 0,
+                  static_cast<size_t>(
+                      sections[SawlogHeader::FILE_NAME_TEXT].size),
+                  &file_name_text) ||
+      !ReadValues(&file_, sections[SawlogHeader::TRACE_OFFSETS], 0,
+                  static_cast<size_t>(header_.num_traces + 1),
+                  &trace_offsets_) ||
+      !ReadValues(&file_, sections[SawlogHeader::TRACE_FRAMES], 0,
+                  static_cast<size_t>(
+                      sections[SawlogHeader::TRACE_FRAMES].size /
+                          sizeof(void*)),
+                  &trace_frames_)) {
+    LOG(ERROR) << "Unable to read " << path.value() << ".";
+    return false;
+  }
+  file_name_text_.assign(file_name_text.begin(), file_name_text.end());
+
+  num_rows_ = static_cast<size_t>(header_.num_rows);
+  return true;
+}
+
+bool SawlogPageReader::ReadPage(size_t first_row,
+                                size_t num_rows,
+                                bool read_messages,
+                                SawlogPage* page) {
+  DCHECK_LE(first_row + num_rows, num_rows_);
+  DCHECK(page != NULL);
+  page->first_row = first_row;
+
+  const SawlogHeader::SectionInfo* sections = header_.sections;
+  bool success =
+      ReadValues(&file_, sections[SawlogHeader::TIMES], first_row,
+                 num_rows, &page->times) &&
+      ReadValues(&file_, sections[SawlogHeader::PROCESS_IDS], first_row,
+                 num_rows, &page->process_ids) &&
+      ReadValues(&file_, sections[SawlogHeader::THREAD_IDS], first_row,
+                 num_rows, &page->thread_ids) &&
+      ReadValues(&file_, sections[SawlogHeader::LEVELS], first_row,
+                 num_rows, &page->levels) &&
+      ReadValues(&file_, sections[SawlogHeader::LINES], first_row,
+                 num_rows, &page->lines) &&
+      ReadValues(&file_, sections[SawlogHeader::FILE_IDS], first_row,
+                 num_rows, &page->file_ids) &&
+      ReadValues(&file_, sections[SawlogHeader::TRACE_IDS], first_row,
+                 num_rows, &page->trace_ids);
+
+  page->message_offsets.assign(num_rows + 1, 0);
+  page->message_text.clear();
+  if (success && read_messages) {
+    success = ReadValues(&file_, sections[SawlogHeader::MESSAGE_OFFSETS],
+                         first_row, num_rows + 1, &page->message_offsets);
+
+    // Text past the section, or a page of text past 2 GB, leaves the
+    // page's messages empty, as bad offsets do in SawlogFile.
+    uint64 begin = page->message_offsets[0];
+    uint64 end = page->message_offsets[num_rows];
+    const SawlogHeader::SectionInfo& text =
+        sections[SawlogHeader::MESSAGE_TEXT];
+    if (success && begin < end && end <= text.size &&
+        end - begin <= static_cast<uint64>(kint32max)) {
+      int size = static_cast<int>(end - begin);
+      page->message_text.resize(size);
+      success = file_.Read(text.offset + begin, &page->message_text[0],
+                           size) == size;
+    }
+  }
+
+  if (!success) {
+    page->Reset(first_row, num_rows);
+    return false;
+  }
+
+  return true;
+}
+
+base::StringPiece SawlogPageReader::GetFileName(uint32 file_id) const {
+  if (file_name_offsets_.empty() || file_id >= file_name_offsets_.size() - 1)
+    return base::StringPiece();
+
+  uint32 begin = file_name_offsets_[file_id];
+  uint32 end = file_name_offsets_[file_id + 1];
+  if (begin > end || end > file_name_text_.size())
+    return base::StringPiece();
+
+  return base::StringPiece(file_name_text_.data() + begin, end - begin);
+}
+
+void* const* SawlogPageReader::GetTrace(uint32 trace_id,
+                                        size_t* depth) const {
+  DCHECK(depth != NULL);
+  *depth = 0;
+  if (trace_offsets_.empty() || trace_id >= trace_offsets_.size() - 1)
+    return NULL;
+
+  uint32 begin = trace_offsets_[trace_id];
+  uint32 end = trace_offsets_[trace_id + 1];
+  if (begin >= end || end > trace_frames_.size())
+    return NULL;
+
+  *depth = end - begin;
+  return &trace_frames_[begin];
+}
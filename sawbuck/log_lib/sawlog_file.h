@@ -0,0 +1,289 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Saved log session (.sawlog) file declarations.
+#ifndef SAWBUCK_LOG_LIB_SAWLOG_FILE_H_
+#define SAWBUCK_LOG_LIB_SAWLOG_FILE_H_
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include "base/basictypes.h"
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/logging.h"
+#include "base/strings/string_piece.h"
+#include "base/time/time.h"
+
+// A .sawlog file holds a saved session of log messages, as the viewer
+// shows them, laid out by column so that it can be mapped and read in
+// place. It starts with a SawlogHeader, which locates the sections that
+// follow. Each section starts on an 8 byte boundary.
+//
+// The per-row sections are arrays indexed by row. File names and stack
+// traces are deduplicated, rows refer to them by id, and id 0 is always
+// the empty file name or trace. Message text and file names are packed
+// into heaps, and located by arrays of offsets into those, with one more
+// offset than entries, so that entry i spans offsets i to i + 1.
+struct SawlogHeader {
+  enum Section {
+    // Per row: base::Time internal values as int64, process and thread
+    // ids as uint32, levels as uint8, lines as int32, and file name and
+    // trace ids as uint32.
+    TIMES,
+    PROCESS_IDS,
+    THREAD_IDS,
+    LEVELS,
+    LINES,
+    FILE_IDS,
+    TRACE_IDS,
+    // uint64 offsets of each row's message into MESSAGE_TEXT.
+    MESSAGE_OFFSETS,
+    MESSAGE_TEXT,
+    // uint32 offsets of each file name into FILE_NAME_TEXT.
+    FILE_NAME_OFFSETS,
+    FILE_NAME_TEXT,
+    // uint32 indexes of each trace's first frame in TRACE_FRAMES, and
+    // the frames themselves, pointer_size bytes each.
+    TRACE_OFFSETS,
+    TRACE_FRAMES,
+    NUM_SECTIONS
+  };
+
+  struct SectionInfo {
+    uint64 offset;
+    uint64 size;
+  };
+
+  static const char kMagic[8];
+  static const uint32 kVersion = 1;
+
+  char magic[8];
+  uint32 version;
+  // The size of the stack trace frames. Stack traces hold addresses in
+  // the logging processes, so a file is only opened by a reader with the
+  // same pointer size.
+  uint32 pointer_size;
+  uint64 num_rows;
+  uint64 num_file_names;
+  uint64 num_traces;
+  SectionInfo sections[NUM_SECTIONS];
+};
+
+// A row to write to a .sawlog file.
+struct SawlogRow {
+  SawlogRow() : level(0), process_id(0), thread_id(0), line(0),
+      trace(NULL), trace_depth(0) {
+  }
+
+  UCHAR level;
+  DWORD process_id;
+  DWORD thread_id;
+  base::Time time;
+  int line;
+  base::StringPiece file;
+  base::StringPiece message;
+  void* const* trace;
+  size_t trace_depth;
+};
+
+// Implemented by clients of SawlogWriter to supply the rows to write.
+class SawlogRowSource {
+ public:
+  virtual ~SawlogRowSource() {
+  }
+
+  // @returns the number of rows.
+  virtual size_t num_rows() const = 0;
+
+  // Retrieves row @p index. The strings and trace of @p row need only
+  // stay valid until the next call.
+  virtual void GetRow(size_t index, SawlogRow* row) const = 0;
+};
+
+// Writes .sawlog files.
+class SawlogWriter {
+ public:
+  // Writes the rows of @p source to a new .sawlog file at @p path. The
+  // rows are visited twice, first to size the sections, then to fill
+  // them. The header is written last, so a file that failed to write
+  // doesn't open.
+  // @returns true on success.
+  static bool Write(const base::FilePath& path,
+                    const SawlogRowSource& source);
+};
+
+// Reads a .sawlog file mapped in place. Opening only validates the
+// header, so takes constant time, and rows are read straight from the
+// mapping, so the file takes no memory beyond the pages touched.
+class SawlogFile {
+ public:
+  SawlogFile();
+  ~SawlogFile();
+
+  // Maps the file at @p path. This may only be called once.
+  // @returns true on success.
+  bool Open(const base::FilePath& path);
+
+  // @returns the number of rows.
+  size_t num_rows() const { return num_rows_; }
+
+  // Accessors for row @p row.
+  UCHAR level(size_t row) const {
+    DCHECK_LT(row, num_rows_);
+    return levels_[row];
+  }
+  DWORD process_id(size_t row) const {
+    DCHECK_LT(row, num_rows_);
+    return process_ids_[row];
+  }
+  DWORD thread_id(size_t row) const {
+    DCHECK_LT(row, num_rows_);
+    return thread_ids_[row];
+  }
+  base::Time time(size_t row) const {
+    DCHECK_LT(row, num_rows_);
+    return base::Time::FromInternalValue(times_[row]);
+  }
+  int line(size_t row) const {
+    DCHECK_LT(row, num_rows_);
+    return lines_[row];
+  }
+  uint32 file_id(size_t row) const {
+    DCHECK_LT(row, num_rows_);
+    return file_ids_[row];
+  }
+  base::StringPiece file_name(size_t row) const {
+    return GetFileName(file_id(row));
+  }
+  base::StringPiece message(size_t row) const;
+  void* const* trace(size_t row, size_t* depth) const;
+
+  // @returns the number of distinct file names, including the empty one.
+  size_t num_file_names() const { return num_file_names_; }
+
+  // @returns the file name with id @p file_id, or the empty string if
+  //     there's none.
+  base::StringPiece GetFileName(uint32 file_id) const;
+
+ private:
+  base::MemoryMappedFile file_;
+
+  size_t num_rows_;
+  const int64* times_;
+  const uint32* process_ids_;
+  const uint32* thread_ids_;
+  const uint8* levels_;
+  const int32* lines_;
+  const uint32* file_ids_;
+  const uint32* trace_ids_;
+  const uint64* message_offsets_;
+  const char* message_text_;
+  uint64 message_text_size_;
+
+  size_t num_file_names_;
+  const uint32* file_name_offsets_;
+  const char* file_name_text_;
+  uint64 file_name_text_size_;
+
+  size_t num_traces_;
+  const uint32* trace_offsets_;
+  void* const* trace_frames_;
+  uint64 num_trace_frames_;
+
+  DISALLOW_COPY_AND_ASSIGN(SawlogFile);
+};
+
+// A page of consecutive rows of a .sawlog file, read into memory. The
+// columns hold a value per row, as in the file.
+struct SawlogPage {
+  SawlogPage();
+
+  // Sizes the columns for @p num_rows rows from @p first_row, all zero,
+  // with empty messages.
+  void Reset(size_t first_row, size_t num_rows);
+
+  // @returns the number of rows.
+  size_t num_rows() const { return levels.size(); }
+
+  // @returns the message of the row @p index rows into the page.
+  base::StringPiece message(size_t index) const;
+
+  // @returns the number of bytes the page holds.
+  size_t bytes() const;
+
+  size_t first_row;
+  std::vector<int64> times;
+  std::vector<uint32> process_ids;
+  std::vector<uint32> thread_ids;
+  std::vector<uint8> levels;
+  std::vector<int32> lines;
+  std::vector<uint32> file_ids;
+  std::vector<uint32> trace_ids;
+  // The offsets of the messages into the file's MESSAGE_TEXT, with one
+  // more than rows, and the text they span, which starts at the first.
+  std::vector<uint64> message_offsets;
+  std::string message_text;
+};
+
+// Reads a .sawlog file a page of rows at a time, for files too large to
+// map. Opening reads the header, and the file names and traces rows refer
+// to, which are deduplicated, so are small next to the rows. Each page is
+// then read with a positioned read per column.
+class SawlogPageReader {
+ public:
+  SawlogPageReader();
+  ~SawlogPageReader();
+
+  // Opens the file at @p path. This may only be called once.
+  // @returns true on success.
+  bool Open(const base::FilePath& path);
+
+  // @returns the number of rows.
+  size_t num_rows() const { return num_rows_; }
+
+  // Reads @p num_rows rows from @p first_row on into @p page. On failure,
+  // the page holds as many blank rows.
+  // @param read_messages false to skip the message text, which leaves
+  //     the messages empty.
+  // @returns true on success.
+  bool ReadPage(size_t first_row,
+                size_t num_rows,
+                bool read_messages,
+                SawlogPage* page);
+
+  // @returns the file name with id @p file_id, or the empty string if
+  //     there's none.
+  base::StringPiece GetFileName(uint32 file_id) const;
+
+  // @returns the frames of the trace with id @p trace_id, or NULL if
+  //     there's none.
+  // @param depth returns the number of frames.
+  void* const* GetTrace(uint32 trace_id, size_t* depth) const;
+
+ private:
+  base::File file_;
+  SawlogHeader header_;
+  size_t num_rows_;
+
+  std::vector<uint32> file_name_offsets_;
+  std::string file_name_text_;
+  std::vector<uint32> trace_offsets_;
+  std::vector<void*> trace_frames_;
+
+  DISALLOW_COPY_AND_ASSIGN(SawlogPageReader);
+};
+
+#endif  // SAWBUCK_LOG_LIB_SAWLOG_FILE_H_
@@ -0,0 +1,249 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/log_lib/sawlog_file.h"
+
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+void* const kTrace[] = {
+  reinterpret_cast<void*>(0x1000),
+  reinterpret_cast<void*>(0x2000),
+  reinterpret_cast<void*>(0x3000),
+};
+
+class TestRowSource : public SawlogRowSource {
+ public:
+  struct Row {
+    UCHAR level;
+    DWORD process_id;
+    DWORD thread_id;
+    int64 time;
+    int line;
+    std::string file;
+    std::string message;
+    size_t trace_depth;
+  };
+
+  void AddRow(UCHAR level, DWORD process_id, int64 time,
+              const std::string& file, const std::string& message,
+              size_t trace_depth) {
+    Row row = { level, process_id, process_id + 1, time,
+                static_cast<int>(rows_.size()), file, message, trace_depth };
+    rows_.push_back(row);
+  }
+
+  const Row& row(size_t index) const { return rows_[index]; }
+
+  // SawlogRowSource implementation.
+  virtual size_t num_rows() const { return rows_.size(); }
+  virtual void GetRow(size_t index, SawlogRow* row) const {
+    const Row& source = rows_[index];
+    row->level = source.level;
+    row->process_id = source.process_id;
+    row->thread_id = source.thread_id;
+    row->time = base::Time::FromInternalValue(source.time);
+    row->line = source.line;
+    row->file = source.file;
+    row->message = source.message;
+    row->trace = kTrace;
+    row->trace_depth = source.trace_depth;
+  }
+
+ private:
+  std::vector<Row> rows_;
+};
+
+class SawlogFileTest : public testing::Test {
+ public:
+  virtual void SetUp() {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.path().Append(L"session.sawlog");
+  }
+
+ protected:
+  base::ScopedTempDir temp_dir_;
+  base::FilePath path_;
+  TestRowSource source_;
+};
+
+TEST_F(SawlogFileTest, RoundTrip) {
+  source_.AddRow(TRACE_LEVEL_ERROR, 10, 1000, "foo.cc", "Hello", 3);
+  source_.AddRow(TRACE_LEVEL_INFORMATION, 20, 2000, "bar.cc", "", 0);
+  source_.AddRow(TRACE_LEVEL_WARNING, 10, 3000, "foo.cc",
+                 std::string("Embedded\0nul", 12), 2);
+  ASSERT_TRUE(SawlogWriter::Write(path_, source_));
+
+  SawlogFile file;
+  ASSERT_TRUE(file.Open(path_));
+  ASSERT_EQ(3U, file.num_rows());
+  for (size_t i = 0; i < file.num_rows(); ++i) {
+    const TestRowSource::Row& row = source_.row(i);
+    EXPECT_EQ(row.level, file.level(i));
+    EXPECT_EQ(row.process_id, file.process_id(i));
+    EXPECT_EQ(row.thread_id, file.thread_id(i));
+    EXPECT_EQ(row.time, file.time(i).ToInternalValue());
+    EXPECT_EQ(row.line, file.line(i));
+    EXPECT_EQ(row.file, file.file_name(i).as_string());
+    EXPECT_EQ(row.message, file.message(i).as_string());
+
+    size_t depth = 0;
+    void* const* trace = file.trace(i, &depth);
+    ASSERT_EQ(row.trace_depth, depth);
+    for (size_t j = 0; j < depth; ++j)
+      EXPECT_EQ(kTrace[j], trace[j]);
+  }
+
+  // The file names are shared, with the empty file name first.
+  EXPECT_EQ(3U, file.num_file_names());
+  EXPECT_EQ(file.file_id(0), file.file_id(2));
+  EXPECT_EQ("", file.GetFileName(0).as_string());
+  EXPECT_EQ("", file.GetFileName(3).as_string());
+}
+
+TEST_F(SawlogFileTest, Empty) {
+  ASSERT_TRUE(SawlogWriter::Write(path_, source_));
+
+  SawlogFile file;
+  ASSERT_TRUE(file.Open(path_));
+  EXPECT_EQ(0U, file.num_rows());
+  EXPECT_EQ(1U, file.num_file_names());
+}
+
+TEST_F(SawlogFileTest, OpenFailsOnMissingFile) {
+  SawlogFile file;
+  EXPECT_FALSE(file.Open(path_));
+}
+
+TEST_F(SawlogFileTest, OpenFailsOnBadHeader) {
+  ASSERT_EQ(5, base::WriteFile(path_, "Hello", 5));
+  SawlogFile short_file;
+  EXPECT_FALSE(short_file.Open(path_));
+
+  source_.AddRow(TRACE_LEVEL_ERROR, 10, 1000, "foo.cc", "Hello", 1);
+  ASSERT_TRUE(SawlogWriter::Write(path_, source_));
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(path_, &contents));
+
+  // A bad magic.
+  std::string corrupt(contents);
+  corrupt[0] = 'X';
+  ASSERT_EQ(static_cast<int>(corrupt.size()),
+            base::WriteFile(path_, corrupt.data(), corrupt.size()));
+  SawlogFile bad_magic;
+  EXPECT_FALSE(bad_magic.Open(path_));
+
+  // A truncated file, whose sections run past its end.
+  ASSERT_EQ(static_cast<int>(sizeof(SawlogHeader)),
+            base::WriteFile(path_, contents.data(), sizeof(SawlogHeader)));
+  SawlogFile truncated;
+  EXPECT_FALSE(truncated.Open(path_));
+}
+
+TEST_F(SawlogFileTest, PageReaderMatchesFile) {
+  source_.AddRow(TRACE_LEVEL_ERROR, 10, 1000, "foo.cc", "Hello", 3);
+  source_.AddRow(TRACE_LEVEL_INFORMATION, 20, 2000, "bar.cc", "", 0);
+  source_.AddRow(TRACE_LEVEL_WARNING, 10, 3000, "foo.cc", "World", 2);
+  ASSERT_TRUE(SawlogWriter::Write(path_, source_));
+
+  SawlogFile file;
+  ASSERT_TRUE(file.Open(path_));
+  SawlogPageReader reader;
+  ASSERT_TRUE(reader.Open(path_));
+  ASSERT_EQ(3U, reader.num_rows());
+
+  // Read the rows in pages of two, the last one short.
+  for (size_t first = 0; first < reader.num_rows(); first += 2) {
+    size_t num_rows = std::min<size_t>(2, reader.num_rows() - first);
+    SawlogPage page;
+    ASSERT_TRUE(reader.ReadPage(first, num_rows, true, &page));
+    EXPECT_EQ(first, page.first_row);
+    ASSERT_EQ(num_rows, page.num_rows());
+    for (size_t i = 0; i < num_rows; ++i) {
+      size_t row = first + i;
+      EXPECT_EQ(file.level(row), page.levels[i]);
+      EXPECT_EQ(file.process_id(row), page.process_ids[i]);
+      EXPECT_EQ(file.thread_id(row), page.thread_ids[i]);
+      EXPECT_EQ(file.time(row).ToInternalValue(), page.times[i]);
+      EXPECT_EQ(file.line(row), page.lines[i]);
+      EXPECT_EQ(file.file_name(row), reader.GetFileName(page.file_ids[i]));
+      EXPECT_EQ(file.message(row), page.message(i));
+
+      size_t depth = 0;
+      void* const* trace = reader.GetTrace(page.trace_ids[i], &depth);
+      ASSERT_EQ(source_.row(row).trace_depth, depth);
+      for (size_t j = 0; j < depth; ++j)
+        EXPECT_EQ(kTrace[j], trace[j]);
+    }
+  }
+
+  // The message text may be skipped.
+  SawlogPage page;
+  ASSERT_TRUE(reader.ReadPage(0, 1, false, &page));
+  EXPECT_EQ(file.process_id(0), page.process_ids[0]);
+  EXPECT_EQ("", page.message(0).as_string());
+  EXPECT_EQ("", reader.GetFileName(3).as_string());
+}
+
+TEST_F(SawlogFileTest, PageReaderOpenFailsOnBadHeader) {
+  SawlogPageReader missing;
+  EXPECT_FALSE(missing.Open(path_));
+
+  source_.AddRow(TRACE_LEVEL_ERROR, 10, 1000, "foo.cc", "Hello", 1);
+  ASSERT_TRUE(SawlogWriter::Write(path_, source_));
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(path_, &contents));
+
+  ASSERT_EQ(static_cast<int>(sizeof(SawlogHeader)),
+            base::WriteFile(path_, contents.data(), sizeof(SawlogHeader)));
+  SawlogPageReader truncated;
+  EXPECT_FALSE(truncated.Open(path_));
+}
+
+TEST_F(SawlogFileTest, IgnoresCorruptOffsets) {
+  source_.AddRow(TRACE_LEVEL_ERROR, 10, 1000, "foo.cc", "Hello", 1);
+  ASSERT_TRUE(SawlogWriter::Write(path_, source_));
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(path_, &contents));
+
+  // Point the row's message past the message text.
+  const SawlogHeader& header =
+      *reinterpret_cast<const SawlogHeader*>(contents.data());
+  uint64 offset = header.sections[SawlogHeader::MESSAGE_OFFSETS].offset;
+  uint64 bad_end = 1000;
+  memcpy(&contents[offset + sizeof(uint64)], &bad_end, sizeof(bad_end));
+  ASSERT_EQ(static_cast<int>(contents.size()),
+            base::WriteFile(path_, contents.data(), contents.size()));
+
+  SawlogFile file;
+  ASSERT_TRUE(file.Open(path_));
+  ASSERT_EQ(1U, file.num_rows());
+  EXPECT_EQ("", file.message(0).as_string());
+  EXPECT_EQ("foo.cc", file.file_name(0).as_string());
+
+  SawlogPageReader reader;
+  ASSERT_TRUE(reader.Open(path_));
+  SawlogPage page;
+  ASSERT_TRUE(reader.ReadPage(0, 1, true, &page));
+  EXPECT_EQ("", page.message(0).as_string());
+  EXPECT_EQ("foo.cc", reader.GetFileName(page.file_ids[0]).as_string());
+}
+
+}  // namespace
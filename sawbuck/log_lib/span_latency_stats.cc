@@ -0,0 +1,127 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Span latency statistics implementation.
+#include "sawbuck/log_lib/span_latency_stats.h"
+
+#include <algorithm>
+#include "base/logging.h"
+
+namespace {
+
+bool SummaryNameLess(const SpanLatencyStats::Summary& a,
+                     const SpanLatencyStats::Summary& b) {
+  return a.name < b.name;
+}
+
+}  // namespace
+
+// static
+const size_t SpanLatencyStats::kDefaultMaxNames;
+
+SpanLatencyStats::SpanLatencyStats(size_t max_names)
+    : max_names_(max_names), num_dropped_spans_(0) {
+  // The tracker keeps no more names than we do, so that names past the
+  // limit don't take up memory there either.
+  tracker_.set_index_spans(false);
+  tracker_.set_max_names(max_names);
+  tracker_.set_span_sink(this);
+}
+
+SpanLatencyStats::~SpanLatencyStats() {
+}
+
+void SpanLatencyStats::OnTraceEventBegin(const TraceMessage& trace_message) {
+  base::AutoLock lock(lock_);
+  tracker_.OnTraceEventBegin(trace_message);
+}
+
+void SpanLatencyStats::OnTraceEventEnd(const TraceMessage& trace_message) {
+  // The tracker calls back to OnTraceSpan under the lock.
+  base::AutoLock lock(lock_);
+  tracker_.OnTraceEventEnd(trace_message);
+}
+
+void SpanLatencyStats::OnTraceEventInstant(
+    const TraceMessage& trace_message) {
+  // Instant events don't span any time.
+}
+
+void SpanLatencyStats::OnTraceSpan(const TraceSpan& span) {
+  lock_.AssertAcquired();
+
+  HistogramMap::iterator it = histogram_map_.find(span.name_id);
+  if (it == histogram_map_.end()) {
+    if (histograms_.size() >= max_names_) {
+      ++num_dropped_spans_;
+      return;
+    }
+
+    it = histogram_map_.insert(
+        std::make_pair(span.name_id, histograms_.size())).first;
+    histograms_.push_back(new LatencyHistogram());
+    names_.push_back(tracker_.GetName(span).as_string());
+  }
+
+  histograms_[it->second]->Record(span.duration().InMicroseconds());
+}
+
+void SpanLatencyStats::GetSummaries(std::vector<Summary>* summaries) const {
+  DCHECK(summaries != NULL);
+  summaries->clear();
+
+  base::AutoLock lock(lock_);
+  summaries->resize(histograms_.size());
+  for (size_t i = 0; i < histograms_.size(); ++i) {
+    const LatencyHistogram* histogram = histograms_[i];
+    Summary& summary = (*summaries)[i];
+    summary.name = names_[i];
+    summary.count = histogram->count();
+    summary.p50 = histogram->GetPercentile(50.0);
+    summary.p90 = histogram->GetPercentile(90.0);
+    summary.p99 = histogram->GetPercentile(99.0);
+    summary.max = histogram->max();
+  }
+
+  std::sort(summaries->begin(), summaries->end(), SummaryNameLess);
+}
+
+bool SpanLatencyStats::GetHistogram(const base::StringPiece& name,
+                                    LatencyHistogram* histogram) const {
+  DCHECK(histogram != NULL);
+
+  base::AutoLock lock(lock_);
+  for (size_t i = 0; i < names_.size(); ++i) {
+    if (name == names_[i]) {
+      *histogram = *histograms_[i];
+      return true;
+    }
+  }
+
+  return false;
+}
+
+size_t SpanLatencyStats::num_dropped_spans() const {
+  base::AutoLock lock(lock_);
+  return num_dropped_spans_ + tracker_.num_dropped_begins();
+}
+
+void SpanLatencyStats::Clear() {
+  base::AutoLock lock(lock_);
+  tracker_.Clear();
+  histograms_.clear();
+  names_.clear();
+  histogram_map_.clear();
+  num_dropped_spans_ = 0;
+}
@@ -0,0 +1,98 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Span latency statistics declaration.
+#ifndef SAWBUCK_LOG_LIB_SPAN_LATENCY_STATS_H_
+#define SAWBUCK_LOG_LIB_SPAN_LATENCY_STATS_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include "base/memory/scoped_vector.h"
+#include "base/strings/string_piece.h"
+#include "base/synchronization/lock.h"
+#include "sawbuck/log_lib/latency_histogram.h"
+#include "sawbuck/log_lib/trace_span_tracker.h"
+
+// Keeps a latency histogram of the spans of each name, fed from trace
+// events as they're consumed. The summaries can be read at any time, from
+// any thread, while the events are still coming in.
+//
+// Memory stays bounded however many spans arrive: completed spans aren't
+// kept, and each histogram is a fixed size. Up to max_names names get a
+// histogram; spans with names past that are only counted.
+class SpanLatencyStats : public TraceEvents, public TraceSpanEvents {
+ public:
+  // The statistics of the spans of one name. Durations are in
+  // microseconds.
+  struct Summary {
+    std::string name;
+    uint64 count;
+    int64 p50;
+    int64 p90;
+    int64 p99;
+    int64 max;
+  };
+
+  static const size_t kDefaultMaxNames = 1024;
+
+  explicit SpanLatencyStats(size_t max_names);
+  ~SpanLatencyStats();
+
+  // TraceEvents implementation.
+  virtual void OnTraceEventBegin(const TraceMessage& trace_message);
+  virtual void OnTraceEventEnd(const TraceMessage& trace_message);
+  virtual void OnTraceEventInstant(const TraceMessage& trace_message);
+
+  // TraceSpanEvents implementation.
+  virtual void OnTraceSpan(const TraceSpan& span);
+
+  // Retrieves a summary for each span name seen so far, ordered by name.
+  // @param summaries on success returns the summaries.
+  void GetSummaries(std::vector<Summary>* summaries) const;
+
+  // Retrieves the histogram of the spans named @p name.
+  // @param histogram on success returns a copy of the histogram.
+  // @returns true iff there have been spans named @p name.
+  bool GetHistogram(const base::StringPiece& name,
+                    LatencyHistogram* histogram) const;
+
+  // @returns the number of spans with names past max_names.
+  size_t num_dropped_spans() const;
+
+  // Discards all statistics and open spans.
+  void Clear();
+
+ private:
+  // Protects all members below.
+  mutable base::Lock lock_;
+
+  // Pairs up the events into spans, without keeping them.
+  TraceSpanTracker tracker_;
+
+  // The histograms, and the names they belong to in the same order.
+  ScopedVector<LatencyHistogram> histograms_;
+  std::vector<std::string> names_;
+
+  // Maps the tracker's name ids to their entry in histograms_.
+  typedef std::map<StringTable::StringId, size_t> HistogramMap;
+  HistogramMap histogram_map_;
+
+  size_t max_names_;
+  size_t num_dropped_spans_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpanLatencyStats);
+};
+
+#endif  // SAWBUCK_LOG_LIB_SPAN_LATENCY_STATS_H_
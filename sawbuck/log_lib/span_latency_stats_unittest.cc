@@ -0,0 +1,110 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/log_lib/span_latency_stats.h"
+
+#include <string.h>
+#include "gtest/gtest.h"
+
+namespace {
+
+const DWORD kProcessId = 1234;
+
+class SpanLatencyStatsTest : public testing::Test {
+ public:
+  SpanLatencyStatsTest()
+      : time_(0), stats_(SpanLatencyStats::kDefaultMaxNames) {
+  }
+
+  // Issues a span named @p name lasting @p duration, to @p stats.
+  void AddSpan(SpanLatencyStats* stats, const char* name, int64 duration) {
+    stats->OnTraceEventBegin(MakeMessage(time_, name));
+    time_ += duration;
+    stats->OnTraceEventEnd(MakeMessage(time_, name));
+  }
+
+ protected:
+  TraceEvents::TraceMessage MakeMessage(int64 time, const char* name) {
+    TraceEvents::TraceMessage message;
+    message.time = base::Time::FromInternalValue(time);
+    message.process_id = kProcessId;
+    message.thread_id = 1;
+    message.name = name;
+    message.name_len = strlen(name);
+    message.id = NULL;
+    return message;
+  }
+
+  int64 time_;
+  SpanLatencyStats stats_;
+};
+
+TEST_F(SpanLatencyStatsTest, SummarizesByName) {
+  for (int64 i = 1; i <= 100; ++i)
+    AddSpan(&stats_, "Paint", i);
+  AddSpan(&stats_, "Load", 5000);
+
+  std::vector<SpanLatencyStats::Summary> summaries;
+  stats_.GetSummaries(&summaries);
+  ASSERT_EQ(2U, summaries.size());
+
+  EXPECT_EQ("Load", summaries[0].name);
+  EXPECT_EQ(1U, summaries[0].count);
+  EXPECT_EQ(5000, summaries[0].max);
+  EXPECT_EQ(5000, summaries[0].p50);
+
+  EXPECT_EQ("Paint", summaries[1].name);
+  EXPECT_EQ(100U, summaries[1].count);
+  EXPECT_EQ(100, summaries[1].max);
+  EXPECT_EQ(50, summaries[1].p50);
+  // Past 64 microseconds, the buckets are two wide.
+  EXPECT_EQ(91, summaries[1].p90);
+  EXPECT_EQ(99, summaries[1].p99);
+
+  LatencyHistogram histogram;
+  ASSERT_TRUE(stats_.GetHistogram("Paint", &histogram));
+  EXPECT_EQ(100U, histogram.count());
+  EXPECT_FALSE(stats_.GetHistogram("Unknown", &histogram));
+}
+
+TEST_F(SpanLatencyStatsTest, BoundsNames) {
+  SpanLatencyStats stats(2);
+  AddSpan(&stats, "A", 10);
+  AddSpan(&stats, "B", 10);
+  AddSpan(&stats, "C", 10);
+  AddSpan(&stats, "C", 10);
+  AddSpan(&stats, "A", 10);
+
+  std::vector<SpanLatencyStats::Summary> summaries;
+  stats.GetSummaries(&summaries);
+  ASSERT_EQ(2U, summaries.size());
+  EXPECT_EQ(2U, summaries[0].count);
+  EXPECT_EQ(2U, stats.num_dropped_spans());
+}
+
+TEST_F(SpanLatencyStatsTest, Clear) {
+  AddSpan(&stats_, "Paint", 10);
+  stats_.OnTraceEventBegin(MakeMessage(time_, "Open"));
+  stats_.Clear();
+
+  std::vector<SpanLatencyStats::Summary> summaries;
+  stats_.GetSummaries(&summaries);
+  EXPECT_TRUE(summaries.empty());
+
+  // The open span went with the rest.
+  stats_.OnTraceEventEnd(MakeMessage(time_ + 10, "Open"));
+  stats_.GetSummaries(&summaries);
+  EXPECT_TRUE(summaries.empty());
+}
+
+}  // namespace
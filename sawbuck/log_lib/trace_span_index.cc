@@ -0,0 +1,301 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Trace span index implementation.
+#include "sawbuck/log_lib/trace_span_index.h"
+
+#include <algorithm>
+#include <queue>
+
+namespace {
+
+// @returns a well-mixed priority for node @p node, so that the shape of
+//     the tree doesn't depend on the order spans arrive in.
+uint32 NodePriority(size_t node) {
+  uint32 x = static_cast<uint32>(node) + 0x9E3779B9U;
+  x = (x ^ (x >> 16)) * 0x85EBCA6BU;
+  x = (x ^ (x >> 13)) * 0xC2B2AE35U;
+  return x ^ (x >> 16);
+}
+
+// A pending step of the longest spans search: either a whole subtree of
+// spans that all overlap the range, whose bound is the longest of them,
+// or a single span, whose bound is its duration.
+struct SearchEntry {
+  SearchEntry(int64 bound, size_t node, bool is_subtree)
+      : bound(bound), node(node), is_subtree(is_subtree) {
+  }
+
+  // Orders entries so that the largest bound comes out of a priority
+  // queue first, and spans ahead of subtrees with the same bound.
+  bool operator<(const SearchEntry& other) const {
+    if (bound != other.bound)
+      return bound < other.bound;
+    if (is_subtree != other.is_subtree)
+      return is_subtree;
+    return node > other.node;
+  }
+
+  int64 bound;
+  size_t node;
+  bool is_subtree;
+};
+
+}  // namespace
+
+// static
+const size_t TraceSpanIndex::kNil;
+
+TraceSpanIndex::TraceSpanIndex() : root_(kNil), nodes_visited_(0) {
+}
+
+TraceSpanIndex::~TraceSpanIndex() {
+}
+
+TraceSpanIndex::SpanId TraceSpanIndex::Add(const TraceSpan& span) {
+  DCHECK(span.begin_time <= span.end_time);
+
+  SpanId id = spans_.size();
+  spans_.push_back(span);
+
+  Node node = {};
+  node.left = kNil;
+  node.right = kNil;
+  node.priority = NodePriority(id);
+  node.begin = span.begin_time.ToInternalValue();
+  node.end = span.end_time.ToInternalValue();
+  node.max_end = node.end;
+  node.max_duration = node.end - node.begin;
+  nodes_.push_back(node);
+
+  root_ = Insert(root_, id);
+  return id;
+}
+
+void TraceSpanIndex::GetSpansOpenAt(base::Time time,
+                                    std::vector<SpanId>* spans) const {
+  DCHECK(spans != NULL);
+  spans->clear();
+  CollectOpenSpans(root_, time.ToInternalValue(), spans);
+}
+
+void TraceSpanIndex::GetLongestSpans(base::Time start,
+                                     base::Time end,
+                                     size_t max_spans,
+                                     std::vector<SpanId>* spans) const {
+  DCHECK(spans != NULL);
+  spans->clear();
+  nodes_visited_ = 0;
+  if (root_ == kNil || max_spans == 0)
+    return;
+
+  int64 range_start = start.ToInternalValue();
+  int64 range_end = end.ToInternalValue();
+
+  // A span overlaps the range iff it begins before the range and is still
+  // open at its start, or begins within the range. The former are found
+  // by their latest end. The latter are a run of the tree's order, which
+  // splits into whole subtrees and the spans on the paths between them.
+  // Either way, only spans that overlap the range are ever queued.
+  std::vector<SpanId> first_spans;
+  std::vector<size_t> subtrees;
+  CollectSpansEndingFrom(root_, range_start, &first_spans);
+  SplitBeginRange(root_, range_start, range_end, &subtrees, &first_spans);
+
+  std::priority_queue<SearchEntry> queue;
+  for (size_t i = 0; i < first_spans.size(); ++i) {
+    const Node& node = nodes_[first_spans[i]];
+    queue.push(SearchEntry(node.end - node.begin, first_spans[i], false));
+  }
+  for (size_t i = 0; i < subtrees.size(); ++i) {
+    queue.push(SearchEntry(nodes_[subtrees[i]].max_duration, subtrees[i],
+                           true));
+  }
+
+  // A best-first search. Each bound is met by a span in the range, so the
+  // spans come out longest first.
+  while (!queue.empty() && spans->size() < max_spans) {
+    SearchEntry entry = queue.top();
+    queue.pop();
+
+    if (!entry.is_subtree) {
+      spans->push_back(entry.node);
+      continue;
+    }
+
+    ++nodes_visited_;
+    const Node& node = nodes_[entry.node];
+    queue.push(SearchEntry(node.end - node.begin, entry.node, false));
+    if (node.left != kNil) {
+      queue.push(SearchEntry(nodes_[node.left].max_duration, node.left,
+                             true));
+    }
+    if (node.right != kNil) {
+      queue.push(SearchEntry(nodes_[node.right].max_duration, node.right,
+                             true));
+    }
+  }
+}
+
+void TraceSpanIndex::Clear() {
+  spans_.clear();
+  nodes_.clear();
+  root_ = kNil;
+}
+
+bool TraceSpanIndex::Less(size_t a, size_t b) const {
+  if (nodes_[a].begin != nodes_[b].begin)
+    return nodes_[a].begin < nodes_[b].begin;
+  return a < b;
+}
+
+size_t TraceSpanIndex::Insert(size_t node, size_t new_node) {
+  if (node == kNil)
+    return new_node;
+
+  if (Less(new_node, node)) {
+    nodes_[node].left = Insert(nodes_[node].left, new_node);
+    if (nodes_[nodes_[node].left].priority > nodes_[node].priority)
+      return RotateRight(node);
+  } else {
+    nodes_[node].right = Insert(nodes_[node].right, new_node);
+    if (nodes_[nodes_[node].right].priority > nodes_[node].priority)
+      return RotateLeft(node);
+  }
+
+  Update(node);
+  return node;
+}
+
+size_t TraceSpanIndex::RotateLeft(size_t node) {
+  size_t right = nodes_[node].right;
+  nodes_[node].right = nodes_[right].left;
+  nodes_[right].left = node;
+  Update(node);
+  Update(right);
+  return right;
+}
+
+size_t TraceSpanIndex::RotateRight(size_t node) {
+  size_t left = nodes_[node].left;
+  nodes_[node].left = nodes_[left].right;
+  nodes_[left].right = node;
+  Update(node);
+  Update(left);
+  return left;
+}
+
+void TraceSpanIndex::Update(size_t node) {
+  Node& n = nodes_[node];
+  n.max_end = n.end;
+  n.max_duration = n.end - n.begin;
+  if (n.left != kNil) {
+    n.max_end = std::max(n.max_end, nodes_[n.left].max_end);
+    n.max_duration = std::max(n.max_duration, nodes_[n.left].max_duration);
+  }
+  if (n.right != kNil) {
+    n.max_end = std::max(n.max_end, nodes_[n.right].max_end);
+    n.max_duration = std::max(n.max_duration, nodes_[n.right].max_duration);
+  }
+}
+
+void TraceSpanIndex::CollectOpenSpans(size_t node,
+                                      int64 time,
+                                      std::vector<SpanId>* spans) const {
+  // Nothing in this subtree is still open at time.
+  if (node == kNil || nodes_[node].max_end <= time)
+    return;
+
+  const Node& n = nodes_[node];
+  CollectOpenSpans(n.left, time, spans);
+
+  // This span and everything to its right begin after time.
+  if (n.begin > time)
+    return;
+
+  if (n.end > time)
+    spans->push_back(node);
+  CollectOpenSpans(n.right, time, spans);
+}
+
+void TraceSpanIndex::CollectSpansEndingFrom(size_t node,
+                                            int64 time,
+                                            std::vector<SpanId>* spans) const {
+  // Nothing in this subtree lasts until time.
+  if (node == kNil || nodes_[node].max_end < time)
+    return;
+
+  ++nodes_visited_;
+  const Node& n = nodes_[node];
+  CollectSpansEndingFrom(n.left, time, spans);
+
+  // This span and everything to its right begin at or after time.
+  if (n.begin >= time)
+    return;
+
+  if (n.end >= time)
+    spans->push_back(node);
+  CollectSpansEndingFrom(n.right, time, spans);
+}
+
+void TraceSpanIndex::SplitBeginRange(size_t node,
+                                     int64 start,
+                                     int64 end,
+                                     std::vector<size_t>* subtrees,
+                                     std::vector<SpanId>* spans) const {
+  // Descend to the topmost span that begins in the range, where the paths
+  // to either end of the range part.
+  while (node != kNil) {
+    ++nodes_visited_;
+    const Node& n = nodes_[node];
+    if (n.begin < start)
+      node = n.right;
+    else if (n.begin > end)
+      node = n.left;
+    else
+      break;
+  }
+  if (node == kNil)
+    return;
+  spans->push_back(node);
+
+  // On the path to the start of the range, each span in the range has
+  // only spans in the range to its right.
+  for (size_t left = nodes_[node].left; left != kNil; ) {
+    ++nodes_visited_;
+    const Node& n = nodes_[left];
+    if (n.begin >= start) {
+      spans->push_back(left);
+      if (n.right != kNil)
+        subtrees->push_back(n.right);
+      left = n.left;
+    } else {
+      left = n.right;
+    }
+  }
+
+  // And on the path to the end, only spans in the range to its left.
+  for (size_t right = nodes_[node].right; right != kNil; ) {
+    ++nodes_visited_;
+    const Node& n = nodes_[right];
+    if (n.begin <= end) {
+      spans->push_back(right);
+      if (n.left != kNil)
+        subtrees->push_back(n.left);
+      right = n.right;
+    } else {
+      right = n.left;
+    }
+  }
+}
@@ -0,0 +1,154 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Trace span and trace span index declarations.
+#ifndef SAWBUCK_LOG_LIB_TRACE_SPAN_INDEX_H_
+#define SAWBUCK_LOG_LIB_TRACE_SPAN_INDEX_H_
+
+#include <windows.h>
+#include <vector>
+#include "base/basictypes.h"
+#include "base/logging.h"
+#include "base/time/time.h"
+#include "sawbuck/common/string_table.h"
+
+// A completed trace span, from a trace event begin to its matching end.
+struct TraceSpan {
+  TraceSpan() : process_id(0), begin_thread_id(0), end_thread_id(0),
+      name_id(StringTable::kEmptyStringId), id(NULL), depth(0) {
+  }
+
+  base::TimeDelta duration() const { return end_time - begin_time; }
+
+  DWORD process_id;
+  DWORD begin_thread_id;
+  DWORD end_thread_id;
+  StringTable::StringId name_id;
+  void* id;
+  base::Time begin_time;
+  base::Time end_time;
+
+  // The number of spans that were open on the beginning thread when this
+  // span began.
+  size_t depth;
+};
+
+// An interval index of trace spans. Spans can be added in any order, and
+// the index answers which spans were open at a given time, and which were
+// the longest in a given time range.
+//
+// The spans are kept in a treap ordered by begin time, where each node
+// also records the latest end time and the longest duration in its
+// subtree. That lets queries skip subtrees that can't contribute.
+class TraceSpanIndex {
+ public:
+  typedef size_t SpanId;
+
+  TraceSpanIndex();
+  ~TraceSpanIndex();
+
+  // Adds @p span to the index in expected O(log n) time.
+  // @returns the id of the span.
+  SpanId Add(const TraceSpan& span);
+
+  // @returns the span with id @p id.
+  const TraceSpan& span(SpanId id) const {
+    DCHECK_LT(id, spans_.size());
+    return spans_[id];
+  }
+
+  // @returns the number of spans in the index.
+  size_t size() const { return spans_.size(); }
+
+  // Finds the spans open at @p time, that is the spans that begin at or
+  // before @p time and end after it, in O(log n) time per span found.
+  // @param spans returns the ids of the spans, ordered by begin time.
+  void GetSpansOpenAt(base::Time time, std::vector<SpanId>* spans) const;
+
+  // Finds the longest spans that overlap [@p start, @p end], in expected
+  // O((k + m + log n) log n) time, where k is @p max_spans and m is the
+  // number of spans that begin before @p start and are still open at it.
+  // Spans that end before @p start don't slow the search, however long.
+  // @param max_spans the maximum number of spans to return.
+  // @param spans returns the ids of up to @p max_spans spans, by
+  //     decreasing duration.
+  void GetLongestSpans(base::Time start,
+                       base::Time end,
+                       size_t max_spans,
+                       std::vector<SpanId>* spans) const;
+
+  // @returns the number of tree nodes the last GetLongestSpans visited.
+  size_t nodes_visited() const { return nodes_visited_; }
+
+  // Discards all spans.
+  void Clear();
+
+ private:
+  static const size_t kNil = static_cast<size_t>(-1);
+
+  struct Node {
+    size_t left;
+    size_t right;
+    uint32 priority;
+    // The span's begin and end times, and the latest end and longest
+    // duration in the subtree rooted here, all as internal time values.
+    int64 begin;
+    int64 end;
+    int64 max_end;
+    int64 max_duration;
+  };
+
+  // @returns true iff node @p a orders before node @p b.
+  bool Less(size_t a, size_t b) const;
+
+  // Inserts @p new_node into the subtree at @p node.
+  // @returns the new root of the subtree.
+  size_t Insert(size_t node, size_t new_node);
+  size_t RotateLeft(size_t node);
+  size_t RotateRight(size_t node);
+
+  // Recomputes the subtree summary of @p node from its children.
+  void Update(size_t node);
+
+  void CollectOpenSpans(size_t node,
+                        int64 time,
+                        std::vector<SpanId>* spans) const;
+
+  // Appends the spans in the subtree at @p node that begin before @p time
+  // and end at or after it to @p spans.
+  void CollectSpansEndingFrom(size_t node,
+                              int64 time,
+                              std::vector<SpanId>* spans) const;
+
+  // Splits the spans in the subtree at @p node that begin in
+  // [@p start, @p end] into whole subtrees, appended to @p subtrees, and
+  // the single spans on the paths between them, appended to @p spans.
+  void SplitBeginRange(size_t node,
+                       int64 start,
+                       int64 end,
+                       std::vector<size_t>* subtrees,
+                       std::vector<SpanId>* spans) const;
+
+  std::vector<TraceSpan> spans_;
+  // The tree nodes, parallel to spans_.
+  std::vector<Node> nodes_;
+  size_t root_;
+
+  // The nodes the last GetLongestSpans visited.
+  mutable size_t nodes_visited_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceSpanIndex);
+};
+
+#endif  // SAWBUCK_LOG_LIB_TRACE_SPAN_INDEX_H_
@@ -0,0 +1,201 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/log_lib/trace_span_index.h"
+
+#include <algorithm>
+#include <vector>
+#include "gtest/gtest.h"
+#include "sawbuck/common/test_random.h"
+#include "sawbuck/common/test_time.h"
+
+namespace {
+
+using testing::Random;
+using testing::TimeAt;
+
+TraceSpan MakeSpan(int64 begin, int64 end) {
+  TraceSpan span;
+  span.begin_time = TimeAt(begin);
+  span.end_time = TimeAt(end);
+  return span;
+}
+
+TEST(TraceSpanIndexTest, Empty) {
+  TraceSpanIndex index;
+  std::vector<TraceSpanIndex::SpanId> spans(1);
+
+  index.GetSpansOpenAt(TimeAt(10), &spans);
+  EXPECT_TRUE(spans.empty());
+  index.GetLongestSpans(TimeAt(0), TimeAt(100), 10, &spans);
+  EXPECT_TRUE(spans.empty());
+}
+
+TEST(TraceSpanIndexTest, OpenAt) {
+  TraceSpanIndex index;
+  TraceSpanIndex::SpanId outer = index.Add(MakeSpan(10, 100));
+  TraceSpanIndex::SpanId inner = index.Add(MakeSpan(20, 30));
+  TraceSpanIndex::SpanId later = index.Add(MakeSpan(50, 60));
+  ASSERT_EQ(3U, index.size());
+  EXPECT_EQ(TimeAt(20), index.span(inner).begin_time);
+
+  std::vector<TraceSpanIndex::SpanId> spans;
+  index.GetSpansOpenAt(TimeAt(5), &spans);
+  EXPECT_TRUE(spans.empty());
+
+  // Spans are open from their begin up to, but not including, their end.
+  index.GetSpansOpenAt(TimeAt(20), &spans);
+  ASSERT_EQ(2U, spans.size());
+  EXPECT_EQ(outer, spans[0]);
+  EXPECT_EQ(inner, spans[1]);
+
+  index.GetSpansOpenAt(TimeAt(30), &spans);
+  ASSERT_EQ(1U, spans.size());
+  EXPECT_EQ(outer, spans[0]);
+
+  index.GetSpansOpenAt(TimeAt(55), &spans);
+  ASSERT_EQ(2U, spans.size());
+  EXPECT_EQ(later, spans[1]);
+
+  index.GetSpansOpenAt(TimeAt(100), &spans);
+  EXPECT_TRUE(spans.empty());
+}
+
+TEST(TraceSpanIndexTest, LongestSpans) {
+  TraceSpanIndex index;
+  TraceSpanIndex::SpanId a = index.Add(MakeSpan(0, 10));
+  TraceSpanIndex::SpanId b = index.Add(MakeSpan(20, 80));
+  TraceSpanIndex::SpanId c = index.Add(MakeSpan(30, 50));
+  TraceSpanIndex::SpanId d = index.Add(MakeSpan(90, 200));
+
+  std::vector<TraceSpanIndex::SpanId> spans;
+  index.GetLongestSpans(TimeAt(0), TimeAt(1000), 10, &spans);
+  ASSERT_EQ(4U, spans.size());
+  EXPECT_EQ(d, spans[0]);
+  EXPECT_EQ(b, spans[1]);
+  EXPECT_EQ(c, spans[2]);
+  EXPECT_EQ(a, spans[3]);
+
+  index.GetLongestSpans(TimeAt(0), TimeAt(1000), 2, &spans);
+  ASSERT_EQ(2U, spans.size());
+  EXPECT_EQ(d, spans[0]);
+  EXPECT_EQ(b, spans[1]);
+
+  // Spans that overlap the range at all count.
+  index.GetLongestSpans(TimeAt(10), TimeAt(30), 10, &spans);
+  ASSERT_EQ(3U, spans.size());
+  EXPECT_EQ(b, spans[0]);
+  EXPECT_EQ(c, spans[1]);
+  EXPECT_EQ(a, spans[2]);
+
+  index.GetLongestSpans(TimeAt(81), TimeAt(89), 10, &spans);
+  EXPECT_TRUE(spans.empty());
+}
+
+TEST(TraceSpanIndexTest, MatchesBruteForce) {
+  const size_t kNumSpans = 5000;
+  const size_t kNumQueries = 200;
+  const uint32 kTimeRange = 100000;
+
+  TraceSpanIndex index;
+  std::vector<TraceSpan> spans;
+  Random random(42);
+  for (size_t i = 0; i < kNumSpans; ++i) {
+    int64 begin = random.Next(kTimeRange);
+    // Mostly short spans, with the odd long one.
+    int64 duration = random.Next(random.Next(10) == 0 ? kTimeRange : 100);
+    spans.push_back(MakeSpan(begin, begin + duration));
+    ASSERT_EQ(i, index.Add(spans.back()));
+  }
+
+  for (size_t i = 0; i < kNumQueries; ++i) {
+    int64 time = random.Next(kTimeRange);
+    std::vector<TraceSpanIndex::SpanId> expected;
+    for (size_t j = 0; j < spans.size(); ++j) {
+      if (spans[j].begin_time <= TimeAt(time) &&
+          spans[j].end_time > TimeAt(time)) {
+        expected.push_back(j);
+      }
+    }
+
+    std::vector<TraceSpanIndex::SpanId> found;
+    index.GetSpansOpenAt(TimeAt(time), &found);
+    std::sort(found.begin(), found.end());
+    ASSERT_EQ(expected, found) << "Time " << time;
+  }
+
+  for (size_t i = 0; i < kNumQueries; ++i) {
+    int64 start = random.Next(kTimeRange);
+    int64 end = start + random.Next(1000);
+    const size_t kMaxSpans = 20;
+
+    std::vector<int64> expected;
+    for (size_t j = 0; j < spans.size(); ++j) {
+      if (spans[j].begin_time <= TimeAt(end) &&
+          spans[j].end_time >= TimeAt(start)) {
+        expected.push_back(spans[j].duration().ToInternalValue());
+      }
+    }
+    std::sort(expected.rbegin(), expected.rend());
+    if (expected.size() > kMaxSpans)
+      expected.resize(kMaxSpans);
+
+    std::vector<TraceSpanIndex::SpanId> found;
+    index.GetLongestSpans(TimeAt(start), TimeAt(end), kMaxSpans, &found);
+    std::vector<int64> found_durations;
+    for (size_t j = 0; j < found.size(); ++j) {
+      found_durations.push_back(
+          index.span(found[j]).duration().ToInternalValue());
+    }
+    ASSERT_EQ(expected, found_durations) << "Range " << start << "-" << end;
+  }
+}
+
+TEST(TraceSpanIndexTest, LongestSpansSkipSpansBeforeRange) {
+  const size_t kNumSpans = 10000;
+  const int64 kRangeStart = 1000000000;
+
+  // Many long spans that all end before the range, and one short span
+  // that overlaps its start.
+  TraceSpanIndex index;
+  for (size_t i = 0; i < kNumSpans; ++i) {
+    int64 begin = i * 10;
+    index.Add(MakeSpan(begin, begin + kRangeStart / 2));
+  }
+  TraceSpanIndex::SpanId short_span =
+      index.Add(MakeSpan(kRangeStart - 5, kRangeStart + 5));
+
+  std::vector<TraceSpanIndex::SpanId> spans;
+  index.GetLongestSpans(TimeAt(kRangeStart), TimeAt(kRangeStart + 100), 5,
+                        &spans);
+  ASSERT_EQ(1U, spans.size());
+  EXPECT_EQ(short_span, spans[0]);
+
+  // The search stays on a few paths of the tree, rather than expanding
+  // the long spans ahead of the short one.
+  EXPECT_GT(kNumSpans / 50, index.nodes_visited());
+}
+
+TEST(TraceSpanIndexTest, Clear) {
+  TraceSpanIndex index;
+  index.Add(MakeSpan(0, 10));
+  index.Clear();
+
+  EXPECT_EQ(0U, index.size());
+  std::vector<TraceSpanIndex::SpanId> spans;
+  index.GetSpansOpenAt(TimeAt(5), &spans);
+  EXPECT_TRUE(spans.empty());
+  EXPECT_EQ(0U, index.Add(MakeSpan(0, 10)));
+}
+
+}  // namespace
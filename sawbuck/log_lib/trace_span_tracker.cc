@@ -0,0 +1,164 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Trace span tracker implementation.
+#include "sawbuck/log_lib/trace_span_tracker.h"
+
+#include <algorithm>
+#include "base/logging.h"
+
+bool TraceSpanTracker::SpanKey::operator<(const SpanKey& other) const {
+  if (process_id != other.process_id)
+    return process_id < other.process_id;
+  if (name_id != other.name_id)
+    return name_id < other.name_id;
+  return id < other.id;
+}
+
+// static
+const size_t TraceSpanTracker::kDefaultMaxNames;
+// static
+const size_t TraceSpanTracker::kDefaultMaxOpenSpans;
+
+TraceSpanTracker::TraceSpanTracker()
+    : next_sequence_(0),
+      num_unmatched_ends_(0),
+      num_dropped_begins_(0),
+      num_expired_spans_(0),
+      max_names_(kDefaultMaxNames),
+      max_open_spans_(kDefaultMaxOpenSpans),
+      index_spans_(true),
+      span_sink_(NULL) {
+}
+
+TraceSpanTracker::~TraceSpanTracker() {
+}
+
+void TraceSpanTracker::OnTraceEventBegin(const TraceMessage& trace_message) {
+  base::StringPiece name(trace_message.name, trace_message.name_len);
+  StringTable::StringId name_id = StringTable::kEmptyStringId;
+  if (!names_.Find(name, &name_id)) {
+    if (num_names() >= max_names_) {
+      ++num_dropped_begins_;
+      return;
+    }
+    name_id = names_.Intern(name);
+  }
+
+  while (num_open_spans() >= max_open_spans_)
+    ExpireOldestSpan();
+
+  SpanKey key(trace_message.process_id, name_id, trace_message.id);
+  size_t& depth =
+      nesting_[ThreadKey(trace_message.process_id, trace_message.thread_id)];
+  OpenSpan open_span = {};
+  open_span.thread_id = trace_message.thread_id;
+  open_span.begin_time = trace_message.time;
+  open_span.depth = depth++;
+  open_span.sequence = next_sequence_++;
+
+  open_spans_[key].push_back(open_span);
+  open_spans_by_age_.insert(std::make_pair(open_span.sequence, key));
+}
+
+void TraceSpanTracker::OnTraceEventEnd(const TraceMessage& trace_message) {
+  // Ends never intern their name, as a name that's not kept has no begin.
+  base::StringPiece name(trace_message.name, trace_message.name_len);
+  StringTable::StringId name_id = StringTable::kEmptyStringId;
+  OpenSpanMap::iterator it = open_spans_.end();
+  if (names_.Find(name, &name_id)) {
+    it = open_spans_.find(
+        SpanKey(trace_message.process_id, name_id, trace_message.id));
+  }
+  if (it == open_spans_.end()) {
+    ++num_unmatched_ends_;
+    return;
+  }
+
+  DCHECK(!it->second.empty());
+  OpenSpan open_span = it->second.back();
+  it->second.pop_back();
+  if (it->second.empty())
+    open_spans_.erase(it);
+  open_spans_by_age_.erase(open_span.sequence);
+  DecrementNesting(trace_message.process_id, open_span.thread_id);
+
+  TraceSpan span;
+  span.process_id = trace_message.process_id;
+  span.begin_thread_id = open_span.thread_id;
+  span.end_thread_id = trace_message.thread_id;
+  span.name_id = name_id;
+  span.id = trace_message.id;
+  span.begin_time = open_span.begin_time;
+  // Clamp ends that precede their begins, which clock skew between
+  // processors can produce.
+  span.end_time = std::max(open_span.begin_time, trace_message.time);
+  span.depth = open_span.depth;
+
+  if (index_spans_)
+    spans_.Add(span);
+  if (span_sink_ != NULL)
+    span_sink_->OnTraceSpan(span);
+}
+
+void TraceSpanTracker::OnTraceEventInstant(
+    const TraceMessage& trace_message) {
+  // Instant events don't span any time.
+}
+
+void TraceSpanTracker::ExpireOldestSpan() {
+  DCHECK(!open_spans_by_age_.empty());
+  OpenSpanAgeMap::iterator age_it = open_spans_by_age_.begin();
+  OpenSpanMap::iterator it = open_spans_.find(age_it->second);
+  DCHECK(it != open_spans_.end());
+
+  // The spans of a key are in the order they began, so the oldest is first.
+  DCHECK_EQ(age_it->first, it->second.front().sequence);
+  DecrementNesting(age_it->second.process_id, it->second.front().thread_id);
+  it->second.erase(it->second.begin());
+  if (it->second.empty())
+    open_spans_.erase(it);
+  open_spans_by_age_.erase(age_it);
+  ++num_expired_spans_;
+}
+
+void TraceSpanTracker::DecrementNesting(DWORD process_id, DWORD thread_id) {
+  NestingMap::iterator it = nesting_.find(ThreadKey(process_id, thread_id));
+  DCHECK(it != nesting_.end());
+  DCHECK_NE(0U, it->second);
+  if (--it->second == 0)
+    nesting_.erase(it);
+}
+
+size_t TraceSpanTracker::GetNestingDepth(DWORD process_id,
+                                         DWORD thread_id) const {
+  NestingMap::const_iterator it =
+      nesting_.find(ThreadKey(process_id, thread_id));
+  if (it == nesting_.end())
+    return 0;
+
+  return it->second;
+}
+
+void TraceSpanTracker::Clear() {
+  open_spans_.clear();
+  open_spans_by_age_.clear();
+  next_sequence_ = 0;
+  nesting_.clear();
+  num_unmatched_ends_ = 0;
+  num_dropped_begins_ = 0;
+  num_expired_spans_ = 0;
+  names_.Clear();
+  spans_.Clear();
+}
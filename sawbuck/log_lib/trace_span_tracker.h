@@ -0,0 +1,167 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Trace span tracker declaration.
+#ifndef SAWBUCK_LOG_LIB_TRACE_SPAN_TRACKER_H_
+#define SAWBUCK_LOG_LIB_TRACE_SPAN_TRACKER_H_
+
+#include <map>
+#include <utility>
+#include <vector>
+#include "base/strings/string_piece.h"
+#include "sawbuck/common/string_table.h"
+#include "sawbuck/log_lib/log_consumer.h"
+#include "sawbuck/log_lib/trace_span_index.h"
+
+// Implemented by clients of TraceSpanTracker to receive completed spans.
+class TraceSpanEvents {
+ public:
+  // Issued for each span as it completes, after it's in the index, if
+  // the tracker keeps one.
+  virtual void OnTraceSpan(const TraceSpan& span) = 0;
+};
+
+// Pairs trace event begins with their ends into spans. A begin and an end
+// match when they have the same process id, name and id. Where the same
+// span is begun more than once before it ends, each end closes the latest
+// begin. Completed spans go to an interval index, unless indexing is
+// turned off, and to the span sink, if one is set.
+//
+// The tracker also keeps the number of spans open on each thread, which
+// gives the nesting depth of each span.
+//
+// Memory stays bounded whatever the events: up to max_names distinct names
+// are kept, and begins with names past that are dropped. Up to
+// max_open_spans spans are kept open, and past that the oldest open span
+// is discarded, as its end was likely lost.
+// @note This class is not thread safe.
+class TraceSpanTracker : public TraceEvents {
+ public:
+  static const size_t kDefaultMaxNames = 64 * 1024;
+  static const size_t kDefaultMaxOpenSpans = 64 * 1024;
+
+  TraceSpanTracker();
+  ~TraceSpanTracker();
+
+  // TraceEvents implementation.
+  virtual void OnTraceEventBegin(const TraceMessage& trace_message);
+  virtual void OnTraceEventEnd(const TraceMessage& trace_message);
+  virtual void OnTraceEventInstant(const TraceMessage& trace_message);
+
+  // Accessors.
+  void set_span_sink(TraceSpanEvents* span_sink) { span_sink_ = span_sink; }
+  const TraceSpanIndex& spans() const { return spans_; }
+
+  // Clients that only need the span sink can turn the index off, which
+  // keeps the tracker's memory bounded by the spans open at any one time.
+  bool index_spans() const { return index_spans_; }
+  void set_index_spans(bool index_spans) { index_spans_ = index_spans; }
+
+  // The most distinct span names to keep.
+  size_t max_names() const { return max_names_; }
+  void set_max_names(size_t max_names) { max_names_ = max_names; }
+
+  // The most spans to keep open, which must be at least one.
+  size_t max_open_spans() const { return max_open_spans_; }
+  void set_max_open_spans(size_t max_open_spans) {
+    DCHECK_NE(0U, max_open_spans);
+    max_open_spans_ = max_open_spans;
+  }
+
+  // @returns the name of @p span.
+  base::StringPiece GetName(const TraceSpan& span) const {
+    return names_.Get(span.name_id);
+  }
+
+  // @returns the number of distinct span names kept.
+  size_t num_names() const { return names_.size() - 1; }
+
+  // @returns the number of spans begun but not yet ended.
+  size_t num_open_spans() const { return open_spans_by_age_.size(); }
+
+  // @returns the number of ends that matched no begin.
+  size_t num_unmatched_ends() const { return num_unmatched_ends_; }
+
+  // @returns the number of begins dropped for names past max_names.
+  size_t num_dropped_begins() const { return num_dropped_begins_; }
+
+  // @returns the number of open spans discarded past max_open_spans.
+  size_t num_expired_spans() const { return num_expired_spans_; }
+
+  // @returns the number of spans open that began on thread @p thread_id
+  //     of process @p process_id.
+  size_t GetNestingDepth(DWORD process_id, DWORD thread_id) const;
+
+  // Discards all spans, open and completed.
+  void Clear();
+
+ private:
+  // Identifies the spans a begin and an end could pair up.
+  struct SpanKey {
+    SpanKey(DWORD process_id, StringTable::StringId name_id, void* id)
+        : process_id(process_id), name_id(name_id), id(id) {
+    }
+
+    bool operator<(const SpanKey& other) const;
+
+    DWORD process_id;
+    StringTable::StringId name_id;
+    void* id;
+  };
+
+  // A span that has begun.
+  struct OpenSpan {
+    DWORD thread_id;
+    base::Time begin_time;
+    size_t depth;
+    // Orders the open spans by age.
+    uint64 sequence;
+  };
+
+  // Discards the oldest open span.
+  void ExpireOldestSpan();
+
+  // Counts off an open span that began on thread @p thread_id of process
+  // @p process_id.
+  void DecrementNesting(DWORD process_id, DWORD thread_id);
+
+  // The open spans for each key, latest last.
+  typedef std::map<SpanKey, std::vector<OpenSpan> > OpenSpanMap;
+  OpenSpanMap open_spans_;
+
+  // The key of each open span, by sequence.
+  typedef std::map<uint64, SpanKey> OpenSpanAgeMap;
+  OpenSpanAgeMap open_spans_by_age_;
+  uint64 next_sequence_;
+
+  // The number of open spans by process and thread id.
+  typedef std::pair<DWORD, DWORD> ThreadKey;
+  typedef std::map<ThreadKey, size_t> NestingMap;
+  NestingMap nesting_;
+
+  size_t num_unmatched_ends_;
+  size_t num_dropped_begins_;
+  size_t num_expired_spans_;
+
+  StringTable names_;
+  size_t max_names_;
+  size_t max_open_spans_;
+  bool index_spans_;
+  TraceSpanIndex spans_;
+  TraceSpanEvents* span_sink_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceSpanTracker);
+};
+
+#endif  // SAWBUCK_LOG_LIB_TRACE_SPAN_TRACKER_H_
@@ -0,0 +1,279 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/log_lib/trace_span_tracker.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include "base/strings/stringprintf.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using testing::_;
+using testing::StrictMock;
+
+const DWORD kProcessId = 1234;
+
+class MockTraceSpanEvents : public TraceSpanEvents {
+ public:
+  MOCK_METHOD1(OnTraceSpan, void(const TraceSpan& span));
+};
+
+class TraceSpanTrackerTest : public testing::Test {
+ public:
+  void Begin(int64 time, DWORD thread_id, const char* name, void* id) {
+    tracker_.OnTraceEventBegin(MakeMessage(time, thread_id, name, id));
+  }
+
+  void End(int64 time, DWORD thread_id, const char* name, void* id) {
+    tracker_.OnTraceEventEnd(MakeMessage(time, thread_id, name, id));
+  }
+
+  // @returns the span named @p name.
+  const TraceSpan* FindSpan(const char* name) {
+    const TraceSpanIndex& spans = tracker_.spans();
+    for (size_t i = 0; i < spans.size(); ++i) {
+      if (tracker_.GetName(spans.span(i)) == base::StringPiece(name))
+        return &spans.span(i);
+    }
+    return NULL;
+  }
+
+ protected:
+  TraceEvents::TraceMessage MakeMessage(int64 time,
+                                        DWORD thread_id,
+                                        const char* name,
+                                        void* id) {
+    TraceEvents::TraceMessage message;
+    message.time = base::Time::FromInternalValue(time);
+    message.process_id = kProcessId;
+    message.thread_id = thread_id;
+    message.name = name;
+    message.name_len = strlen(name);
+    message.id = id;
+    return message;
+  }
+
+  TraceSpanTracker tracker_;
+};
+
+void* Id(uintptr_t id) {
+  return reinterpret_cast<void*>(id);
+}
+
+TEST_F(TraceSpanTrackerTest, PairsBeginAndEnd) {
+  Begin(100, 1, "Load", Id(1));
+  EXPECT_EQ(1U, tracker_.num_open_spans());
+  EXPECT_EQ(0U, tracker_.spans().size());
+
+  End(250, 1, "Load", Id(1));
+  EXPECT_EQ(0U, tracker_.num_open_spans());
+  ASSERT_EQ(1U, tracker_.spans().size());
+
+  const TraceSpan& span = tracker_.spans().span(0);
+  EXPECT_EQ("Load", tracker_.GetName(span).as_string());
+  EXPECT_EQ(kProcessId, span.process_id);
+  EXPECT_EQ(Id(1), span.id);
+  EXPECT_EQ(150, span.duration().ToInternalValue());
+  EXPECT_EQ(0U, span.depth);
+}
+
+TEST_F(TraceSpanTrackerTest, MatchesOnNameAndId) {
+  Begin(100, 1, "Load", Id(1));
+  Begin(110, 1, "Load", Id(2));
+  Begin(120, 1, "Save", Id(1));
+
+  // Neither the name nor the id alone match.
+  End(130, 1, "Paint", Id(1));
+  EXPECT_EQ(1U, tracker_.num_unmatched_ends());
+
+  End(140, 1, "Load", Id(1));
+  End(150, 1, "Save", Id(1));
+  End(160, 1, "Load", Id(2));
+  ASSERT_EQ(3U, tracker_.spans().size());
+  EXPECT_EQ(40, tracker_.spans().span(0).duration().ToInternalValue());
+  EXPECT_EQ(30, tracker_.spans().span(1).duration().ToInternalValue());
+  EXPECT_EQ(50, tracker_.spans().span(2).duration().ToInternalValue());
+}
+
+TEST_F(TraceSpanTrackerTest, RepeatedBeginsCloseLatestFirst) {
+  Begin(100, 1, "Recurse", Id(1));
+  Begin(110, 1, "Recurse", Id(1));
+  End(120, 1, "Recurse", Id(1));
+  End(200, 1, "Recurse", Id(1));
+
+  ASSERT_EQ(2U, tracker_.spans().size());
+  EXPECT_EQ(10, tracker_.spans().span(0).duration().ToInternalValue());
+  EXPECT_EQ(1U, tracker_.spans().span(0).depth);
+  EXPECT_EQ(100, tracker_.spans().span(1).duration().ToInternalValue());
+  EXPECT_EQ(0U, tracker_.spans().span(1).depth);
+}
+
+TEST_F(TraceSpanTrackerTest, TracksNestingPerThread) {
+  Begin(100, 1, "Outer", Id(1));
+  Begin(110, 1, "Inner", Id(1));
+  Begin(115, 2, "Other", Id(1));
+  EXPECT_EQ(2U, tracker_.GetNestingDepth(kProcessId, 1));
+  EXPECT_EQ(1U, tracker_.GetNestingDepth(kProcessId, 2));
+  EXPECT_EQ(0U, tracker_.GetNestingDepth(kProcessId + 1, 1));
+
+  // Ends can come from another thread, and count against the thread the
+  // span began on.
+  End(120, 2, "Inner", Id(1));
+  End(130, 2, "Other", Id(1));
+  End(140, 1, "Outer", Id(1));
+  EXPECT_EQ(0U, tracker_.GetNestingDepth(kProcessId, 1));
+  EXPECT_EQ(0U, tracker_.GetNestingDepth(kProcessId, 2));
+
+  const TraceSpan* inner = FindSpan("Inner");
+  ASSERT_TRUE(inner != NULL);
+  EXPECT_EQ(1U, inner->depth);
+  EXPECT_EQ(1U, inner->begin_thread_id);
+  EXPECT_EQ(2U, inner->end_thread_id);
+
+  const TraceSpan* other = FindSpan("Other");
+  ASSERT_TRUE(other != NULL);
+  EXPECT_EQ(0U, other->depth);
+}
+
+TEST_F(TraceSpanTrackerTest, IssuesSpans) {
+  StrictMock<MockTraceSpanEvents> span_events;
+  tracker_.set_span_sink(&span_events);
+
+  Begin(100, 1, "Load", Id(1));
+  EXPECT_CALL(span_events, OnTraceSpan(_));
+  End(200, 1, "Load", Id(1));
+
+  // Instant events make no spans.
+  tracker_.OnTraceEventInstant(MakeMessage(300, 1, "Load", Id(1)));
+}
+
+TEST_F(TraceSpanTrackerTest, IssuesSpansWithoutIndex) {
+  StrictMock<MockTraceSpanEvents> span_events;
+  tracker_.set_span_sink(&span_events);
+  tracker_.set_index_spans(false);
+
+  Begin(100, 1, "Load", Id(1));
+  EXPECT_CALL(span_events, OnTraceSpan(_));
+  End(200, 1, "Load", Id(1));
+  EXPECT_EQ(0U, tracker_.spans().size());
+}
+
+TEST_F(TraceSpanTrackerTest, IndexesSpans) {
+  Begin(100, 1, "Outer", Id(1));
+  Begin(110, 1, "Inner", Id(1));
+  End(120, 1, "Inner", Id(1));
+  End(200, 1, "Outer", Id(1));
+
+  std::vector<TraceSpanIndex::SpanId> open;
+  tracker_.spans().GetSpansOpenAt(base::Time::FromInternalValue(115), &open);
+  ASSERT_EQ(2U, open.size());
+  const TraceSpanIndex& spans = tracker_.spans();
+  EXPECT_EQ("Outer", tracker_.GetName(spans.span(open[0])).as_string());
+  EXPECT_EQ("Inner", tracker_.GetName(spans.span(open[1])).as_string());
+}
+
+TEST_F(TraceSpanTrackerTest, ClampsBackwardsEnds) {
+  Begin(100, 1, "Skewed", Id(1));
+  End(90, 2, "Skewed", Id(1));
+
+  ASSERT_EQ(1U, tracker_.spans().size());
+  EXPECT_EQ(0, tracker_.spans().span(0).duration().ToInternalValue());
+}
+
+TEST_F(TraceSpanTrackerTest, BoundsNames) {
+  tracker_.set_max_names(2);
+  Begin(100, 1, "A", Id(1));
+  Begin(100, 1, "B", Id(1));
+  Begin(100, 1, "C", Id(1));
+  EXPECT_EQ(2U, tracker_.num_names());
+  EXPECT_EQ(2U, tracker_.num_open_spans());
+  EXPECT_EQ(1U, tracker_.num_dropped_begins());
+
+  // Ends with names that aren't kept aren't kept either.
+  End(110, 1, "C", Id(1));
+  End(110, 1, "D", Id(1));
+  EXPECT_EQ(2U, tracker_.num_names());
+  EXPECT_EQ(2U, tracker_.num_unmatched_ends());
+
+  // Names that are kept still pair up.
+  End(110, 1, "A", Id(1));
+  EXPECT_TRUE(FindSpan("A") != NULL);
+}
+
+TEST_F(TraceSpanTrackerTest, ExpiresOldestOpenSpans) {
+  tracker_.set_max_open_spans(2);
+  Begin(100, 1, "A", Id(1));
+  Begin(110, 2, "B", Id(1));
+  Begin(120, 1, "C", Id(1));
+  EXPECT_EQ(2U, tracker_.num_open_spans());
+  EXPECT_EQ(1U, tracker_.num_expired_spans());
+  EXPECT_EQ(1U, tracker_.GetNestingDepth(kProcessId, 1));
+
+  // The end of the expired span matches nothing.
+  End(130, 1, "A", Id(1));
+  EXPECT_EQ(1U, tracker_.num_unmatched_ends());
+
+  End(130, 1, "C", Id(1));
+  End(130, 2, "B", Id(1));
+  EXPECT_EQ(0U, tracker_.num_open_spans());
+  EXPECT_EQ(2U, tracker_.spans().size());
+}
+
+TEST_F(TraceSpanTrackerTest, MemoryStaysFlat) {
+  const size_t kMaxNames = 100;
+  const size_t kMaxOpenSpans = 50;
+  tracker_.set_index_spans(false);
+  tracker_.set_max_names(kMaxNames);
+  tracker_.set_max_open_spans(kMaxOpenSpans);
+
+  // Floods the tracker with unique names that never end, and ends that
+  // never began.
+  int64 time = 0;
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 0; i < 10000; ++i) {
+      std::string name = base::StringPrintf("Leaked %d-%d", round, i);
+      Begin(time++, 1, name.c_str(), Id(i));
+      Begin(time++, 1, "Nested", Id(i));
+      name = base::StringPrintf("Unmatched %d-%d", round, i);
+      End(time++, 1, name.c_str(), Id(i));
+    }
+
+    EXPECT_EQ(kMaxNames, tracker_.num_names());
+    EXPECT_EQ(kMaxOpenSpans, tracker_.num_open_spans());
+    EXPECT_EQ(kMaxOpenSpans, tracker_.GetNestingDepth(kProcessId, 1));
+  }
+
+  EXPECT_EQ(20000U, tracker_.num_unmatched_ends());
+  EXPECT_LT(0U, tracker_.num_dropped_begins());
+  EXPECT_LT(0U, tracker_.num_expired_spans());
+}
+
+TEST_F(TraceSpanTrackerTest, Clear) {
+  Begin(100, 1, "Open", Id(1));
+  Begin(100, 1, "Closed", Id(1));
+  End(110, 1, "Closed", Id(1));
+  End(110, 1, "Unmatched", Id(1));
+  tracker_.Clear();
+
+  EXPECT_EQ(0U, tracker_.num_open_spans());
+  EXPECT_EQ(0U, tracker_.num_unmatched_ends());
+  EXPECT_EQ(0U, tracker_.num_names());
+  EXPECT_EQ(0U, tracker_.spans().size());
+  EXPECT_EQ(0U, tracker_.GetNestingDepth(kProcessId, 1));
+}
+
+}  // namespace
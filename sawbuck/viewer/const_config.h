@@ -57,6 +57,15 @@ const wchar_t kFilterViewColumnWidths[] = L"filter_view_column_widths";
 
 const wchar_t kFilterValues[] = L"filter_values";
 
+// DWORD values bounding the rows, and the megabytes, kept while capturing.
+// The oldest rows are dropped past either. Zero or absent is no bound.
+const wchar_t kRetainRowsValue[] = L"retain_rows";
+const wchar_t kRetainMegabytesValue[] = L"retain_megabytes";
+
+// DWORD value of the megabytes of pages cached while reading a saved
+// session a page at a time. Zero or absent maps the session whole.
+const wchar_t kSessionCacheMegabytesValue[] = L"session_cache_megabytes";
+
 }  // namespace config
 
 #endif  // SAWBUCK_VIEWER_CONST_CONFIG_H_
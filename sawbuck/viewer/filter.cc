@@ -24,6 +24,7 @@
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
 #include "base/strings/utf_string_conversions.h"
+#include "sawbuck/log_lib/log_filter.h"
 #include "sawbuck/viewer/log_list_view.h"
 
 using base::IntToString;
@@ -32,6 +33,20 @@ using base::StringToInt;
 
 const wchar_t kSeparator[] = L"|";
 
+// dump_logs reads our serialized filters with LogFilter, which must
+// number its columns, relations and actions the same.
+COMPILE_ASSERT(static_cast<int>(Filter::MESSAGE) ==
+                   static_cast<int>(LogFilter::MESSAGE) &&
+               static_cast<int>(Filter::NUM_COLUMNS) ==
+                   static_cast<int>(LogFilter::NUM_COLUMNS),
+               log_filter_columns_match);
+COMPILE_ASSERT(static_cast<int>(Filter::CONTAINS) ==
+                   static_cast<int>(LogFilter::CONTAINS),
+               log_filter_relations_match);
+COMPILE_ASSERT(static_cast<int>(Filter::EXCLUDE) ==
+                   static_cast<int>(LogFilter::EXCLUDE),
+               log_filter_actions_match);
+
 Filter::Filter(Column column, Relation relation, Action action,
                const wchar_t* value)
     : column_(column), relation_(relation), action_(action), is_valid_(true),
@@ -64,7 +79,7 @@ std::string Filter::value() const {
   return value_;
 }
 
-bool Filter::Matches(ILogView* log_view, int row_index) const {
+bool Filter::Matches(ILogViewV2* log_view, int row_index) const {
   DCHECK(log_view);
 
   bool matches = false;
@@ -89,7 +104,7 @@ bool Filter::Matches(ILogView* log_view, int row_index) const {
       break;
     }
     case FILE: {
-      matches = ValueMatchesString(log_view->GetFileName(row_index));
+      matches = ValueMatchesString(log_view->GetFileNameView(row_index));
       break;
     }
     case LINE: {
@@ -97,7 +112,7 @@ bool Filter::Matches(ILogView* log_view, int row_index) const {
       break;
     }
     case MESSAGE: {
-      matches = ValueMatchesString(log_view->GetMessage(row_index));
+      matches = ValueMatchesString(log_view->GetMessageView(row_index));
       break;
     }
     default:
@@ -123,13 +138,14 @@ bool Filter::ValueMatchesInt(int check_value) const {
   return matches;
 }
 
-bool Filter::ValueMatchesString(const std::string& check_string) const {
+bool Filter::ValueMatchesString(const base::StringPiece& check_string) const {
   DCHECK(!match_re_.pattern().empty());
+  pcrecpp::StringPiece subject(check_string.data(), check_string.size());
   bool matches = false;
   if (relation_ == IS) {
-    matches = match_re_.FullMatch(check_string);
+    matches = match_re_.FullMatch(subject);
   } else if (relation_ == CONTAINS) {
-    matches = match_re_.PartialMatch(check_string);
+    matches = match_re_.PartialMatch(subject);
   }
   return matches;
 }
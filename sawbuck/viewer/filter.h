@@ -20,6 +20,7 @@
 
 #include <string>
 #include <vector>
+#include "base/strings/string_piece.h"
 #include "sawbuck/viewer/log_list_view.h"
 #include "pcrecpp.h"  // NOLINT
 
@@ -75,7 +76,14 @@ class Filter {
   bool IsValid() { return is_valid_; }
 
   // Returns true if this filter matches the log entry in log_view on row_index.
-  bool Matches(ILogView* log_view, int row_index) const;
+  bool Matches(ILogViewV2* log_view, int row_index) const;
+
+  // Returns true if this filter matches a row whose column has the value
+  // check_value or check_string, as formatted for this filter's column.
+  // These let a filter be matched against the distinct values of a column
+  // rather than against each row.
+  bool ValueMatchesInt(int check_value) const;
+  bool ValueMatchesString(const base::StringPiece& check_string) const;
 
   // Returns a JSON value representation of this filter. This representation
   // can be used in the constructor that takes a serialized representation.
@@ -108,10 +116,6 @@ class Filter {
   bool operator==(const Filter& other) const;
 
  private:
-
-  bool ValueMatchesInt(int check_value) const;
-  bool ValueMatchesString(const std::string& check_string) const;
-
   // Sets up match_re_ if needed.
   void BuildRegExp();
 
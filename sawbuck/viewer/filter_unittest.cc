@@ -32,11 +32,11 @@ TEST_F(FilterTest, TestMessageMatching) {
   const int kNumRows = 3;
   EXPECT_CALL(mock_view_, GetNumRows())
       .WillRepeatedly(Return(kNumRows));
-  EXPECT_CALL(mock_view_, GetMessage(0))
+  EXPECT_CALL(mock_view_, GetMessageView(0))
       .WillRepeatedly(Return("I'm not included"));
-  EXPECT_CALL(mock_view_, GetMessage(1))
+  EXPECT_CALL(mock_view_, GetMessageView(1))
       .WillRepeatedly(Return("I'm Included"));
-  EXPECT_CALL(mock_view_, GetMessage(2))
+  EXPECT_CALL(mock_view_, GetMessageView(2))
       .WillRepeatedly(Return("I'm Included but also Excluded"));
 
   Filter include_nothing_contains(Filter::MESSAGE, Filter::CONTAINS,
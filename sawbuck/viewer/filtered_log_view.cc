@@ -15,13 +15,16 @@
 // Filtered list view implementation.
 #include "sawbuck/viewer/filtered_log_view.h"
 
+#include <algorithm>
+
 #include "base/bind.h"
 #include "base/logging.h"
 #include "pcrecpp.h"  // NOLINT
+#include "sawbuck/viewer/log_index.h"
 
-FilteredLogView::FilteredLogView(ILogView* original,
+FilteredLogView::FilteredLogView(ILogViewV2* original,
                                  const std::vector<Filter>& filters) :
-    filtered_rows_(0), original_(original),
+    filtered_rows_(0), include_candidate_rows_(0), original_(original),
     registration_cookie_(0), next_sink_cookie_(1) {
   DCHECK(original_ != NULL);
   original_->Register(this, &registration_cookie_);
@@ -47,6 +50,30 @@ void FilteredLogView::LogViewCleared() {
     it->second->LogViewCleared();
 }
 
+void FilteredLogView::LogViewRowsRemoved(int num_rows) {
+  // Drop our rows among those removed, and renumber the rest.
+  std::vector<int>::iterator kept(
+      std::lower_bound(included_rows_.begin(), included_rows_.end(),
+                       num_rows));
+  int removed = kept - included_rows_.begin();
+  included_rows_.erase(included_rows_.begin(), kept);
+  for (size_t i = 0; i < included_rows_.size(); ++i)
+    included_rows_[i] -= num_rows;
+
+  // Removed rows that weren't filtered yet are skipped.
+  filtered_rows_ = std::max(filtered_rows_ - num_rows, 0);
+
+  // The candidates are queried again for the renumbered rows.
+  include_candidates_.Clear();
+  include_candidate_rows_ = 0;
+
+  if (removed != 0) {
+    EventSinkMap::iterator it(event_sinks_.begin());
+    for (; it != event_sinks_.end(); ++it)
+      it->second->LogViewRowsRemoved(removed);
+  }
+}
+
 int FilteredLogView::GetNumRows() {
   return included_rows_.size();
 }
@@ -82,7 +109,7 @@ base::Time FilteredLogView::GetTime(int row) {
 std::string FilteredLogView::GetFileName(int row) {
   DCHECK(row < GetNumRows());
 
-  return original_->GetFileName(included_rows_[row]);
+  return GetFileNameView(row).as_string();
 }
 
 int FilteredLogView::GetLine(int row) {
@@ -94,7 +121,7 @@ int FilteredLogView::GetLine(int row) {
 std::string FilteredLogView::GetMessage(int row) {
   DCHECK(row < GetNumRows());
 
-  return original_->GetMessage(included_rows_[row]);
+  return GetMessageView(row).as_string();
 }
 
 void FilteredLogView::GetStackTrace(int row, std::vector<void*>* trace) {
@@ -103,6 +130,94 @@ void FilteredLogView::GetStackTrace(int row, std::vector<void*>* trace) {
   return original_->GetStackTrace(included_rows_[row], trace);
 }
 
+base::StringPiece FilteredLogView::GetFileNameView(int row) {
+  DCHECK(row < GetNumRows());
+
+  return original_->GetFileNameView(included_rows_[row]);
+}
+
+base::StringPiece FilteredLogView::GetMessageView(int row) {
+  DCHECK(row < GetNumRows());
+
+  return original_->GetMessageView(included_rows_[row]);
+}
+
+void FilteredLogView::GetStackTraceView(int row,
+                                        void* const** trace,
+                                        size_t* depth) {
+  DCHECK(row < GetNumRows());
+
+  original_->GetStackTraceView(included_rows_[row], trace, depth);
+}
+
+void FilteredLogView::GetColumns(int first_row,
+                                 int num_rows,
+                                 uint32 columns,
+                                 LogColumnBatch* batch) {
+  DCHECK(first_row >= 0 && first_row + num_rows <= GetNumRows());
+  DCHECK(batch != NULL);
+
+  batch->Clear();
+  for (int i = first_row; i < first_row + num_rows; ++i) {
+    int row = included_rows_[i];
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::SEVERITY))
+      batch->severities.push_back(original_->GetSeverity(row));
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::PROCESS_ID))
+      batch->process_ids.push_back(original_->GetProcessId(row));
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::THREAD_ID))
+      batch->thread_ids.push_back(original_->GetThreadId(row));
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::TIME))
+      batch->times.push_back(original_->GetTime(row));
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::FILE))
+      batch->file_names.push_back(original_->GetFileNameView(row));
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::LINE))
+      batch->lines.push_back(original_->GetLine(row));
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::MESSAGE))
+      batch->messages.push_back(original_->GetMessageView(row));
+  }
+}
+
+const LogIndex* FilteredLogView::GetIndex() {
+  // Our rows are a subset of the original's, so its index doesn't apply.
+  return NULL;
+}
+
+bool FilteredLogView::GetMessageCandidates(const std::string& pattern,
+                                           bool caseless,
+                                           RowBitmap* rows,
+                                           int* num_rows) {
+  DCHECK(rows != NULL);
+  DCHECK(num_rows != NULL);
+
+  RowBitmap original_rows;
+  int original_num_rows = 0;
+  if (!original_->GetMessageCandidates(pattern, caseless, &original_rows,
+                                       &original_num_rows)) {
+    return false;
+  }
+
+  // Map the original's candidates to our rows.
+  std::vector<int> candidates;
+  original_rows.AppendRows(0, original_num_rows, &candidates);
+  rows->Clear();
+  std::vector<int>::const_iterator it(included_rows_.begin());
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    it = std::lower_bound(it, included_rows_.end(), candidates[i]);
+    if (it == included_rows_.end())
+      break;
+    if (*it == candidates[i])
+      rows->Add(it - included_rows_.begin());
+  }
+
+  *num_rows = std::lower_bound(included_rows_.begin(), included_rows_.end(),
+                               original_num_rows) - included_rows_.begin();
+  return true;
+}
+
+void FilteredLogView::ReleaseViews() {
+  original_->ReleaseViews();
+}
+
 void FilteredLogView::Register(ILogViewEvents* event_sink,
                             int* registration_cookie) {
   int cookie = next_sink_cookie_++;
@@ -126,6 +241,141 @@ bool FilteredLogView::MatchesFilterList(const std::vector<Filter>& list,
   return false;
 }
 
+// static
+bool FilteredLogView::IsIndexed(const Filter& filter) {
+  switch (filter.column()) {
+    case Filter::SEVERITY:
+    case Filter::PROCESS_ID:
+    case Filter::THREAD_ID:
+    case Filter::FILE:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// static
+void FilteredLogView::GetIndexedRows(const LogIndex& index,
+                                     const Filter& filter,
+                                     RowBitmap* rows) {
+  DCHECK(IsIndexed(filter));
+  DCHECK(rows != NULL);
+
+  rows->Clear();
+  const LogIndex::ValueMap* values = NULL;
+  switch (filter.column()) {
+    case Filter::SEVERITY:
+      values = &index.levels();
+      break;
+    case Filter::PROCESS_ID:
+      values = &index.process_ids();
+      break;
+    case Filter::THREAD_ID:
+      values = &index.thread_ids();
+      break;
+
+    case Filter::FILE: {
+      const LogIndex::FileVector& files = index.files();
+      for (size_t i = 0; i < files.size(); ++i) {
+        if (!files[i].rows.empty() &&
+            filter.ValueMatchesString(files[i].file_name)) {
+          rows->Union(files[i].rows);
+        }
+      }
+      return;
+    }
+
+    default:
+      NOTREACHED();
+      return;
+  }
+
+  LogIndex::ValueMap::const_iterator it(values->begin());
+  for (; it != values->end(); ++it) {
+    bool matches = false;
+    if (filter.column() == Filter::SEVERITY) {
+      matches = filter.ValueMatchesString(LogViewFormatter::GetSeverityText(
+          static_cast<UCHAR>(it->first)));
+    } else {
+      matches = filter.ValueMatchesInt(it->first);
+    }
+
+    if (matches)
+      rows->Union(it->second);
+  }
+}
+
+bool FilteredLogView::FilterFromIndex(RowBitmap* rows) {
+  DCHECK(rows != NULL);
+
+  if (inclusion_filters_.empty() && exclusion_filters_.empty())
+    return false;
+  for (size_t i = 0; i < inclusion_filters_.size(); ++i) {
+    if (!IsIndexed(inclusion_filters_[i]))
+      return false;
+  }
+  for (size_t i = 0; i < exclusion_filters_.size(); ++i) {
+    if (!IsIndexed(exclusion_filters_[i]))
+      return false;
+  }
+
+  const LogIndex* index = original_->GetIndex();
+  int num_rows = original_->GetNumRows();
+  if (index == NULL || index->num_rows() < static_cast<size_t>(num_rows))
+    return false;
+
+  rows->Clear();
+  if (inclusion_filters_.empty())
+    rows->AddRange(0, num_rows);
+
+  RowBitmap matches;
+  for (size_t i = 0; i < inclusion_filters_.size(); ++i) {
+    GetIndexedRows(*index, inclusion_filters_[i], &matches);
+    rows->Union(matches);
+  }
+  for (size_t i = 0; i < exclusion_filters_.size(); ++i) {
+    GetIndexedRows(*index, exclusion_filters_[i], &matches);
+    rows->Subtract(matches);
+  }
+
+  return true;
+}
+
+bool FilteredLogView::UpdateIncludeCandidates(int start) {
+  if (start < include_candidate_rows_)
+    return true;
+
+  include_candidates_.Clear();
+  include_candidate_rows_ = 0;
+  if (inclusion_filters_.empty())
+    return false;
+
+  int covered_rows = original_->GetNumRows();
+  RowBitmap candidates;
+  std::vector<Filter>::const_iterator iter(inclusion_filters_.begin());
+  for (; iter != inclusion_filters_.end(); ++iter) {
+    // Filters always match case insensitively.
+    int num_rows = 0;
+    if (iter->column() != Filter::MESSAGE ||
+        !original_->GetMessageCandidates(iter->value(), true, &candidates,
+                                         &num_rows)) {
+      include_candidates_.Clear();
+      return false;
+    }
+    include_candidates_.Union(candidates);
+    covered_rows = std::min(covered_rows, num_rows);
+  }
+
+  if (covered_rows <= start) {
+    include_candidates_.Clear();
+    return false;
+  }
+
+  include_candidate_rows_ = covered_rows;
+  return true;
+}
+
 void FilteredLogView::FilterChunk() {
   task_.Cancel();
 
@@ -137,8 +387,31 @@ void FilteredLogView::FilterChunk() {
   int start = filtered_rows_;
   int end = std::min(filtered_rows_ + kMaxFilterRows, original_->GetNumRows());
 
-
-  if (inclusion_filters_.empty()) {
+  RowBitmap indexed_rows;
+  if (FilterFromIndex(&indexed_rows)) {
+    // The index answers for all the rows there are, in one go.
+    end = original_->GetNumRows();
+    indexed_rows.AppendRows(start, end, &included_rows_);
+  } else if (UpdateIncludeCandidates(start)) {
+    // Only the candidate rows can match an inclusion filter, so match just
+    // those, up to kMaxFilterRows of them.
+    uint32 next = start;
+    end = include_candidate_rows_;
+    for (int i = 0; i < kMaxFilterRows; ++i) {
+      uint32 row = 0;
+      if (!include_candidates_.NextRow(next, &row) ||
+          row >= static_cast<uint32>(end)) {
+        next = end;
+        break;
+      }
+      if (MatchesFilterList(inclusion_filters_, row) &&
+          !MatchesFilterList(exclusion_filters_, row)) {
+        included_rows_.push_back(row);
+      }
+      next = row + 1;
+    }
+    end = static_cast<int>(next);
+  } else if (inclusion_filters_.empty()) {
     // If the inclusion_filters_ list is empty, show all rows that do not match
     // a filter in the exclusion list
     for (int i = start; i < end; ++i) {
@@ -161,6 +434,9 @@ void FilteredLogView::FilterChunk() {
   // Update our cursor.
   filtered_rows_ = end;
 
+  // The rows filtered are done with, so their storage may be freed.
+  original_->ReleaseViews();
+
   // Post again if we're not done.
   if (end != original_->GetNumRows())
     PostFilteringTask();
@@ -195,6 +471,8 @@ void FilteredLogView::RestartFiltering() {
   // Reset our included state and our filtering state.
   filtered_rows_ = 0;
   included_rows_.clear();
+  include_candidates_.Clear();
+  include_candidate_rows_ = 0;
   PostFilteringTask();
 }
 
@@ -22,21 +22,27 @@
 
 #include "base/cancelable_callback.h"
 #include "base/memory/scoped_ptr.h"
+#include "sawbuck/common/row_bitmap.h"
 #include "sawbuck/viewer/filter.h"
 #include "sawbuck/viewer/log_list_view.h"
 
-// Provides a filtered view on a log.
+// Provides a filtered view on a log. When every filter is on an indexed
+// column, and the original view has an index, the filters are answered
+// from the index rather than by matching each row. Likewise, when every
+// inclusion filter is on the message, and the original view can narrow
+// message searches, only the candidate rows are matched.
 class FilteredLogView
     : public ILogViewEvents,
-      public ILogView {
+      public ILogViewV2 {
  public:
-  explicit FilteredLogView(ILogView* original,
+  explicit FilteredLogView(ILogViewV2* original,
                            const std::vector<Filter>& filters);
   ~FilteredLogView();
 
   // ILogViewEvents implementation.
   virtual void LogViewNewItems();
   virtual void LogViewCleared();
+  virtual void LogViewRowsRemoved(int num_rows);
 
   // ILogView implementation;
   // @{
@@ -55,6 +61,23 @@ class FilteredLogView
   virtual void Unregister(int registration_cookie);
   // @}
 
+  // ILogViewV2 implementation;
+  // @{
+  virtual base::StringPiece GetFileNameView(int row);
+  virtual base::StringPiece GetMessageView(int row);
+  virtual void GetStackTraceView(int row, void* const** trace, size_t* depth);
+  virtual void GetColumns(int first_row,
+                          int num_rows,
+                          uint32 columns,
+                          LogColumnBatch* batch);
+  virtual const LogIndex* GetIndex();
+  virtual bool GetMessageCandidates(const std::string& pattern,
+                                    bool caseless,
+                                    RowBitmap* rows,
+                                    int* num_rows);
+  virtual void ReleaseViews();
+  // @}
+
  void SetFilters(const std::vector<Filter>& filters);
 
  protected:
@@ -66,6 +89,23 @@ class FilteredLogView
   // false otherwise.
   bool MatchesFilterList(const std::vector<Filter>& list, int index);
 
+  // Returns true if |filter| is on a column a LogIndex indexes.
+  static bool IsIndexed(const Filter& filter);
+
+  // Sets |rows| to the rows of |index| that |filter| matches.
+  static void GetIndexedRows(const LogIndex& index,
+                             const Filter& filter,
+                             RowBitmap* rows);
+
+  // Sets |rows| to the rows of |original_| our filters include, and
+  // returns true, if the filters can be answered from its index. Returns
+  // false otherwise.
+  bool FilterFromIndex(RowBitmap* rows);
+
+  // Returns true if |include_candidates_| narrows the inclusion filters
+  // for the rows from |start| on, querying the original view if need be.
+  bool UpdateIncludeCandidates(int start);
+
   // The filters we are using. We break them into two lists, one that contains
   // inclusion filters, the other exclusion filters.
   std::vector<Filter> inclusion_filters_;
@@ -76,12 +116,17 @@ class FilteredLogView
   // Row number of last row in |original_| that we've processed.
   int filtered_rows_;
 
+  // The rows of |original_| that may match an inclusion filter, among the
+  // first |include_candidate_rows_|, which is zero when there are none.
+  RowBitmap include_candidates_;
+  int include_candidate_rows_;
+
   typedef base::CancelableCallback<void()> FilterCallback;
 
   // Non-NULL if there's a task pending to process additional rows.
   FilterCallback task_;
 
-  ILogView* original_;
+  ILogViewV2* original_;
   int registration_cookie_;
 
   typedef std::map<int, ILogViewEvents*> EventSinkMap;
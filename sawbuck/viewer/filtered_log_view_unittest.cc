@@ -17,12 +17,15 @@
 #include "base/message_loop/message_loop.h"
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
+#include "sawbuck/viewer/log_index.h"
 #include "sawbuck/viewer/mock_log_view_interfaces.h"
 
 namespace {
 
 using testing::_;
+using testing::AnyNumber;
 using testing::AtLeast;
+using testing::DoAll;
 using testing::Return;
 using testing::SetArgumentPointee;
 using testing::StrictMock;
@@ -30,12 +33,13 @@ using testing::StrictMock;
 
 class TestingFilteredLogView: public FilteredLogView {
  public:
-  explicit TestingFilteredLogView(ILogView* original,
+  explicit TestingFilteredLogView(ILogViewV2* original,
                                   const std::vector<Filter>& filters)
       : FilteredLogView(original, filters) {
   }
 
   const FilterCallback& task() const { return task_; }
+  const std::vector<int>& included_rows() const { return included_rows_; }
 };
 
 class FilteredLogViewTest: public testing::Test {
@@ -45,6 +49,8 @@ class FilteredLogViewTest: public testing::Test {
   void ExpectCreation(int num_rows) {
     EXPECT_CALL(mock_view_, Register(_, _))
         .WillOnce(SetArgumentPointee<1>(kRegCookie));
+    EXPECT_CALL(mock_view_, ReleaseViews())
+        .Times(AnyNumber());
   }
 
   void ExpectUnregistration() {
@@ -129,7 +135,7 @@ TEST_F(FilteredLogViewTest, IdentityFilter) {
   filtered.LogViewNewItems();
   EXPECT_EQ(0, filtered.GetNumRows());
 
-  EXPECT_CALL(mock_view_, GetMessage(_))
+  EXPECT_CALL(mock_view_, GetMessageView(_))
       .WillRepeatedly(Return("foo"));
 
   RunMessageLoopToIdle();
@@ -148,12 +154,14 @@ TEST_F(FilteredLogViewTest, Filtering) {
 
   EXPECT_CALL(mock_view_, GetNumRows())
       .WillRepeatedly(Return(kNumRows));
-  EXPECT_CALL(mock_view_, GetMessage(0))
+  EXPECT_CALL(mock_view_, GetMessageView(0))
       .WillRepeatedly(Return("I'm not included"));
-  EXPECT_CALL(mock_view_, GetMessage(1))
+  EXPECT_CALL(mock_view_, GetMessageView(1))
       .WillRepeatedly(Return("I'm Included"));
-  EXPECT_CALL(mock_view_, GetMessage(2))
+  EXPECT_CALL(mock_view_, GetMessageView(2))
       .WillRepeatedly(Return("I'm Included but also Excluded"));
+  EXPECT_CALL(mock_view_, GetMessageCandidates(_, _, _, _))
+      .WillRepeatedly(Return(false));
 
   // Run the identity filter to start with.
   RunMessageLoopToIdle();
@@ -203,9 +211,205 @@ TEST_F(FilteredLogViewTest, Filtering) {
   ExpectUnregistration();
 }
 
+TEST_F(FilteredLogViewTest, RowsRemoved) {
+  const int kNumRows = 4;
+  ExpectCreation(kNumRows);
+
+  std::vector<Filter> filters;
+  filters.push_back(Filter(Filter::MESSAGE, Filter::CONTAINS, Filter::EXCLUDE,
+                           L"Excluded"));
+  TestingFilteredLogView filtered(&mock_view_, filters);
+
+  int cookie = 0;
+  filtered.Register(&mock_view_events_, &cookie);
+
+  EXPECT_CALL(mock_view_, GetNumRows())
+      .WillRepeatedly(Return(kNumRows));
+  EXPECT_CALL(mock_view_, GetMessageView(0))
+      .WillRepeatedly(Return("First"));
+  EXPECT_CALL(mock_view_, GetMessageView(1))
+      .WillRepeatedly(Return("Excluded"));
+  EXPECT_CALL(mock_view_, GetMessageView(2))
+      .WillRepeatedly(Return("Third"));
+  EXPECT_CALL(mock_view_, GetMessageView(3))
+      .WillRepeatedly(Return("Fourth"));
+  EXPECT_CALL(mock_view_events_, LogViewNewItems())
+      .Times(AtLeast(1));
+
+  RunMessageLoopToIdle();
+  ASSERT_EQ(3, filtered.GetNumRows());
+
+  // Removing the first two rows removes one of ours, and renumbers the
+  // rest along with the original's.
+  EXPECT_CALL(mock_view_events_, LogViewRowsRemoved(1)).Times(1);
+  filtered.LogViewRowsRemoved(2);
+  ASSERT_EQ(2, filtered.GetNumRows());
+  EXPECT_EQ(0, filtered.included_rows()[0]);
+  EXPECT_EQ(1, filtered.included_rows()[1]);
+
+  ExpectUnregistration();
+}
+
+TEST_F(FilteredLogViewTest, GetColumns) {
+  const int kNumRows = 3;
+  ExpectCreation(kNumRows);
+
+  std::vector<Filter> filters;
+  filters.push_back(Filter(Filter::MESSAGE, Filter::CONTAINS, Filter::EXCLUDE,
+                           L"Excluded"));
+  TestingFilteredLogView filtered(&mock_view_, filters);
+
+  EXPECT_CALL(mock_view_, GetNumRows())
+      .WillRepeatedly(Return(kNumRows));
+  EXPECT_CALL(mock_view_, GetMessageView(0))
+      .WillRepeatedly(Return("First"));
+  EXPECT_CALL(mock_view_, GetMessageView(1))
+      .WillRepeatedly(Return("Excluded"));
+  EXPECT_CALL(mock_view_, GetMessageView(2))
+      .WillRepeatedly(Return("Third"));
+  EXPECT_CALL(mock_view_, GetLine(0))
+      .WillRepeatedly(Return(10));
+  EXPECT_CALL(mock_view_, GetLine(2))
+      .WillRepeatedly(Return(30));
+
+  RunMessageLoopToIdle();
+  ASSERT_EQ(2, filtered.GetNumRows());
+
+  // Only the requested columns of the included rows are retrieved.
+  LogColumnBatch batch;
+  filtered.GetColumns(0, 2,
+                      LogColumnBatch::Bit(LogViewFormatter::LINE) |
+                          LogColumnBatch::Bit(LogViewFormatter::MESSAGE),
+                      &batch);
+  ASSERT_EQ(2U, batch.lines.size());
+  EXPECT_EQ(10, batch.lines[0]);
+  EXPECT_EQ(30, batch.lines[1]);
+  ASSERT_EQ(2U, batch.messages.size());
+  EXPECT_EQ("First", batch.messages[0].as_string());
+  EXPECT_EQ("Third", batch.messages[1].as_string());
+  EXPECT_TRUE(batch.severities.empty());
+  EXPECT_TRUE(batch.file_names.empty());
+
+  // A subsequent batch replaces the previous one.
+  filtered.GetColumns(1, 1, LogColumnBatch::Bit(LogViewFormatter::MESSAGE),
+                      &batch);
+  EXPECT_TRUE(batch.lines.empty());
+  ASSERT_EQ(1U, batch.messages.size());
+  EXPECT_EQ("Third", batch.messages[0].as_string());
+
+  ExpectUnregistration();
+}
+
+TEST_F(FilteredLogViewTest, FiltersFromIndex) {
+  const int kNumRows = 5;
+  ExpectCreation(kNumRows);
+
+  // Rows 0 and 3 are process 10's errors, and row 1 its warning.
+  LogIndex index;
+  index.AddRow(TRACE_LEVEL_ERROR, 10, 1, 1, "foo.cc");
+  index.AddRow(TRACE_LEVEL_WARNING, 10, 1, 1, "foo.cc");
+  index.AddRow(TRACE_LEVEL_ERROR, 20, 2, 2, "bar.cc");
+  index.AddRow(TRACE_LEVEL_ERROR, 10, 3, 2, "bar.cc");
+  index.AddRow(TRACE_LEVEL_INFORMATION, 30, 3, 1, "foo.cc");
+
+  std::vector<Filter> filters;
+  filters.push_back(Filter(Filter::PROCESS_ID, Filter::IS, Filter::INCLUDE,
+                           L"10"));
+  filters.push_back(Filter(Filter::FILE, Filter::CONTAINS, Filter::INCLUDE,
+                           L"^FOO"));
+  filters.push_back(Filter(Filter::SEVERITY, Filter::IS, Filter::EXCLUDE,
+                           L"warning"));
+  TestingFilteredLogView filtered(&mock_view_, filters);
+
+  // No row is matched individually.
+  EXPECT_CALL(mock_view_, GetNumRows())
+      .WillRepeatedly(Return(kNumRows));
+  EXPECT_CALL(mock_view_, GetIndex())
+      .WillRepeatedly(Return(&index));
+
+  RunMessageLoopToIdle();
+  ASSERT_EQ(3, filtered.GetNumRows());
+  EXPECT_EQ(0, filtered.included_rows()[0]);
+  EXPECT_EQ(3, filtered.included_rows()[1]);
+  EXPECT_EQ(4, filtered.included_rows()[2]);
+
+  ExpectUnregistration();
+}
+
+TEST_F(FilteredLogViewTest, FiltersWithoutIndex) {
+  const int kNumRows = 3;
+  ExpectCreation(kNumRows);
+
+  std::vector<Filter> filters;
+  filters.push_back(Filter(Filter::THREAD_ID, Filter::IS, Filter::EXCLUDE,
+                           L"2"));
+  TestingFilteredLogView filtered(&mock_view_, filters);
+
+  EXPECT_CALL(mock_view_, GetNumRows())
+      .WillRepeatedly(Return(kNumRows));
+  EXPECT_CALL(mock_view_, GetIndex())
+      .WillRepeatedly(Return(static_cast<const LogIndex*>(NULL)));
+  EXPECT_CALL(mock_view_, GetThreadId(0))
+      .WillRepeatedly(Return(1));
+  EXPECT_CALL(mock_view_, GetThreadId(1))
+      .WillRepeatedly(Return(2));
+  EXPECT_CALL(mock_view_, GetThreadId(2))
+      .WillRepeatedly(Return(3));
+
+  RunMessageLoopToIdle();
+  ASSERT_EQ(2, filtered.GetNumRows());
+  EXPECT_EQ(0, filtered.included_rows()[0]);
+  EXPECT_EQ(2, filtered.included_rows()[1]);
+
+  ExpectUnregistration();
+}
+
+TEST_F(FilteredLogViewTest, FiltersMessageCandidates) {
+  const int kNumRows = 5;
+  ExpectCreation(kNumRows);
+
+  std::vector<Filter> filters;
+  filters.push_back(Filter(Filter::MESSAGE, Filter::CONTAINS, Filter::INCLUDE,
+                           L"Hello"));
+  TestingFilteredLogView filtered(&mock_view_, filters);
+
+  // Rows 1 and 3 of the first 4 may contain the text, and row 4 isn't
+  // narrowed. Only those rows are matched.
+  RowBitmap candidates;
+  candidates.Add(1);
+  candidates.Add(3);
+  EXPECT_CALL(mock_view_, GetNumRows())
+      .WillRepeatedly(Return(kNumRows));
+  EXPECT_CALL(mock_view_, GetMessageCandidates("Hello", true, _, _))
+      .WillRepeatedly(DoAll(SetArgumentPointee<2>(candidates),
+                            SetArgumentPointee<3>(4),
+                            Return(true)));
+  EXPECT_CALL(mock_view_, GetMessageView(1))
+      .WillRepeatedly(Return("Hello there"));
+  EXPECT_CALL(mock_view_, GetMessageView(3))
+      .WillRepeatedly(Return("Hell or high water"));
+  EXPECT_CALL(mock_view_, GetMessageView(4))
+      .WillRepeatedly(Return("Well, hello"));
+
+  RunMessageLoopToIdle();
+  ASSERT_EQ(2, filtered.GetNumRows());
+  EXPECT_EQ(1, filtered.included_rows()[0]);
+  EXPECT_EQ(4, filtered.included_rows()[1]);
+
+  // Our candidates are the original's, in our rows.
+  RowBitmap rows;
+  int num_rows = 0;
+  ASSERT_TRUE(filtered.GetMessageCandidates("Hello", true, &rows, &num_rows));
+  EXPECT_EQ(1, num_rows);
+  EXPECT_EQ(1U, rows.size());
+  EXPECT_TRUE(rows.Contains(0));
+
+  ExpectUnregistration();
+}
+
 class MockFilteredLogView : public TestingFilteredLogView {
  public:
-  explicit MockFilteredLogView(ILogView* original,
+  explicit MockFilteredLogView(ILogViewV2* original,
                                const std::vector<Filter>& filters)
       : TestingFilteredLogView(original, filters) {
   }
@@ -0,0 +1,82 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Log index implementation.
+#include "sawbuck/viewer/log_index.h"
+
+#include "base/logging.h"
+
+namespace {
+
+// Removes the first @p count rows of each value of @p values, and drops
+// the values left with no rows.
+void RemoveFrontRows(uint32 count, LogIndex::ValueMap* values) {
+  LogIndex::ValueMap::iterator it(values->begin());
+  while (it != values->end()) {
+    it->second.RemoveFront(count);
+    if (it->second.empty())
+      values->erase(it++);
+    else
+      ++it;
+  }
+}
+
+}  // namespace
+
+LogIndex::LogIndex() : num_rows_(0) {
+}
+
+LogIndex::~LogIndex() {
+}
+
+void LogIndex::AddRow(UCHAR level,
+                      DWORD process_id,
+                      DWORD thread_id,
+                      uint32 file_id,
+                      const base::StringPiece& file_name) {
+  uint32 row = static_cast<uint32>(num_rows_);
+  levels_[level].Add(row);
+  process_ids_[process_id].Add(row);
+  thread_ids_[thread_id].Add(row);
+
+  if (file_id >= files_.size())
+    files_.resize(file_id + 1);
+  FileRows& file = files_[file_id];
+  DCHECK(file.rows.empty() || file.file_name == file_name);
+  file.file_name = file_name;
+  file.rows.Add(row);
+
+  ++num_rows_;
+}
+
+void LogIndex::Clear() {
+  num_rows_ = 0;
+  levels_.clear();
+  process_ids_.clear();
+  thread_ids_.clear();
+  files_.clear();
+}
+
+void LogIndex::RemoveFront(size_t count) {
+  DCHECK_LE(count, num_rows_);
+
+  uint32 rows = static_cast<uint32>(count);
+  RemoveFrontRows(rows, &levels_);
+  RemoveFrontRows(rows, &process_ids_);
+  RemoveFrontRows(rows, &thread_ids_);
+  for (size_t i = 0; i < files_.size(); ++i)
+    files_[i].rows.RemoveFront(rows);
+
+  num_rows_ -= count;
+}
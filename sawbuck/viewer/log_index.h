@@ -0,0 +1,86 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Secondary indexes over the rows of a log.
+#ifndef SAWBUCK_VIEWER_LOG_INDEX_H_
+#define SAWBUCK_VIEWER_LOG_INDEX_H_
+
+#include <windows.h>
+#include <map>
+#include <vector>
+#include "base/basictypes.h"
+#include "base/strings/string_piece.h"
+#include "sawbuck/common/row_bitmap.h"
+
+// Keeps a RowBitmap of the rows with each distinct severity, process id,
+// thread id and file name of a log, so that filters on those columns are
+// answered by matching each distinct value once, rather than each row.
+// Rows are added in order as the log grows.
+class LogIndex {
+ public:
+  typedef std::map<DWORD, RowBitmap> ValueMap;
+
+  // The rows logged from one file.
+  struct FileRows {
+    base::StringPiece file_name;
+    RowBitmap rows;
+  };
+  typedef std::vector<FileRows> FileVector;
+
+  LogIndex();
+  ~LogIndex();
+
+  // Indexes the next row.
+  // @param file_id the log's id for @p file_name. Ids should be small, as
+  //     the index keeps a vector of them.
+  // @param file_name the row's file name, which must stay valid until the
+  //     index is cleared.
+  void AddRow(UCHAR level,
+              DWORD process_id,
+              DWORD thread_id,
+              uint32 file_id,
+              const base::StringPiece& file_name);
+
+  // Discards all rows.
+  void Clear();
+
+  // Discards the first @p count rows, and renumbers the rest down by
+  // @p count, which must be a multiple of RowBitmap::kChunkSize. Values
+  // left with no rows are dropped, except for file ids.
+  void RemoveFront(size_t count);
+
+  // @returns the number of rows indexed.
+  size_t num_rows() const { return num_rows_; }
+
+  // @returns the rows by severity, process id and thread id.
+  // @{
+  const ValueMap& levels() const { return levels_; }
+  const ValueMap& process_ids() const { return process_ids_; }
+  const ValueMap& thread_ids() const { return thread_ids_; }
+  // @}
+
+  // @returns the rows by file id. Ids no row has have no rows.
+  const FileVector& files() const { return files_; }
+
+ private:
+  size_t num_rows_;
+  ValueMap levels_;
+  ValueMap process_ids_;
+  ValueMap thread_ids_;
+  FileVector files_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogIndex);
+};
+
+#endif  // SAWBUCK_VIEWER_LOG_INDEX_H_
@@ -0,0 +1,101 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/viewer/log_index.h"
+
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+
+std::vector<int> Rows(const RowBitmap& bitmap) {
+  std::vector<int> rows;
+  bitmap.AppendRows(0, kuint32max, &rows);
+  return rows;
+}
+
+TEST(LogIndexTest, IndexesEachColumn) {
+  LogIndex index;
+  index.AddRow(TRACE_LEVEL_ERROR, 10, 100, 1, "foo.cc");
+  index.AddRow(TRACE_LEVEL_INFORMATION, 20, 200, 2, "bar.cc");
+  index.AddRow(TRACE_LEVEL_ERROR, 10, 101, 1, "foo.cc");
+  ASSERT_EQ(3U, index.num_rows());
+
+  ASSERT_EQ(2U, index.levels().size());
+  std::vector<int> rows = Rows(index.levels().find(TRACE_LEVEL_ERROR)->second);
+  ASSERT_EQ(2U, rows.size());
+  EXPECT_EQ(0, rows[0]);
+  EXPECT_EQ(2, rows[1]);
+
+  ASSERT_EQ(2U, index.process_ids().size());
+  EXPECT_EQ(2U, index.process_ids().find(10)->second.size());
+  EXPECT_EQ(1U, index.process_ids().find(20)->second.size());
+
+  ASSERT_EQ(3U, index.thread_ids().size());
+  EXPECT_TRUE(index.thread_ids().find(200)->second.Contains(1));
+
+  // File id 0 has no rows.
+  ASSERT_EQ(3U, index.files().size());
+  EXPECT_TRUE(index.files()[0].rows.empty());
+  EXPECT_EQ("foo.cc", index.files()[1].file_name.as_string());
+  EXPECT_EQ(2U, index.files()[1].rows.size());
+  EXPECT_EQ("bar.cc", index.files()[2].file_name.as_string());
+  EXPECT_TRUE(index.files()[2].rows.Contains(1));
+}
+
+TEST(LogIndexTest, Clear) {
+  LogIndex index;
+  index.AddRow(TRACE_LEVEL_ERROR, 10, 100, 1, "foo.cc");
+  index.Clear();
+  EXPECT_EQ(0U, index.num_rows());
+  EXPECT_TRUE(index.levels().empty());
+  EXPECT_TRUE(index.process_ids().empty());
+  EXPECT_TRUE(index.thread_ids().empty());
+  EXPECT_TRUE(index.files().empty());
+
+  // Rows are numbered from zero again.
+  index.AddRow(TRACE_LEVEL_WARNING, 30, 300, 0, "");
+  EXPECT_TRUE(index.process_ids().find(30)->second.Contains(0));
+}
+
+TEST(LogIndexTest, RemoveFront) {
+  LogIndex index;
+  for (size_t i = 0; i < RowBitmap::kChunkSize; ++i)
+    index.AddRow(TRACE_LEVEL_ERROR, 10, 100, 1, "foo.cc");
+  index.AddRow(TRACE_LEVEL_INFORMATION, 10, 200, 1, "foo.cc");
+  index.AddRow(TRACE_LEVEL_INFORMATION, 20, 200, 2, "bar.cc");
+
+  index.RemoveFront(RowBitmap::kChunkSize);
+  EXPECT_EQ(2U, index.num_rows());
+
+  // Values left with no rows are dropped, and the rest renumbered.
+  ASSERT_EQ(1U, index.levels().size());
+  std::vector<int> rows =
+      Rows(index.levels().find(TRACE_LEVEL_INFORMATION)->second);
+  ASSERT_EQ(2U, rows.size());
+  EXPECT_EQ(0, rows[0]);
+  EXPECT_EQ(1, rows[1]);
+  EXPECT_EQ(2U, index.process_ids().size());
+  ASSERT_EQ(1U, index.thread_ids().size());
+  EXPECT_TRUE(index.thread_ids().find(200)->second.Contains(1));
+
+  ASSERT_EQ(3U, index.files().size());
+  EXPECT_TRUE(index.files()[1].rows.Contains(0));
+  EXPECT_TRUE(index.files()[2].rows.Contains(1));
+
+  // Rows are added after the rest.
+  index.AddRow(TRACE_LEVEL_ERROR, 30, 300, 0, "");
+  EXPECT_TRUE(index.process_ids().find(30)->second.Contains(2));
+}
+
+}  // namespace
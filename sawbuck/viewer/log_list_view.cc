@@ -19,12 +19,14 @@
 #include <atlframe.h>
 #include <wmistr.h>
 #include <evntrace.h>
+#include <algorithm>
 #include "base/logging.h"
 #include "base/i18n/time_formatting.h"
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
 #include "pcrecpp.h"  // NOLINT
+#include "sawbuck/common/row_bitmap.h"
 #include "sawbuck/log_lib/process_info_service.h"
 #include "sawbuck/viewer/const_config.h"
 #include "sawbuck/viewer/resource.h"
@@ -32,33 +34,6 @@
 
 namespace {
 
-const char* GetSeverityText(UCHAR severity) {
-  switch (severity)  {
-    case TRACE_LEVEL_NONE:
-      return "NONE";
-    case TRACE_LEVEL_FATAL:
-      return "FATAL";
-    case TRACE_LEVEL_ERROR:
-      return "ERROR";
-    case TRACE_LEVEL_WARNING:
-      return "WARNING";
-    case TRACE_LEVEL_INFORMATION:
-      return "INFORMATION";
-    case TRACE_LEVEL_VERBOSE:
-      return "VERBOSE";
-    case TRACE_LEVEL_RESERVED6:
-      return "RESERVED6";
-    case TRACE_LEVEL_RESERVED7:
-      return "RESERVED7";
-    case TRACE_LEVEL_RESERVED8:
-      return "RESERVED8";
-    case TRACE_LEVEL_RESERVED9:
-      return "RESERVED9";
-  }
-
-  return "UNKNOWN";
-}
-
 // Returns true iff state indicates a selected listview item.
 bool IsSelected(UINT state) {
   return (state & LVIS_SELECTED) == LVIS_SELECTED;
@@ -66,6 +41,67 @@ bool IsSelected(UINT state) {
 
 const int kNoItem = -1;
 
+// The number of rows FindNext fetches at a time.
+const int kFindBatchRows = 1024;
+
+bool MessageMatches(const pcrecpp::RE& expression,
+                    const base::StringPiece& message) {
+  return expression.PartialMatch(
+      pcrecpp::StringPiece(message.data(), message.size()));
+}
+
+// Searches the messages of rows [begin, end) of log_view for expression, a
+// batch of rows at a time, in the direction of the search, releasing the
+// views of each batch before the next. Returns the first row found, or
+// kNoItem.
+int FindInRange(ILogViewV2* log_view,
+                const pcrecpp::RE& expression,
+                int begin,
+                int end,
+                bool down) {
+  LogColumnBatch batch;
+  while (begin < end) {
+    int count = std::min(kFindBatchRows, end - begin);
+    int first = down ? begin : end - count;
+    log_view->GetColumns(first, count,
+                         LogColumnBatch::Bit(LogViewFormatter::MESSAGE),
+                         &batch);
+
+    for (int j = 0; j < count; ++j) {
+      int index = down ? j : count - 1 - j;
+      if (MessageMatches(expression, batch.messages[index]))
+        return first + index;
+    }
+
+    batch.Clear();
+    log_view->ReleaseViews();
+    if (down)
+      begin += count;
+    else
+      end -= count;
+  }
+
+  return kNoItem;
+}
+
+// Searches the messages of rows of log_view for expression, in the
+// direction of the search, releasing views every batch of rows. Returns
+// the first row found, or kNoItem.
+int FindInRows(ILogViewV2* log_view,
+               const pcrecpp::RE& expression,
+               const std::vector<int>& rows,
+               bool down) {
+  for (size_t j = 0; j < rows.size(); ++j) {
+    int row = down ? rows[j] : rows[rows.size() - 1 - j];
+    if (MessageMatches(expression, log_view->GetMessageView(row)))
+      return row;
+    if ((j + 1) % kFindBatchRows == 0)
+      log_view->ReleaseViews();
+  }
+
+  return kNoItem;
+}
+
 }  // namespace
 
 using base::StringPrintf;
@@ -88,10 +124,20 @@ const wchar_t* LogListView::kColumnWidthValueName =
     config::kLogViewColumnWidths;
 
 
+void LogColumnBatch::Clear() {
+  severities.clear();
+  process_ids.clear();
+  thread_ids.clear();
+  times.clear();
+  file_names.clear();
+  lines.clear();
+  messages.clear();
+}
+
 LogViewFormatter::LogViewFormatter() {
 }
 
-bool LogViewFormatter::FormatColumn(ILogView* log_view,
+bool LogViewFormatter::FormatColumn(ILogViewV2* log_view,
                                     int row,
                                     Column col,
                                     std::string* str) {
@@ -149,7 +195,7 @@ bool LogViewFormatter::FormatColumn(ILogView* log_view,
       break;
 
     case FILE:
-      *str = log_view->GetFileName(row);
+      log_view->GetFileNameView(row).CopyToString(str);
       break;
 
     case LINE:
@@ -157,7 +203,7 @@ bool LogViewFormatter::FormatColumn(ILogView* log_view,
       break;
 
     case MESSAGE:
-      *str = log_view->GetMessage(row);
+      log_view->GetMessageView(row).CopyToString(str);
       break;
 
     default:
@@ -168,6 +214,34 @@ bool LogViewFormatter::FormatColumn(ILogView* log_view,
   return true;
 }
 
+// static
+const char* LogViewFormatter::GetSeverityText(UCHAR severity) {
+  switch (severity)  {
+    case TRACE_LEVEL_NONE:
+      return "NONE";
+    case TRACE_LEVEL_FATAL:
+      return "FATAL";
+    case TRACE_LEVEL_ERROR:
+      return "ERROR";
+    case TRACE_LEVEL_WARNING:
+      return "WARNING";
+    case TRACE_LEVEL_INFORMATION:
+      return "INFORMATION";
+    case TRACE_LEVEL_VERBOSE:
+      return "VERBOSE";
+    case TRACE_LEVEL_RESERVED6:
+      return "RESERVED6";
+    case TRACE_LEVEL_RESERVED7:
+      return "RESERVED7";
+    case TRACE_LEVEL_RESERVED8:
+      return "RESERVED8";
+    case TRACE_LEVEL_RESERVED9:
+      return "RESERVED9";
+  }
+
+  return "UNKNOWN";
+}
+
 LogListView::LogListView(CUpdateUIBase* update_ui)
     : log_view_(NULL), event_cookie_(0),
       update_ui_(update_ui), stack_trace_view_(NULL),
@@ -181,7 +255,7 @@ LogListView::LogListView(CUpdateUIBase* update_ui)
                  wrong_number_of_column_info);
 }
 
-void LogListView::SetLogView(ILogView* log_view) {
+void LogListView::SetLogView(ILogViewV2* log_view) {
   if (log_view_ == log_view)
     return;
 
@@ -287,15 +361,16 @@ LRESULT LogListView::OnItemChanged(NMHDR* pnmh) {
     if (IsSelected(info->uNewState) && !IsSelected(info->uOldState)) {
       // Set the stack trace for a single row selection only.
       if (row != kNoItem) {
-        std::vector<void*> trace;
-        log_view_->GetStackTrace(row, &trace);
+        void* const* trace = NULL;
+        size_t depth = 0;
+        log_view_->GetStackTraceView(row, &trace, &depth);
 
         DCHECK(stack_trace_view_ != NULL);
         stack_trace_view_->SetStackTrace(
             log_view_->GetProcessId(row),
             log_view_->GetTime(row),
-            trace.size(),
-            trace.size() ? &trace[0] : NULL);
+            depth,
+            trace);
       }
     } else if (!IsSelected(info->uNewState) && IsSelected(info->uOldState)) {
       // Clear the trace.
@@ -527,12 +602,40 @@ void LogListView::FindNext() {
   if (i < 0)
     i = 0;  // in case start == -1.
 
-  for (; down ? i < num_rows : i >= 0; down ? ++i : --i) {
-    std::string message(log_view_->GetMessage(i));
-    if (expression.PartialMatch(message))
-      break;
+  // The log's message index, if any, narrows the search of the rows it
+  // covers to its candidates. The other rows are searched in full.
+  RowBitmap candidates;
+  int covered = 0;
+  if (!log_view_->GetMessageCandidates(find_params_.expression_,
+                                       !find_params_.match_case_,
+                                       &candidates,
+                                       &covered)) {
+    covered = 0;
+  }
+  covered = std::min(covered, num_rows);
+
+  int found = kNoItem;
+  std::vector<int> rows;
+  if (down) {
+    if (i < covered) {
+      candidates.AppendRows(i, covered, &rows);
+      found = FindInRows(log_view_, expression, rows, true);
+    }
+    if (found == kNoItem) {
+      found = FindInRange(log_view_, expression, std::max(i, covered),
+                          num_rows, true);
+    }
+  } else {
+    int end = std::min(i + 1, num_rows);
+    if (end > covered)
+      found = FindInRange(log_view_, expression, covered, end, false);
+    if (found == kNoItem && covered > 0) {
+      candidates.AppendRows(0, std::min(end, covered), &rows);
+      found = FindInRows(log_view_, expression, rows, false);
+    }
   }
 
+  i = found;
   if (i >= 0 && i < num_rows) {
     // Clear the existing selection.
     if (start >= 0)
@@ -591,6 +694,36 @@ void LogListView::LogViewCleared() {
   DeleteAllItems();
 }
 
+void LogListView::LogViewRowsRemoved(int num_rows) {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+
+  if (IsWindow()) {
+    BOOL is_last_item_visible = ListView_IsItemVisible(m_hWnd,
+                                                       GetItemCount() - 1);
+    int top = GetTopIndex();
+    int focused = GetNextItem(kNoItem, LVIS_FOCUSED);
+
+    // The list keeps its selection by row number, so reduce it to the
+    // focused row, and move that with the rows.
+    SetItemState(kNoItem, 0, LVIS_SELECTED | LVIS_FOCUSED);
+    int count = log_view_->GetNumRows();
+    SetItemCountEx(count, LVSICF_NOSCROLL);
+    if (focused >= num_rows) {
+      SetItemState(focused - num_rows, LVIS_SELECTED | LVIS_FOCUSED,
+                   LVIS_SELECTED | LVIS_FOCUSED);
+    }
+
+    // Keep following the latest items, or else keep the same rows in view.
+    if (is_last_item_visible) {
+      EnsureVisible(count - 1, TRUE /* PartialOK */);
+    } else if (count > 0) {
+      CRect item;
+      GetItemRect(0, &item, LVIR_BOUNDS);
+      Scroll(CSize(0, -std::min(num_rows, top) * item.Height()));
+    }
+  }
+}
+
 void LogListView::UpdateCommandStatus(bool has_focus) {
   bool has_selection = GetSelectedCount() != 0;
 
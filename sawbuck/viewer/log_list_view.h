@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 #include "base/message_loop/message_loop.h"
+#include "base/strings/string_piece.h"
 #include "sawbuck/viewer/find_dialog.h"
 #include "sawbuck/viewer/list_view_base.h"
 #include "sawbuck/viewer/resource.h"
@@ -34,11 +35,19 @@ class ILogViewEvents {
   // Called on the UI thread.
   virtual void LogViewNewItems() = 0;
   virtual void LogViewCleared() = 0;
+
+  // Called when the first @p num_rows rows have been removed, and the
+  // rest renumbered down by as many.
+  virtual void LogViewRowsRemoved(int num_rows) = 0;
 };
 
 // Provides a view on a log, the view may be filtered or sorted.
 class ILogView {
  public:
+  // Views may be owned, and deleted, through this interface.
+  virtual ~ILogView() {
+  }
+
   // Returns the number of rows in this view.
   virtual int GetNumRows() = 0;
 
@@ -61,6 +70,10 @@ class ILogView {
   virtual void Unregister(int registration_cookie) = 0;
 };
 
+class ILogViewV2;
+class LogIndex;
+class RowBitmap;
+
 class LogViewFormatter {
  public:
   enum Column {
@@ -78,11 +91,14 @@ class LogViewFormatter {
 
   LogViewFormatter();
 
-  bool FormatColumn(ILogView* log_view,
+  bool FormatColumn(ILogViewV2* log_view,
                     int row,
                     Column col,
                     std::string* str);
 
+  // @returns the text the SEVERITY column shows for @p severity.
+  static const char* GetSeverityText(UCHAR severity);
+
   base::Time base_time() const { return base_time_; }
   void set_base_time(base::Time base_time) { base_time_ = base_time; }
 
@@ -91,6 +107,78 @@ class LogViewFormatter {
   base::Time base_time_;
 };
 
+// The values of a range of rows of an ILogViewV2, one vector per column.
+// Only the requested columns are filled in, the rest are left empty.
+struct LogColumnBatch {
+  // @returns the GetColumns mask bit for @p col.
+  static uint32 Bit(LogViewFormatter::Column col) { return 1U << col; }
+
+  // Empties all columns.
+  void Clear();
+
+  std::vector<int> severities;
+  std::vector<DWORD> process_ids;
+  std::vector<DWORD> thread_ids;
+  std::vector<base::Time> times;
+  std::vector<base::StringPiece> file_names;
+  std::vector<int> lines;
+  std::vector<base::StringPiece> messages;
+};
+
+// Version 2 of the log view, which hands out non-owning views on the log
+// rather than copies.
+//
+// The views refer to the storage of the underlying log, and stay valid
+// until that log is cleared, or the caller calls ReleaseViews. As the log
+// may be cleared by any task on the UI thread, callers must not hold on
+// to views past the current task.
+class ILogViewV2 : public ILogView {
+ public:
+  virtual base::StringPiece GetFileNameView(int row) = 0;
+  virtual base::StringPiece GetMessageView(int row) = 0;
+
+  // Retrieves the stack trace of @p row.
+  // @param trace on success returns the trace frames.
+  // @param depth on success returns the number of frames in @p trace.
+  virtual void GetStackTraceView(int row,
+                                 void* const** trace,
+                                 size_t* depth) = 0;
+
+  // Retrieves a range of rows in bulk.
+  // @param first_row the first row to retrieve.
+  // @param num_rows the number of rows to retrieve.
+  // @param columns the LogColumnBatch::Bit values of the columns to retrieve.
+  // @param batch on return holds @p num_rows values for each requested
+  //     column.
+  virtual void GetColumns(int first_row,
+                          int num_rows,
+                          uint32 columns,
+                          LogColumnBatch* batch) = 0;
+
+  // @returns the secondary indexes over this view's rows, or NULL if it
+  //     has none. The index covers at least GetNumRows() rows, and is
+  //     valid until the next task on the UI thread.
+  virtual const LogIndex* GetIndex() = 0;
+
+  // Narrows a search of the messages for a regular expression.
+  // @param pattern a PCRE regular expression.
+  // @param caseless true iff @p pattern is matched case insensitively.
+  // @param rows on success returns the rows whose messages may match,
+  //     among the first @p num_rows.
+  // @param num_rows on success returns the number of rows narrowed. Rows
+  //     from there on must be searched in full.
+  // @returns true on success, or false if every row must be searched.
+  virtual bool GetMessageCandidates(const std::string& pattern,
+                                    bool caseless,
+                                    RowBitmap* rows,
+                                    int* num_rows) = 0;
+
+  // Tells the log no views are held, so it may free storage that backs
+  // views, such as cached message text. Long scans call this between
+  // batches, to keep the storage they touch bounded.
+  virtual void ReleaseViews() = 0;
+};
+
 // Forward decls.
 class StackTraceListView;
 class IProcessInfoService;
@@ -140,10 +228,11 @@ class LogListView
     process_info_service_ = process_info_service;
   }
 
-  void SetLogView(ILogView* log_view);
+  void SetLogView(ILogViewV2* log_view);
 
   virtual void LogViewNewItems();
   virtual void LogViewCleared();
+  virtual void LogViewRowsRemoved(int num_rows);
 
   // Our column definitions and config data to satisfy our contract
   // to the ListViewImpl superclass.
@@ -209,7 +298,7 @@ class LogListView
   // Our process info service, if any.
   IProcessInfoService* process_info_service_;
 
-  ILogView* log_view_;
+  ILogViewV2* log_view_;
   int event_cookie_;
 
   // Image indexes for severity, stored by severity value.
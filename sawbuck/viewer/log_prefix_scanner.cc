@@ -0,0 +1,248 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Log prefix scanner implementation.
+#include "sawbuck/viewer/log_prefix_scanner.h"
+
+#include <emmintrin.h>
+#include <intrin.h>
+#include <limits>
+#include "base/basictypes.h"
+#include "base/logging.h"
+
+namespace {
+
+const ptrdiff_t kBlockSize = sizeof(__m128i);
+
+__m128i LoadBlock(const char* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// @returns a bit mask of the bytes of @p block that equal those of
+//     @p needles.
+int MatchMask(__m128i block, __m128i needles) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(block, needles));
+}
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// PCRE's \w, which is ASCII-only in the absence of Unicode properties.
+bool IsWordChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || IsDigit(c) ||
+      c == '_';
+}
+
+// @returns the length of the UTF-8 character starting with @p lead.
+ptrdiff_t Utf8CharLength(char lead) {
+  uint8 c = static_cast<uint8>(lead);
+  if (c < 0x80)
+    return 1;
+  if (c < 0xE0)
+    return 2;
+  if (c < 0xF0)
+    return 3;
+  return 4;
+}
+
+// @returns true iff [@p begin, @p end) is valid UTF-8 by the rules PCRE
+//     applies to its subjects, which follow RFC 3629.
+bool IsValidUtf8(const char* begin, const char* end) {
+  const char* p = begin;
+  while (p != end) {
+    // Skip ASCII a block at a time.
+    if (end - p >= kBlockSize && _mm_movemask_epi8(LoadBlock(p)) == 0) {
+      p += kBlockSize;
+      continue;
+    }
+
+    uint8 c = static_cast<uint8>(*p++);
+    if (c < 0x80)
+      continue;
+    if (c < 0xC2 || c > 0xF4)
+      return false;
+
+    ptrdiff_t trail = Utf8CharLength(c) - 1;
+    if (end - p < trail)
+      return false;
+    for (ptrdiff_t i = 0; i < trail; ++i) {
+      if ((static_cast<uint8>(p[i]) & 0xC0) != 0x80)
+        return false;
+    }
+
+    // Reject overlong sequences, surrogates and values past 0x10FFFF.
+    uint8 next = static_cast<uint8>(p[0]);
+    if ((c == 0xE0 && next < 0xA0) || (c == 0xED && next >= 0xA0) ||
+        (c == 0xF0 && next < 0x90) || (c == 0xF4 && next > 0x8F)) {
+      return false;
+    }
+
+    p += trail;
+  }
+
+  return true;
+}
+
+// @returns the first occurrence of @p c in [@p begin, @p end), or @p end.
+const char* FindChar(const char* begin, const char* end, char c) {
+  const __m128i needles = _mm_set1_epi8(c);
+  const char* p = begin;
+  for (; end - p >= kBlockSize; p += kBlockSize) {
+    int mask = MatchMask(LoadBlock(p), needles);
+    if (mask != 0) {
+      unsigned long index = 0;
+      _BitScanForward(&index, mask);
+      return p + index;
+    }
+  }
+
+  for (; p != end; ++p) {
+    if (*p == c)
+      return p;
+  }
+
+  return end;
+}
+
+// Finds the first ']' in [@p begin, @p end), and the last ':' before it.
+// @param bracket returns the bracket, or @p end if there is none.
+// @param colon returns the colon, or NULL if there is none.
+void FindPrefixEnd(const char* begin,
+                   const char* end,
+                   const char** bracket,
+                   const char** colon) {
+  const __m128i brackets = _mm_set1_epi8(']');
+  const __m128i colons = _mm_set1_epi8(':');
+
+  *colon = NULL;
+  const char* p = begin;
+  for (; end - p >= kBlockSize; p += kBlockSize) {
+    __m128i block = LoadBlock(p);
+    int bracket_mask = MatchMask(block, brackets);
+    int colon_mask = MatchMask(block, colons);
+
+    unsigned long index = 0;
+    if (bracket_mask != 0) {
+      // Only the colons ahead of the bracket count.
+      _BitScanForward(&index, bracket_mask);
+      *bracket = p + index;
+      colon_mask &= (1 << index) - 1;
+    }
+    if (colon_mask != 0) {
+      unsigned long colon_index = 0;
+      _BitScanReverse(&colon_index, colon_mask);
+      *colon = p + colon_index;
+    }
+    if (bracket_mask != 0)
+      return;
+  }
+
+  for (; p != end && *p != ']'; ++p) {
+    if (*p == ':')
+      *colon = p;
+  }
+  *bracket = p;
+}
+
+// Parses the decimal number [@p begin, @p end) to @p value.
+// @returns false if the number overflows an int.
+bool ParseLine(const char* begin, const char* end, int* value) {
+  DCHECK(begin != end);
+
+  const int kMax = std::numeric_limits<int>::max();
+  int result = 0;
+  for (const char* p = begin; p != end; ++p) {
+    int digit = *p - '0';
+    if (result > (kMax - digit) / 10)
+      return false;
+    result = result * 10 + digit;
+  }
+
+  *value = result;
+  return true;
+}
+
+}  // namespace
+
+bool ScanLogPrefix(const base::StringPiece& text,
+                   base::StringPiece* file,
+                   int* line,
+                   base::StringPiece* message) {
+  DCHECK(file != NULL);
+  DCHECK(line != NULL);
+  DCHECK(message != NULL);
+
+  const char* begin = text.data();
+  const char* end = begin + text.size();
+  if (begin == end || *begin != '[')
+    return false;
+  if (!IsValidUtf8(begin, end))
+    return false;
+
+  // The file name follows the last colon ahead of the first bracket.
+  const char* bracket = NULL;
+  const char* colon = NULL;
+  FindPrefixEnd(begin + 1, end, &bracket, &colon);
+  if (bracket == end || colon == NULL)
+    return false;
+
+  // The file name can't contain a colon, but may run past the first
+  // bracket, so the line number is in the last "(<digits>)]" ahead of
+  // the next colon.
+  const char* file_begin = colon + 1;
+  const char* file_limit = FindChar(file_begin, end, ':');
+
+  // The message ends at the last word character.
+  const char* message_end = end;
+  while (message_end != begin && !IsWordChar(message_end[-1]))
+    --message_end;
+
+  const char* line_begin = NULL;
+  const char* line_end = NULL;
+  const char* message_begin = NULL;
+  for (const char* close = bracket; close < file_limit;
+       close = FindChar(close + 1, file_limit, ']')) {
+    // A single character separates the bracket from the message, which
+    // must have a word character. Both only get harder to satisfy
+    // further on.
+    if (end - close < 2)
+      break;
+    const char* candidate_message = close + 1 + Utf8CharLength(close[1]);
+    if (candidate_message >= message_end)
+      break;
+
+    if (close[-1] != ')')
+      continue;
+    const char* digits = close - 1;
+    while (digits > file_begin && IsDigit(digits[-1]))
+      --digits;
+    if (digits == close - 1 || digits - 1 <= file_begin || digits[-1] != '(')
+      continue;
+
+    line_begin = digits;
+    line_end = close - 1;
+    message_begin = candidate_message;
+  }
+
+  if (line_begin == NULL)
+    return false;
+
+  file->set(file_begin, line_begin - 1 - file_begin);
+  if (!ParseLine(line_begin, line_end, line))
+    return false;
+  message->set(message_begin, message_end - message_begin);
+
+  return true;
+}
@@ -0,0 +1,39 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A scanner for the prefix of Chrome-style log messages.
+#ifndef SAWBUCK_VIEWER_LOG_PREFIX_SCANNER_H_
+#define SAWBUCK_VIEWER_LOG_PREFIX_SCANNER_H_
+
+#include "base/strings/string_piece.h"
+
+// Splits a log message of format "[<stuff>:<file>(<line>)].<message><junk>"
+// into its file, line and message, where the message runs up to its last
+// word character. This is equivalent to a full match of the regular
+// expression
+//     \[[^\]]*\:([^:]+)\((\d+)\)\].(.*\w).*
+// in PCRE's UTF-8 and dot-all modes, but runs a good deal faster.
+// @param text the log message, which must be valid UTF-8 to match.
+// @param file on success returns the file name.
+// @param line on success returns the line number.
+// @param message on success returns the message.
+// @returns true on success. Like the regular expression match, this fails
+//     when the line number doesn't fit an int, yet returns the file name.
+// @note the returned file name and message refer to @p text.
+bool ScanLogPrefix(const base::StringPiece& text,
+                   base::StringPiece* file,
+                   int* line,
+                   base::StringPiece* message);
+
+#endif  // SAWBUCK_VIEWER_LOG_PREFIX_SCANNER_H_
@@ -0,0 +1,89 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Measures the log prefix scanner against the regular expression it
+// replaces.
+#include "sawbuck/viewer/log_prefix_scanner.h"
+
+#include <string>
+#include <vector>
+#include "base/basictypes.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/perf_time_logger.h"
+#include "gtest/gtest.h"
+#include "sawbuck/common/test_random.h"
+#include "pcrecpp.h"  // NOLINT
+
+namespace {
+
+using testing::Random;
+
+const size_t kNumMessages = 100000;
+const size_t kNumPasses = 10;
+
+// The regular expression the scanner replaces.
+const pcrecpp::RE kFileRe("\\[[^\\]]*\\:([^:]+)\\((\\d+)\\)\\].(.*\\w).*",
+                          PCRE_NEWLINE_ANYCRLF | PCRE_DOTALL | PCRE_UTF8);
+
+class LogPrefixScannerPerfTest : public testing::Test {
+ public:
+  virtual void SetUp() {
+    Random random(42);
+    for (size_t i = 0; i < kNumMessages; ++i) {
+      messages_.push_back(base::StringPrintf(
+          "[%d:%d:%d:VERBOSE1:file_%d.cc(%d)] Message number %d",
+          random.Next(10000), random.Next(10000), random.Next(100000),
+          random.Next(10), random.Next(5000), static_cast<int>(i)));
+    }
+  }
+
+ protected:
+  std::vector<std::string> messages_;
+};
+
+TEST_F(LogPrefixScannerPerfTest, Scanner) {
+  size_t num_matched = 0;
+  base::PerfTimeLogger timer("log_prefix_scanner");
+  for (size_t pass = 0; pass < kNumPasses; ++pass) {
+    for (size_t i = 0; i < messages_.size(); ++i) {
+      base::StringPiece file;
+      base::StringPiece message;
+      int line = 0;
+      if (ScanLogPrefix(messages_[i], &file, &line, &message))
+        ++num_matched;
+    }
+  }
+  timer.Done();
+
+  EXPECT_EQ(kNumPasses * kNumMessages, num_matched);
+}
+
+TEST_F(LogPrefixScannerPerfTest, RegularExpression) {
+  size_t num_matched = 0;
+  base::PerfTimeLogger timer("log_prefix_regular_expression");
+  for (size_t pass = 0; pass < kNumPasses; ++pass) {
+    for (size_t i = 0; i < messages_.size(); ++i) {
+      pcrecpp::StringPiece file;
+      pcrecpp::StringPiece message;
+      int line = 0;
+      if (kFileRe.FullMatch(messages_[i], &file, &line, &message))
+        ++num_matched;
+    }
+  }
+  timer.Done();
+
+  EXPECT_EQ(kNumPasses * kNumMessages, num_matched);
+}
+
+}  // namespace
@@ -0,0 +1,161 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/viewer/log_prefix_scanner.h"
+
+#include <string>
+#include "base/basictypes.h"
+#include "base/strings/stringprintf.h"
+#include "gtest/gtest.h"
+#include "sawbuck/common/test_random.h"
+#include "pcrecpp.h"  // NOLINT
+
+namespace {
+
+using testing::Random;
+
+// The regular expression the scanner replaces.
+const pcrecpp::RE kFileRe("\\[[^\\]]*\\:([^:]+)\\((\\d+)\\)\\].(.*\\w).*",
+                          PCRE_NEWLINE_ANYCRLF | PCRE_DOTALL | PCRE_UTF8);
+
+struct ScanResult {
+  ScanResult() : matched(false), line(-1) {
+  }
+
+  bool operator==(const ScanResult& other) const {
+    return matched == other.matched && file == other.file &&
+        line == other.line && message == other.message;
+  }
+
+  bool matched;
+  std::string file;
+  int line;
+  std::string message;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const ScanResult& result) {
+  return os << "{" << result.matched << ", \"" << result.file << "\", "
+            << result.line << ", \"" << result.message << "\"}";
+}
+
+ScanResult Scan(const std::string& text) {
+  base::StringPiece file;
+  base::StringPiece message;
+  ScanResult result;
+  result.matched = ScanLogPrefix(text, &file, &result.line, &message);
+  file.CopyToString(&result.file);
+  message.CopyToString(&result.message);
+  return result;
+}
+
+ScanResult Match(const std::string& text) {
+  pcrecpp::StringPiece file;
+  pcrecpp::StringPiece message;
+  ScanResult result;
+  result.matched = kFileRe.FullMatch(text, &file, &result.line, &message);
+  result.file = file.as_string();
+  result.message = message.as_string();
+  return result;
+}
+
+// Generates messages that stress the corners of the prefix grammar.
+std::string RandomMessage(Random* random) {
+  static const char* kPieces[] = {
+    "[", "]", ":", "(", ")", "12", "0", "4294967296", "foo.cc", "a", "_",
+    " ", "\n", "\r\n", "\t", ".", "-", "\xC3\xA9", "\xE2\x82\xAC",
+    "\xF0\x9F\x98\x80", "\xC3", "\xED\xA0\x80", "\xC0\x80", "\xFF",
+  };
+
+  std::string text;
+  // Most messages start with a well-formed prefix that later pieces may
+  // wreck, the rest are left to chance.
+  if (random->Next(4) != 0) {
+    text = base::StringPrintf("[%d:%d:%d:VERBOSE1:file_%d.cc(%d)] Text",
+                              random->Next(10000), random->Next(10000),
+                              random->Next(100000), random->Next(10),
+                              random->Next(5000));
+  }
+
+  size_t num_pieces = random->Next(12);
+  for (size_t i = 0; i < num_pieces; ++i) {
+    size_t offset = random->Next(text.length() + 1);
+    text.insert(offset, kPieces[random->Next(arraysize(kPieces))]);
+  }
+
+  return text;
+}
+
+TEST(LogPrefixScannerTest, ParsesPrefix) {
+  base::StringPiece file;
+  base::StringPiece message;
+  int line = 0;
+  std::string text("[1234:5678:0215/120000:INFO:foo_bar.cc(42)] Hello world");
+  ASSERT_TRUE(ScanLogPrefix(text, &file, &line, &message));
+  EXPECT_EQ("foo_bar.cc", file.as_string());
+  EXPECT_EQ(42, line);
+  EXPECT_EQ("Hello world", message.as_string());
+
+  // The pieces refer to the text.
+  EXPECT_EQ(text.data() + text.find("foo_bar.cc"), file.data());
+  EXPECT_EQ(text.data() + text.find("Hello"), message.data());
+}
+
+TEST(LogPrefixScannerTest, MatchesRegularExpression) {
+  const char* kCases[] = {
+    "",
+    "No prefix",
+    "[foo.cc(1)] No colon",
+    "[:foo.cc(1)] Empty stuff",
+    "[a:foo.cc(1)]",
+    "[a:foo.cc(1)] ",
+    "[a:foo.cc(1)]x",
+    "[a:foo.cc(1)] !!!",
+    "[a:(1)] Empty file",
+    "[a:foo.cc()] No line",
+    "[a:foo.cc(x1)] Bad line",
+    "[a:b:c:foo.cc(12)] Message with trailing space  \r\n",
+    "[a:foo.cc(1)] Message with ] and (2)] in it",
+    "[a:foo](1)] Bracket in file",
+    "[a:foo.cc(1)]:x(2)] Colon after prefix",
+    "[a:foo.cc(1)] x(2)]y Later line",
+    "[a:foo.cc(1)]\xC3\xA9x Multibyte separator",
+    "[a:foo.cc(1)] Invalid \xFF UTF-8",
+    "[a:foo.cc(4294967296)] Overflowing line",
+    "[a:foo.cc(2147483647)] Largest line",
+    "[a:foo.cc(2147483648)] Just past the largest line",
+    "[a:foo.cc(0000000000000000000000000000000000000007)] Long line",
+    "[0123456789abcdef:0123456789abcdef:foo.cc(1)] Long prefix",
+  };
+
+  for (size_t i = 0; i < arraysize(kCases); ++i)
+    EXPECT_EQ(Match(kCases[i]), Scan(kCases[i])) << kCases[i];
+}
+
+TEST(LogPrefixScannerTest, MatchesRegularExpressionOnCorpus) {
+  const size_t kNumMessages = 200000;
+  Random random(42);
+  size_t num_matched = 0;
+  for (size_t i = 0; i < kNumMessages; ++i) {
+    std::string text = RandomMessage(&random);
+    ScanResult expected = Match(text);
+    ASSERT_EQ(expected, Scan(text)) << "Message " << i << ": " << text;
+    if (expected.matched)
+      ++num_matched;
+  }
+
+  // Make sure the corpus exercises both outcomes.
+  EXPECT_LT(kNumMessages / 10, num_matched);
+  EXPECT_GT(kNumMessages - kNumMessages / 10, num_matched);
+}
+
+}  // namespace
@@ -0,0 +1,359 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Log store implementation.
+#include "sawbuck/viewer/log_store.h"
+
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include "base/logging.h"
+#include "third_party/zlib/zlib.h"
+
+namespace {
+
+// Compresses @p size bytes of text in @p chunks of @p chunk_size bytes,
+// all full but the last, to @p compressed.
+// @returns true on success.
+bool CompressChunks(const std::vector<char*>& chunks,
+                    size_t chunk_size,
+                    size_t size,
+                    std::string* compressed) {
+  DCHECK(compressed != NULL);
+
+  z_stream stream = {};
+  if (deflateInit(&stream, Z_BEST_SPEED) != Z_OK)
+    return false;
+
+  // Deflating into a buffer of the bound finishes in a single pass.
+  std::string buffer(deflateBound(&stream, size), '\0');
+  stream.next_out = reinterpret_cast<Bytef*>(&buffer[0]);
+  stream.avail_out = buffer.size();
+
+  int result = Z_OK;
+  for (size_t i = 0; i < chunks.size() && result == Z_OK; ++i) {
+    bool last = i + 1 == chunks.size();
+    stream.next_in = reinterpret_cast<Bytef*>(chunks[i]);
+    stream.avail_in = last ? size - i * chunk_size : chunk_size;
+    result = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+  }
+  deflateEnd(&stream);
+  if (result != Z_STREAM_END)
+    return false;
+
+  // Copy rather than shrink, so as not to keep the bound's capacity.
+  compressed->assign(buffer.data(), stream.total_out);
+  return true;
+}
+
+// Decompresses @p compressed into @p size bytes of text, in new chunks of
+// @p chunk_size bytes, all full but the last, appended to @p chunks.
+// @returns true on success.
+bool DecompressChunks(const std::string& compressed,
+                      size_t chunk_size,
+                      size_t size,
+                      std::vector<char*>* chunks) {
+  DCHECK(chunks != NULL);
+
+  z_stream stream = {};
+  if (inflateInit(&stream) != Z_OK)
+    return false;
+
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  stream.avail_in = compressed.size();
+
+  int result = Z_OK;
+  for (size_t offset = 0; offset < size && result == Z_OK;
+       offset += chunk_size) {
+    size_t len = std::min(chunk_size, size - offset);
+    chunks->push_back(new char[len]);
+    stream.next_out = reinterpret_cast<Bytef*>(chunks->back());
+    stream.avail_out = len;
+    result = inflate(&stream, Z_SYNC_FLUSH);
+    if (result == Z_OK && stream.avail_out != 0)
+      result = Z_DATA_ERROR;
+  }
+  // The end of the stream may remain once all the text is out.
+  if (result == Z_OK)
+    result = inflate(&stream, Z_SYNC_FLUSH);
+  inflateEnd(&stream);
+
+  return result == Z_STREAM_END && stream.total_out == size;
+}
+
+}  // namespace
+
+LogStore::TextBlock::TextBlock() : size(0), chunk_bytes(0), last_use(0) {
+}
+
+LogStore::TextBlock::~TextBlock() {
+  FreeChunks();
+}
+
+void LogStore::TextBlock::FreeChunks() {
+  for (size_t i = 0; i < chunks.size(); ++i)
+    delete [] chunks[i];
+  chunks.clear();
+  chunk_bytes = 0;
+}
+
+LogStore::LogStore()
+    : size_(0), sealed_text_bytes_(0), compressed_text_bytes_(0),
+      chunk_bytes_(0), cache_bytes_(0), cache_budget_(kDefaultCacheBudget),
+      use_clock_(0), cache_hits_(0), cache_misses_(0) {
+}
+
+LogStore::~LogStore() {
+  Clear();
+}
+
+void LogStore::Append(const Entry& entry) {
+  size_t offset = size_ % kRowsPerBlock;
+  if (offset == 0) {
+    blocks_.push_back(new Row[kRowsPerBlock]);
+    text_blocks_.push_back(new TextBlock());
+  }
+
+  Row& row = blocks_.back()[offset];
+  row.level = entry.level;
+  row.process_id = entry.process_id;
+  row.thread_id = entry.thread_id;
+  row.time_stamp = entry.time_stamp;
+  row.line = entry.line;
+  row.file_id =
+      file_names_.Intern(base::StringPiece(entry.file, entry.file_len));
+
+  size_t message_len = entry.message_len;
+  if (message_len > kTextChunkSize) {
+    LOG(WARNING) << "Truncating a message of " << message_len << " bytes.";
+    message_len = kTextChunkSize;
+  }
+  row.message_offset = AppendText(entry.message, message_len);
+  row.message_len = static_cast<uint32>(message_len);
+
+  row.trace_id = traces_.Intern(entry.trace, entry.trace_depth);
+
+  index_.AddRow(row.level, row.process_id, row.thread_id, row.file_id,
+                file_names_.Get(row.file_id));
+
+  ++size_;
+  if (offset == kRowsPerBlock - 1)
+    SealBlock(blocks_.size() - 1);
+}
+
+void LogStore::Clear() {
+  for (size_t i = 0; i < blocks_.size(); ++i)
+    delete [] blocks_[i];
+  blocks_.clear();
+  size_ = 0;
+
+  for (size_t i = 0; i < text_blocks_.size(); ++i)
+    delete text_blocks_[i];
+  text_blocks_.clear();
+  sealed_text_bytes_ = 0;
+  compressed_text_bytes_ = 0;
+  chunk_bytes_ = 0;
+  cached_blocks_.clear();
+  cache_bytes_ = 0;
+  use_clock_ = 0;
+  cache_hits_ = 0;
+  cache_misses_ = 0;
+
+  index_.Clear();
+  file_names_.Clear();
+  traces_.Clear();
+}
+
+void LogStore::RemoveFront(size_t count) {
+  DCHECK_EQ(0U, count % RowBitmap::kChunkSize);
+  DCHECK_LE(count, size_);
+  COMPILE_ASSERT(RowBitmap::kChunkSize % kRowsPerBlock == 0,
+                 blocks_must_divide_index_chunks);
+
+  size_t num_blocks = count / kRowsPerBlock;
+  if (num_blocks == 0)
+    return;
+
+  // Renumber the cached blocks that stay.
+  std::vector<size_t> cached_blocks;
+  for (size_t i = 0; i < cached_blocks_.size(); ++i) {
+    size_t index = cached_blocks_[i];
+    if (index < num_blocks)
+      cache_bytes_ -= text_blocks_[index]->chunk_bytes;
+    else
+      cached_blocks.push_back(index - num_blocks);
+  }
+  cached_blocks_.swap(cached_blocks);
+
+  for (size_t i = 0; i < num_blocks; ++i) {
+    delete [] blocks_[i];
+
+    TextBlock* block = text_blocks_[i];
+    chunk_bytes_ -= block->chunk_bytes;
+    if (!block->compressed.empty()) {
+      sealed_text_bytes_ -= block->size;
+      compressed_text_bytes_ -= block->compressed.size();
+    }
+    delete block;
+  }
+  blocks_.erase(blocks_.begin(), blocks_.begin() + num_blocks);
+  text_blocks_.erase(text_blocks_.begin(), text_blocks_.begin() + num_blocks);
+  size_ -= count;
+
+  index_.RemoveFront(count);
+}
+
+base::StringPiece LogStore::message(size_t index) const {
+  const Row& row = this->row(index);
+  if (row.message_len == 0)
+    return base::StringPiece();
+
+  // Only full blocks are cached. The last block is read as it is.
+  size_t block_index = index / kRowsPerBlock;
+  TextBlock* block = text_blocks_[block_index];
+  if (block_index + 1 < text_blocks_.size() || size_ % kRowsPerBlock == 0) {
+    if (block->chunks.empty()) {
+      LoadText(block_index);
+      ++cache_misses_;
+    } else {
+      ++cache_hits_;
+    }
+    block->last_use = ++use_clock_;
+  }
+
+  const char* chunk = block->chunks[row.message_offset / kTextChunkSize];
+  return base::StringPiece(chunk + row.message_offset % kTextChunkSize,
+                           row.message_len);
+}
+
+size_t LogStore::data_bytes() const {
+  return static_cast<size_t>(compressed_text_bytes_) + chunk_bytes_ +
+      file_names_.data_bytes() + traces_.data_bytes();
+}
+
+size_t LogStore::stored_bytes() const {
+  // The chunks outside the cache are the open block's text, and that of
+  // any full block that couldn't be compressed.
+  DCHECK_LE(cache_bytes_, chunk_bytes_);
+  return data_bytes() - cache_bytes_ + row_bytes();
+}
+
+void LogStore::TrimCache() const {
+  if (cache_bytes_ <= cache_budget_)
+    return;
+
+  // Evict the least recently read blocks first.
+  std::vector<std::pair<uint64, size_t> > blocks;
+  for (size_t i = 0; i < cached_blocks_.size(); ++i) {
+    size_t index = cached_blocks_[i];
+    blocks.push_back(std::make_pair(text_blocks_[index]->last_use, index));
+  }
+  std::sort(blocks.begin(), blocks.end());
+
+  cached_blocks_.clear();
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    TextBlock* block = text_blocks_[blocks[i].second];
+    if (cache_bytes_ > cache_budget_) {
+      cache_bytes_ -= block->chunk_bytes;
+      chunk_bytes_ -= block->chunk_bytes;
+      block->FreeChunks();
+    } else {
+      cached_blocks_.push_back(blocks[i].second);
+    }
+  }
+}
+
+void LogStore::GetRow(size_t index, SawlogRow* row) const {
+  DCHECK(row != NULL);
+
+  // The previous row's strings are no longer needed, so saving a long log
+  // keeps to the cache budget.
+  TrimCache();
+
+  const Row& stored = this->row(index);
+  row->level = stored.level;
+  row->process_id = stored.process_id;
+  row->thread_id = stored.thread_id;
+  row->time = stored.time_stamp;
+  row->line = stored.line;
+  row->file = file_name(stored);
+  row->message = message(index);
+  row->trace = trace(stored);
+  row->trace_depth = trace_depth(stored);
+}
+
+uint32 LogStore::AppendText(const char* text, size_t len) {
+  DCHECK_LE(len, kTextChunkSize);
+  TextBlock* block = text_blocks_.back();
+
+  // Start a new chunk if the text doesn't fit the remainder of this one.
+  // The remainder is zeroed, as it's compressed along with the text.
+  size_t capacity = block->chunks.size() * kTextChunkSize;
+  if (block->size + len > capacity) {
+    CHECK_LE(capacity + kTextChunkSize, std::numeric_limits<uint32>::max())
+        << "Log text of a block exceeds 4 GB.";
+    if (!block->chunks.empty()) {
+      size_t used = block->size - (capacity - kTextChunkSize);
+      memset(block->chunks.back() + used, 0, kTextChunkSize - used);
+    }
+    block->size = static_cast<uint32>(capacity);
+    block->chunks.push_back(new char[kTextChunkSize]);
+    block->chunk_bytes += kTextChunkSize;
+    chunk_bytes_ += kTextChunkSize;
+  }
+
+  uint32 offset = block->size;
+  if (len != 0)
+    memcpy(block->chunks.back() + offset % kTextChunkSize, text, len);
+  block->size += static_cast<uint32>(len);
+
+  return offset;
+}
+
+void LogStore::SealBlock(size_t index) {
+  TextBlock* block = text_blocks_[index];
+  if (block->size == 0)
+    return;
+
+  if (!CompressChunks(block->chunks, kTextChunkSize, block->size,
+                      &block->compressed)) {
+    LOG(ERROR) << "Failed to compress log text, keeping it as is.";
+    block->compressed.clear();
+    return;
+  }
+  sealed_text_bytes_ += block->size;
+  compressed_text_bytes_ += block->compressed.size();
+
+  // The newest rows are the likeliest to be read, so the text stays
+  // cached until it's trimmed.
+  cached_blocks_.push_back(index);
+  cache_bytes_ += block->chunk_bytes;
+  block->last_use = ++use_clock_;
+}
+
+void LogStore::LoadText(size_t index) const {
+  TextBlock* block = text_blocks_[index];
+  DCHECK(block->chunks.empty());
+  DCHECK(!block->compressed.empty());
+
+  CHECK(DecompressChunks(block->compressed, kTextChunkSize, block->size,
+                         &block->chunks)) << "Failed to decompress log text.";
+  block->chunk_bytes = block->size;
+  chunk_bytes_ += block->chunk_bytes;
+
+  cached_blocks_.push_back(index);
+  cache_bytes_ += block->chunk_bytes;
+}
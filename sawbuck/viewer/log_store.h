@@ -0,0 +1,260 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// An append-only store of log messages.
+#ifndef SAWBUCK_VIEWER_LOG_STORE_H_
+#define SAWBUCK_VIEWER_LOG_STORE_H_
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include "base/logging.h"
+#include "base/strings/string_piece.h"
+#include "base/time/time.h"
+#include "sawbuck/common/string_table.h"
+#include "sawbuck/common/trace_table.h"
+#include "sawbuck/log_lib/sawlog_file.h"
+#include "sawbuck/viewer/log_index.h"
+
+// Stores log messages in fixed-size blocks of rows. File names and stack
+// traces are interned, and the message text of each block is packed into
+// a chunked text buffer. Appending never moves existing rows or their
+// data, and costs no per-message heap allocations. The store keeps a
+// LogIndex of its rows, and can be saved as a .sawlog file.
+//
+// Message text dominates the memory of long logs, so once a block is
+// full its text is compressed, and only the compressed text is kept.
+// Reading a message decompresses its block's text into a cache of the
+// most recently read blocks. The cache grows as needed until TrimCache,
+// which evicts the least recently read blocks down to a budget, so
+// message views stay valid until then.
+class LogStore : public SawlogRowSource {
+ public:
+  // A log message to append. The pointers refer to the caller's data.
+  struct Entry {
+    Entry() : level(0), process_id(0), thread_id(0), line(0), file_len(0),
+        file(NULL), message_len(0), message(NULL), trace_depth(0),
+        trace(NULL) {
+    }
+
+    UCHAR level;
+    DWORD process_id;
+    DWORD thread_id;
+    base::Time time_stamp;
+    int line;
+
+    size_t file_len;
+    const char* file;
+
+    size_t message_len;
+    const char* message;
+
+    size_t trace_depth;
+    void* const* trace;
+  };
+
+  // A stored log message.
+  struct Row {
+    UCHAR level;
+    DWORD process_id;
+    DWORD thread_id;
+    base::Time time_stamp;
+    int line;
+
+    // The id of the file name in our file name table.
+    StringTable::StringId file_id;
+
+    // The location of the message text in the text of the row's block.
+    uint32 message_offset;
+    uint32 message_len;
+
+    // The id of the stack trace in our trace table. Rows with the same
+    // stack trace share an id.
+    TraceTable::TraceId trace_id;
+  };
+
+  // The number of rows per block.
+  static const size_t kRowsPerBlock = 4096;
+
+  // The size of the chunks of our text buffers. Messages come from ETW
+  // events, which are at most 64 KB, so any message fits a chunk.
+  static const size_t kTextChunkSize = 1024 * 1024;
+
+  // The default budget of the cache of decompressed text.
+  static const size_t kDefaultCacheBudget = 32 * 1024 * 1024;
+
+  LogStore();
+  ~LogStore();
+
+  // @returns the number of rows in the store.
+  size_t size() const { return size_; }
+
+  // @returns row @p index, which is valid until the store is cleared.
+  const Row& row(size_t index) const {
+    DCHECK_LT(index, size_);
+    return blocks_[index / kRowsPerBlock][index % kRowsPerBlock];
+  }
+
+  // @returns the file name of @p row.
+  base::StringPiece file_name(const Row& row) const {
+    return file_names_.Get(row.file_id);
+  }
+
+  // @returns the message of row @p index, decompressing the text of its
+  //     block as needed. The message is valid until the next TrimCache.
+  base::StringPiece message(size_t index) const;
+
+  // @returns the stack trace frames of @p row.
+  void* const* trace(const Row& row) const {
+    return traces_.frames(row.trace_id);
+  }
+
+  // @returns the stack trace depth of @p row.
+  size_t trace_depth(const Row& row) const {
+    return traces_.depth(row.trace_id);
+  }
+
+  // Appends a copy of @p entry, including its strings and trace.
+  void Append(const Entry& entry);
+
+  // Discards all rows.
+  void Clear();
+
+  // Discards the first @p count rows, and renumbers the rest down by
+  // @p count, which must be a multiple of RowBitmap::kChunkSize, so that
+  // whole blocks and index chunks go. Rows and messages of the rest stay
+  // where they are, but their views must be fetched again by row number.
+  void RemoveFront(size_t count);
+
+  // @returns the number of distinct file names.
+  size_t num_file_names() const { return file_names_.size(); }
+
+  // @returns the number of distinct stack traces.
+  size_t num_traces() const { return traces_.size(); }
+
+  // @returns the number of bytes used for strings and traces.
+  size_t data_bytes() const;
+
+  // @returns the number of bytes used for rows.
+  size_t row_bytes() const {
+    return blocks_.size() * kRowsPerBlock * sizeof(Row);
+  }
+
+  // @returns the number of bytes the log is stored in: the rows, the
+  //     strings and traces, and the text, compressed where the block is
+  //     full. This leaves out the cache of decompressed text, so reading
+  //     doesn't change it.
+  size_t stored_bytes() const;
+
+  // Evicts the least recently read decompressed text until the cache is
+  // within budget. This invalidates the messages of the evicted blocks,
+  // so call it only while no message is held.
+  void TrimCache() const;
+
+  // Sets the budget of the cache of decompressed text to @p bytes.
+  void set_cache_budget(size_t bytes) { cache_budget_ = bytes; }
+
+  // @returns the size of the message text of the full blocks.
+  uint64 sealed_text_bytes() const { return sealed_text_bytes_; }
+
+  // @returns the size of the compressed message text of the full blocks.
+  uint64 compressed_text_bytes() const { return compressed_text_bytes_; }
+
+  // @returns the number of bytes of decompressed text cached.
+  size_t cache_bytes() const { return cache_bytes_; }
+
+  // @returns the number of messages of full blocks read from the cache,
+  //     and the number that had to be decompressed, since the last Clear.
+  uint64 cache_hits() const { return cache_hits_; }
+  uint64 cache_misses() const { return cache_misses_; }
+
+  // @returns the index of our rows.
+  const LogIndex& index() const { return index_; }
+
+  // SawlogRowSource implementation.
+  virtual size_t num_rows() const { return size_; }
+  virtual void GetRow(size_t index, SawlogRow* row) const;
+
+ private:
+  // The message text of a block of rows, in chunks of kTextChunkSize.
+  // Text is addressed by offset, and never straddles chunks.
+  struct TextBlock {
+    TextBlock();
+    ~TextBlock();
+
+    // Frees the chunks.
+    void FreeChunks();
+
+    // The size of the text, including the zeroed slack at the end of all
+    // chunks but the last.
+    uint32 size;
+
+    // The text, while the block is open or its text is cached.
+    std::vector<char*> chunks;
+    size_t chunk_bytes;
+
+    // The text compressed with zlib, once the block is full. This is
+    // empty for a full block whose text couldn't be compressed, and which
+    // is then kept as is.
+    std::string compressed;
+
+    // The value of use_clock_ when the text was last read.
+    uint64 last_use;
+  };
+
+  // Copies @p len bytes of text at @p text to the text of the last block.
+  // @returns the offset of the copy.
+  uint32 AppendText(const char* text, size_t len);
+
+  // Compresses the text of the full block @p index, which stays cached.
+  void SealBlock(size_t index);
+
+  // Decompresses the text of block @p index into the cache.
+  void LoadText(size_t index) const;
+
+  // Our blocks of rows. Only this table of pointers grows.
+  std::vector<Row*> blocks_;
+  size_t size_;
+
+  // The interned file names of our rows.
+  StringTable file_names_;
+
+  // The message text of each block of rows.
+  std::vector<TextBlock*> text_blocks_;
+  uint64 sealed_text_bytes_;
+  uint64 compressed_text_bytes_;
+
+  // The number of bytes in text chunks, cached or not.
+  mutable size_t chunk_bytes_;
+
+  // The full blocks whose text is cached, and the bytes of their chunks.
+  mutable std::vector<size_t> cached_blocks_;
+  mutable size_t cache_bytes_;
+  size_t cache_budget_;
+
+  // Ticks on each read of a full block's text, to order the cache.
+  mutable uint64 use_clock_;
+  mutable uint64 cache_hits_;
+  mutable uint64 cache_misses_;
+
+  // The interned stack traces of our rows.
+  TraceTable traces_;
+
+  // The index of our rows, whose file names refer to file_names_.
+  LogIndex index_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogStore);
+};
+
+#endif  // SAWBUCK_VIEWER_LOG_STORE_H_
@@ -0,0 +1,293 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/viewer/log_store.h"
+
+#include <string>
+#include "base/strings/stringprintf.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+std::string RowMessage(const LogStore& store, size_t index) {
+  return store.message(index).as_string();
+}
+
+std::string MessageText(size_t i) {
+  return base::StringPrintf("Message %d", static_cast<int>(i));
+}
+
+std::string PaddedMessageText(size_t i) {
+  std::string text = MessageText(i);
+  text.resize(1000, ' ');
+  return text;
+}
+
+TEST(LogStoreTest, AppendCopiesData) {
+  LogStore store;
+  EXPECT_EQ(0U, store.size());
+
+  std::string file("foo.cc");
+  std::string message("Hello, world");
+  void* trace[] = { &file, &message };
+
+  LogStore::Entry row;
+  row.level = 3;
+  row.process_id = 12;
+  row.thread_id = 34;
+  row.time_stamp = base::Time::Now();
+  row.line = 56;
+  row.file_len = file.length();
+  row.file = file.c_str();
+  row.message_len = message.length();
+  row.message = message.c_str();
+  row.trace_depth = arraysize(trace);
+  row.trace = trace;
+  store.Append(row);
+
+  // Clobber the originals.
+  file.assign(file.length(), 'X');
+  message.assign(message.length(), 'X');
+  trace[0] = NULL;
+
+  ASSERT_EQ(1U, store.size());
+  const LogStore::Row& stored = store.row(0);
+  EXPECT_EQ(3, stored.level);
+  EXPECT_EQ(12, stored.process_id);
+  EXPECT_EQ(34, stored.thread_id);
+  EXPECT_EQ(row.time_stamp, stored.time_stamp);
+  EXPECT_EQ(56, stored.line);
+  EXPECT_EQ("foo.cc", store.file_name(stored).as_string());
+  EXPECT_EQ("Hello, world", RowMessage(store, 0));
+  ASSERT_EQ(2U, store.trace_depth(stored));
+  EXPECT_EQ(&file, store.trace(stored)[0]);
+  EXPECT_EQ(&message, store.trace(stored)[1]);
+}
+
+TEST(LogStoreTest, EmptyFields) {
+  LogStore store;
+  store.Append(LogStore::Entry());
+
+  ASSERT_EQ(1U, store.size());
+  EXPECT_TRUE(store.file_name(store.row(0)).empty());
+  EXPECT_TRUE(store.message(0).empty());
+  EXPECT_EQ(0U, store.trace_depth(store.row(0)));
+}
+
+TEST(LogStoreTest, InternsFileNames) {
+  LogStore store;
+
+  const char* kFiles[] = { "foo.cc", "bar.cc", "foo.cc", "", "bar.cc" };
+  for (size_t i = 0; i < arraysize(kFiles); ++i) {
+    std::string file(kFiles[i]);
+    LogStore::Entry entry;
+    entry.file_len = file.length();
+    entry.file = file.c_str();
+    store.Append(entry);
+  }
+
+  // The empty string, foo.cc and bar.cc.
+  EXPECT_EQ(3U, store.num_file_names());
+  EXPECT_EQ(store.row(0).file_id, store.row(2).file_id);
+  EXPECT_EQ(store.row(1).file_id, store.row(4).file_id);
+  EXPECT_NE(store.row(0).file_id, store.row(1).file_id);
+  for (size_t i = 0; i < arraysize(kFiles); ++i)
+    EXPECT_EQ(kFiles[i], store.file_name(store.row(i)).as_string());
+}
+
+TEST(LogStoreTest, InternsTraces) {
+  LogStore store;
+
+  int frames[3];
+  void* foo[] = { &frames[0], &frames[1] };
+  void* bar[] = { &frames[0], &frames[2] };
+  void* const* kTraces[] = { foo, bar, foo, NULL, bar };
+  for (size_t i = 0; i < arraysize(kTraces); ++i) {
+    LogStore::Entry entry;
+    entry.trace_depth = kTraces[i] != NULL ? 2 : 0;
+    entry.trace = kTraces[i];
+    store.Append(entry);
+  }
+
+  // The empty trace, foo and bar.
+  EXPECT_EQ(3U, store.num_traces());
+  EXPECT_EQ(store.row(0).trace_id, store.row(2).trace_id);
+  EXPECT_EQ(store.row(1).trace_id, store.row(4).trace_id);
+  EXPECT_NE(store.row(0).trace_id, store.row(1).trace_id);
+  EXPECT_EQ(TraceTable::kEmptyTraceId, store.row(3).trace_id);
+  EXPECT_EQ(&frames[2], store.trace(store.row(4))[1]);
+}
+
+TEST(LogStoreTest, MessagesSpanTextChunks) {
+  LogStore store;
+
+  // Messages that don't divide the chunk size evenly, so that some
+  // have to move on to the next chunk.
+  std::string message(LogStore::kTextChunkSize / 3 + 1, 'a');
+  for (size_t i = 0; i < 10; ++i) {
+    message[0] = static_cast<char>('a' + i);
+    LogStore::Entry entry;
+    entry.message_len = message.length();
+    entry.message = message.c_str();
+    store.Append(entry);
+  }
+
+  for (size_t i = 0; i < 10; ++i) {
+    message[0] = static_cast<char>('a' + i);
+    ASSERT_EQ(message, RowMessage(store, i));
+  }
+}
+
+TEST(LogStoreTest, RowsAreStableAcrossBlocks) {
+  LogStore store;
+
+  const size_t kNumRows = 3 * LogStore::kRowsPerBlock + 10;
+  std::vector<const LogStore::Row*> rows;
+  for (size_t i = 0; i < kNumRows; ++i) {
+    std::string message = MessageText(i);
+    LogStore::Entry row;
+    row.message_len = message.length();
+    row.message = message.c_str();
+    store.Append(row);
+    rows.push_back(&store.row(i));
+  }
+
+  ASSERT_EQ(kNumRows, store.size());
+  for (size_t i = 0; i < kNumRows; ++i) {
+    ASSERT_EQ(rows[i], &store.row(i));
+    ASSERT_EQ(MessageText(i), RowMessage(store, i));
+  }
+
+  store.Clear();
+  EXPECT_EQ(0U, store.size());
+  EXPECT_EQ(0U, store.data_bytes());
+}
+
+TEST(LogStoreTest, CompressesFullBlocks) {
+  LogStore store;
+
+  const size_t kNumRows = 2 * LogStore::kRowsPerBlock + 10;
+  for (size_t i = 0; i < kNumRows; ++i) {
+    std::string message = MessageText(i);
+    LogStore::Entry row;
+    row.message_len = message.length();
+    row.message = message.c_str();
+    store.Append(row);
+  }
+  EXPECT_LT(0U, store.compressed_text_bytes());
+  EXPECT_LT(store.compressed_text_bytes(), store.sealed_text_bytes());
+
+  // Evict all of the decompressed text.
+  EXPECT_LT(0U, store.cache_bytes());
+  store.set_cache_budget(0);
+  store.TrimCache();
+  EXPECT_EQ(0U, store.cache_bytes());
+
+  // Reading decompresses each full block once, the last block is read as
+  // it is.
+  for (size_t i = 0; i < kNumRows; ++i)
+    ASSERT_EQ(MessageText(i), RowMessage(store, i));
+  EXPECT_EQ(2U, store.cache_misses());
+  EXPECT_EQ(2 * LogStore::kRowsPerBlock - 2, store.cache_hits());
+  EXPECT_LT(0U, store.cache_bytes());
+
+  store.TrimCache();
+  EXPECT_EQ(0U, store.cache_bytes());
+  EXPECT_EQ(MessageText(0), RowMessage(store, 0));
+  EXPECT_EQ(3U, store.cache_misses());
+}
+
+TEST(LogStoreTest, ReadingLeavesStoredBytesAlone) {
+  LogStore store;
+
+  const size_t kNumRows = 2 * LogStore::kRowsPerBlock + 10;
+  for (size_t i = 0; i < kNumRows; ++i) {
+    std::string message = MessageText(i);
+    LogStore::Entry row;
+    row.message_len = message.length();
+    row.message = message.c_str();
+    store.Append(row);
+  }
+  store.set_cache_budget(0);
+  store.TrimCache();
+  size_t stored_bytes = store.stored_bytes();
+  EXPECT_LT(store.compressed_text_bytes() + store.row_bytes(), stored_bytes);
+
+  // Reading old rows fills the cache, which retention mustn't count, lest
+  // scrolling back evict rows.
+  size_t data_bytes = store.data_bytes();
+  for (size_t i = 0; i < kNumRows; ++i)
+    ASSERT_EQ(MessageText(i), RowMessage(store, i));
+  EXPECT_LT(0U, store.cache_bytes());
+  EXPECT_LT(data_bytes, store.data_bytes());
+  EXPECT_EQ(stored_bytes, store.stored_bytes());
+
+  store.TrimCache();
+  EXPECT_EQ(stored_bytes, store.stored_bytes());
+}
+
+TEST(LogStoreTest, RemoveFront) {
+  LogStore store;
+
+  const size_t kNumKeptRows = LogStore::kRowsPerBlock;
+  const size_t kNumRows = RowBitmap::kChunkSize + kNumKeptRows;
+  for (size_t i = 0; i < kNumRows; ++i) {
+    std::string message = MessageText(i);
+    LogStore::Entry row;
+    row.message_len = message.length();
+    row.message = message.c_str();
+    store.Append(row);
+  }
+  size_t data_bytes = store.data_bytes();
+  size_t row_bytes = store.row_bytes();
+
+  store.RemoveFront(RowBitmap::kChunkSize);
+  ASSERT_EQ(kNumKeptRows, store.size());
+  EXPECT_EQ(kNumKeptRows, store.index().num_rows());
+  EXPECT_GT(data_bytes, store.data_bytes());
+  EXPECT_GT(row_bytes, store.row_bytes());
+
+  // The rest are renumbered, including in the cache.
+  store.set_cache_budget(0);
+  store.TrimCache();
+  EXPECT_EQ(0U, store.cache_bytes());
+  for (size_t i = 0; i < store.size(); ++i)
+    ASSERT_EQ(MessageText(RowBitmap::kChunkSize + i), RowMessage(store, i));
+
+  store.RemoveFront(0);
+  EXPECT_EQ(kNumKeptRows, store.size());
+}
+
+TEST(LogStoreTest, CompressesBlocksSpanningTextChunks) {
+  LogStore store;
+
+  // Messages that don't divide the chunk size evenly, so that the block's
+  // text spans chunks with slack at their ends.
+  for (size_t i = 0; i < LogStore::kRowsPerBlock; ++i) {
+    std::string message = PaddedMessageText(i);
+    LogStore::Entry row;
+    row.message_len = message.length();
+    row.message = message.c_str();
+    store.Append(row);
+  }
+
+  store.set_cache_budget(0);
+  store.TrimCache();
+  EXPECT_EQ(0U, store.cache_bytes());
+
+  for (size_t i = 0; i < LogStore::kRowsPerBlock; ++i)
+    ASSERT_EQ(PaddedMessageText(i), RowMessage(store, i));
+  EXPECT_EQ(1U, store.cache_misses());
+}
+
+}  // namespace
@@ -35,7 +35,7 @@ LogViewer::LogViewer(CUpdateUIBase* update_ui)
 LogViewer::~LogViewer() {
 }
 
-void LogViewer::SetLogView(ILogView* log_view) {
+void LogViewer::SetLogView(ILogViewV2* log_view) {
   DCHECK(log_view_ == NULL);
   log_view_ = log_view;
   log_list_view_.SetLogView(log_view);
@@ -55,7 +55,7 @@ class LogViewer : public CSplitterWindowImpl<LogViewer, false> {
   ~LogViewer();
 
   // This must be called before the log window viewer is created.
-  void SetLogView(ILogView* log_view);
+  void SetLogView(ILogViewV2* log_view);
 
   void SetSymbolLookupService(ISymbolLookupService* symbol_lookup_service) {
     stack_trace_list_view_.SetSymbolLookupService(symbol_lookup_service);
@@ -75,7 +75,7 @@ class LogViewer : public CSplitterWindowImpl<LogViewer, false> {
   scoped_ptr<FilteredLogView> filtered_log_view_;
 
   // The original log view we're handed.
-  ILogView* log_view_;
+  ILogViewV2* log_view_;
 
   // The list view that displays the log.
   LogListView log_list_view_;
@@ -0,0 +1,181 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Background message text index implementation.
+#include "sawbuck/viewer/message_index.h"
+
+#include <algorithm>
+#include "base/bind.h"
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "sawbuck/viewer/log_list_view.h"
+
+MessageIndex::MessageIndex(ILogViewV2* view,
+                           base::MessageLoop* background_thread)
+    : view_(view), background_thread_(background_thread),
+      ui_loop_(base::MessageLoop::current()), enabled_(false),
+      rows_queued_(0), batch_pending_(false), generation_(0) {
+  DCHECK(view_ != NULL);
+  DCHECK(background_thread_ != NULL);
+  DCHECK(ui_loop_ != NULL);
+}
+
+MessageIndex::~MessageIndex() {
+}
+
+void MessageIndex::SetEnabled(bool enabled) {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (enabled == enabled_)
+    return;
+
+  enabled_ = enabled;
+  if (enabled_)
+    Update();
+  else
+    Clear();
+}
+
+void MessageIndex::Update() {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (!enabled_ || batch_pending_)
+    return;
+
+  int num_rows = view_->GetNumRows();
+  if (rows_queued_ >= num_rows)
+    return;
+
+  // Copy the next batch's messages here, where the view may be read.
+  int count = std::min(kBatchRows, num_rows - rows_queued_);
+  LogColumnBatch batch;
+  view_->GetColumns(rows_queued_, count,
+                    LogColumnBatch::Bit(LogViewFormatter::MESSAGE), &batch);
+  MessageBatch* messages = new MessageBatch();
+  messages->ends.reserve(batch.messages.size());
+  for (size_t i = 0; i < batch.messages.size(); ++i) {
+    batch.messages[i].AppendToString(&messages->text);
+    messages->ends.push_back(messages->text.size());
+  }
+  view_->ReleaseViews();
+  rows_queued_ += count;
+
+  int generation = 0;
+  {
+    base::AutoLock lock(lock_);
+    generation = generation_;
+  }
+
+  batch_pending_ = true;
+  batch_indexed_.Reset(base::Bind(&MessageIndex::OnBatchIndexed,
+                                  base::Unretained(this)));
+  background_thread_->PostTask(
+      FROM_HERE,
+      base::Bind(&MessageIndex::IndexBatch, base::Unretained(this),
+                 generation, base::Owned(messages),
+                 batch_indexed_.callback()));
+}
+
+void MessageIndex::Clear() {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+
+  // Any batch in flight is dropped once it sees the new generation.
+  batch_indexed_.Cancel();
+  batch_pending_ = false;
+  rows_queued_ = 0;
+
+  base::AutoLock lock(lock_);
+  ++generation_;
+  index_.Clear();
+}
+
+void MessageIndex::RemoveFront(int count) {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  DCHECK_LE(0, count);
+  if (!enabled_ || count == 0)
+    return;
+
+  {
+    // A batch in flight holds the rows after those indexed, so it still
+    // lands after the renumbered rows.
+    base::AutoLock lock(lock_);
+    if (index_.num_rows() >= static_cast<size_t>(count)) {
+      index_.RemoveFront(count);
+      rows_queued_ -= count;
+      return;
+    }
+  }
+
+  // Some of the rows removed are still to be indexed, so start over.
+  Clear();
+  Update();
+}
+
+bool MessageIndex::GetCandidates(const std::string& pattern,
+                                 bool caseless,
+                                 RowBitmap* rows,
+                                 int* num_rows) {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  DCHECK(rows != NULL);
+  DCHECK(num_rows != NULL);
+  if (!enabled_)
+    return false;
+
+  std::vector<std::string> literals;
+  TrigramIndex::ExtractLiterals(pattern, caseless, &literals);
+  if (literals.empty())
+    return false;
+
+  base::AutoLock lock(lock_);
+  if (!index_.GetCandidates(literals, rows))
+    return false;
+
+  *num_rows = static_cast<int>(index_.num_rows());
+  return true;
+}
+
+int MessageIndex::num_rows() {
+  base::AutoLock lock(lock_);
+  return static_cast<int>(index_.num_rows());
+}
+
+void MessageIndex::IndexBatch(int generation,
+                              const MessageBatch* messages,
+                              const base::Closure& done) {
+  DCHECK_EQ(background_thread_, base::MessageLoop::current());
+  DCHECK(messages != NULL);
+
+  {
+    // Rows read before a clear mustn't land in the new index, which the
+    // lock holds off.
+    base::AutoLock lock(lock_);
+    if (generation != generation_)
+      return;
+
+    size_t begin = 0;
+    for (size_t i = 0; i < messages->ends.size(); ++i) {
+      size_t end = messages->ends[i];
+      index_.AddRow(base::StringPiece(messages->text.data() + begin,
+                                      end - begin));
+      begin = end;
+    }
+  }
+
+  ui_loop_->PostTask(FROM_HERE, done);
+}
+
+void MessageIndex::OnBatchIndexed() {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+
+  batch_pending_ = false;
+  Update();
+}
@@ -0,0 +1,120 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Background message text index declaration.
+#ifndef SAWBUCK_VIEWER_MESSAGE_INDEX_H_
+#define SAWBUCK_VIEWER_MESSAGE_INDEX_H_
+
+#include <string>
+#include <vector>
+#include "base/cancelable_callback.h"
+#include "base/synchronization/lock.h"
+#include "sawbuck/common/row_bitmap.h"
+#include "sawbuck/common/trigram_index.h"
+
+// Fwd.
+namespace base { class MessageLoop; }
+class ILogViewV2;
+
+// Builds a TrigramIndex of the messages of a log view on a background
+// thread, as the view grows, and narrows searches of the messages with
+// it. The index is optional, as it takes memory in proportion to the
+// text, so it's built only while enabled.
+//
+// Rows are indexed a batch at a time. The UI thread copies each batch's
+// messages, as views on the log don't outlast the task, and the background
+// thread indexes the copy.
+class MessageIndex {
+ public:
+  // The number of rows indexed per background task.
+  static const int kBatchRows = 4096;
+
+  // @param view the view whose messages we index.
+  // @param background_thread the thread to index on.
+  // Note: This object must outlive the background thread, and be used on
+  //     the UI thread it's created on.
+  MessageIndex(ILogViewV2* view, base::MessageLoop* background_thread);
+  ~MessageIndex();
+
+  // @returns true iff the index is enabled.
+  bool enabled() const { return enabled_; }
+
+  // Enables or disables the index. Disabling it discards the index.
+  void SetEnabled(bool enabled);
+
+  // Starts indexing the view's new rows, if any. Call when the view grows.
+  void Update();
+
+  // Discards the index. Call when the view is cleared.
+  void Clear();
+
+  // Drops the first @p count rows from the index, and renumbers the rest.
+  // Call when as many rows are removed from the front of the view.
+  // @p count must be a multiple of RowBitmap::kChunkSize.
+  void RemoveFront(int count);
+
+  // Narrows a search of the messages for a regular expression.
+  // @param pattern a PCRE regular expression.
+  // @param caseless true iff @p pattern is matched case insensitively.
+  // @param rows on success returns the rows whose messages may match,
+  //     among the first @p num_rows.
+  // @param num_rows on success returns the number of rows indexed. Rows
+  //     from there on may match, and must be searched in full.
+  // @returns true on success, or false if the search can't be narrowed.
+  bool GetCandidates(const std::string& pattern,
+                     bool caseless,
+                     RowBitmap* rows,
+                     int* num_rows);
+
+  // @returns the number of rows indexed.
+  int num_rows();
+
+ private:
+  // A copy of the messages of a batch of rows.
+  struct MessageBatch {
+    // The messages, back to back.
+    std::string text;
+    // The offset in text of the end of each message.
+    std::vector<size_t> ends;
+  };
+
+  // Indexes @p messages on the background thread, unless the index has
+  // been cleared since they were read, then signals @p done.
+  void IndexBatch(int generation,
+                  const MessageBatch* messages,
+                  const base::Closure& done);
+
+  // Called on the UI thread when a batch is indexed.
+  void OnBatchIndexed();
+
+  ILogViewV2* view_;
+  base::MessageLoop* background_thread_;
+  base::MessageLoop* ui_loop_;
+  bool enabled_;
+
+  // The number of rows read for indexing, and whether a batch is being
+  // indexed. A single batch is in flight at a time.
+  int rows_queued_;
+  bool batch_pending_;
+  base::CancelableClosure batch_indexed_;
+
+  base::Lock lock_;
+  // Bumped by Clear, so that batches read before it are dropped.
+  int generation_;  // Under lock_.
+  TrigramIndex index_;  // Under lock_.
+
+  DISALLOW_COPY_AND_ASSIGN(MessageIndex);
+};
+
+#endif  // SAWBUCK_VIEWER_MESSAGE_INDEX_H_
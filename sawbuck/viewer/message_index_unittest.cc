@@ -0,0 +1,167 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/viewer/message_index.h"
+
+#include <string>
+#include <vector>
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/thread.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "sawbuck/viewer/mock_log_view_interfaces.h"
+
+namespace {
+
+using testing::_;
+using testing::AnyNumber;
+using testing::Invoke;
+using testing::Return;
+
+class MessageIndexTest: public testing::Test {
+ public:
+  MessageIndexTest() : worker_("Message Index Worker") {
+  }
+
+  virtual void SetUp() {
+    ASSERT_TRUE(worker_.Start());
+
+    // Every row is numbered, and a couple have a needle.
+    const int kNumRows = MessageIndex::kBatchRows + 10;
+    for (int i = 0; i < kNumRows; ++i)
+      messages_.push_back(base::StringPrintf("Message %d", i));
+    messages_[7] = "Found the needle";
+    messages_[kNumRows - 1] = "Found another needle";
+
+    EXPECT_CALL(mock_view_, GetNumRows()).WillRepeatedly(Return(kNumRows));
+    EXPECT_CALL(mock_view_, GetColumns(_, _, _, _)).WillRepeatedly(
+        Invoke(this, &MessageIndexTest::GetColumns));
+    EXPECT_CALL(mock_view_, ReleaseViews()).Times(AnyNumber());
+  }
+
+  virtual void TearDown() {
+    worker_.Stop();
+  }
+
+  void GetColumns(int first_row,
+                  int num_rows,
+                  uint32 columns,
+                  LogColumnBatch* batch) {
+    EXPECT_EQ(LogColumnBatch::Bit(LogViewFormatter::MESSAGE), columns);
+    batch->Clear();
+    for (int i = first_row; i < first_row + num_rows; ++i)
+      batch->messages.push_back(messages_[i]);
+  }
+
+  // Waits for the batch being indexed, and lets the index start the next.
+  void IndexPendingBatch() {
+    base::RunLoop run_loop;
+    worker_.message_loop_proxy()->PostTaskAndReply(
+        FROM_HERE, base::Bind(&base::DoNothing), run_loop.QuitClosure());
+    run_loop.Run();
+  }
+
+  // @returns the candidates of @p index for @p pattern, or an empty
+  //     vector if the search can't be narrowed.
+  std::vector<int> Candidates(MessageIndex* index, const char* pattern) {
+    RowBitmap rows;
+    int num_rows = 0;
+    std::vector<int> candidates;
+    if (index->GetCandidates(pattern, true, &rows, &num_rows)) {
+      EXPECT_EQ(index->num_rows(), num_rows);
+      rows.AppendRows(0, kuint32max, &candidates);
+    }
+    return candidates;
+  }
+
+ protected:
+  base::MessageLoop message_loop_;
+  base::Thread worker_;
+  std::vector<std::string> messages_;
+  testing::StrictMock<testing::MockILogView> mock_view_;
+};
+
+TEST_F(MessageIndexTest, IndexesBatchesWhileEnabled) {
+  MessageIndex index(&mock_view_, worker_.message_loop());
+  EXPECT_FALSE(index.enabled());
+
+  // Nothing is indexed while disabled.
+  index.Update();
+  RowBitmap rows;
+  int num_rows = 0;
+  EXPECT_FALSE(index.GetCandidates("needle", true, &rows, &num_rows));
+
+  index.SetEnabled(true);
+  EXPECT_TRUE(index.enabled());
+  IndexPendingBatch();
+  EXPECT_EQ(MessageIndex::kBatchRows, index.num_rows());
+
+  std::vector<int> candidates(Candidates(&index, "NEEDLE"));
+  ASSERT_EQ(1U, candidates.size());
+  EXPECT_EQ(7, candidates[0]);
+
+  // The rest of the rows follow in the next batch.
+  IndexPendingBatch();
+  EXPECT_EQ(static_cast<int>(messages_.size()), index.num_rows());
+  candidates = Candidates(&index, "Found.*needle");
+  ASSERT_EQ(2U, candidates.size());
+  EXPECT_EQ(7, candidates[0]);
+  EXPECT_EQ(static_cast<int>(messages_.size()) - 1, candidates[1]);
+
+  // Patterns without literals can't be narrowed.
+  EXPECT_FALSE(index.GetCandidates("needle|haystack", true, &rows,
+                                   &num_rows));
+
+  index.SetEnabled(false);
+  EXPECT_EQ(0, index.num_rows());
+  EXPECT_FALSE(index.GetCandidates("needle", true, &rows, &num_rows));
+}
+
+TEST_F(MessageIndexTest, ClearDropsBatchInFlight) {
+  MessageIndex index(&mock_view_, worker_.message_loop());
+  index.SetEnabled(true);
+
+  // The batch read before the clear is never indexed.
+  index.Clear();
+  IndexPendingBatch();
+  EXPECT_EQ(0, index.num_rows());
+
+  // Indexing starts over on the next update.
+  index.Update();
+  IndexPendingBatch();
+  EXPECT_EQ(MessageIndex::kBatchRows, index.num_rows());
+}
+
+TEST_F(MessageIndexTest, RemoveFrontOfUnindexedRowsStartsOver) {
+  MessageIndex index(&mock_view_, worker_.message_loop());
+  index.SetEnabled(true);
+  IndexPendingBatch();
+  ASSERT_EQ(MessageIndex::kBatchRows, index.num_rows());
+
+  // Not all the rows removed are indexed, so the batch in flight is
+  // dropped, and the view's rows are indexed again from the first.
+  index.RemoveFront(RowBitmap::kChunkSize);
+  EXPECT_EQ(0, index.num_rows());
+  IndexPendingBatch();
+  EXPECT_EQ(MessageIndex::kBatchRows, index.num_rows());
+
+  std::vector<int> candidates(Candidates(&index, "needle"));
+  ASSERT_EQ(1U, candidates.size());
+  EXPECT_EQ(7, candidates[0]);
+}
+
+}  // namespace
@@ -26,9 +26,10 @@ class MockILogViewEvents: public ILogViewEvents {
  public:
   MOCK_METHOD0(LogViewNewItems, void());
   MOCK_METHOD0(LogViewCleared, void());
+  MOCK_METHOD1(LogViewRowsRemoved, void(int num_rows));
 };
 
-class MockILogView: public ILogView {
+class MockILogView: public ILogViewV2 {
  public:
   MOCK_METHOD0(GetNumRows, int());
   MOCK_METHOD0(ClearAll, void());
@@ -45,6 +46,22 @@ class MockILogView: public ILogView {
   MOCK_METHOD2(Register, void(ILogViewEvents* event_sink,
                               int* registration_cookie));
   MOCK_METHOD1(Unregister, void(int registration_cookie));
+
+  MOCK_METHOD1(GetFileNameView, base::StringPiece(int row));
+  MOCK_METHOD1(GetMessageView, base::StringPiece(int row));
+  MOCK_METHOD3(GetStackTraceView, void(int row,
+                                       void* const** trace,
+                                       size_t* depth));
+  MOCK_METHOD4(GetColumns, void(int first_row,
+                                int num_rows,
+                                uint32 columns,
+                                LogColumnBatch* batch));
+  MOCK_METHOD0(GetIndex, const LogIndex*());
+  MOCK_METHOD4(GetMessageCandidates, bool(const std::string& pattern,
+                                          bool caseless,
+                                          RowBitmap* rows,
+                                          int* num_rows));
+  MOCK_METHOD0(ReleaseViews, void());
 };
 
 }  // namespace testing
@@ -0,0 +1,281 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Paged saved session log view implementation.
+#include "sawbuck/viewer/paged_log_view.h"
+
+#include <algorithm>
+#include "base/logging.h"
+
+PagedLogView::PagedLogView(size_t cache_budget)
+    : cache_bytes_(0), cache_budget_(cache_budget), last_page_(0),
+      use_clock_(0), page_reads_(0), next_sink_cookie_(1) {
+}
+
+PagedLogView::~PagedLogView() {
+  ClearCache();
+}
+
+bool PagedLogView::Open(const base::FilePath& path) {
+  DCHECK(reader_.get() == NULL);
+  scoped_ptr<SawlogPageReader> reader(new SawlogPageReader());
+  if (!reader->Open(path))
+    return false;
+
+  reader_.reset(reader.release());
+  return true;
+}
+
+int PagedLogView::GetNumRows() {
+  if (reader_.get() == NULL)
+    return 0;
+  return reader_->num_rows();
+}
+
+void PagedLogView::ClearAll() {
+  index_.reset();
+  ClearCache();
+  reader_.reset();
+
+  EventSinkMap::iterator it(event_sinks_.begin());
+  for (; it != event_sinks_.end(); ++it)
+    it->second->LogViewCleared();
+}
+
+int PagedLogView::GetSeverity(int row) {
+  const SawlogPage& page = GetPage(row);
+  return page.levels[row - page.first_row];
+}
+
+DWORD PagedLogView::GetProcessId(int row) {
+  const SawlogPage& page = GetPage(row);
+  return page.process_ids[row - page.first_row];
+}
+
+DWORD PagedLogView::GetThreadId(int row) {
+  const SawlogPage& page = GetPage(row);
+  return page.thread_ids[row - page.first_row];
+}
+
+base::Time PagedLogView::GetTime(int row) {
+  const SawlogPage& page = GetPage(row);
+  return base::Time::FromInternalValue(page.times[row - page.first_row]);
+}
+
+std::string PagedLogView::GetFileName(int row) {
+  return GetFileNameView(row).as_string();
+}
+
+int PagedLogView::GetLine(int row) {
+  const SawlogPage& page = GetPage(row);
+  return page.lines[row - page.first_row];
+}
+
+std::string PagedLogView::GetMessage(int row) {
+  return GetMessageView(row).as_string();
+}
+
+void PagedLogView::GetStackTrace(int row, std::vector<void*>* trace) {
+  DCHECK(trace != NULL);
+  void* const* frames = NULL;
+  size_t depth = 0;
+  GetStackTraceView(row, &frames, &depth);
+  trace->assign(frames, frames + depth);
+}
+
+void PagedLogView::Register(ILogViewEvents* event_sink,
+                            int* registration_cookie) {
+  int cookie = next_sink_cookie_++;
+
+  event_sinks_.insert(std::make_pair(cookie, event_sink));
+  *registration_cookie = cookie;
+}
+
+void PagedLogView::Unregister(int registration_cookie) {
+  event_sinks_.erase(registration_cookie);
+}
+
+base::StringPiece PagedLogView::GetFileNameView(int row) {
+  const SawlogPage& page = GetPage(row);
+  return reader_->GetFileName(page.file_ids[row - page.first_row]);
+}
+
+base::StringPiece PagedLogView::GetMessageView(int row) {
+  const SawlogPage& page = GetPage(row);
+  return page.message(row - page.first_row);
+}
+
+void PagedLogView::GetStackTraceView(int row,
+                                     void* const** trace,
+                                     size_t* depth) {
+  DCHECK(trace != NULL && depth != NULL);
+  const SawlogPage& page = GetPage(row);
+  *trace = reader_->GetTrace(page.trace_ids[row - page.first_row], depth);
+}
+
+void PagedLogView::GetColumns(int first_row,
+                              int num_rows,
+                              uint32 columns,
+                              LogColumnBatch* batch) {
+  DCHECK(first_row >= 0 && first_row + num_rows <= GetNumRows());
+  DCHECK(batch != NULL);
+
+  // The rows are read a page at a time.
+  batch->Clear();
+  int end_row = first_row + num_rows;
+  for (int row = first_row; row < end_row; ) {
+    const SawlogPage& page = GetPage(row);
+    size_t begin = row - page.first_row;
+    size_t end = std::min(page.num_rows(),
+                          static_cast<size_t>(end_row) - page.first_row);
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::SEVERITY)) {
+      for (size_t i = begin; i < end; ++i)
+        batch->severities.push_back(page.levels[i]);
+    }
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::PROCESS_ID)) {
+      for (size_t i = begin; i < end; ++i)
+        batch->process_ids.push_back(page.process_ids[i]);
+    }
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::THREAD_ID)) {
+      for (size_t i = begin; i < end; ++i)
+        batch->thread_ids.push_back(page.thread_ids[i]);
+    }
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::TIME)) {
+      for (size_t i = begin; i < end; ++i)
+        batch->times.push_back(base::Time::FromInternalValue(page.times[i]));
+    }
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::FILE)) {
+      for (size_t i = begin; i < end; ++i)
+        batch->file_names.push_back(reader_->GetFileName(page.file_ids[i]));
+    }
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::LINE)) {
+      for (size_t i = begin; i < end; ++i)
+        batch->lines.push_back(page.lines[i]);
+    }
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::MESSAGE)) {
+      for (size_t i = begin; i < end; ++i)
+        batch->messages.push_back(page.message(i));
+    }
+    row += end - begin;
+  }
+}
+
+const LogIndex* PagedLogView::GetIndex() {
+  if (reader_.get() == NULL)
+    return NULL;
+
+  if (index_.get() == NULL) {
+    // The indexed columns are read a page at a time, past the cache, and
+    // without the message text.
+    index_.reset(new LogIndex());
+    SawlogPage page;
+    for (size_t first = 0; first < reader_->num_rows(); first += kPageRows) {
+      if (!reader_->ReadPage(first, PageRows(first), false, &page))
+        LOG(ERROR) << "Unable to read the rows from " << first << " on.";
+
+      for (size_t i = 0; i < page.num_rows(); ++i) {
+        uint32 file_id = page.file_ids[i];
+        index_->AddRow(page.levels[i], page.process_ids[i],
+                       page.thread_ids[i], file_id,
+                       reader_->GetFileName(file_id));
+      }
+    }
+  }
+
+  return index_.get();
+}
+
+bool PagedLogView::GetMessageCandidates(const std::string& pattern,
+                                        bool caseless,
+                                        RowBitmap* rows,
+                                        int* num_rows) {
+  // Sessions have no message index of their own, the viewer indexes
+  // them as it does its own log.
+  return false;
+}
+
+void PagedLogView::ReleaseViews() {
+  TrimCache();
+}
+
+const SawlogPage& PagedLogView::GetPage(int row) {
+  DCHECK(reader_.get() != NULL);
+  DCHECK(row >= 0 && static_cast<size_t>(row) < reader_->num_rows());
+
+  size_t index = row / kPageRows;
+  CachedPage* page = LoadPage(index);
+  if (index != last_page_) {
+    // Read ahead in the direction of travel.
+    size_t num_pages = (reader_->num_rows() + kPageRows - 1) / kPageRows;
+    if (index > last_page_ && index + 1 < num_pages)
+      LoadPage(index + 1);
+    else if (index < last_page_ && index > 0)
+      LoadPage(index - 1);
+    last_page_ = index;
+  }
+
+  page->last_use = ++use_clock_;
+  return page->rows;
+}
+
+PagedLogView::CachedPage* PagedLogView::LoadPage(size_t index) {
+  PageMap::iterator it(pages_.find(index));
+  if (it != pages_.end())
+    return it->second;
+
+  size_t first = index * kPageRows;
+  CachedPage* page = new CachedPage();
+  if (!reader_->ReadPage(first, PageRows(first), true, &page->rows))
+    LOG(ERROR) << "Unable to read the rows from " << first << " on.";
+
+  ++page_reads_;
+  page->last_use = ++use_clock_;
+  cache_bytes_ += page->rows.bytes();
+  pages_.insert(std::make_pair(index, page));
+  return page;
+}
+
+size_t PagedLogView::PageRows(size_t first_row) const {
+  DCHECK_LT(first_row, reader_->num_rows());
+  size_t num_rows = reader_->num_rows() - first_row;
+  return num_rows < kPageRows ? num_rows : kPageRows;
+}
+
+void PagedLogView::TrimCache() {
+  if (cache_bytes_ <= cache_budget_)
+    return;
+
+  // Evict the least recently read pages first.
+  std::vector<std::pair<uint64, size_t> > pages;
+  PageMap::iterator it(pages_.begin());
+  for (; it != pages_.end(); ++it)
+    pages.push_back(std::make_pair(it->second->last_use, it->first));
+  std::sort(pages.begin(), pages.end());
+
+  for (size_t i = 0; i < pages.size() && cache_bytes_ > cache_budget_; ++i) {
+    it = pages_.find(pages[i].second);
+    cache_bytes_ -= it->second->rows.bytes();
+    delete it->second;
+    pages_.erase(it);
+  }
+}
+
+void PagedLogView::ClearCache() {
+  PageMap::iterator it(pages_.begin());
+  for (; it != pages_.end(); ++it)
+    delete it->second;
+  pages_.clear();
+  cache_bytes_ = 0;
+  last_page_ = 0;
+}
@@ -0,0 +1,143 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Paged saved session log view declaration.
+#ifndef SAWBUCK_VIEWER_PAGED_LOG_VIEW_H_
+#define SAWBUCK_VIEWER_PAGED_LOG_VIEW_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include "base/files/file_path.h"
+#include "base/memory/scoped_ptr.h"
+#include "sawbuck/log_lib/sawlog_file.h"
+#include "sawbuck/viewer/log_index.h"
+#include "sawbuck/viewer/log_list_view.h"
+
+// Provides a log view on a saved session, read from the .sawlog file a
+// page of rows at a time, so that sessions larger than memory can be
+// browsed in a bounded footprint.
+//
+// Pages are kept in a cache of the most recently read. Reading a page
+// other than the last one read also reads the next page in the same
+// direction, so that scrolling on rarely waits on the disk. The cache
+// grows as needed until ReleaseViews, which trims it to its budget, so
+// views stay valid until then.
+class PagedLogView : public ILogViewV2 {
+ public:
+  // The number of rows per page.
+  static const size_t kPageRows = 4096;
+
+  // @param cache_budget the number of bytes of pages to keep on trimming.
+  explicit PagedLogView(size_t cache_budget);
+  ~PagedLogView();
+
+  // Opens the saved session at @p path. This may only be called once.
+  // @returns true on success.
+  bool Open(const base::FilePath& path);
+
+  // @returns the number of bytes of pages cached.
+  size_t cache_bytes() const { return cache_bytes_; }
+
+  // @returns the number of pages read from the file.
+  uint64 page_reads() const { return page_reads_; }
+
+  // ILogView implementation;
+  // @{
+  virtual int GetNumRows();
+  virtual void ClearAll();
+  virtual int GetSeverity(int row);
+  virtual DWORD GetProcessId(int row);
+  virtual DWORD GetThreadId(int row);
+  virtual base::Time GetTime(int row);
+  virtual std::string GetFileName(int row);
+  virtual int GetLine(int row);
+  virtual std::string GetMessage(int row);
+  virtual void GetStackTrace(int row, std::vector<void*>* trace);
+  virtual void Register(ILogViewEvents* event_sink,
+                        int* registration_cookie);
+  virtual void Unregister(int registration_cookie);
+  // @}
+
+  // ILogViewV2 implementation;
+  // @{
+  virtual base::StringPiece GetFileNameView(int row);
+  virtual base::StringPiece GetMessageView(int row);
+  virtual void GetStackTraceView(int row, void* const** trace, size_t* depth);
+  virtual void GetColumns(int first_row,
+                          int num_rows,
+                          uint32 columns,
+                          LogColumnBatch* batch);
+  virtual const LogIndex* GetIndex();
+  virtual bool GetMessageCandidates(const std::string& pattern,
+                                    bool caseless,
+                                    RowBitmap* rows,
+                                    int* num_rows);
+  virtual void ReleaseViews();
+  // @}
+
+ private:
+  struct CachedPage {
+    CachedPage() : last_use(0) {
+    }
+
+    SawlogPage rows;
+    // The value of use_clock_ when the page was last read.
+    uint64 last_use;
+  };
+  typedef std::map<size_t, CachedPage*> PageMap;
+
+  // @returns the page holding @p row, reading it if need be, along with
+  //     the next page in the direction of travel.
+  const SawlogPage& GetPage(int row);
+
+  // @returns page @p index, reading it into the cache if need be.
+  CachedPage* LoadPage(size_t index);
+
+  // @returns the number of rows of the page starting at @p first_row.
+  size_t PageRows(size_t first_row) const;
+
+  // Evicts the least recently read pages until the cache is within
+  // budget. This invalidates the views on the evicted pages.
+  void TrimCache();
+
+  // Empties the cache.
+  void ClearCache();
+
+  // NULL until opened, and after ClearAll.
+  scoped_ptr<SawlogPageReader> reader_;
+
+  // The cached pages, by index, and the bytes they hold.
+  PageMap pages_;
+  size_t cache_bytes_;
+  size_t cache_budget_;
+
+  // The page last read, which gives the direction of travel.
+  size_t last_page_;
+
+  // Ticks on each read of a page, to order the cache.
+  uint64 use_clock_;
+  uint64 page_reads_;
+
+  // The index of our rows, built on first use so that opening stays cheap.
+  scoped_ptr<LogIndex> index_;
+
+  typedef std::map<int, ILogViewEvents*> EventSinkMap;
+  EventSinkMap event_sinks_;
+  int next_sink_cookie_;
+
+  DISALLOW_COPY_AND_ASSIGN(PagedLogView);
+};
+
+#endif  // SAWBUCK_VIEWER_PAGED_LOG_VIEW_H_
@@ -0,0 +1,219 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/viewer/paged_log_view.h"
+
+#include <string>
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "gtest/gtest.h"
+#include "sawbuck/viewer/log_store.h"
+#include "sawbuck/viewer/mock_log_view_interfaces.h"
+
+namespace {
+
+// Three full pages and a short one.
+const int kPageRows = PagedLogView::kPageRows;
+const int kNumRows = 3 * kPageRows + 10;
+const size_t kLargeBudget = 1024 * 1024 * 1024;
+
+class PagedLogViewTest : public testing::Test {
+ public:
+  virtual void SetUp() {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.path().Append(L"session.sawlog");
+
+    // Save a store with a few distinct files and traces.
+    for (int i = 0; i < kNumRows; ++i) {
+      std::string file = base::StringPrintf("file%d.cc", i % 3);
+      std::string message = base::StringPrintf("Message %d", i);
+      void* trace[] = { &file, &message };
+
+      LogStore::Entry entry;
+      entry.level = static_cast<UCHAR>(i % 5);
+      entry.process_id = 100 + i;
+      entry.thread_id = 200 + i;
+      entry.time_stamp = base::Time::FromInternalValue(1000 * i);
+      entry.line = i;
+      entry.file_len = file.length();
+      entry.file = file.c_str();
+      entry.message_len = message.length();
+      entry.message = message.c_str();
+      entry.trace_depth = i % arraysize(trace);
+      entry.trace = trace;
+      store_.Append(entry);
+    }
+    ASSERT_TRUE(SawlogWriter::Write(path_, store_));
+  }
+
+ protected:
+  base::ScopedTempDir temp_dir_;
+  base::FilePath path_;
+  LogStore store_;
+};
+
+TEST_F(PagedLogViewTest, MatchesSavedStore) {
+  PagedLogView view(kLargeBudget);
+  ASSERT_TRUE(view.Open(path_));
+  ASSERT_EQ(kNumRows, view.GetNumRows());
+
+  for (int i = 0; i < view.GetNumRows(); ++i) {
+    const LogStore::Row& row = store_.row(i);
+    EXPECT_EQ(row.level, view.GetSeverity(i));
+    EXPECT_EQ(row.process_id, view.GetProcessId(i));
+    EXPECT_EQ(row.thread_id, view.GetThreadId(i));
+    EXPECT_EQ(row.time_stamp, view.GetTime(i));
+    EXPECT_EQ(row.line, view.GetLine(i));
+    EXPECT_EQ(store_.file_name(row), view.GetFileNameView(i));
+    EXPECT_EQ(store_.message(i), view.GetMessageView(i));
+
+    std::vector<void*> trace;
+    view.GetStackTrace(i, &trace);
+    ASSERT_EQ(store_.trace_depth(row), trace.size());
+    for (size_t j = 0; j < trace.size(); ++j)
+      EXPECT_EQ(store_.trace(row)[j], trace[j]);
+  }
+
+  // Each page was read once.
+  EXPECT_EQ(4U, view.page_reads());
+}
+
+TEST_F(PagedLogViewTest, GetColumnsAcrossPages) {
+  PagedLogView view(kLargeBudget);
+  ASSERT_TRUE(view.Open(path_));
+
+  const int kFirstRow = kPageRows - 5;
+  const int kBatchRows = kPageRows + 10;
+  LogColumnBatch batch;
+  view.GetColumns(kFirstRow, kBatchRows,
+                  LogColumnBatch::Bit(LogViewFormatter::PROCESS_ID) |
+                      LogColumnBatch::Bit(LogViewFormatter::MESSAGE),
+                  &batch);
+  ASSERT_EQ(static_cast<size_t>(kBatchRows), batch.process_ids.size());
+  ASSERT_EQ(static_cast<size_t>(kBatchRows), batch.messages.size());
+  EXPECT_TRUE(batch.severities.empty());
+  EXPECT_TRUE(batch.file_names.empty());
+  for (int i = 0; i < kBatchRows; ++i) {
+    EXPECT_EQ(store_.row(kFirstRow + i).process_id, batch.process_ids[i]);
+    EXPECT_EQ(store_.message(kFirstRow + i), batch.messages[i]);
+  }
+}
+
+TEST_F(PagedLogViewTest, ReadsAheadInDirectionOfTravel) {
+  PagedLogView view(kLargeBudget);
+  ASSERT_TRUE(view.Open(path_));
+
+  // The first page read has no direction.
+  view.GetMessageView(0);
+  EXPECT_EQ(1U, view.page_reads());
+
+  // Moving down reads the page below too, so the next page down is
+  // already there.
+  view.GetMessageView(kPageRows);
+  EXPECT_EQ(3U, view.page_reads());
+  view.GetMessageView(2 * kPageRows);
+  EXPECT_EQ(4U, view.page_reads());
+
+  // Moving up reads the page above too. There's nothing below the last.
+  PagedLogView up_view(kLargeBudget);
+  ASSERT_TRUE(up_view.Open(path_));
+  up_view.GetMessageView(kNumRows - 1);
+  EXPECT_EQ(1U, up_view.page_reads());
+  up_view.GetMessageView(2 * kPageRows);
+  EXPECT_EQ(3U, up_view.page_reads());
+  up_view.GetMessageView(kPageRows);
+  EXPECT_EQ(4U, up_view.page_reads());
+}
+
+TEST_F(PagedLogViewTest, ReleaseViewsTrimsToBudget) {
+  PagedLogView view(0);
+  ASSERT_TRUE(view.Open(path_));
+
+  // Views stay valid until released, whatever the budget.
+  base::StringPiece message = view.GetMessageView(0);
+  view.GetMessageView(kPageRows);
+  EXPECT_EQ(store_.message(0), message);
+  EXPECT_LT(0U, view.cache_bytes());
+  EXPECT_EQ(3U, view.page_reads());
+
+  view.ReleaseViews();
+  EXPECT_EQ(0U, view.cache_bytes());
+
+  // The pages are read again on the next use.
+  EXPECT_EQ(store_.message(0), view.GetMessageView(0));
+  EXPECT_EQ(4U, view.page_reads());
+
+  // Within budget, the pages stay.
+  PagedLogView large_view(kLargeBudget);
+  ASSERT_TRUE(large_view.Open(path_));
+  large_view.GetMessageView(0);
+  size_t cache_bytes = large_view.cache_bytes();
+  large_view.ReleaseViews();
+  EXPECT_EQ(cache_bytes, large_view.cache_bytes());
+}
+
+TEST_F(PagedLogViewTest, IndexMatchesSavedStore) {
+  PagedLogView view(0);
+  ASSERT_TRUE(view.Open(path_));
+
+  const LogIndex* index = view.GetIndex();
+  ASSERT_TRUE(index != NULL);
+  EXPECT_EQ(index, view.GetIndex());
+  EXPECT_EQ(store_.index().num_rows(), index->num_rows());
+  EXPECT_EQ(store_.index().levels().size(), index->levels().size());
+  EXPECT_EQ(store_.index().process_ids().size(),
+            index->process_ids().size());
+
+  // The index is read past the cache.
+  EXPECT_EQ(0U, view.cache_bytes());
+  EXPECT_EQ(0U, view.page_reads());
+}
+
+TEST_F(PagedLogViewTest, ClearAllClosesTheSession) {
+  PagedLogView view(kLargeBudget);
+  ASSERT_TRUE(view.Open(path_));
+  view.GetMessageView(0);
+
+  testing::StrictMock<testing::MockILogViewEvents> events;
+  int cookie = 0;
+  view.Register(&events, &cookie);
+
+  EXPECT_CALL(events, LogViewCleared());
+  view.ClearAll();
+  EXPECT_EQ(0, view.GetNumRows());
+  EXPECT_EQ(0U, view.cache_bytes());
+
+  view.Unregister(cookie);
+}
+
+TEST_F(PagedLogViewTest, DeletingThroughInterfaceClosesTheFile) {
+  scoped_ptr<ILogViewV2> view;
+  {
+    PagedLogView* paged = new PagedLogView(kLargeBudget);
+    view.reset(paged);
+    ASSERT_TRUE(paged->Open(path_));
+  }
+  EXPECT_EQ(store_.message(0), view->GetMessageView(0));
+
+  view.reset();
+  EXPECT_TRUE(base::DeleteFile(path_, false));
+}
+
+TEST_F(PagedLogViewTest, OpenFailsOnMissingFile) {
+  PagedLogView view(kLargeBudget);
+  EXPECT_FALSE(view.Open(temp_dir_.path().Append(L"missing.sawlog")));
+  EXPECT_EQ(0, view.GetNumRows());
+}
+
+}  // namespace
@@ -79,6 +79,17 @@ bool Preferences::ReadStringValue(const wchar_t* name,
   return result;
 }
 
+DWORD Preferences::ReadDWordValue(const wchar_t* name,
+                                  DWORD default_value) {
+  DWORD value = 0;
+  if (EnsureReadableKey() &&
+      key_.QueryDWORDValue(name, value) == ERROR_SUCCESS) {
+    return value;
+  }
+
+  return default_value;
+}
+
 bool Preferences::EnsureReadableKey() {
   if (key_)
     return true;
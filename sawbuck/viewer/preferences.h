@@ -32,6 +32,10 @@ class Preferences {
   bool ReadStringValue(const wchar_t* name,
                        std::wstring* value,
                        const wchar_t* default_value);
+
+  // @returns the DWORD value |name|, or |default_value| if there's none.
+  DWORD ReadDWordValue(const wchar_t* name, DWORD default_value);
+
  private:
   bool EnsureReadableKey();
   bool EnsureWritableKey();
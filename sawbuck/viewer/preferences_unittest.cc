@@ -62,6 +62,15 @@ TEST_F(PreferencesTest, ReadStringValue) {
   }
 }
 
+TEST_F(PreferencesTest, ReadDWordValue) {
+  Register(kStringPrefences);
+
+  Preferences pref;
+  EXPECT_EQ(12345U, pref.ReadDWordValue(L"number", 0));
+  EXPECT_EQ(42U, pref.ReadDWordValue(L"foo", 42));
+  EXPECT_EQ(42U, pref.ReadDWordValue(L"nonesuch", 42));
+}
+
 TEST_F(PreferencesTest, WriteStringValue) {
   Preferences pref;
 
@@ -0,0 +1,181 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Saved session log view implementation.
+#include "sawbuck/viewer/sawlog_log_view.h"
+
+#include "base/logging.h"
+
+SawlogLogView::SawlogLogView() : next_sink_cookie_(1) {
+}
+
+SawlogLogView::~SawlogLogView() {
+}
+
+bool SawlogLogView::Open(const base::FilePath& path) {
+  DCHECK(file_.get() == NULL);
+  scoped_ptr<SawlogFile> file(new SawlogFile());
+  if (!file->Open(path))
+    return false;
+
+  file_.reset(file.release());
+  return true;
+}
+
+int SawlogLogView::GetNumRows() {
+  if (file_.get() == NULL)
+    return 0;
+  return file_->num_rows();
+}
+
+void SawlogLogView::ClearAll() {
+  index_.reset();
+  file_.reset();
+
+  EventSinkMap::iterator it(event_sinks_.begin());
+  for (; it != event_sinks_.end(); ++it)
+    it->second->LogViewCleared();
+}
+
+int SawlogLogView::GetSeverity(int row) {
+  return file_->level(row);
+}
+
+DWORD SawlogLogView::GetProcessId(int row) {
+  return file_->process_id(row);
+}
+
+DWORD SawlogLogView::GetThreadId(int row) {
+  return file_->thread_id(row);
+}
+
+base::Time SawlogLogView::GetTime(int row) {
+  return file_->time(row);
+}
+
+std::string SawlogLogView::GetFileName(int row) {
+  return GetFileNameView(row).as_string();
+}
+
+int SawlogLogView::GetLine(int row) {
+  return file_->line(row);
+}
+
+std::string SawlogLogView::GetMessage(int row) {
+  return GetMessageView(row).as_string();
+}
+
+void SawlogLogView::GetStackTrace(int row, std::vector<void*>* trace) {
+  DCHECK(trace != NULL);
+  size_t depth = 0;
+  void* const* frames = file_->trace(row, &depth);
+  trace->assign(frames, frames + depth);
+}
+
+void SawlogLogView::Register(ILogViewEvents* event_sink,
+                             int* registration_cookie) {
+  int cookie = next_sink_cookie_++;
+
+  event_sinks_.insert(std::make_pair(cookie, event_sink));
+  *registration_cookie = cookie;
+}
+
+void SawlogLogView::Unregister(int registration_cookie) {
+  event_sinks_.erase(registration_cookie);
+}
+
+base::StringPiece SawlogLogView::GetFileNameView(int row) {
+  return file_->file_name(row);
+}
+
+base::StringPiece SawlogLogView::GetMessageView(int row) {
+  return file_->message(row);
+}
+
+void SawlogLogView::GetStackTraceView(int row,
+                                      void* const** trace,
+                                      size_t* depth) {
+  DCHECK(trace != NULL && depth != NULL);
+  *trace = file_->trace(row, depth);
+}
+
+void SawlogLogView::GetColumns(int first_row,
+                               int num_rows,
+                               uint32 columns,
+                               LogColumnBatch* batch) {
+  DCHECK(first_row >= 0 && first_row + num_rows <= GetNumRows());
+  DCHECK(batch != NULL);
+
+  // Each column is read in a single pass, as it's laid out on disk.
+  batch->Clear();
+  int end_row = first_row + num_rows;
+  if (columns & LogColumnBatch::Bit(LogViewFormatter::SEVERITY)) {
+    for (int i = first_row; i < end_row; ++i)
+      batch->severities.push_back(file_->level(i));
+  }
+  if (columns & LogColumnBatch::Bit(LogViewFormatter::PROCESS_ID)) {
+    for (int i = first_row; i < end_row; ++i)
+      batch->process_ids.push_back(file_->process_id(i));
+  }
+  if (columns & LogColumnBatch::Bit(LogViewFormatter::THREAD_ID)) {
+    for (int i = first_row; i < end_row; ++i)
+      batch->thread_ids.push_back(file_->thread_id(i));
+  }
+  if (columns & LogColumnBatch::Bit(LogViewFormatter::TIME)) {
+    for (int i = first_row; i < end_row; ++i)
+      batch->times.push_back(file_->time(i));
+  }
+  if (columns & LogColumnBatch::Bit(LogViewFormatter::FILE)) {
+    for (int i = first_row; i < end_row; ++i)
+      batch->file_names.push_back(file_->file_name(i));
+  }
+  if (columns & LogColumnBatch::Bit(LogViewFormatter::LINE)) {
+    for (int i = first_row; i < end_row; ++i)
+      batch->lines.push_back(file_->line(i));
+  }
+  if (columns & LogColumnBatch::Bit(LogViewFormatter::MESSAGE)) {
+    for (int i = first_row; i < end_row; ++i)
+      batch->messages.push_back(file_->message(i));
+  }
+}
+
+const LogIndex* SawlogLogView::GetIndex() {
+  if (file_.get() == NULL)
+    return NULL;
+
+  if (index_.get() == NULL) {
+    index_.reset(new LogIndex());
+    for (size_t i = 0; i < file_->num_rows(); ++i) {
+      uint32 file_id = file_->file_id(i);
+      index_->AddRow(file_->level(i), file_->process_id(i),
+                     file_->thread_id(i), file_id,
+                     file_->GetFileName(file_id));
+    }
+  }
+
+  return index_.get();
+}
+
+bool SawlogLogView::GetMessageCandidates(const std::string& pattern,
+                                         bool caseless,
+                                         RowBitmap* rows,
+                                         int* num_rows) {
+  // Sessions have no message index of their own, the viewer indexes
+  // them as it does its own log.
+  return false;
+}
+
+void SawlogLogView::ReleaseViews() {
+  // Views refer to the mapped file, which stays mapped while open.
+}
@@ -0,0 +1,88 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Saved session log view declaration.
+#ifndef SAWBUCK_VIEWER_SAWLOG_LOG_VIEW_H_
+#define SAWBUCK_VIEWER_SAWLOG_LOG_VIEW_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include "base/files/file_path.h"
+#include "base/memory/scoped_ptr.h"
+#include "sawbuck/log_lib/sawlog_file.h"
+#include "sawbuck/viewer/log_index.h"
+#include "sawbuck/viewer/log_list_view.h"
+
+// Provides a log view on a saved session, read in place from the mapped
+// .sawlog file. The view never grows, and is emptied by ClearAll, which
+// closes the file.
+class SawlogLogView : public ILogViewV2 {
+ public:
+  SawlogLogView();
+  ~SawlogLogView();
+
+  // Opens the saved session at @p path. This may only be called once.
+  // @returns true on success.
+  bool Open(const base::FilePath& path);
+
+  // ILogView implementation;
+  // @{
+  virtual int GetNumRows();
+  virtual void ClearAll();
+  virtual int GetSeverity(int row);
+  virtual DWORD GetProcessId(int row);
+  virtual DWORD GetThreadId(int row);
+  virtual base::Time GetTime(int row);
+  virtual std::string GetFileName(int row);
+  virtual int GetLine(int row);
+  virtual std::string GetMessage(int row);
+  virtual void GetStackTrace(int row, std::vector<void*>* trace);
+  virtual void Register(ILogViewEvents* event_sink,
+                        int* registration_cookie);
+  virtual void Unregister(int registration_cookie);
+  // @}
+
+  // ILogViewV2 implementation;
+  // @{
+  virtual base::StringPiece GetFileNameView(int row);
+  virtual base::StringPiece GetMessageView(int row);
+  virtual void GetStackTraceView(int row, void* const** trace, size_t* depth);
+  virtual void GetColumns(int first_row,
+                          int num_rows,
+                          uint32 columns,
+                          LogColumnBatch* batch);
+  virtual const LogIndex* GetIndex();
+  virtual bool GetMessageCandidates(const std::string& pattern,
+                                    bool caseless,
+                                    RowBitmap* rows,
+                                    int* num_rows);
+  virtual void ReleaseViews();
+  // @}
+
+ private:
+  // NULL until opened, and after ClearAll.
+  scoped_ptr<SawlogFile> file_;
+
+  // The index of file_, built on first use so that opening stays cheap.
+  scoped_ptr<LogIndex> index_;
+
+  typedef std::map<int, ILogViewEvents*> EventSinkMap;
+  EventSinkMap event_sinks_;
+  int next_sink_cookie_;
+
+  DISALLOW_COPY_AND_ASSIGN(SawlogLogView);
+};
+
+#endif  // SAWBUCK_VIEWER_SAWLOG_LOG_VIEW_H_
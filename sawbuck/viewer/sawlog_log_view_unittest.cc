@@ -0,0 +1,150 @@
+// Copyright 2014 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "sawbuck/viewer/sawlog_log_view.h"
+
+#include <string>
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "gtest/gtest.h"
+#include "sawbuck/viewer/log_store.h"
+#include "sawbuck/viewer/mock_log_view_interfaces.h"
+
+namespace {
+
+const int kNumRows = 10;
+
+class SawlogLogViewTest : public testing::Test {
+ public:
+  virtual void SetUp() {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.path().Append(L"session.sawlog");
+
+    // Save a store with a few distinct files and traces.
+    for (int i = 0; i < kNumRows; ++i) {
+      std::string file = base::StringPrintf("file%d.cc", i % 3);
+      std::string message = base::StringPrintf("Message %d", i);
+      void* trace[] = { &file, &message };
+
+      LogStore::Entry entry;
+      entry.level = static_cast<UCHAR>(i % 5);
+      entry.process_id = 100 + i;
+      entry.thread_id = 200 + i;
+      entry.time_stamp = base::Time::FromInternalValue(1000 * i);
+      entry.line = i;
+      entry.file_len = file.length();
+      entry.file = file.c_str();
+      entry.message_len = message.length();
+      entry.message = message.c_str();
+      entry.trace_depth = i % arraysize(trace);
+      entry.trace = trace;
+      store_.Append(entry);
+    }
+    ASSERT_TRUE(SawlogWriter::Write(path_, store_));
+  }
+
+ protected:
+  base::ScopedTempDir temp_dir_;
+  base::FilePath path_;
+  LogStore store_;
+};
+
+TEST_F(SawlogLogViewTest, MatchesSavedStore) {
+  SawlogLogView view;
+  ASSERT_TRUE(view.Open(path_));
+  ASSERT_EQ(kNumRows, view.GetNumRows());
+
+  for (int i = 0; i < view.GetNumRows(); ++i) {
+    const LogStore::Row& row = store_.row(i);
+    EXPECT_EQ(row.level, view.GetSeverity(i));
+    EXPECT_EQ(row.process_id, view.GetProcessId(i));
+    EXPECT_EQ(row.thread_id, view.GetThreadId(i));
+    EXPECT_EQ(row.time_stamp, view.GetTime(i));
+    EXPECT_EQ(row.line, view.GetLine(i));
+    EXPECT_EQ(store_.file_name(row), view.GetFileNameView(i));
+    EXPECT_EQ(store_.message(i), view.GetMessageView(i));
+
+    std::vector<void*> trace;
+    view.GetStackTrace(i, &trace);
+    ASSERT_EQ(store_.trace_depth(row), trace.size());
+    for (size_t j = 0; j < trace.size(); ++j)
+      EXPECT_EQ(store_.trace(row)[j], trace[j]);
+  }
+}
+
+TEST_F(SawlogLogViewTest, GetColumns) {
+  SawlogLogView view;
+  ASSERT_TRUE(view.Open(path_));
+
+  LogColumnBatch batch;
+  view.GetColumns(2, 5,
+                  LogColumnBatch::Bit(LogViewFormatter::PROCESS_ID) |
+                      LogColumnBatch::Bit(LogViewFormatter::MESSAGE),
+                  &batch);
+  ASSERT_EQ(5U, batch.process_ids.size());
+  ASSERT_EQ(5U, batch.messages.size());
+  EXPECT_TRUE(batch.severities.empty());
+  EXPECT_TRUE(batch.file_names.empty());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(view.GetProcessId(2 + i), batch.process_ids[i]);
+    EXPECT_EQ(view.GetMessageView(2 + i), batch.messages[i]);
+  }
+}
+
+TEST_F(SawlogLogViewTest, IndexMatchesSavedStore) {
+  SawlogLogView view;
+  ASSERT_TRUE(view.Open(path_));
+
+  const LogIndex* index = view.GetIndex();
+  ASSERT_TRUE(index != NULL);
+  EXPECT_EQ(index, view.GetIndex());
+  EXPECT_EQ(store_.index().num_rows(), index->num_rows());
+  EXPECT_EQ(store_.index().levels().size(), index->levels().size());
+  EXPECT_EQ(store_.index().process_ids().size(),
+            index->process_ids().size());
+
+  // Each file's rows are those logged from it.
+  size_t num_rows = 0;
+  for (size_t i = 0; i < index->files().size(); ++i) {
+    const LogIndex::FileRows& file = index->files()[i];
+    std::vector<int> rows;
+    file.rows.AppendRows(0, kNumRows, &rows);
+    for (size_t j = 0; j < rows.size(); ++j)
+      EXPECT_EQ(file.file_name, view.GetFileNameView(rows[j]));
+    num_rows += rows.size();
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumRows), num_rows);
+}
+
+TEST_F(SawlogLogViewTest, ClearAllClosesTheSession) {
+  SawlogLogView view;
+  ASSERT_TRUE(view.Open(path_));
+
+  testing::StrictMock<testing::MockILogViewEvents> events;
+  int cookie = 0;
+  view.Register(&events, &cookie);
+
+  EXPECT_CALL(events, LogViewCleared());
+  view.ClearAll();
+  EXPECT_EQ(0, view.GetNumRows());
+
+  view.Unregister(cookie);
+}
+
+TEST_F(SawlogLogViewTest, OpenFailsOnMissingFile) {
+  SawlogLogView view;
+  EXPECT_FALSE(view.Open(temp_dir_.path().Append(L"missing.sawlog")));
+  EXPECT_EQ(0, view.GetNumRows());
+}
+
+}  // namespace
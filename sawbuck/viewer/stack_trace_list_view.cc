@@ -57,7 +57,7 @@ void StackTraceListView::SetSymbolLookupService(
 void StackTraceListView::SetStackTrace(sym_util::ProcessId pid,
                                        const base::Time& time,
                                        size_t num_traces,
-                                       void* traces[]) {
+                                       void* const traces[]) {
   pid_ = pid;
   time_ = time;
 
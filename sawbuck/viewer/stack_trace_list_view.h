@@ -64,7 +64,7 @@ class StackTraceListView
   void SetStackTrace(sym_util::ProcessId pid,
                      const base::Time& time,
                      size_t num_traces,
-                     void* traces[]);
+                     void* const traces[]);
 
   // Our column definitions and config data to satisfy our contract
   // to the ListViewImpl superclass.
@@ -73,10 +73,20 @@
         'filtered_log_view.h',
         'find_dialog.cc',
         'find_dialog.h',
+        'log_index.cc',
+        'log_index.h',
         'log_viewer.h',
         'log_viewer.cc',
         'log_list_view.h',
         'log_list_view.cc',
+        'log_prefix_scanner.cc',
+        'log_prefix_scanner.h',
+        'log_store.cc',
+        'log_store.h',
+        'message_index.cc',
+        'message_index.h',
+        'paged_log_view.cc',
+        'paged_log_view.h',
         'preferences.cc',
         'preferences.h',
         'provider_configuration.cc',
@@ -84,15 +94,19 @@
         'provider_dialog.cc',
         'provider_dialog.h',
         'sawbuck_guids.h',
+        'sawlog_log_view.cc',
+        'sawlog_log_view.h',
         'stack_trace_list_view.h',
         'stack_trace_list_view.cc',
         'viewer_window.cc',
         'viewer_window.h',
       ],
       'dependencies': [
+        '../common/common.gyp:common',
         '../log_lib/log_lib.gyp:log_lib',
         '<(DEPTH)/base/base.gyp:base',
         '<(DEPTH)/third_party/pcre/pcre.gyp:pcre_lib',
+        '<(DEPTH)/third_party/zlib/zlib.gyp:zlib',
       ],
     },
     {
@@ -149,11 +163,17 @@
       'sources': [
         'filter_unittest.cc',
         'filtered_log_view_unittest.cc',
+        'log_index_unittest.cc',
+        'log_prefix_scanner_unittest.cc',
+        'log_store_unittest.cc',
+        'message_index_unittest.cc',
+        'paged_log_view_unittest.cc',
         'preferences_unittest.cc',
         'provider_configuration_unittest.cc',
         'registry_test.h',
         'registry_test.cc',
         'sawbuck_guids.h',
+        'sawlog_log_view_unittest.cc',
         'viewer_unittest_main.cc',
         'viewer_window_unittest.cc',
         'viewer.rc',
@@ -161,11 +181,27 @@
       'dependencies': [
         'copy_dlls',
         'viewer_lib',
+        '../common/common.gyp:common_test_utils',
         '<(DEPTH)/base/base.gyp:base',
         '<(DEPTH)/base/base.gyp:base_i18n',
         '<(DEPTH)/testing/gmock.gyp:gmock',
         '<(DEPTH)/testing/gtest.gyp:gtest',
       ],
     },
+    {
+      'target_name': 'viewer_perftests',
+      'type': 'executable',
+      'sources': [
+        'log_prefix_scanner_perftest.cc',
+      ],
+      'dependencies': [
+        'viewer_lib',
+        '../common/common.gyp:common_test_utils',
+        '<(DEPTH)/base/base.gyp:base',
+        '<(DEPTH)/base/base.gyp:test_support_perf',
+        '<(DEPTH)/testing/gtest.gyp:gtest',
+        '<(DEPTH)/third_party/pcre/pcre.gyp:pcre_lib',
+      ],
+    },
   ]
 }
@@ -15,7 +15,8 @@
 // Log viewer window implementation.
 #include "sawbuck/viewer/viewer_window.h"
 
-#include "pcrecpp.h"  // NOLINT
+#include <algorithm>
+#include <limits>
 #include "base/bind.h"
 #include "base/environment.h"
 #include "base/file_util.h"
@@ -24,8 +25,10 @@
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
-#include "base/win/event_trace_consumer.h"
+#include "base/sys_info.h"
+#include "sawbuck/log_lib/etl_file_consumer.h"
 #include "sawbuck/viewer/const_config.h"
+#include "sawbuck/viewer/log_prefix_scanner.h"
 #include "sawbuck/viewer/preferences.h"
 #include "sawbuck/viewer/provider_dialog.h"
 #include "sawbuck/viewer/viewer_module.h"
@@ -37,13 +40,19 @@ const wchar_t* kMicrosoftSymSrv = L"http://msdl.microsoft.com/download/symbols";
 const wchar_t* kChromeSymSrv =
     L"http://chromium-browser-symsrv.commondatastorage.googleapis.com";
 
-// A regular expression that matches "[<stuff>:<file>(<line>)].message"
-// and extracts the file/line/message parts.
-const pcrecpp::RE kFileRe("\\[[^\\]]*\\:([^:]+)\\((\\d+)\\)\\].(.*\\w).*",
-                          PCRE_NEWLINE_ANYCRLF | PCRE_DOTALL | PCRE_UTF8);
-
 const wchar_t kSessionName[] = L"Sawbuck Log Session";
 
+const wchar_t kSawlogExtension[] = L".sawlog";
+
+// The number of batches the consumer thread can publish ahead of the UI
+// thread. Batches are issued per ETW buffer, and the session flushes every
+// second, so this only fills if the UI thread stalls.
+const size_t kMaxPendingBatches = 1024;
+
+// The arena chunk size for a batch, which holds the messages of one ETW
+// buffer.
+const size_t kBatchArenaChunkSize = 16 * 1024;
+
 bool Is64BitSystem() {
   if (sizeof(void*) == 8)  // NOLINT
     return true;
@@ -75,15 +84,25 @@ bool operator < (const GUID& a, const GUID& b) {
 void ViewerWindow::CompileAsserts() {
 }
 
+ViewerWindow::DeliveryStats::DeliveryStats()
+    : batches_published(0), overflows(0), batches_drained(0),
+      messages_drained(0), max_batches_pending(0) {
+}
+
 ViewerWindow::ViewerWindow()
      : symbol_lookup_worker_("Symbol Lookup Worker"),
+       message_index_worker_("Message Index Worker"),
+       retain_rows_(0),
+       retain_bytes_(0),
+       pending_batches_(kMaxPendingBatches),
+       overflow_pending_(0),
        next_sink_cookie_(1),
        log_viewer_(this),
        ui_loop_(NULL),
        notify_log_view_new_items_(
           base::Bind(&ViewerWindow::NotifyLogViewNewItems,
                      base::Unretained(this))),
-       notify_log_view_new_items_pending_(false),
+       notify_log_view_new_items_pending_(0),
        update_status_task_(base::Bind(&ViewerWindow::UpdateStatus,
                                       base::Unretained(this))),
        update_status_task_pending_(false),
@@ -102,9 +121,21 @@ ViewerWindow::ViewerWindow()
   symbol_lookup_service_.set_background_thread(
       symbol_lookup_worker_.message_loop());
 
+  message_index_worker_.Start();
+  DCHECK(message_index_worker_.message_loop() != NULL);
+  message_index_.reset(
+      new MessageIndex(this, message_index_worker_.message_loop()));
+
   InitSymbolPath();
   symbol_lookup_service_.SetSymbolPath(symbol_path_.c_str());
 
+  {
+    Preferences pref;
+    retain_rows_ = pref.ReadDWordValue(config::kRetainRowsValue, 0);
+    retain_bytes_ = static_cast<uint64>(
+        pref.ReadDWordValue(config::kRetainMegabytesValue, 0)) << 20;
+  }
+
   settings_.ReadProviders();
   settings_.ReadSettings();
 }
@@ -114,55 +145,44 @@ ViewerWindow::~ViewerWindow() {
   StopCapturing();
 
   symbol_lookup_worker_.Stop();
+  message_index_worker_.Stop();
 
   notify_log_view_new_items_.Cancel();
   update_status_task_.Cancel();
-}
-
-namespace {
-
-class ImportLogConsumer
-    : public base::win::EtwTraceConsumerBase<ImportLogConsumer>,
-      public LogParser,
-      public KernelLogParser {
- public:
-  ImportLogConsumer();
-  ~ImportLogConsumer();
-
-  static void ProcessEvent(PEVENT_TRACE event);
 
- private:
-  static ImportLogConsumer* current_;
-};
-
-ImportLogConsumer* ImportLogConsumer::current_ = NULL;
-
-ImportLogConsumer::ImportLogConsumer() {
-  DCHECK(current_ == NULL);
-  current_ = this;
+  // Discard any batches still in flight.
+  PendingBatch* batch = NULL;
+  while (pending_batches_.TryPop(&batch))
+    delete batch;
+  for (size_t i = 0; i < overflow_batches_.size(); ++i)
+    delete overflow_batches_[i];
 }
 
-ImportLogConsumer::~ImportLogConsumer() {
-  DCHECK(current_ == this);
-  current_ = NULL;
-}
-
-void ImportLogConsumer::ProcessEvent(PEVENT_TRACE event) {
-  DCHECK(current_ != NULL);
+void ViewerWindow::ImportLogFiles(const std::vector<base::FilePath>& paths) {
+  for (size_t i = 0; i < paths.size(); ++i) {
+    if (paths[i].MatchesExtension(kSawlogExtension)) {
+      if (paths.size() != 1) {
+        ::MessageBox(m_hWnd,
+                     L"A saved session can't be imported with other logs.",
+                     L"Error Importing Logs",
+                     MB_OK);
+        return;
+      }
 
-  if (!current_->LogParser::ProcessOneEvent(event) &&
-      !current_->KernelLogParser::ProcessOneEvent(event)) {
-    LOG(INFO) << "Unknown event";
+      OpenSession(paths[i]);
+      return;
+    }
   }
-}
 
-}  // namespace
+  // Imported messages can't be added to a saved session, so close it.
+  if (session_.get() != NULL)
+    ClearAll();
 
-void ViewerWindow::ImportLogFiles(const std::vector<base::FilePath>& paths) {
   UISetText(0, L"Importing");
   UIUpdateStatusBar();
 
-  ImportLogConsumer import_consumer;
+  EtlFileConsumer import_consumer;
+  import_consumer.set_num_threads(base::SysInfo::NumberOfProcessors());
 
   // Open all the log files.
   for (size_t i = 0; i < paths.size(); ++i) {
@@ -199,9 +219,15 @@ void ViewerWindow::ImportLogFiles(const std::vector<base::FilePath>& paths) {
 }
 
 const wchar_t kLogFileFilter[] =
+    L"Logs and Saved Sessions\0*.etl;*.sawlog\0"
     L"Event Trace Files\0*.etl\0"
+    L"Saved Sessions\0*.sawlog\0"
     L"All Files\n\0*.*\0";
 
+const wchar_t kSessionFileFilter[] =
+    L"Saved Sessions\0*.sawlog\0"
+    L"All Files\0*.*\0";
+
 void ViewerWindow::SetCapture(bool capture) {
   bool capturing = (log_controller_.session() != NULL);
   if (capturing != capture) {
@@ -250,6 +276,70 @@ LRESULT ViewerWindow::OnImport(
   return 0;
 }
 
+LRESULT ViewerWindow::OnSaveSession(
+    WORD code, LPARAM lparam, HWND wnd, BOOL& handled) {
+  CFileDialog dialog(FALSE, L"sawlog", NULL,
+                     OFN_HIDEREADONLY | OFN_OVERWRITEPROMPT,
+                     kSessionFileFilter, m_hWnd);
+  if (dialog.DoModal() != IDOK)
+    return 0;
+
+  UISetText(0, L"Saving");
+  UIUpdateStatusBar();
+
+  base::FilePath path(dialog.m_szFileName);
+  if (!SawlogWriter::Write(path, log_store_)) {
+    std::wstring msg =
+        base::StringPrintf(L"Failed to save the session to \"%ls\"",
+                           path.value().c_str());
+    ::MessageBox(m_hWnd, msg.c_str(), L"Error Saving Session", MB_OK);
+  }
+
+  UISetText(0, L"Ready");
+  UIUpdateStatusBar();
+
+  return 0;
+}
+
+void ViewerWindow::OpenSession(const base::FilePath& path) {
+  // With a page cache budget, the session is read a page at a time, else
+  // it's mapped whole.
+  DWORD cache_megabytes = 0;
+  {
+    Preferences pref;
+    cache_megabytes =
+        pref.ReadDWordValue(config::kSessionCacheMegabytesValue, 0);
+  }
+
+  scoped_ptr<ILogViewV2> session;
+  bool opened = false;
+  if (cache_megabytes != 0) {
+    uint64 budget = static_cast<uint64>(cache_megabytes) << 20;
+    PagedLogView* paged = new PagedLogView(static_cast<size_t>(
+        std::min<uint64>(budget, std::numeric_limits<size_t>::max())));
+    session.reset(paged);
+    opened = paged->Open(path);
+  } else {
+    SawlogLogView* mapped = new SawlogLogView();
+    session.reset(mapped);
+    opened = mapped->Open(path);
+  }
+  if (!opened) {
+    std::wstring msg =
+        base::StringPrintf(L"Failed to open saved session \"%ls\"",
+                           path.value().c_str());
+    ::MessageBox(m_hWnd, msg.c_str(), L"Error Importing Logs", MB_OK);
+    return;
+  }
+
+  // The session replaces our log, and is only ever read, so there's
+  // nothing to save.
+  ClearAll();
+  session_.reset(session.release());
+  UIEnable(ID_FILE_SAVE_SESSION, false);
+  NotifyLogViewNewItems();
+}
+
 LRESULT ViewerWindow::OnExit(
     WORD code, LPARAM lparam, HWND wnd, BOOL& handled) {
   PostMessage(WM_CLOSE);
@@ -267,6 +357,10 @@ void ViewerWindow::StopCapturing() {
   log_controller_.Stop(NULL);
   kernel_controller_.Stop(NULL);
   log_consumer_thread_.Stop();
+  if (log_consumer_.get() != NULL) {
+    DrainPendingBatches();
+    LogDeliveryStats();
+  }
   log_consumer_.reset();
 
   kernel_consumer_thread_.Stop();
@@ -326,6 +420,10 @@ bool ViewerWindow::StartCapturing() {
     return false;
   }
 
+  // Captured messages can't be added to a saved session, so close it.
+  if (session_.get() != NULL)
+    ClearAll();
+
   // Create a session for our log message capturing.
   base::win::EtwTraceProperties log_props;
   EVENT_TRACE_PROPERTIES* p = log_props.get();
@@ -404,42 +502,165 @@ void ViewerWindow::EnableProviders(
   }
 }
 
+ViewerWindow::PendingBatch::PendingBatch() : arena(kBatchArenaChunkSize) {
+}
+
 void ViewerWindow::OnLogMessage(const LogEvents::LogMessage& log_message) {
-  ViewerWindow::LogMessage msg;
-  msg.level = log_message.level;
-  msg.process_id = log_message.process_id;
-  msg.thread_id = log_message.thread_id;
-  msg.time_stamp = log_message.time;
-
-  // Use regular expression matching to extract the
-  // file/line/message from the log string, which is of
+  OnLogMessages(&log_message, 1);
+}
+
+void ViewerWindow::OnLogMessages(const LogEvents::LogMessage* log_messages,
+                                 size_t num_messages) {
+  if (num_messages == 0)
+    return;
+
+  // Do the parsing on the calling thread, so that the UI thread only
+  // has to copy the batch to our log.
+  PendingBatch* batch = new PendingBatch;
+  batch->entries.reserve(num_messages);
+  for (size_t i = 0; i < num_messages; ++i)
+    AddLogMessage(log_messages[i], batch);
+
+  DeliverBatch(batch);
+}
+
+// static
+void ViewerWindow::AddLogMessage(const LogEvents::LogMessage& log_message,
+                                 PendingBatch* batch) {
+  DCHECK(batch != NULL);
+  LogStore::Entry entry;
+  entry.level = log_message.level;
+  entry.process_id = log_message.process_id;
+  entry.thread_id = log_message.thread_id;
+  entry.time_stamp = log_message.time;
+
+  // Extract the file/line/message from the log string, which is of
   // format "[<stuff>:<file>(<line>)] <message><ws>".
-  if (!kFileRe.FullMatch(
-      pcrecpp::StringPiece(log_message.message, log_message.message_len),
-                           &msg.file, &msg.line, &msg.message)) {
+  base::StringPiece file;
+  base::StringPiece message;
+  if (!ScanLogPrefix(
+          base::StringPiece(log_message.message, log_message.message_len),
+          &file, &entry.line, &message)) {
     // As fallback, just slurp the entire string.
-    msg.message.assign(log_message.message, log_message.message_len);
+    message.set(log_message.message, log_message.message_len);
   }
 
   // If the message carried file information, use that
   // in preference to the above.
   if (log_message.file_len != 0) {
-    msg.file.assign(log_message.file, log_message.file_len);
-    msg.line = log_message.line;
+    file.set(log_message.file, log_message.file_len);
+    entry.line = log_message.line;
   }
 
+  entry.file_len = file.size();
+  entry.file = batch->arena.CopyString(file.data(), file.size());
+  entry.message_len = message.size();
+  entry.message = batch->arena.CopyString(message.data(), message.size());
+
   if (log_message.trace_depth > 0) {
-    msg.trace.insert(msg.trace.begin(),
-                     &log_message.traces[0],
-                     &log_message.traces[log_message.trace_depth - 1]);
+    entry.trace_depth = log_message.trace_depth - 1;
+    entry.trace = static_cast<void* const*>(
+        batch->arena.Copy(log_message.traces,
+                          entry.trace_depth * sizeof(log_message.traces[0]),
+                          sizeof(log_message.traces[0])));
   }
 
-  base::AutoLock lock(list_lock_);
-  log_messages_.push_back(msg);
+  batch->entries.push_back(entry);
+}
+
+void ViewerWindow::DeliverBatch(PendingBatch* batch) {
+  DCHECK(batch != NULL);
+
+  if (base::MessageLoop::current() == ui_loop_) {
+    // Preserve the order of anything published before.
+    DrainPendingBatches();
+    AppendBatch(batch);
+  } else {
+    batch->publish_time = base::TimeTicks::Now();
+    PublishBatch(batch);
+  }
 
   ScheduleNewItemsNotification();
 }
 
+void ViewerWindow::PublishBatch(PendingBatch* batch) {
+  DCHECK(batch != NULL);
+  ++delivery_stats_.batches_published;
+
+  // Once a batch overflows, the following ones must overflow too, until
+  // the UI thread catches up, so as to stay in order.
+  if (base::subtle::NoBarrier_Load(&overflow_pending_) == 0 &&
+      pending_batches_.TryPush(batch)) {
+    return;
+  }
+
+  ++delivery_stats_.overflows;
+  base::AutoLock lock(overflow_lock_);
+  overflow_batches_.push_back(batch);
+  base::subtle::Release_Store(&overflow_pending_, 1);
+}
+
+void ViewerWindow::DrainPendingBatches() {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+
+  delivery_stats_.max_batches_pending =
+      std::max(delivery_stats_.max_batches_pending, pending_batches_.size());
+
+  PendingBatch* batch = NULL;
+  while (pending_batches_.TryPop(&batch))
+    AppendBatch(batch);
+
+  if (base::subtle::Acquire_Load(&overflow_pending_) == 0)
+    return;
+
+  // The producer doesn't push to the ring while overflow_pending_ is set,
+  // so anything in the ring at this point precedes the overflow batches.
+  base::AutoLock lock(overflow_lock_);
+  while (pending_batches_.TryPop(&batch))
+    AppendBatch(batch);
+  for (size_t i = 0; i < overflow_batches_.size(); ++i)
+    AppendBatch(overflow_batches_[i]);
+  overflow_batches_.clear();
+  base::subtle::Release_Store(&overflow_pending_, 0);
+}
+
+void ViewerWindow::AppendBatch(PendingBatch* batch) {
+  DCHECK(batch != NULL);
+
+  if (!batch->publish_time.is_null()) {
+    base::TimeDelta latency = base::TimeTicks::Now() - batch->publish_time;
+    ++delivery_stats_.batches_drained;
+    delivery_stats_.messages_drained += batch->entries.size();
+    delivery_stats_.total_latency += latency;
+    delivery_stats_.max_latency =
+        std::max(delivery_stats_.max_latency, latency);
+  }
+
+  for (size_t i = 0; i < batch->entries.size(); ++i)
+    log_store_.Append(batch->entries[i]);
+
+  delete batch;
+}
+
+void ViewerWindow::LogDeliveryStats() {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+
+  const DeliveryStats& stats = delivery_stats_;
+  base::TimeDelta mean_latency;
+  if (stats.batches_drained != 0)
+    mean_latency =
+        stats.total_latency / static_cast<int64>(stats.batches_drained);
+
+  LOG(INFO) << "Delivered " << stats.messages_drained << " messages in "
+            << stats.batches_drained << " of " << stats.batches_published
+            << " batches, " << stats.overflows << " overflowed, at most "
+            << stats.max_batches_pending << " pending. Latency mean "
+            << mean_latency.InMicroseconds() << " us, max "
+            << stats.max_latency.InMicroseconds() << " us.";
+
+  delivery_stats_ = DeliveryStats();
+}
+
 void ViewerWindow::OnStatusUpdate(const wchar_t* status) {
   base::AutoLock lock(status_lock_);
   if (status_.find_first_of(L"\r\n") == std::wstring::npos) {
@@ -479,65 +700,121 @@ void ViewerWindow::UpdateStatus() {
   UISetText(0, status.c_str());
 }
 
+void ViewerWindow::UpdateStorageStatus() {
+  DCHECK_EQ(base::MessageLoop::current(), ui_loop_);
+
+  // Saved sessions are mapped rather than compressed.
+  std::wstring status;
+  if (session_.get() == NULL && log_store_.compressed_text_bytes() != 0) {
+    const double kMegabyte = 1024 * 1024;
+    double ratio = static_cast<double>(log_store_.sealed_text_bytes()) /
+        log_store_.compressed_text_bytes();
+    uint64 reads = log_store_.cache_hits() + log_store_.cache_misses();
+    int hit_rate = reads == 0 ? 0 :
+        static_cast<int>(100 * log_store_.cache_hits() / reads);
+    status = base::StringPrintf(
+        L"Text compressed %.1f:1, %.1f MB cached, %d%% hits",
+        ratio, log_store_.cache_bytes() / kMegabyte, hit_rate);
+  }
+
+  if (status != storage_status_) {
+    storage_status_ = status;
+    UISetText(1, storage_status_.c_str());
+  }
+}
+
 void ViewerWindow::OnTraceEventBegin(
     const TraceEvents::TraceMessage& trace_message) {
-  AddTraceEventToLog("BEGIN", trace_message);
+  TraceEvents::TraceEvent trace_event;
+  trace_event.type = TraceEvents::TRACE_EVENT_TYPE_BEGIN;
+  trace_event.message = trace_message;
+  OnTraceEvents(&trace_event, 1);
 }
 
 void ViewerWindow::OnTraceEventEnd(
     const TraceEvents::TraceMessage& trace_message) {
-  AddTraceEventToLog("END", trace_message);
+  TraceEvents::TraceEvent trace_event;
+  trace_event.type = TraceEvents::TRACE_EVENT_TYPE_END;
+  trace_event.message = trace_message;
+  OnTraceEvents(&trace_event, 1);
 }
 
 void ViewerWindow::OnTraceEventInstant(
     const TraceEvents::TraceMessage& trace_message) {
-  AddTraceEventToLog("INSTANT", trace_message);
+  TraceEvents::TraceEvent trace_event;
+  trace_event.type = TraceEvents::TRACE_EVENT_TYPE_INSTANT;
+  trace_event.message = trace_message;
+  OnTraceEvents(&trace_event, 1);
 }
 
-void ViewerWindow::AddTraceEventToLog(const char* type,
-    const TraceEvents::TraceMessage& trace_message) {
-  ViewerWindow::LogMessage msg;
-  msg.level = trace_message.level;
-  msg.process_id = trace_message.process_id;
-  msg.thread_id = trace_message.thread_id;
-  msg.time_stamp = trace_message.time;
+void ViewerWindow::OnTraceEvents(const TraceEvents::TraceEvent* trace_events,
+                                 size_t num_events) {
+  if (num_events == 0)
+    return;
 
-  // The message will be of form "{BEGIN|END|INSTANT}(<name>, 0x<id>): <extra>"
-  msg.message = base::StringPrintf("%s(%*s, 0x%08X): %*s",
-                                   type,
-                                   trace_message.name_len,
-                                   trace_message.name,
-                                   trace_message.id,
-                                   trace_message.extra_len,
-                                   trace_message.extra);
+  PendingBatch* batch = new PendingBatch;
+  batch->entries.reserve(num_events);
+  for (size_t i = 0; i < num_events; ++i)
+    AddTraceEvent(trace_events[i], batch);
 
-  for (size_t i = 0; i < trace_message.trace_depth; ++i)
-    msg.trace.push_back(trace_message.traces[i]);
+  DeliverBatch(batch);
+}
 
-  base::AutoLock lock(list_lock_);
-  log_messages_.push_back(msg);
+// static
+void ViewerWindow::AddTraceEvent(const TraceEvents::TraceEvent& trace_event,
+                                 PendingBatch* batch) {
+  DCHECK(batch != NULL);
+  const TraceEvents::TraceMessage& trace_message = trace_event.message;
+  LogStore::Entry entry;
+  entry.level = trace_message.level;
+  entry.process_id = trace_message.process_id;
+  entry.thread_id = trace_message.thread_id;
+  entry.time_stamp = trace_message.time;
+
+  const char* type = "INSTANT";
+  if (trace_event.type == TraceEvents::TRACE_EVENT_TYPE_BEGIN)
+    type = "BEGIN";
+  else if (trace_event.type == TraceEvents::TRACE_EVENT_TYPE_END)
+    type = "END";
 
-  ScheduleNewItemsNotification();
+  // The message will be of form "{BEGIN|END|INSTANT}(<name>, 0x<id>): <extra>"
+  std::string message = base::StringPrintf("%s(%*s, 0x%08X): %*s",
+                                           type,
+                                           trace_message.name_len,
+                                           trace_message.name,
+                                           trace_message.id,
+                                           trace_message.extra_len,
+                                           trace_message.extra);
+  entry.message_len = message.length();
+  entry.message = batch->arena.CopyString(message.data(), message.length());
+
+  entry.trace_depth = trace_message.trace_depth;
+  entry.trace = static_cast<void* const*>(
+      batch->arena.Copy(trace_message.traces,
+                        entry.trace_depth * sizeof(trace_message.traces[0]),
+                        sizeof(trace_message.traces[0])));
+
+  batch->entries.push_back(entry);
 }
 
 void ViewerWindow::ScheduleNewItemsNotification() {
-  // The list lock must be held.
-  list_lock_.AssertAcquired();
-
-  if (!notify_log_view_new_items_pending_) {
-    notify_log_view_new_items_pending_ = true;
+  // Only the first caller to set the flag posts the task.
+  if (base::subtle::NoBarrier_CompareAndSwap(
+          &notify_log_view_new_items_pending_, 0, 1) == 0) {
     ui_loop_->PostTask(FROM_HERE, notify_log_view_new_items_.callback());
   }
 }
 
 void ViewerWindow::NotifyLogViewNewItems() {
   DCHECK_EQ(ui_loop_, base::MessageLoop::current());
-  {
-    base::AutoLock lock(list_lock_);
 
-    // Notification no longer pending.
-    notify_log_view_new_items_pending_ = false;
-  }
+  // Notification no longer pending. This is cleared before draining, so
+  // that batches published from here on schedule a new notification.
+  base::subtle::Release_Store(&notify_log_view_new_items_pending_, 0);
+  base::subtle::MemoryBarrier();
+  DrainPendingBatches();
+  ApplyRetention();
+  message_index_->Update();
 
   EventSinkMap::iterator it(event_sinks_.begin());
   for (; it != event_sinks_.end(); ++it) {
@@ -553,6 +830,41 @@ void ViewerWindow::NotifyLogViewCleared() {
   }
 }
 
+void ViewerWindow::NotifyLogViewRowsRemoved(int num_rows) {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  EventSinkMap::iterator it(event_sinks_.begin());
+  for (; it != event_sinks_.end(); ++it) {
+    it->second->LogViewRowsRemoved(num_rows);
+  }
+}
+
+void ViewerWindow::ApplyRetention() {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (session_.get() != NULL || (retain_rows_ == 0 && retain_bytes_ == 0))
+    return;
+
+  // Rows go a whole index chunk at a time, so that the indexes shift
+  // cheaply, and the newest chunk always stays.
+  const size_t kChunkRows = RowBitmap::kChunkSize;
+  size_t removed = 0;
+  while (log_store_.size() > kChunkRows) {
+    bool over_rows = retain_rows_ != 0 &&
+        log_store_.size() - kChunkRows >= retain_rows_;
+    bool over_bytes = retain_bytes_ != 0 &&
+        log_store_.stored_bytes() > retain_bytes_;
+    if (!over_rows && !over_bytes)
+      break;
+
+    log_store_.RemoveFront(kChunkRows);
+    removed += kChunkRows;
+  }
+
+  if (removed != 0) {
+    message_index_->RemoveFront(static_cast<int>(removed));
+    NotifyLogViewRowsRemoved(static_cast<int>(removed));
+  }
+}
+
 LRESULT ViewerWindow::OnConfigureProviders(WORD code,
                                            LPARAM lparam,
                                            HWND wnd,
@@ -584,6 +896,17 @@ LRESULT ViewerWindow::OnToggleCapture(WORD code,
   return 0;
 }
 
+LRESULT ViewerWindow::OnToggleMessageIndex(WORD code,
+                                           LPARAM lparam,
+                                           HWND wnd,
+                                           BOOL& handled) {
+  bool enabled = !message_index_->enabled();
+  message_index_->SetEnabled(enabled);
+  UISetCheck(ID_LOG_INDEX_MESSAGES, enabled);
+
+  return 0;
+}
+
 namespace {
 
 class SymbolPathDialog: public CDialogImpl<SymbolPathDialog> {
@@ -644,6 +967,11 @@ LRESULT ViewerWindow::OnSymbolPath(WORD code,
 }
 
 BOOL ViewerWindow::OnIdle() {
+  // No views of our log are held between messages, so this is the time to
+  // trim the cache of message text.
+  ReleaseViews();
+  UpdateStorageStatus();
+
   UIUpdateMenuBar();
   UIUpdateStatusBar();
 
@@ -660,6 +988,7 @@ int ViewerWindow::OnCreate(LPCREATESTRUCT lpCreateStruct) {
 
   // Import is enabled, except when capturing.
   UIEnable(ID_FILE_IMPORT, true);
+  UIEnable(ID_FILE_SAVE_SESSION, true);
 
   // Edit menu is disabled by default.
   UIEnable(ID_EDIT_CUT, false);
@@ -672,6 +1001,9 @@ int ViewerWindow::OnCreate(LPCREATESTRUCT lpCreateStruct) {
   UIEnable(ID_EDIT_FIND_NEXT, false);
 
   CreateSimpleStatusBar();
+  status_bar_.SubclassWindow(m_hWndStatusBar);
+  int panes[] = { ID_DEFAULT_PANE, IDS_STORAGE_PANE };
+  status_bar_.SetPanes(panes, arraysize(panes), false);
   UIAddStatusBar(m_hWndStatusBar);
 
   // Set the main window title.
@@ -738,56 +1070,161 @@ void ViewerWindow::OnDestroy() {
 }
 
 int ViewerWindow::GetNumRows() {
-  base::AutoLock lock(list_lock_);
-  return log_messages_.size();
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (session_.get() != NULL)
+    return session_->GetNumRows();
+  return log_store_.size();
 }
 
 void ViewerWindow::ClearAll() {
-  {
-    base::AutoLock lock(list_lock_);
-    log_messages_.clear();
-  }
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  message_index_->Clear();
+  session_.reset();
+  log_store_.Clear();
+  UIEnable(ID_FILE_SAVE_SESSION, true);
   NotifyLogViewCleared();
 }
 
 int ViewerWindow::GetSeverity(int row) {
-  base::AutoLock lock(list_lock_);
-  return log_messages_[row].level;
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (session_.get() != NULL)
+    return session_->GetSeverity(row);
+  return log_store_.row(row).level;
 }
 
 DWORD ViewerWindow::GetProcessId(int row) {
-  base::AutoLock lock(list_lock_);
-  return log_messages_[row].process_id;
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (session_.get() != NULL)
+    return session_->GetProcessId(row);
+  return log_store_.row(row).process_id;
 }
 
 DWORD ViewerWindow::GetThreadId(int row) {
-  base::AutoLock lock(list_lock_);
-  return log_messages_[row].thread_id;
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (session_.get() != NULL)
+    return session_->GetThreadId(row);
+  return log_store_.row(row).thread_id;
 }
 
 base::Time ViewerWindow::GetTime(int row) {
-  base::AutoLock lock(list_lock_);
-  return log_messages_[row].time_stamp;
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (session_.get() != NULL)
+    return session_->GetTime(row);
+  return log_store_.row(row).time_stamp;
 }
 
 std::string ViewerWindow::GetFileName(int row) {
-  base::AutoLock lock(list_lock_);
-  return log_messages_[row].file;
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  return GetFileNameView(row).as_string();
 }
 
 int ViewerWindow::GetLine(int row) {
-  base::AutoLock lock(list_lock_);
-  return log_messages_[row].line;
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (session_.get() != NULL)
+    return session_->GetLine(row);
+  return log_store_.row(row).line;
 }
 
 std::string ViewerWindow::GetMessage(int row) {
-  base::AutoLock lock(list_lock_);
-  return log_messages_[row].message;
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  return GetMessageView(row).as_string();
 }
 
 void ViewerWindow::GetStackTrace(int row, std::vector<void*>* trace) {
-  base::AutoLock lock(list_lock_);
-  *trace = log_messages_[row].trace;
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (session_.get() != NULL) {
+    session_->GetStackTrace(row, trace);
+    return;
+  }
+
+  const LogStore::Row& entry = log_store_.row(row);
+  void* const* frames = log_store_.trace(entry);
+  trace->assign(frames, frames + log_store_.trace_depth(entry));
+}
+
+base::StringPiece ViewerWindow::GetFileNameView(int row) {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (session_.get() != NULL)
+    return session_->GetFileNameView(row);
+  return log_store_.file_name(log_store_.row(row));
+}
+
+base::StringPiece ViewerWindow::GetMessageView(int row) {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (session_.get() != NULL)
+    return session_->GetMessageView(row);
+  return log_store_.message(row);
+}
+
+void ViewerWindow::GetStackTraceView(int row,
+                                     void* const** trace,
+                                     size_t* depth) {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  DCHECK(trace != NULL && depth != NULL);
+  if (session_.get() != NULL) {
+    session_->GetStackTraceView(row, trace, depth);
+    return;
+  }
+
+  const LogStore::Row& entry = log_store_.row(row);
+  *trace = log_store_.trace(entry);
+  *depth = log_store_.trace_depth(entry);
+}
+
+void ViewerWindow::GetColumns(int first_row,
+                              int num_rows,
+                              uint32 columns,
+                              LogColumnBatch* batch) {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  DCHECK(first_row >= 0 && first_row + num_rows <= GetNumRows());
+  DCHECK(batch != NULL);
+  if (session_.get() != NULL) {
+    session_->GetColumns(first_row, num_rows, columns, batch);
+    return;
+  }
+
+  batch->Clear();
+  for (int i = first_row; i < first_row + num_rows; ++i) {
+    const LogStore::Row& entry = log_store_.row(i);
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::SEVERITY))
+      batch->severities.push_back(entry.level);
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::PROCESS_ID))
+      batch->process_ids.push_back(entry.process_id);
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::THREAD_ID))
+      batch->thread_ids.push_back(entry.thread_id);
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::TIME))
+      batch->times.push_back(entry.time_stamp);
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::FILE))
+      batch->file_names.push_back(log_store_.file_name(entry));
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::LINE))
+      batch->lines.push_back(entry.line);
+    if (columns & LogColumnBatch::Bit(LogViewFormatter::MESSAGE))
+      batch->messages.push_back(log_store_.message(i));
+  }
+}
+
+const LogIndex* ViewerWindow::GetIndex() {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (session_.get() != NULL)
+    return session_->GetIndex();
+
+  return &log_store_.index();
+}
+
+bool ViewerWindow::GetMessageCandidates(const std::string& pattern,
+                                        bool caseless,
+                                        RowBitmap* rows,
+                                        int* num_rows) {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  return message_index_->GetCandidates(pattern, caseless, rows, num_rows);
+}
+
+void ViewerWindow::ReleaseViews() {
+  DCHECK_EQ(ui_loop_, base::MessageLoop::current());
+  if (session_.get() != NULL)
+    session_->ReleaseViews();
+  else
+    log_store_.TrimCache();
 }
 
 void ViewerWindow::Register(ILogViewEvents* event_sink,
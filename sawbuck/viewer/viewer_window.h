@@ -20,6 +20,7 @@
 #include <atlcrack.h>
 #include <atlapp.h>
 #include <atlctrls.h>
+#include <atlctrlx.h>
 #include <atldlgs.h>
 #include <atlframe.h>
 #include <atlmisc.h>
@@ -27,18 +28,26 @@
 #include <map>
 #include <string>
 #include <vector>
+#include "base/atomicops.h"
 #include "base/cancelable_callback.h"
 #include "base/files/file_path.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/synchronization/lock.h"
 #include "base/threading/thread.h"
+#include "base/time/time.h"
 #include "base/win/event_trace_controller.h"
+#include "sawbuck/common/arena.h"
+#include "sawbuck/common/spsc_ring.h"
 #include "sawbuck/log_lib/kernel_log_consumer.h"
 #include "sawbuck/log_lib/log_consumer.h"
 #include "sawbuck/log_lib/process_info_service.h"
 #include "sawbuck/log_lib/symbol_lookup_service.h"
+#include "sawbuck/viewer/log_store.h"
 #include "sawbuck/viewer/log_viewer.h"
+#include "sawbuck/viewer/message_index.h"
+#include "sawbuck/viewer/paged_log_view.h"
 #include "sawbuck/viewer/provider_configuration.h"
+#include "sawbuck/viewer/sawlog_log_view.h"
 #include "sawbuck/viewer/resource.h"
 
 
@@ -46,7 +55,7 @@ class ViewerWindow
     : public CFrameWindowImpl<ViewerWindow>,
       public LogEvents,
       public TraceEvents,
-      public ILogView,
+      public ILogViewV2,
       public CIdleHandler,
       public CMessageFilter,
       public CUpdateUI<ViewerWindow> {
@@ -58,10 +67,12 @@ class ViewerWindow
     MSG_WM_CREATE(OnCreate)
     MSG_WM_DESTROY(OnDestroy)
     COMMAND_ID_HANDLER(ID_FILE_IMPORT, OnImport)
+    COMMAND_ID_HANDLER(ID_FILE_SAVE_SESSION, OnSaveSession)
     COMMAND_ID_HANDLER(ID_FILE_EXIT, OnExit)
     COMMAND_ID_HANDLER(ID_APP_ABOUT, OnAbout)
     COMMAND_ID_HANDLER(ID_LOG_CONFIGUREPROVIDERS, OnConfigureProviders)
     COMMAND_ID_HANDLER(ID_LOG_CAPTURE, OnToggleCapture)
+    COMMAND_ID_HANDLER(ID_LOG_INDEX_MESSAGES, OnToggleMessageIndex)
     COMMAND_ID_HANDLER(ID_LOG_SYMBOLPATH, OnSymbolPath)
     // Forward other commands to the client window.
     CHAIN_CLIENT_COMMANDS()
@@ -71,7 +82,9 @@ class ViewerWindow
 
   BEGIN_UPDATE_UI_MAP(ViewerWindow)
     UPDATE_ELEMENT(ID_FILE_IMPORT, UPDUI_MENUBAR)
+    UPDATE_ELEMENT(ID_FILE_SAVE_SESSION, UPDUI_MENUBAR)
     UPDATE_ELEMENT(ID_LOG_CAPTURE, UPDUI_MENUBAR)
+    UPDATE_ELEMENT(ID_LOG_INDEX_MESSAGES, UPDUI_MENUBAR)
     UPDATE_ELEMENT(ID_LOG_FILTER, UPDUI_MENUBAR)
     UPDATE_ELEMENT(ID_EDIT_AUTOSIZE_COLUMNS, UPDUI_MENUBAR)
     UPDATE_ELEMENT(ID_EDIT_CUT, UPDUI_MENUBAR)
@@ -83,6 +96,7 @@ class ViewerWindow
     UPDATE_ELEMENT(ID_EDIT_FIND, UPDUI_MENUBAR)
     UPDATE_ELEMENT(ID_EDIT_FIND_NEXT, UPDUI_MENUBAR)
     UPDATE_ELEMENT(0, UPDUI_STATUSBAR)
+    UPDATE_ELEMENT(1, UPDUI_STATUSBAR)
   END_UPDATE_UI_MAP()
 
   ViewerWindow();
@@ -104,19 +118,38 @@ class ViewerWindow
                         int* registration_cookie);
   virtual void Unregister(int registration_cookie);
 
+  // ILogViewV2 implementation
+  virtual base::StringPiece GetFileNameView(int row);
+  virtual base::StringPiece GetMessageView(int row);
+  virtual void GetStackTraceView(int row, void* const** trace, size_t* depth);
+  virtual void GetColumns(int first_row,
+                          int num_rows,
+                          uint32 columns,
+                          LogColumnBatch* batch);
+  virtual const LogIndex* GetIndex();
+  virtual bool GetMessageCandidates(const std::string& pattern,
+                                    bool caseless,
+                                    RowBitmap* rows,
+                                    int* num_rows);
+  virtual void ReleaseViews();
+
   // Turn capturing on or off.
   virtual void SetCapture(bool capture);
 
-  // Consumes the logs in paths.
+  // Consumes the logs in paths. A saved session is opened instead, and
+  // must be the only path.
   void ImportLogFiles(const std::vector<base::FilePath>& paths);
 
  private:
   LRESULT OnImport(WORD code, LPARAM lparam, HWND wnd, BOOL& handled);
+  LRESULT OnSaveSession(WORD code, LPARAM lparam, HWND wnd, BOOL& handled);
   LRESULT OnExit(WORD code, LPARAM lparam, HWND wnd, BOOL& handled);
   LRESULT OnAbout(WORD code, LPARAM lparam, HWND wnd, BOOL& handled);
   LRESULT OnConfigureProviders(WORD code, LPARAM lparam, HWND wnd,
       BOOL& handled);
   LRESULT OnToggleCapture(WORD code, LPARAM lparam, HWND wnd, BOOL& handled);
+  LRESULT OnToggleMessageIndex(WORD code, LPARAM lparam, HWND wnd,
+      BOOL& handled);
   LRESULT OnSymbolPath(WORD code, LPARAM lparam, HWND wnd, BOOL& handled);
 
   virtual BOOL OnIdle();
@@ -134,29 +167,38 @@ class ViewerWindow
   // Initializes the symbol path.
   void InitSymbolPath();
 
+  // Replaces our log with the saved session at @p path.
+  void OpenSession(const base::FilePath& path);
+
   // Called on UI thread to dispatch notifications to listeners.
   void NotifyLogViewNewItems();
   void NotifyLogViewCleared();
+  void NotifyLogViewRowsRemoved(int num_rows);
+
+  // Drops the oldest rows of our log while it's past either retention
+  // bound. Must be called on the UI thread.
+  void ApplyRetention();
 
   // LogEvents implementation.
   void OnLogMessage(const LogEvents::LogMessage& log_message);
+  void OnLogMessages(const LogEvents::LogMessage* log_messages,
+                     size_t num_messages);
 
   // Invoked on the background thread by the symbol service.
   void OnStatusUpdate(const wchar_t* status);
   // Invoked on the UI thread to update our status.
   void UpdateStatus();
+  // Shows the compression and cache statistics of our log.
+  void UpdateStorageStatus();
 
   // TraceEvents implementation.
   void OnTraceEventBegin(const TraceEvents::TraceMessage& trace_message);
   void OnTraceEventEnd(const TraceEvents::TraceMessage& trace_message);
   void OnTraceEventInstant(const TraceEvents::TraceMessage& trace_message);
-
-  // Adds a trace event to the log.
-  void AddTraceEventToLog(const char* type,
-                          const TraceEvents::TraceMessage& trace_message);
+  void OnTraceEvents(const TraceEvents::TraceEvent* trace_events,
+                     size_t num_events);
 
   // Schedule a notification of new items on UI thread.
-  // Must be called under list_lock_.
   void ScheduleNewItemsNotification();
 
   void EnableProviders(const ProviderConfiguration& settings);
@@ -164,32 +206,105 @@ class ViewerWindow
   // The currently configured symbol path.
   std::wstring symbol_path_;
 
-  struct LogMessage {
-    LogMessage() : level(0), process_id(0), thread_id(0), line(0) {
-    }
-
-    UCHAR level;
-    DWORD process_id;
-    DWORD thread_id;
-    base::Time time_stamp;
-    std::string file;
-    int line;
-    std::string message;
-    std::vector<void*> trace;
+  // A batch of messages on its way to our log.
+  struct PendingBatch {
+    PendingBatch();
+
+    std::vector<LogStore::Entry> entries;
+    // Backs the strings and traces of entries.
+    Arena arena;
+    base::TimeTicks publish_time;
   };
 
+  // Converts @p log_message to a row in @p batch.
+  static void AddLogMessage(const LogEvents::LogMessage& log_message,
+                            PendingBatch* batch);
+
+  // Converts @p trace_event to a row in @p batch.
+  static void AddTraceEvent(const TraceEvents::TraceEvent& trace_event,
+                            PendingBatch* batch);
+
+  // Moves @p batch to the end of our log, and schedules a single
+  // notification for all of its messages. Takes ownership of @p batch.
+  // On the UI thread, the messages are appended directly. Elsewhere the
+  // batch is published to the UI thread.
+  void DeliverBatch(PendingBatch* batch);
+
+  // Publishes @p batch to the UI thread, which takes ownership.
+  void PublishBatch(PendingBatch* batch);
+
+  // Moves all published batches to the end of our log.
+  // Must be called on the UI thread.
+  void DrainPendingBatches();
+
+  // Moves the messages of @p batch to the end of our log, and deletes it.
+  void AppendBatch(PendingBatch* batch);
+
+  // Logs and resets delivery_stats_. Must be called on the UI thread,
+  // while there's no producer.
+  void LogDeliveryStats();
+
   // We dedicate a thread to the symbol lookup work.
   base::Thread symbol_lookup_worker_;
 
-  base::Lock list_lock_;
-  typedef std::vector<LogMessage> LogMessageList;
-  LogMessageList log_messages_;  // Under list_lock_.
+  // The log messages. These are appended to and read on the UI thread
+  // only, so the ILogView accessors need no locking.
+  LogStore log_store_;
+
+  // The bounds on the rows and bytes of our log, or zero for none.
+  size_t retain_rows_;
+  uint64 retain_bytes_;
+
+  // The saved session being viewed, if any. While it's open, our log is
+  // empty and the ILogView accessors read from the session instead.
+  scoped_ptr<ILogViewV2> session_;
+
+  // We dedicate a thread to indexing messages.
+  base::Thread message_index_worker_;
+
+  // Indexes the messages of our log or session, when enabled.
+  scoped_ptr<MessageIndex> message_index_;
+
+  // Our status bar, whose second pane shows storage_status_.
+  CMultiPaneStatusBarCtrl status_bar_;
+  std::wstring storage_status_;
+
+  // Batches published by the log consumer thread. This is the only
+  // producer, so the ring needs no locking.
+  SpscRing<PendingBatch*> pending_batches_;
+
+  // Batches published while pending_batches_ is full, which happens only
+  // when the UI thread falls behind. Once this is non-empty, further
+  // batches go here too, until the UI thread drains it.
+  base::Lock overflow_lock_;
+  std::vector<PendingBatch*> overflow_batches_;  // Under overflow_lock_.
+  // Non-zero while overflow_batches_ may be non-empty.
+  base::subtle::Atomic32 overflow_pending_;
+
+  // Statistics on the delivery of messages to the UI thread, logged and
+  // reset when capture stops.
+  struct DeliveryStats {
+    DeliveryStats();
+
+    // Updated by the producer.
+    size_t batches_published;
+    size_t overflows;
+
+    // Updated on the UI thread.
+    size_t batches_drained;
+    size_t messages_drained;
+    size_t max_batches_pending;
+    base::TimeDelta total_latency;
+    base::TimeDelta max_latency;
+  };
+  DeliveryStats delivery_stats_;
 
   typedef base::CancelableCallback<void()> NotifyNewItemsCallback;
 
   // Keeps the task pending to notify event sinks on the UI thread.
   NotifyNewItemsCallback notify_log_view_new_items_;
-  bool notify_log_view_new_items_pending_;  // Under list_lock_.
+  // Non-zero while the notification task is pending.
+  base::subtle::Atomic32 notify_log_view_new_items_pending_;
 
   // The message loop we're instantiated on, used to signal
   // back to the main thread from workers.
@@ -213,7 +328,7 @@ class ViewerWindow
   // Takes care of sinking KernelProcessEvents for us.
   ProcessInfoService process_info_service_;
 
-  // The list view control that displays log_messages_.
+  // The list view control that displays log_store_.
   LogViewer log_viewer_;
 
   // Controller for the logging session.
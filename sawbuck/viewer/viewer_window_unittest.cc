@@ -13,14 +13,50 @@
 // limitations under the License.
 #include "sawbuck/viewer/viewer_window.h"
 
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/run_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/thread.h"
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 #include "sawbuck/viewer/mock_log_view_interfaces.h"
 
 namespace {
 
+using testing::AtLeast;
 using testing::StrictMock;
 
+// Issues @p num_messages log messages numbered from @p first to @p sink.
+void IssueLogMessages(LogEvents* sink, int first, int num_messages) {
+  for (int i = first; i < first + num_messages; ++i) {
+    std::string text = base::StringPrintf("Message %d", i);
+    LogEvents::LogMessage msg;
+    msg.level = TRACE_LEVEL_INFORMATION;
+    msg.time = base::Time::Now();
+    msg.message = text.c_str();
+    msg.message_len = text.length();
+    sink->OnLogMessages(&msg, 1);
+  }
+}
+
+// Saves a session of @p num_messages messages numbered from @p first to
+// @p path.
+bool SaveSession(const base::FilePath& path, int first, int num_messages) {
+  LogStore store;
+  for (int i = first; i < first + num_messages; ++i) {
+    std::string text = base::StringPrintf("Message %d", i);
+    LogStore::Entry entry;
+    entry.level = TRACE_LEVEL_INFORMATION;
+    entry.file = "";
+    entry.message = text.c_str();
+    entry.message_len = text.length();
+    store.Append(entry);
+  }
+  return SawlogWriter::Write(path, store);
+}
+
 class ViewerWindowTest : public testing::Test {
  protected:
   base::MessageLoop message_loop_;
@@ -52,4 +88,89 @@ TEST_F(ViewerWindowTest, ClearAll) {
   viewer_window.ClearAll();
 }
 
+TEST_F(ViewerWindowTest, DeliversMessagesFromOtherThreadInOrder) {
+  ViewerWindow viewer_window;
+
+  int reg_cookie = 0;
+  StrictMock<testing::MockILogViewEvents> mock_event_sink;
+  viewer_window.Register(&mock_event_sink, &reg_cookie);
+
+  // Messages issued on another thread are published to the UI thread,
+  // and show up only once it's had a chance to run.
+  const int kNumMessages = 5000;
+  base::Thread producer("Producer");
+  ASSERT_TRUE(producer.Start());
+  producer.message_loop()->PostTask(FROM_HERE,
+      base::Bind(&IssueLogMessages,
+                 static_cast<LogEvents*>(&viewer_window), 0, kNumMessages));
+  producer.Stop();
+  EXPECT_EQ(0, viewer_window.GetNumRows());
+
+  // Messages issued on the UI thread follow those published before.
+  IssueLogMessages(&viewer_window, kNumMessages, 1);
+
+  EXPECT_CALL(mock_event_sink, LogViewNewItems()).Times(AtLeast(1));
+  base::RunLoop().RunUntilIdle();
+
+  ASSERT_EQ(kNumMessages + 1, viewer_window.GetNumRows());
+  for (int i = 0; i < kNumMessages + 1; ++i)
+    ASSERT_EQ(base::StringPrintf("Message %d", i), viewer_window.GetMessage(i));
+
+  viewer_window.Unregister(reg_cookie);
+}
+
+TEST_F(ViewerWindowTest, ViewsReferToStoredMessages) {
+  ViewerWindow viewer_window;
+
+  const int kNumMessages = 10;
+  IssueLogMessages(&viewer_window, 0, kNumMessages);
+  base::RunLoop().RunUntilIdle();
+  ASSERT_EQ(kNumMessages, viewer_window.GetNumRows());
+
+  // The views refer to the same storage on each call.
+  base::StringPiece message = viewer_window.GetMessageView(3);
+  EXPECT_EQ("Message 3", message.as_string());
+  EXPECT_EQ(message.data(), viewer_window.GetMessageView(3).data());
+
+  LogColumnBatch batch;
+  viewer_window.GetColumns(2, 5,
+                           LogColumnBatch::Bit(LogViewFormatter::SEVERITY) |
+                               LogColumnBatch::Bit(LogViewFormatter::MESSAGE),
+                           &batch);
+  ASSERT_EQ(5U, batch.severities.size());
+  ASSERT_EQ(5U, batch.messages.size());
+  EXPECT_TRUE(batch.times.empty());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(TRACE_LEVEL_INFORMATION, batch.severities[i]);
+    EXPECT_EQ(viewer_window.GetMessageView(2 + i).data(),
+              batch.messages[i].data());
+  }
+}
+
+TEST_F(ViewerWindowTest, ReopensSessionAfterClearAll) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath path = temp_dir.path().Append(L"session.sawlog");
+
+  const int kNumMessages = 10;
+  ASSERT_TRUE(SaveSession(path, 0, kNumMessages));
+
+  ViewerWindow viewer_window;
+  std::vector<base::FilePath> paths(1, path);
+  viewer_window.ImportLogFiles(paths);
+  ASSERT_EQ(kNumMessages, viewer_window.GetNumRows());
+  EXPECT_EQ("Message 3", viewer_window.GetMessage(3));
+
+  // Clearing closes the session's file, so it can be replaced.
+  viewer_window.ClearAll();
+  EXPECT_EQ(0, viewer_window.GetNumRows());
+  ASSERT_TRUE(base::DeleteFile(path, false));
+  ASSERT_TRUE(SaveSession(path, 100, kNumMessages / 2));
+
+  viewer_window.ImportLogFiles(paths);
+  ASSERT_EQ(kNumMessages / 2, viewer_window.GetNumRows());
+  EXPECT_EQ("Message 100", viewer_window.GetMessage(0));
+  viewer_window.ClearAll();
+}
+
 }  // namespace